@@ -1,68 +1,177 @@
 #include <Arduino.h>
+#include <util/atomic.h>
+#include "src/communication/baud.hpp"
 #include "src/communication/comm.hpp"
+#include "src/communication/telemetry_rate.hpp"
+#include "src/benchmark.hpp"
+#include "src/calibration.hpp"
 #include "src/encoder.hpp"
+#include "src/motor.hpp"
 #include "src/mpu.hpp"
+#include "src/profiles.hpp"
+#include "src/profiler.hpp"
+#include "src/scheduler.hpp"
+#include "src/storage.hpp"
+#include "src/control/step.hpp"
 
 /* 
-TX_INTERFACE_UPDATE_INTERVAL_MS determines the frequency of appending data from the tx interface to the transmit buffer. This value can not be chosen arbitrarily, due to serial baud rate limitations.
+The telemetry interval determines the frequency of appending data from the tx interface to the transmit buffer. This value can not be chosen arbitrarily, due to serial baud rate limitations.
 According to this table (https://lucidar.me/en/serialib/most-used-baud-rates-table/) using a baud rate of 115200 serial data can be transmitted at a real byte rate of 86.806 µs per byte.
 Depending on the size of the outgoing message and the interval in which data messages are queued up in the buffer, this could overload the transmit buffer in which case data would be lost.
-The fastest interval that is theoretically save from causing data loss can be expressed as transmit_buffer_size * real_byte_rate which for example results in 88.89 ms for a buffer size of 1024 bytes and a baud rate of 115200 bauds per second. 
-So the transmit enqueue interval must not be faster than that. Additionally it should incorporate a margin for transmit buffer depletion delays that are caused by long running code.
-These exist since the buffer is only asynchronously emptied (that is in parallel to other executing code) in chunks of 64 bytes at maximum on the Arduino Mega.
-Consequently, if those 64 bytes are sent before more bytes are forwarded to the serial transmit hardware buffer, transmit delays occur.
+Telemetry is queued in a lane of its own (c.f. Communication::TxLane) though, so a telemetry packet that waits for too long is replaced by the newer one instead of blocking other packets.
+The lanes are forwarded to the 64 bytes serial transmit hardware buffer by a timed interrupt, which refills it before it runs dry, so long running code in loop() doesn't cause transmit delays and the link can be saturated.
+When ENABLE_BINARY_TELEMETRY is defined, a telemetry packet with all channels has a size of 10 (header) + 4 (schema hash) + 4 (channel flags) + BIN_SIZE_TX + 1 (event count) + 2 (CRC) = 128 bytes without events, which takes 128 * 86.806 µs ~= 11.1 ms to transmit at 115200 baud. Each event adds 3 bytes.
+The JSON encoding instead results in several hundred bytes per packet.
+When ENABLE_SAMPLE_TELEMETRY is defined, a batch of 8 samples additionally takes 10 (header) + 10 (batch header) + 8 * (2 + BIN_SIZE_SAMPLE) + 2 (CRC) = 150 bytes every 8 control cycles,
+which is about 3 kB/s at a control period of 6 ms, hence about a quarter of the available byte rate.
+Rather than from this worst case math, the interval is adapted by telemetry_rate to the bytes that are actually queued, so the link runs close to capacity whatever the subscription and the encoding.
+The GUI sets its limits by telemetry_limits and the device reports the interval in use as telemetry_interval_ms.
+The baud rate starts at BAUD_RATE_DEFAULT, to which the HC-06 bluetooth module has been increased permanently, and can be raised by the GUI at runtime (c.f. BaudRateSwitch).
 */
-#define TX_INTERFACE_UPDATE_INTERVAL_MS 100
 
-const double WHEEL_RAD_TO_MM = 130.0 / (2 * PI);
-const double WHEEL_MM_TO_RAD = 1 / WHEEL_RAD_TO_MM;
+/*
+PROFILE_INTERVAL_MS determines the frequency of sending profile packets if ENABLE_PROFILING is defined in profiler.hpp. A packet contains the statistics of the code sections measured since the previous one.
+Its size is 10 (header) + 4 (schema hash) + BIN_SIZE_PROFILE + 2 (CRC) = 156 bytes, so it takes only about 300 B/s.
+*/
+#define PROFILE_INTERVAL_MS 500
 
-Encoder wheel_angle_rad{ ENC_PIN_CHA, ENC_PIN_CHB, encoder_isr, enc_counter };
+Encoder wheel_angle_rad{ ENC_PIN_CHA, ENC_PIN_CHB, encoder_isr, enc_counter, enc_edge_us };
 MinSegMPU mpu;
+MPUCalibration calibration{ mpu };
+ParameterStorage parameter_storage;
+BaudRateSwitch baud_switch;
+TelemetryRate telemetry_rate{ BAUD_RATE_DEFAULT };
+ControlStep<ControlArithmetic> control;
+
+// Readings of all sensors in a control step, latched with the same timestamp
+struct SensorSnapshot {
+  uint32_t ts_us;
+  SensorReading wheel_angle_rad;
+  SensorReading tilt_angle_rad;
+  SensorReading tilt_vel_rad_s;
+
+  // Latches every sensor exactly once. The MPU measurements are computed from the samples of the last mpu.update().
+  static SensorSnapshot acquire(uint32_t ts_us) {
+    return SensorSnapshot{ ts_us, ::wheel_angle_rad.latch(ts_us), mpu.tilt_angle_fused_rad.latch(ts_us), mpu.tilt_vel_rad_s.latch(ts_us) };
+  }
+};
+
+// Hardware of the MinSeg board behind the control step, c.f. control/hal.hpp. The sensors are latched before, so their timing doesn't depend on the control step.
+struct TargetHal {
+  const SensorSnapshot &sensors;
+
+  ControlMeasurements measure() const {
+    return ControlMeasurements{ sensors.tilt_vel_rad_s.value, sensors.tilt_angle_rad.value, sensors.wheel_angle_rad.value };
+  }
+
+  ControlSetpoint setpoint() const {
+    return ControlSetpoint{ comm.rx_data.pos_setpoint_mm, comm.rx_data.control_state };
+  }
+
+  void actuate(int16_t motor_val) {
+    PROFILE_SCOPE(MOTOR);
+    write_motor(motor_val);
+  }
+};
+
+volatile bool reset_control = true;  // Set by loop() when the control is switched on and reset by the control step once it became aware of the state change
 
 void setup() {
-  Serial.begin(115200);  // Baud rate has been increased permanently on the HC-06 bluetooth module to allow for bigger messages
+  Serial.begin(BAUD_RATE_DEFAULT);
   while (!Serial) {};
+  setup_motor();  // Before the benchmark, which writes the motor output as well
+#ifdef ENABLE_BENCHMARK
+  run_benchmark();
+#endif
 
-  // Communication setup
-  comm.setup();
+  // Communication setup. The Bluetooth module is probed and reprogrammed before comm takes over the serial port.
+  const uint32_t baud_rate = baud_switch.setup();
+  telemetry_rate.set_baud_rate(baud_rate);
+  comm.tx_data.baud_rate = baud_rate;
+  comm.setup(baud_rate);
 
   // Sensor setup
   mpu.setup();
   wheel_angle_rad.setup();
+
+  // The parameters stored in EEPROM are used until others are received, so the control can start without waiting for the GUI to send them
+  parameter_storage.load(comm.rx_data);
+  comm.tx_data.parameters_crc = parameter_storage.crc();
+  comm.tx_data.parameter_profiles_crc = PARAMETER_PROFILES_CRC;
+
+  // Control setup. From here on the control step runs from the timer interrupt, so loop() is left with communication only.
+  control_scheduler.setup(control_step, comm.rx_data.parameters.variable.General.h_ms);
+  update_control_parameters();
+  control_scheduler.start();
 }
 
 void loop() {
+  PROFILE_SCOPE(LOOP);
   bool prev_control_state = comm.rx_data.control_state;
-  static bool reset_control = true;
 
   // Receive available data
-  switch (comm.async_receive()) {
+  Communication::ReceiveCode rx_code;
+  {
+    PROFILE_SCOPE(RECEIVE);
+    rx_code = comm.async_receive();
+  }
+  switch (rx_code) {
     case Communication::ReceiveCode::NO_DATA_AVAILABLE:
+    case Communication::ReceiveCode::PACKET_PARSING:
       break;
     case Communication::ReceiveCode::PACKET_RECEIVED:
-      comm.message_append(F("## Packet ["));
-      char msg_bytes_num[6];
-      itoa(comm.rx_packet_info.message_length, msg_bytes_num, 10);
-      comm.message_append(msg_bytes_num, sizeof(msg_bytes_num));
-      comm.message_enqueue_for_transmit(F(" Bytes] received!"));
+      if (comm.rx_packet_info.updated_members & ReceiveInterface::Member::PARAMETER_PROFILE) {  // A profile replaces the parameters, even those received in the same packet
+        if (load_parameter_profile(comm.rx_data.parameter_profile, comm.rx_data)) {
+          comm.rx_packet_info.updated_members |= ReceiveInterface::Member::PARAMETERS;
+          comm.event(Event::EVENT_PARAMETER_PROFILE_SELECTED, comm.rx_data.parameter_profile);
+        } else {
+          comm.event(Event::EVENT_UNKNOWN_PARAMETER_PROFILE, comm.rx_data.parameter_profile);
+        }
+      }
+      if (comm.rx_packet_info.updated_members & ReceiveInterface::Member::PARAMETERS) {  // Setpoint and state packets of the GUI don't require to recompile and store the parameters
+        update_control_parameters();
+        parameter_storage.store(comm.rx_data);
+        comm.tx_data.parameters_crc = parameter_storage.crc();
+      }
+      if ((comm.rx_packet_info.updated_members & ReceiveInterface::Member::BAUD_RATE) && comm.rx_data.baud_rate != 0 && comm.rx_data.baud_rate != baud_switch.baud_rate()) {
+        if (baud_switch.request(comm.rx_data.baud_rate)) comm.event(Event::EVENT_BAUD_RATE_SWITCH_PENDING, comm.rx_data.baud_rate / 100);
+        else comm.event(Event::EVENT_UNSUPPORTED_BAUD_RATE, comm.rx_data.baud_rate / 100);
+      }
+      comm.event(Event::EVENT_PACKET_RECEIVED, comm.rx_packet_info.message_length);
       break;
     case Communication::ReceiveCode::RX_IN_PROGRESS:
       static uint32_t last_rx_timestamp_us = 0;
       if (comm.rx_packet_info.timestamp_us > last_rx_timestamp_us) {  // Only send this message once per rx process
-        comm.message_append(F("Receiving Packet ["));
-        char msg_bytes_num[6];
-        itoa(comm.rx_packet_info.message_length, msg_bytes_num, 10);
-        comm.message_append(msg_bytes_num, sizeof(msg_bytes_num));
-        comm.message_enqueue_for_transmit(F(" Bytes] ..."));
+        comm.event(Event::EVENT_PACKET_RECEIVING, comm.rx_packet_info.message_length);
         last_rx_timestamp_us = comm.rx_packet_info.timestamp_us;
       }
       break;
     case Communication::ReceiveCode::MESSAGE_EXCEEDS_RX_BUFFER_SIZE:
-      comm.message_enqueue_for_transmit(F("Receive Error: MESSAGE_EXCEEDS_RX_BUFFER_SIZE"));
+      comm.event(Event::EVENT_MESSAGE_EXCEEDS_RX_BUFFER_SIZE);
+      count_receive_error();
+      break;
+    case Communication::ReceiveCode::UNKNOWN_PACKET_TYPE:
+      comm.event(Event::EVENT_UNKNOWN_PACKET_TYPE);
+      count_receive_error();
       break;
     case Communication::ReceiveCode::DESERIALIZATION_FAILED:
-      comm.message_enqueue_for_transmit(F("Receive Error: DESERIALIZATION_FAILED"));
+      comm.event(Event::EVENT_DESERIALIZATION_FAILED);
+      count_receive_error();
+      break;
+  }
+
+  switch (baud_switch.run()) {  // Suspends comm while the Bluetooth module is reprogrammed, the control continues meanwhile
+    case BaudRateSwitch::IDLE:
+    case BaudRateSwitch::SWITCHING:
+      break;
+    case BaudRateSwitch::SWITCHED:
+      telemetry_rate.set_baud_rate(baud_switch.baud_rate());
+      comm.tx_data.baud_rate = baud_switch.baud_rate();
+      comm.event(Event::EVENT_BAUD_RATE_SWITCHED, baud_switch.baud_rate() / 100);
+      break;
+    case BaudRateSwitch::FAILED:
+      telemetry_rate.set_baud_rate(baud_switch.baud_rate());
+      comm.event(Event::EVENT_BAUD_RATE_SWITCH_FAILED, baud_switch.baud_rate() / 100);
       break;
   }
 
@@ -71,90 +180,30 @@ void loop() {
     reset_control = true;  // This flag will be reset once the asynchronous control cycle became aware of the state change
   }
 
-  if (comm.rx_data.calibration) calibrate_mpu();
-
-  mpu.update();  // This has to be called as frequent as possible to keep up with the configured MPU FIFO buffer sample rate
-
-  static uint32_t control_cycle_start_us = micros();
-  if (millis() > control_cycle_start_us * 1e-3 + comm.rx_data.parameters.variable.General.h_ms) {
-    comm.tx_data.control.cycle_us = micros() - control_cycle_start_us;
-    control_cycle_start_us = micros();
-
-    // System states
-    static double x1 = 0, x2 = 0, x3 = 0, x4 = 0;          // Persistent state values that are calculated recursively by the observer's state equation
-    static double x_m1 = 0, x_m2 = 0, x_m3 = 0, x_m4 = 0;  // Persistent state values that are calculated recursively by the feedforward model's state equation
-    static double xi = 0;                                  // Persistent integral action state for position control
-    double x1_corr, x2_corr, x3_corr, x4_corr;             // State values that are corrected to contain the observer's direct term (using the most recent measurement y)
-
-    if (reset_control) {
-      wheel_angle_rad.reset();
-      xi = 0;
-      x_m1 = 0;
-      x_m2 = 0;
-      x_m3 = 0;
-      x_m4 = 0;
-
-      reset_control = false;
-    }
-
-    // Sensor readings
-    comm.tx_data.sensor.wheel.angle_rad = wheel_angle_rad();
-    comm.tx_data.sensor.wheel.angle_deriv_rad_s = wheel_angle_rad.derivative();
-    comm.tx_data.sensor.tilt.angle_rad = mpu.tilt_angle_from_acc_rad();
-    comm.tx_data.sensor.tilt.vel_rad_s = mpu.tilt_vel_rad_s();
-
-    // System output measurements
-    double &y1 = comm.tx_data.sensor.tilt.vel_rad_s;
-    double &y2 = comm.tx_data.sensor.tilt.angle_rad;
-    double &y3 = comm.tx_data.sensor.wheel.angle_rad;
-
-    // Correct state estimate
-    correct_state_estimation(x1_corr, x2_corr, x3_corr, x4_corr, x1, x2, x3, x4, y1, y2, y3);
-
-    // Estimated system state x_hat
-    comm.tx_data.observer.tilt.vel_rad_s = x1_corr;
-    comm.tx_data.observer.tilt.angle_rad = x2_corr;
-    comm.tx_data.observer.wheel.vel_rad_s = x3_corr;
-    comm.tx_data.observer.wheel.angle_rad = x4_corr;
-    comm.tx_data.observer.position.z_mm = -x4_corr * WHEEL_RAD_TO_MM;
-
-    // Feed Forward Model states
-    double x_m2_with_offset = x_m2 + comm.rx_data.parameters.variable.General.alpha_off;  // Account for the configured tilt angle offset
-    comm.tx_data.ff_model.tilt.vel_rad_s = x_m1;
-    comm.tx_data.ff_model.tilt.angle_rad = x_m2_with_offset;
-    comm.tx_data.ff_model.wheel.vel_rad_s = x_m3;
-    comm.tx_data.ff_model.wheel.angle_rad = x_m4;
-    comm.tx_data.ff_model.position.z_mm = -x_m4 * WHEEL_RAD_TO_MM;
-
-    double r = -comm.rx_data.pos_setpoint_mm * WHEEL_MM_TO_RAD;  // Wheel angle setpoint in rad
-    double u = 0, u_bal, u_pos, u_ff;
-    calculate_feedforward_control_signal(u_ff, x_m1, x_m2, x_m3, x_m4, r);
-    calculate_feedback_control_signal(u_bal, u_pos, x1_corr, x2_corr, x3_corr, x4_corr, xi, x_m1, x_m2_with_offset, x_m3, x_m4);
-    if (comm.rx_data.control_state) {
-      u = u_bal + u_pos + u_ff;
-    }
-    int16_t motor_val = write_motor_voltage(u, 9, 2);
-
-    comm.tx_data.control.signal.u = u;
-    comm.tx_data.control.signal.u_bal = u_bal;
-    comm.tx_data.control.signal.u_pos = u_pos;
-    comm.tx_data.control.signal.u_ff = u_ff;
-    comm.tx_data.control.motor = motor_val;
-
-    // Calculate (predict) next cycle values (k+1)
-    predict_state_estimation(x1, x2, x3, x4, u, y1, y2, y3);
-    predict_feedforward_model_state(x_m1, x_m2, x_m3, x_m4, u_ff);
-    predict_integral_action_state(xi, x4_corr, comm.rx_data.parameters.inferred.ff.Kc == (double)0 ? r : x_m4);  // If feedforward is defined (Kc != 0) use x_m4 as the setpoint instead
-
-    // Finish loop
-    Sensor::cycle_num++;
-  }
+  if (comm.rx_data.calibration && !calibration.running()) start_calibration();
+  if (calibration.running()) run_calibration();
+  if (parameter_storage.run()) comm.event(Event::EVENT_PARAMETERS_STORED, parameter_storage.crc());  // Writes the stored parameters to the EEPROM byte by byte
 
   // Move data to the transmit buffer
   static uint32_t last_tx_update_ms = 0;
-  if (millis() > last_tx_update_ms + TX_INTERFACE_UPDATE_INTERVAL_MS) {
+  if (millis() > last_tx_update_ms + telemetry_rate.interval_ms()) {
     last_tx_update_ms = millis();
-    switch (comm.enqueue_for_transmit(comm.tx_data.to_doc())) {
+
+    // Scheduling statistics of the control steps executed since the last update
+    ControlScheduler::PeriodStats period = control_scheduler.take_stats();
+    comm.tx_data.control.period.min_us = period.count > 0 ? period.min_us : 0;
+    comm.tx_data.control.period.max_us = period.max_us;
+    comm.tx_data.control.period.mean_us = period.count > 0 ? period.sum_us / period.count : 0;
+    comm.tx_data.control.overruns = period.overruns;
+
+    Communication::TransmitCode tx_code;
+    {
+      PROFILE_SCOPE(TELEMETRY);
+      tx_code = comm.enqueue_tx_data();
+    }
+    telemetry_rate.update(last_tx_update_ms, comm.tx_pending_bytes(), comm.take_tx_drain(), comm.rx_data.telemetry_limits.min_interval_ms, comm.rx_data.telemetry_limits.max_interval_ms);
+    comm.tx_data.telemetry_interval_ms = telemetry_rate.interval_ms();  // Sent with the next packet
+    switch (tx_code) {
       case Communication::TransmitCode::TX_SUCCESS:
         break;
       case Communication::TransmitCode::TX_DOC_OVERFLOW:
@@ -169,180 +218,147 @@ void loop() {
     }
   }
 
-  // Deplete transmit buffer procedurally without blocking
-  comm.async_transmit();
+#ifdef ENABLE_SAMPLE_TELEMETRY
+  {
+    PROFILE_SCOPE(SAMPLES);
+    comm.enqueue_samples();  // Samples that don't fit the transmit buffer are kept until the next loop
+  }
+#endif
+
+#ifdef ENABLE_PROFILING
+  static uint32_t last_profile_ms = 0;
+  if (millis() > last_profile_ms + PROFILE_INTERVAL_MS) {
+    last_profile_ms = millis();
+    uint8_t profile[BIN_SIZE_PROFILE];
+    comm.enqueue_for_transmit(Communication::PacketType::PROFILE_PACKET, INTERFACE_SCHEMA_HASH_PROFILE, profile, profiler.take_to_bin(profile));  // Dropped if it doesn't fit the transmit buffer
+  }
+#endif
+  // The transmit lanes are depleted by the serial buffer interrupt of comm, no matter how long loop() takes
 }
 
-void calibrate_mpu() {
-  comm.tx_data.calibrated = false;
-  comm.enqueue_for_transmit(comm.tx_data.to_doc());
-  while (comm.async_transmit() > 0) {}  // Empty transmit buffer
-
-  // Only acc gyro calibration necessary
-  comm.message_transmit_now(F("Accel Gyro calibration will start in 3sec."));
-  comm.message_transmit_now(F("Please leave the device still on the flat plane."));
-  delay(2000);
-  comm.message_transmit_now(F("Accel Gyro calibration start!"));
-  mpu.calibrateAccelGyro();
-  comm.message_transmit_now(F("Accel Gyro calibration finished!"));
-  comm.message_transmit_now(F("-------------------------"));
-  comm.message_transmit_now(F("    Calibration done!"));
+// Compiles the received parameters for the control kernel. This is only done when parameters were received instead of in every control cycle.
+void update_control_parameters() {
+  PROFILE_SCOPE(PARAMETERS);
+  control_scheduler.set_period_ms(comm.rx_data.parameters.variable.General.h_ms);  // Only reprograms the timer if h_ms changed
+  mpu.set_fusion(comm.rx_data.parameters.variable.Fusion.rate_hz, comm.rx_data.parameters.variable.Fusion.tau_s);
 
-  comm.tx_data.calibrated = true;    // Tell gui that calibration procedure is finished
-  comm.rx_data.calibration = false;  // Prevent doing a calibration in the next loop again
-
-  // Adresses issue (https://github.com/hideakitai/MPU9250/issues/88) that biases are not actually forwarded to the sensor after calibration. Do it manually here.
-  mpu.setAccBias(mpu.getAccBiasX(), mpu.getAccBiasY(), mpu.getAccBiasZ());
-  mpu.setGyroBias(mpu.getGyroBiasX(), mpu.getGyroBiasY(), mpu.getGyroBiasZ());
+  ControlStep<ControlArithmetic>::Kernel::CompiledParameters parameters;
+  parameters.compile(comm.rx_data.parameters, control_scheduler.period_ms() * 1e-3);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    control.kernel.parameters = parameters;  // The control step interrupts loop(), so the parameters must be replaced at once
+  }
 }
 
-void predict_state_estimation(double &x1, double &x2, double &x3, double &x4, double &u, double &y1, double &y2, double &y3) {
-  double &l11 = comm.rx_data.parameters.inferred.observer.gain.l11;
-  double &l12 = comm.rx_data.parameters.inferred.observer.gain.l12;
-  double &l13 = comm.rx_data.parameters.inferred.observer.gain.l13;
-  double &l21 = comm.rx_data.parameters.inferred.observer.gain.l21;
-  double &l22 = comm.rx_data.parameters.inferred.observer.gain.l22;
-  double &l23 = comm.rx_data.parameters.inferred.observer.gain.l23;
-  double &l31 = comm.rx_data.parameters.inferred.observer.gain.l31;
-  double &l32 = comm.rx_data.parameters.inferred.observer.gain.l32;
-  double &l33 = comm.rx_data.parameters.inferred.observer.gain.l33;
-  double &l41 = comm.rx_data.parameters.inferred.observer.gain.l41;
-  double &l42 = comm.rx_data.parameters.inferred.observer.gain.l42;
-  double &l43 = comm.rx_data.parameters.inferred.observer.gain.l43;
-
-  double &o_phi11 = comm.rx_data.parameters.inferred.observer.phi.phi11;
-  double &o_phi12 = comm.rx_data.parameters.inferred.observer.phi.phi12;
-  double &o_phi13 = comm.rx_data.parameters.inferred.observer.phi.phi13;
-  double &o_phi14 = comm.rx_data.parameters.inferred.observer.phi.phi14;
-  double &o_phi21 = comm.rx_data.parameters.inferred.observer.phi.phi21;
-  double &o_phi22 = comm.rx_data.parameters.inferred.observer.phi.phi22;
-  double &o_phi23 = comm.rx_data.parameters.inferred.observer.phi.phi23;
-  double &o_phi24 = comm.rx_data.parameters.inferred.observer.phi.phi24;
-  double &o_phi31 = comm.rx_data.parameters.inferred.observer.phi.phi31;
-  double &o_phi32 = comm.rx_data.parameters.inferred.observer.phi.phi32;
-  double &o_phi33 = comm.rx_data.parameters.inferred.observer.phi.phi33;
-  double &o_phi34 = comm.rx_data.parameters.inferred.observer.phi.phi34;
-  double &o_phi41 = comm.rx_data.parameters.inferred.observer.phi.phi41;
-  double &o_phi42 = comm.rx_data.parameters.inferred.observer.phi.phi42;
-  double &o_phi43 = comm.rx_data.parameters.inferred.observer.phi.phi43;
-  double &o_phi44 = comm.rx_data.parameters.inferred.observer.phi.phi44;
-
-  double x1_prev = x1;
-  double x2_prev = x2;
-  double x3_prev = x3;
-  double x4_prev = x4;
-
-  x1 = o_phi11 * x1_prev + o_phi12 * x2_prev + o_phi13 * x3_prev + o_phi14 * x4_prev + l11 * y1 + l12 * y2 + l13 * y3;
-  x2 = o_phi21 * x1_prev + o_phi22 * x2_prev + o_phi23 * x3_prev + o_phi24 * x4_prev + l21 * y1 + l22 * y2 + l23 * y3;
-  x3 = o_phi31 * x1_prev + o_phi32 * x2_prev + o_phi33 * x3_prev + o_phi34 * x4_prev + l31 * y1 + l32 * y2 + l33 * y3;
-  x4 = o_phi41 * x1_prev + o_phi42 * x2_prev + o_phi43 * x3_prev + o_phi44 * x4_prev + l41 * y1 + l42 * y2 + l43 * y3;
-}
+// Executed every h_ms from the timer interrupt of the control scheduler
+void control_step() {
+  PROFILE_SCOPE(STEP);
+  comm.tx_data.control.cycle_us = control_scheduler.last_period_us();
 
-void correct_state_estimation(double &x1, double &x2, double &x3, double &x4, double &x1_prev, double &x2_prev, double &x3_prev, double &x4_prev, double &y1, double &y2, double &y3) {
-  double &mx11 = comm.rx_data.parameters.inferred.observer.innoGain.mx11;
-  double &mx12 = comm.rx_data.parameters.inferred.observer.innoGain.mx12;
-  double &mx13 = comm.rx_data.parameters.inferred.observer.innoGain.mx13;
-  double &mx21 = comm.rx_data.parameters.inferred.observer.innoGain.mx21;
-  double &mx22 = comm.rx_data.parameters.inferred.observer.innoGain.mx22;
-  double &mx23 = comm.rx_data.parameters.inferred.observer.innoGain.mx23;
-  double &mx31 = comm.rx_data.parameters.inferred.observer.innoGain.mx31;
-  double &mx32 = comm.rx_data.parameters.inferred.observer.innoGain.mx32;
-  double &mx33 = comm.rx_data.parameters.inferred.observer.innoGain.mx33;
-  double &mx41 = comm.rx_data.parameters.inferred.observer.innoGain.mx41;
-  double &mx42 = comm.rx_data.parameters.inferred.observer.innoGain.mx42;
-  double &mx43 = comm.rx_data.parameters.inferred.observer.innoGain.mx43;
-
-  double y1_err = y1 - x1_prev;
-  double y2_err = y2 - x2_prev;
-  double y3_err = y3 - x4_prev;
-
-  x1 = x1_prev + mx11 * y1_err + mx12 * y2_err + mx13 * y3_err;
-  x2 = x2_prev + mx21 * y1_err + mx22 * y2_err + mx23 * y3_err;
-  x3 = x3_prev + mx31 * y1_err + mx32 * y2_err + mx33 * y3_err;
-  x4 = x4_prev + mx41 * y1_err + mx42 * y2_err + mx43 * y3_err;
-}
+  {
+    PROFILE_SCOPE(MPU);
+    mpu.update();  // Average the acceleration and gyro samples acquired since the previous step and start acquiring the next ones in the background
+  }
+  comm.tx_data.sensor.mpu.fifo_samples = mpu.fifo_samples;
+  comm.tx_data.sensor.mpu.fifo_overflows = mpu.fifo_overflows;
 
-void predict_feedforward_model_state(double &x1, double &x2, double &x3, double &x4, double &u_ff) {
-  double &phi11 = comm.rx_data.parameters.inferred.ff.phi.phi11;
-  double &phi12 = comm.rx_data.parameters.inferred.ff.phi.phi12;
-  double &phi13 = comm.rx_data.parameters.inferred.ff.phi.phi13;
-  double &phi14 = comm.rx_data.parameters.inferred.ff.phi.phi14;
-  double &phi21 = comm.rx_data.parameters.inferred.ff.phi.phi21;
-  double &phi22 = comm.rx_data.parameters.inferred.ff.phi.phi22;
-  double &phi23 = comm.rx_data.parameters.inferred.ff.phi.phi23;
-  double &phi24 = comm.rx_data.parameters.inferred.ff.phi.phi24;
-  double &phi31 = comm.rx_data.parameters.inferred.ff.phi.phi31;
-  double &phi32 = comm.rx_data.parameters.inferred.ff.phi.phi32;
-  double &phi33 = comm.rx_data.parameters.inferred.ff.phi.phi33;
-  double &phi34 = comm.rx_data.parameters.inferred.ff.phi.phi34;
-  double &phi41 = comm.rx_data.parameters.inferred.ff.phi.phi41;
-  double &phi42 = comm.rx_data.parameters.inferred.ff.phi.phi42;
-  double &phi43 = comm.rx_data.parameters.inferred.ff.phi.phi43;
-  double &phi44 = comm.rx_data.parameters.inferred.ff.phi.phi44;
-
-  double &gam1 = comm.rx_data.parameters.inferred.ff.gamma.gam1;
-  double &gam2 = comm.rx_data.parameters.inferred.ff.gamma.gam2;
-  double &gam3 = comm.rx_data.parameters.inferred.ff.gamma.gam3;
-  double &gam4 = comm.rx_data.parameters.inferred.ff.gamma.gam4;
-
-  double x1_prev = x1;
-  double x2_prev = x2;
-  double x3_prev = x3;
-  double x4_prev = x4;
-
-  x1 = phi11 * x1_prev + phi12 * x2_prev + phi13 * x3_prev + phi14 * x4_prev + gam1 * u_ff;
-  x2 = phi21 * x1_prev + phi22 * x2_prev + phi23 * x3_prev + phi24 * x4_prev + gam2 * u_ff;
-  x3 = phi31 * x1_prev + phi32 * x2_prev + phi33 * x3_prev + phi34 * x4_prev + gam3 * u_ff;
-  x4 = phi41 * x1_prev + phi42 * x2_prev + phi43 * x3_prev + phi44 * x4_prev + gam4 * u_ff;
-}
+  const bool reset = reset_control;
+  if (reset) {
+    wheel_angle_rad.reset();
+    control.kernel.reset_model();
 
-void predict_integral_action_state(double &xi, double &x4, double x4_set) {
-  double h = comm.rx_data.parameters.variable.General.h_ms * 1e-3;
+    reset_control = false;
+  }
 
-  xi += h * (x4_set - x4);
-}
+  // Sensor readings
+  const SensorSnapshot sensors = SensorSnapshot::acquire(control_scheduler.step_start_us());
+  comm.tx_data.sensor.wheel.angle_rad = sensors.wheel_angle_rad.value;
+  comm.tx_data.sensor.wheel.angle_deriv_rad_s = sensors.wheel_angle_rad.derivative;
+  comm.tx_data.sensor.tilt.angle_rad = sensors.tilt_angle_rad.value;
+  comm.tx_data.sensor.tilt.vel_rad_s = sensors.tilt_vel_rad_s.value;
+
+#ifdef ENABLE_SAMPLE_TELEMETRY
+  if (comm.rx_data.recording) {
+    uint8_t *record_state = comm.capture_record_state();
+    if (record_state) control.kernel.save_state(record_state);  // After the reset, so the replay resumes the kernel in the state this step starts from
+  }
+#endif
+
+  {
+    PROFILE_SCOPE(KERNEL);  // Includes the motor section, which is measured by the HAL
+    TargetHal hal{ sensors };
+    control.run(hal);
+#ifdef ENABLE_SAMPLE_TELEMETRY
+    if (comm.rx_data.recording) record_step(hal.measure(), hal.setpoint(), reset);
+#endif
+  }
 
-void calculate_feedforward_control_signal(double &u_ff, double &x1, double &x2, double &x3, double &x4, double &u_c) {
-  double &k_m1 = comm.rx_data.parameters.inferred.ff.Km.k1;
-  double &k_m2 = comm.rx_data.parameters.inferred.ff.Km.k2;
-  double &k_m3 = comm.rx_data.parameters.inferred.ff.Km.k3;
-  double &k_m4 = comm.rx_data.parameters.inferred.ff.Km.k4;
+  // Estimated system state x_hat
+  comm.tx_data.observer.tilt.vel_rad_s = ControlArithmetic::to_double(control.kernel.x_corr[0]);
+  comm.tx_data.observer.tilt.angle_rad = ControlArithmetic::to_double(control.kernel.x_corr[1]);
+  comm.tx_data.observer.wheel.vel_rad_s = ControlArithmetic::to_double(control.kernel.x_corr[2]);
+  comm.tx_data.observer.wheel.angle_rad = ControlArithmetic::to_double(control.kernel.x_corr[3]);
+  comm.tx_data.observer.position.z_mm = -comm.tx_data.observer.wheel.angle_rad * WHEEL_RAD_TO_MM;
+
+  // Feed Forward Model states
+  comm.tx_data.ff_model.tilt.vel_rad_s = ControlArithmetic::to_double(control.kernel.x_m_curr[0]);
+  comm.tx_data.ff_model.tilt.angle_rad = ControlArithmetic::to_double(control.kernel.x_m2_with_offset);
+  comm.tx_data.ff_model.wheel.vel_rad_s = ControlArithmetic::to_double(control.kernel.x_m_curr[2]);
+  comm.tx_data.ff_model.wheel.angle_rad = ControlArithmetic::to_double(control.kernel.x_m_curr[3]);
+  comm.tx_data.ff_model.position.z_mm = -comm.tx_data.ff_model.wheel.angle_rad * WHEEL_RAD_TO_MM;
+
+  comm.tx_data.control.signal.u = control.u;
+  comm.tx_data.control.signal.u_bal = ControlArithmetic::to_double(control.kernel.u_bal);
+  comm.tx_data.control.signal.u_pos = ControlArithmetic::to_double(control.kernel.u_pos);
+  comm.tx_data.control.signal.u_ff = ControlArithmetic::to_double(control.kernel.u_ff);
+  comm.tx_data.control.motor = control.motor_val;
+
+#ifdef ENABLE_SAMPLE_TELEMETRY
+  comm.record_sample(control_scheduler.step_start_us());
+#endif
+}
 
-  double &k_c = comm.rx_data.parameters.inferred.ff.Kc;
+// Receive errors pile up if the baud rate is beyond the tolerance of the link, in which case the next lower one is selected
+void count_receive_error() {
+  if (baud_switch.count_receive_error()) comm.event(Event::EVENT_BAUD_RATE_FALLBACK, baud_switch.lower_baud_rate() / 100);
+}
 
-  u_ff = k_c * u_c - k_m1 * x1 - k_m2 * x2 - k_m3 * x3 - k_m4 * x4;
+#ifdef ENABLE_SAMPLE_TELEMETRY
+// Keeps the inputs and outputs of the control step for the record batches, so a run can be replayed offline by tools/replay
+void record_step(const ControlMeasurements &y, const ControlSetpoint &setpoint, bool reset) {
+  comm.record_data.measurements.tilt_vel_rad_s = y.tilt_vel_rad_s;
+  comm.record_data.measurements.tilt_angle_rad = y.tilt_angle_rad;
+  comm.record_data.measurements.wheel_angle_rad = y.wheel_angle_rad;
+  comm.record_data.setpoint.pos_setpoint_mm = setpoint.pos_setpoint_mm;
+  comm.record_data.setpoint.control_enabled = setpoint.control_enabled;
+  comm.record_data.reset = reset;
+  comm.record_data.cycle_us = control_scheduler.last_period_us();
+  comm.record_data.u = control.u;
+  comm.record_data.motor = control.motor_val;
 }
+#endif
 
-void calculate_feedback_control_signal(double &u_bal, double &u_pos, double &x1, double &x2, double &x3, double &x4, double &xi, double &x_m1, double &x_m2, double &x_m3, double &x_m4) {
-  double &k1 = comm.rx_data.parameters.variable.BalanceControl.k1;
-  double &k2 = comm.rx_data.parameters.variable.BalanceControl.k2;
-  double &k3 = comm.rx_data.parameters.variable.BalanceControl.k3;
-  double &k4 = comm.rx_data.parameters.variable.PositionControl.k4;
-  double &ki = comm.rx_data.parameters.variable.PositionControl.ki;
+// The device must lie still and the calibration reads the MPU itself, so the control step must not run meanwhile. The motor is stopped until the control resumes.
+void start_calibration() {
+  control_scheduler.stop();
+  write_motor(0);
 
-  u_bal = k1 * (x_m1 - x1) + k2 * (x_m2 - x2) + k3 * (x_m3 - x3);
-  u_pos = k4 * (x_m4 - x4) - ki * xi;
+  comm.tx_data.calibrated = false;
+  comm.tx_data.calibration_progress = 0;
+  comm.event(Event::EVENT_CALIBRATION_STARTED);
+  calibration.start(millis());
 }
 
-int16_t write_motor_voltage(double volt, double saturation, uint8_t decimals) {
-  const long scale_amp = pow(10, decimals);
-  const long volt_int_max = round(saturation * scale_amp);
-  const long volt_int = constrain(round(volt * scale_amp), -volt_int_max, volt_int_max);  // map does integer calculations, so we increase the resolution by scaling up the double value by scale_amp
-  uint8_t motor_val = map(abs(volt_int), 0, volt_int_max, 0, UINT8_MAX);
-
-  // Motor deadzone compensation
-  uint8_t &stop_threshold = comm.rx_data.parameters.variable.General.m_stop;
-  uint8_t &start_threshold = comm.rx_data.parameters.variable.General.m_start;
-  motor_val = motor_val < stop_threshold ? 0 : map(motor_val, 0, UINT8_MAX, start_threshold, UINT8_MAX);
-
-  // Positive means to rotate in positive direction
-  if (volt < 0) {
-    analogWrite(PD4, motor_val);
-    analogWrite(PD5, 0);
-    return -motor_val;
-  } else {
-    analogWrite(PD4, 0);
-    analogWrite(PD5, motor_val);
-    return motor_val;
+// Called from every iteration of loop() while calibrating, so communication and telemetry continue meanwhile
+void run_calibration() {
+  if (!calibration.run(millis())) {
+    comm.tx_data.calibration_progress = calibration.progress_percent();
+    return;
   }
+
+  comm.tx_data.calibration_progress = 100;
+  comm.tx_data.calibrated = true;    // Tell gui that calibration procedure is finished
+  comm.rx_data.calibration = false;  // Prevent doing a calibration in the next loop again
+  comm.event(Event::EVENT_CALIBRATION_DONE);
+
+  control_scheduler.start();
 }
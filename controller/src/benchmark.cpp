@@ -0,0 +1,317 @@
+#include "benchmark.hpp"
+
+#ifdef ENABLE_BENCHMARK
+#include <util/atomic.h>
+#include "communication/interface.hpp"
+#include "communication/parser.hpp"
+#include "control/step.hpp"
+#include "encoder.hpp"
+#include "motor.hpp"
+#include "profiles.hpp"
+
+typedef ControlStep<ControlArithmetic>::Kernel Kernel;
+
+// Packet of the GUI with every member of TO_DEVICE, containing the parameter set data/parameters/opti_with_i_with_ff.json which uses every control stage
+static const char PARAMETER_PACKET[] PROGMEM =
+  "{\"calibration\":false,\"control_state\":true,\"pos_setpoint_mm\":100.0,\"subscription\":4294967295,"
+  "\"parameters\":{\"variable\":{\"General\":{\"h_ms\":6,\"alpha_off\":-0.012,\"m_stop\":1,\"m_start\":30},\"BalanceControl\":{\"k1\":-13.81,"
+  "\"k2\":-86.052,\"k3\":-1.119},\"PositionControl\":{\"k4\":-0.82,\"ki\":0.376},\"Fusion\":{\"rate_hz\":200,\"tau_s\":0.0}},"
+  "\"inferred\":{\"observer\":{\"gain\":{\"l11\":0.99999722,\"l12\":2e-08,\"l13\":0.0,\"l21\":0.006,\"l22\":0.00598203,\"l23\":0.0,\"l31\":0.0,"
+  "\"l32\":0.0,\"l33\":86.53732899,\"l41\":0.0,\"l42\":0.0,\"l43\":1.31120427},\"phi\":{\"phi11\":2.78e-06,\"phi12\":-2e-08,\"phi13\":0.0,"
+  "\"phi14\":0.0,\"phi21\":0.0,\"phi22\":0.99401797,\"phi23\":0.0,\"phi24\":0.0,\"phi31\":0.0,\"phi32\":0.0,\"phi33\":1.0,"
+  "\"phi34\":-86.53732899,\"phi41\":0.0,\"phi42\":0.0,\"phi43\":0.006,\"phi44\":-0.31120427},\"innoGain\":{\"mx11\":0.99999722,\"mx12\":2e-08,"
+  "\"mx13\":0.0,\"mx21\":2e-08,\"mx22\":0.00598203,\"mx23\":0.0,\"mx31\":0.0,\"mx32\":0.0,\"mx33\":86.53732899,\"mx41\":0.0,\"mx42\":0.0,"
+  "\"mx43\":0.7919803}},\"ff\":{\"phi\":{\"phi11\":0.9976018,\"phi12\":0.22727551,\"phi13\":0.08080876,\"phi14\":0.0,\"phi21\":0.00598472,"
+  "\"phi22\":1.00074089,\"phi23\":0.00038438,\"phi24\":0.0,\"phi31\":0.04973205,\"phi32\":-0.40153039,\"phi33\":0.01400607,\"phi34\":0.0,"
+  "\"phi41\":0.00024092,\"phi42\":-0.00192853,\"phi43\":0.00130692,\"phi44\":1.0},\"gamma\":{\"gam1\":-0.190784,\"gam2\":-0.0009074,"
+  "\"gam3\":2.32725259,\"gam4\":0.01107714},\"Km\":{\"k1\":-11.25011093,\"k2\":-63.27131886,\"k3\":-0.91289088,\"k4\":-0.24527782},"
+  "\"Kc\":-0.24527782}}},\"parameter_profile\":7,\"telemetry_limits\":{\"min_interval_ms\":6,\"max_interval_ms\":200},\"baud_rate\":115200,"
+  "\"recording\":false}";
+
+static const size_t TX_TEXT_BUFFER_SIZE = 896;  // Fits all channels in JSON, c.f. Communication::TX_TELEMETRY_SLOT_SIZE
+
+static volatile uint16_t cycle_counter_overflows = 0;
+static uint32_t overhead_cycles = 0;
+
+ISR(TIMER1_OVF_vect) {
+  cycle_counter_overflows++;
+}
+
+static void start_cycle_counter() {
+  TCCR1A = 0;
+  TCCR1B = (1 << CS10);  // Normal mode without prescaler, so the counter increments every CPU cycle
+  TCNT1 = 0;
+  TIMSK1 = (1 << TOIE1);
+}
+
+static uint32_t read_cycles() {
+  uint32_t cycles;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    const uint16_t low = TCNT1;
+    uint16_t high = cycle_counter_overflows;
+    if ((TIFR1 & (1 << TOV1)) && low < 0x8000) high++;  // The counter overflowed after interrupts were disabled
+    cycles = ((uint32_t)high << 16) | low;
+  }
+  return cycles;
+}
+
+typedef void (*BenchmarkFunction)();
+
+struct BenchmarkResult {
+  uint32_t min_cycles;
+  uint32_t median_cycles;
+  uint32_t max_cycles;
+};
+
+// Times run() BENCHMARK_RUNS times. prepare() is called before each run and not timed.
+static BenchmarkResult benchmark(BenchmarkFunction prepare, BenchmarkFunction run) {
+  uint32_t cycles[BENCHMARK_RUNS];
+  Serial.flush();  // Transmit interrupts must not occur during the runs
+  for (uint8_t i = 0; i < BENCHMARK_RUNS; i++) {
+    if (prepare) prepare();
+    const uint8_t timsk0 = TIMSK0;
+    TIMSK0 &= ~(1 << TOIE0);
+    const uint32_t start = read_cycles();
+    run();
+    const uint32_t duration = read_cycles() - start;
+    TIMSK0 = timsk0;
+    cycles[i] = duration > overhead_cycles ? duration - overhead_cycles : 0;
+  }
+
+  // Insertion sort for the median
+  for (uint8_t i = 1; i < BENCHMARK_RUNS; i++) {
+    const uint32_t c = cycles[i];
+    uint8_t j = i;
+    for (; j > 0 && cycles[j - 1] > c; j--) cycles[j] = cycles[j - 1];
+    cycles[j] = c;
+  }
+  return BenchmarkResult{ cycles[0], cycles[BENCHMARK_RUNS / 2], cycles[BENCHMARK_RUNS - 1] };
+}
+
+// Prints the rest of the CSV line whose name was printed before
+static void report(const BenchmarkResult &result) {
+  Serial.print(',');
+  Serial.print(BENCHMARK_RUNS);
+  Serial.print(',');
+  Serial.print(result.min_cycles);
+  Serial.print(',');
+  Serial.print(result.median_cycles);
+  Serial.print(',');
+  Serial.println(result.max_cycles);
+}
+
+static void nothing() {}
+
+/*
+The benchmarks of each group access their data by these pointers, since the data lives on the stack of the group.
+Buffers of the size the communication needs would otherwise stay allocated next to the buffers of the controller, which are linked as well.
+*/
+static char *text;
+static ReceiveInterface *rx;
+static TransmitInterface *tx;
+static uint8_t *bin;
+static Kernel *kernel;
+static const Kernel::CompiledParameters *compiled;
+
+// Receive: parsing of a packet into the receive interface
+static void parse_packet() {
+  ReceiveParser parser(*rx);
+  parser.feed(text, sizeof(PARAMETER_PACKET) - 1);
+}
+
+static void benchmark_receive(ReceiveInterface &parameter_packet) {
+  char packet_text[sizeof(PARAMETER_PACKET)];
+  text = packet_text;
+  rx = &parameter_packet;
+
+  memcpy_P(text, PARAMETER_PACKET, sizeof(PARAMETER_PACKET));  // The parser reads from RAM like from the rx buffer and leaves the text unchanged
+  ReceiveParser parser(parameter_packet);
+  parser.feed(text, sizeof(PARAMETER_PACKET) - 1);
+  if (parser.finish() != ReceiveParser::OK) {
+    Serial.print(F("# parsing of the parameter packet failed: "));
+    Serial.println((int)parser.finish());
+  }
+
+  Serial.print(F("parse_json_rx"));
+  report(benchmark(nullptr, parse_packet));
+}
+
+// Transmit: encoding of the telemetry with all channels
+static void fill_telemetry(TransmitInterface &telemetry) {
+  // Values with all digits, like measurements, since the time to serialize a floating point number depends on them
+  telemetry.sensor.wheel.angle_rad = -12.345678;
+  telemetry.sensor.wheel.angle_deriv_rad_s = 3.1415927;
+  telemetry.sensor.tilt.angle_rad = 0.0123456;
+  telemetry.sensor.tilt.vel_rad_s = -0.2345678;
+  telemetry.sensor.mpu.fifo_samples = 1;
+  telemetry.sensor.mpu.fifo_overflows = 0;
+  telemetry.observer.wheel.angle_rad = -12.356789;
+  telemetry.observer.wheel.vel_rad_s = 3.0987654;
+  telemetry.observer.tilt.angle_rad = 0.0112345;
+  telemetry.observer.tilt.vel_rad_s = -0.2234567;
+  telemetry.observer.position.z_mm = -803.45678;
+  telemetry.ff_model.wheel.angle_rad = -12.234567;
+  telemetry.ff_model.wheel.vel_rad_s = 2.9876543;
+  telemetry.ff_model.tilt.angle_rad = -0.0123456;
+  telemetry.ff_model.tilt.vel_rad_s = 0.1234567;
+  telemetry.ff_model.position.z_mm = -795.12345;
+  telemetry.control.cycle_us = 6004;
+  telemetry.control.period.min_us = 5992;
+  telemetry.control.period.max_us = 6012;
+  telemetry.control.period.mean_us = 6000;
+  telemetry.control.overruns = 0;
+  telemetry.control.signal.u = 1.2345678;
+  telemetry.control.signal.u_bal = 2.3456789;
+  telemetry.control.signal.u_pos = -0.3456789;
+  telemetry.control.signal.u_ff = -0.7654321;
+  telemetry.control.motor = 35;
+  telemetry.calibrated = true;
+  telemetry.calibration_progress = 0;
+  telemetry.parameters_crc = 0x3944;  // CRC of the parameters of PARAMETER_PACKET
+  telemetry.parameter_profiles_crc = PARAMETER_PROFILES_CRC;
+  telemetry.telemetry_interval_ms = 20;
+  telemetry.baud_rate = 115200;
+}
+
+static void telemetry_to_json() {
+  const StaticJsonDocument<JSON_DOC_SIZE_TX> doc = tx->to_doc(TransmitInterface::ALL_CHANNELS);
+  serializeJson(doc, text, TX_TEXT_BUFFER_SIZE);
+}
+
+static void telemetry_to_bin() {
+  tx->to_bin(bin, TransmitInterface::ALL_CHANNELS);
+}
+
+static void benchmark_transmit() {
+  char json_text[TX_TEXT_BUFFER_SIZE];
+  uint8_t bin_data[BIN_SIZE_TX];
+  TransmitInterface telemetry;
+  fill_telemetry(telemetry);
+  text = json_text;
+  bin = bin_data;
+  tx = &telemetry;
+
+  Serial.print(F("to_doc_serialize_json_tx"));
+  report(benchmark(nullptr, telemetry_to_json));
+  Serial.print(F("to_bin_tx"));
+  report(benchmark(nullptr, telemetry_to_bin));
+}
+
+// Control: compilation of the parameters, the kernel step of every combination of the stages and the conversion to a PWM value
+static volatile double measurements[3] = { 0.0123, 0.0456, -1.234 };
+static volatile double voltage = 0.5;
+static volatile int16_t motor_val;
+static ControlArithmetic::Signal y[3], r;
+
+static void compile_parameters() {
+  Kernel::CompiledParameters parameters;
+  parameters.compile(rx->parameters, rx->parameters.variable.General.h_ms * 1e-3);
+  kernel->parameters = parameters;
+}
+
+static void convert_measurements() {
+  for (uint8_t i = 0; i < 3; i++) y[i] = ControlArithmetic::signal(measurements[i]);
+  r = ControlArithmetic::signal(-100 * WHEEL_MM_TO_RAD);
+}
+
+static void kernel_step() {
+  kernel->step(y[0], y[1], y[2], r, true);
+}
+
+static MotorCommand motor_command{ MOTOR_SATURATION_V };
+
+static void change_deadzone() {
+  motor_command.set_deadzone(compiled->m_stop, compiled->m_start + 1);
+}
+
+static void motor_command_table() {
+  motor_command.set_deadzone(compiled->m_stop, compiled->m_start);  // The thresholds differ from the previous ones, so the table is rebuilt
+}
+
+static void motor_command_deadzone() {
+  motor_val = motor_command.convert<true>(voltage);
+}
+
+static void motor_command_linear() {
+  motor_val = motor_command.convert<false>(voltage);
+}
+
+static void benchmark_control(ReceiveInterface &parameter_packet) {
+  Kernel control_kernel;
+  rx = &parameter_packet;
+  kernel = &control_kernel;
+
+  Serial.print(F("compile_parameters"));
+  report(benchmark(nullptr, compile_parameters));
+  const Kernel::CompiledParameters parameters = control_kernel.parameters;
+  compiled = &parameters;
+
+  // The stages of the name are the ones of the step, e.g. kernel_step_observer_integral
+  for (uint8_t stages = 0; stages <= CONTROL_KERNEL_STAGES; stages++) {
+    if ((stages & CONTROL_KERNEL_STAGES) != stages) continue;
+    control_kernel = Kernel();
+    control_kernel.parameters = parameters;
+    control_kernel.parameters.stages = (parameters.stages & ~CONTROL_KERNEL_STAGES) | stages;
+
+    Serial.print(F("kernel_step"));
+    if (stages == 0) Serial.print(F("_feedback_only"));
+    if (stages & OBSERVER_STAGE) Serial.print(F("_observer"));
+    if (stages & FEEDFORWARD_STAGE) Serial.print(F("_feedforward"));
+    if (stages & INTEGRAL_STAGE) Serial.print(F("_integral"));
+    report(benchmark(convert_measurements, kernel_step));
+  }
+
+  Serial.print(F("motor_command_table"));
+  report(benchmark(change_deadzone, motor_command_table));
+  Serial.print(F("motor_command_deadzone"));
+  report(benchmark(nullptr, motor_command_deadzone));
+  Serial.print(F("motor_command"));
+  report(benchmark(nullptr, motor_command_linear));
+}
+
+// Hardware: the motor output and the encoder interrupt handler
+static void alternate_motor_direction() {
+  motor_val = motor_val > 0 ? -1 : 1;
+}
+
+static void motor_output() {
+  write_motor(motor_val);
+}
+
+static void benchmark_hardware() {
+  Serial.print(F("write_motor"));
+  report(benchmark(alternate_motor_direction, motor_output));
+  write_motor(0);
+
+  Serial.print(F("encoder_isr"));  // Called directly, i.e. without the dispatch of attachInterrupt(), which adds the interrupt prologue and an indirect call
+  report(benchmark(nullptr, encoder_isr));
+}
+
+void run_benchmark() {
+  start_cycle_counter();
+
+  Serial.println(F("# benchmark in CPU cycles of the controller build"));
+  Serial.print(F("# F_CPU="));
+  Serial.println(F_CPU);
+#ifdef ENABLE_FIXED_POINT_CONTROL
+  Serial.println(F("# fixed point control"));
+#else
+  Serial.println(F("# floating point control"));
+#endif
+  overhead_cycles = benchmark(nullptr, nothing).min_cycles;
+  Serial.print(F("# overhead_cycles="));
+  Serial.println(overhead_cycles);
+  Serial.println(F("name,runs,min_cycles,median_cycles,max_cycles"));
+
+  {
+    ReceiveInterface parameter_packet;
+    benchmark_receive(parameter_packet);
+    benchmark_control(parameter_packet);
+  }
+  benchmark_transmit();
+  benchmark_hardware();
+
+  Serial.println(F("# done"));
+  while (true) {}
+}
+#endif
@@ -0,0 +1,27 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <Arduino.h>
+
+// Comment in to build the benchmark instead of the controller. setup() then runs the benchmarks once after the serial port is opened and the controller is not started.
+// #define ENABLE_BENCHMARK
+
+#ifdef ENABLE_BENCHMARK
+/*
+Micro-benchmarks of the communication and control hot paths on the target, built with the same sources and settings as the controller.
+Each benchmark runs BENCHMARK_RUNS times and is timed in CPU cycles by Timer1 without prescaler, which is free since the TWI service timer is not started.
+The overflow interrupt of Timer0 (millis()) is disabled during a run and the serial port is idle, so only the Timer1 overflow interrupt (every 4.1 ms) adds a few cycles to long runs.
+The time of an empty run is subtracted.
+
+The results are printed as CSV at 115200 baud, which a regression check can compare to a previous run:
+  # comment lines
+  name,runs,min_cycles,median_cycles,max_cycles
+The motor output is written with a PWM value of 1 only, which is far below the motor deadzone.
+*/
+#define BENCHMARK_RUNS 31
+
+// Runs all benchmarks and doesn't return
+void run_benchmark();
+#endif
+
+#endif
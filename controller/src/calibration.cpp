@@ -0,0 +1,70 @@
+#include <Arduino.h>
+#include "calibration.hpp"
+
+MPUCalibration::MPUCalibration(MinSegMPU &mpu)
+  : mpu(mpu) {}
+
+// Clears the gyro offsets and restarts the FIFO. Uses the Wire library, so the control step must be stopped before.
+void MPUCalibration::start(uint32_t now_ms) {
+  mpu.wait_for_acquisition();
+  mpu.setGyroBias(0, 0, 0);
+  mpu.enable_fifo();
+
+  for (uint8_t i = 0; i < 3; i++) {
+    acc_sums_g[i] = 0;
+    gyro_sums_dps[i] = 0;
+  }
+  samples = 0;
+  start_ms = now_ms;
+  state = SETTLING;
+}
+
+// Advances the calibration by the samples available. Returns true once, when the biases have been written to the sensor.
+bool MPUCalibration::run(uint32_t now_ms) {
+  switch (state) {
+    case IDLE:
+      return false;
+    case SETTLING:
+      mpu.update();  // Discard the samples of the settling time, so the FIFO does not overflow
+      if (now_ms - start_ms >= CALIBRATION_SETTLE_MS) state = SAMPLING;
+      return false;
+    case SAMPLING:
+      if (mpu.update()) {
+        for (uint8_t i = 0; i < 3; i++) {
+          acc_sums_g[i] += mpu.acc_g[i] * mpu.fifo_samples;
+          gyro_sums_dps[i] += mpu.gyro_dps[i] * mpu.fifo_samples;
+        }
+        samples += mpu.fifo_samples;
+      }
+      if (samples < CALIBRATION_SAMPLES) return false;
+      finish();
+      return true;
+  }
+  return false;
+}
+
+void MPUCalibration::finish() {
+  float acc_bias_g[3];
+  float gyro_bias_dps[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    acc_bias_g[i] = acc_sums_g[i] / samples;
+    gyro_bias_dps[i] = gyro_sums_dps[i] / samples;
+  }
+  acc_bias_g[2] -= acc_bias_g[2] > 0 ? 1 : -1;  // Gravity, regardless of whether the sensor faces up or down
+
+  mpu.wait_for_acquisition();
+  mpu.setAccBias(acc_bias_g[0], acc_bias_g[1], acc_bias_g[2]);
+  mpu.setGyroBias(gyro_bias_dps[0], gyro_bias_dps[1], gyro_bias_dps[2]);
+  mpu.enable_fifo();  // Discards the samples acquired with the previous biases
+  state = IDLE;
+}
+
+bool MPUCalibration::running() const {
+  return state != IDLE;
+}
+
+// Settling counts as 0 %. 100 % is only reported after the biases are written.
+uint8_t MPUCalibration::progress_percent() const {
+  if (state == IDLE) return 0;
+  return min((uint32_t)samples * 100 / CALIBRATION_SAMPLES, (uint32_t)99);
+}
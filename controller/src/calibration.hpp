@@ -0,0 +1,44 @@
+#ifndef CALIBRATION_HPP
+#define CALIBRATION_HPP
+
+#include <Arduino.h>
+#include "mpu.hpp"
+
+// Time to leave the device still before the samples are taken
+#define CALIBRATION_SETTLE_MS 2000
+// Samples averaged for the biases, which takes 2 s at the FIFO sample rate of 200 Hz
+#define CALIBRATION_SAMPLES 400
+
+/*
+Calibrates the accelerometer and gyro biases incrementally instead of the blocking calibrateAccelGyro() of the library.
+Each run() only drains the samples the FIFO collected since the previous call, so it is meant to be called from every iteration of loop() while running().
+The device must lie still on a flat plane with the z axis vertical. The MPU must not be updated by anyone else meanwhile, i.e. the control step is stopped.
+The gyro offset registers of the sensor are cleared at the start, so the averaged gyro samples are the raw biases. The accelerometer offset registers hold a factory trim,
+from which the library subtracts the bias, so the averaged accelerometer samples are the residual biases after the previous calibration.
+*/
+class MPUCalibration {
+  enum State : uint8_t {
+    IDLE,
+    SETTLING,
+    SAMPLING,
+  };
+
+  MinSegMPU &mpu;
+  State state = IDLE;
+  uint32_t start_ms = 0;
+  uint16_t samples = 0;
+  float acc_sums_g[3];
+  float gyro_sums_dps[3];
+
+  void finish();
+
+public:
+  MPUCalibration(MinSegMPU &mpu);
+
+  void start(uint32_t now_ms);
+  bool run(uint32_t now_ms);
+  bool running() const;
+  uint8_t progress_percent() const;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include <avr/eeprom.h>
+#include "baud.hpp"
+#include "comm.hpp"
+
+// Supported rates and the suffix of the AT+BAUD<x> command of the HC-06 that selects them, in ascending order
+struct BaudRateOption {
+  uint32_t baud_rate;
+  char command;
+};
+static const BaudRateOption BAUD_RATES[]{ { 115200, '8' }, { 230400, '9' } };
+static const uint8_t BAUD_RATE_COUNT = sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]);
+
+// Record: marker, index of the rate the module is programmed to, index of the requested rate
+static const uint8_t BAUD_RECORD_MARKER = 0xB4;
+static const size_t BAUD_RECORD_SIZE = 3;
+
+static void discard_input() {
+  while (Serial.available()) Serial.read();
+}
+
+// Waits for a response of the module that starts with "OK" for up to timeout_ms, e.g. "OK" to "AT" or "OK230400" to "AT+BAUD9"
+static bool wait_for_ok(uint16_t timeout_ms) {
+  char first = 0;
+  const uint32_t start_ms = millis();
+  while (millis() - start_ms < timeout_ms) {
+    if (!Serial.available()) continue;
+    const char c = Serial.read();
+    if (first == 'O' && c == 'K') return true;
+    first = c;
+  }
+  return false;
+}
+
+// Probes the module at the given rate. Only called before comm is set up.
+bool BaudRateSwitch::probe_blocking(uint32_t baud_rate) {
+  Serial.begin(baud_rate);
+  discard_input();
+  Serial.print(F("AT"));
+  return wait_for_ok(BAUD_RESPONSE_MS);
+}
+
+// Programs the module, which answers at the rate in use and switches afterwards. Only called before comm is set up.
+bool BaudRateSwitch::command_blocking(char command) {
+  discard_input();
+  Serial.print(F("AT+BAUD"));
+  Serial.print(command);
+  const bool ok = wait_for_ok(BAUD_RESPONSE_MS);
+  delay(BAUD_RESPONSE_MS);  // The rest of the response, after which the module switches
+  return ok;
+}
+
+/*
+Finds the rate of the module and completes a switch to the requested rate that didn't take place at runtime. Opens the serial port at the resulting rate and returns it.
+The module only answers if no Bluetooth connection is established, which is the case right after a power cycle of the MinSeg. Otherwise the stored rate is assumed.
+The stored rate is probed first, so the probes only take longer if the record is lost, e.g. because the size of the parameter image changed.
+*/
+uint32_t BaudRateSwitch::setup() {
+  uint8_t record[BAUD_RECORD_SIZE];
+  eeprom_read_block(record, (const void *)BAUD_RATE_EEPROM_ADDRESS, BAUD_RECORD_SIZE);
+  if (record[0] == BAUD_RECORD_MARKER && record[1] < BAUD_RATE_COUNT && record[2] < BAUD_RATE_COUNT) {
+    rate_index = record[1];
+    target_index = record[2];
+  }
+
+  bool found = probe_blocking(BAUD_RATES[rate_index].baud_rate);
+  for (uint8_t i = 0; i < BAUD_RATE_COUNT && !found; i++) {
+    if (i != rate_index && probe_blocking(BAUD_RATES[i].baud_rate)) {
+      rate_index = i;
+      found = true;
+    }
+  }
+  if (found && target_index != rate_index) {
+    Serial.begin(BAUD_RATES[rate_index].baud_rate);
+    if (command_blocking(BAUD_RATES[target_index].command)) {
+      if (probe_blocking(BAUD_RATES[target_index].baud_rate)) rate_index = target_index;
+      else command_blocking(BAUD_RATES[rate_index].command);  // At the rate that didn't work, c.f. STATE_VERIFY_RESPONSE
+    }
+    target_index = rate_index;  // A switch that fails here isn't retried at every startup
+  }
+
+  Serial.begin(BAUD_RATES[rate_index].baud_rate);
+  store();
+  return baud_rate();
+}
+
+// Starts a switch to the given rate after the announcement was carried to the GUI. Returns false if the rate isn't supported.
+// A switch that is in progress is redirected to the new rate.
+bool BaudRateSwitch::request(uint32_t baud_rate) {
+  uint8_t index = 0;
+  while (index < BAUD_RATE_COUNT && BAUD_RATES[index].baud_rate != baud_rate) index++;
+  if (index == BAUD_RATE_COUNT) return false;
+
+  target_index = index;
+  if (state == STATE_IDLE) {
+    state = STATE_ANNOUNCED;
+    state_ms = millis();
+    switch_ms = state_ms;
+  }
+  return true;
+}
+
+// Advances the switch. Meant to be called from every iteration of loop().
+BaudRateSwitch::Result BaudRateSwitch::run() {
+  const uint32_t now_ms = millis();
+  switch (state) {
+    case STATE_IDLE:
+      if (fallback_errors > 0 && now_ms - fallback_window_ms > BAUD_FALLBACK_WINDOW_MS) fallback_errors = 0;
+      return IDLE;
+
+    case STATE_ANNOUNCED:
+      if (now_ms - state_ms < BAUD_ANNOUNCE_MS) break;
+      comm.suspend_serial();
+      send_probe();
+      break;
+
+    case STATE_PROBE:
+      if (now_ms - state_ms < BAUD_PROBE_INTERVAL_MS) break;
+      if (now_ms - switch_ms > BAUD_SWITCH_TIMEOUT_MS) {
+        if (target_index < rate_index) store();  // A fallback is completed by the next setup(), since the link may be unusable at the current rate
+        else target_index = rate_index;
+        state = STATE_IDLE;
+        comm.resume_serial(baud_rate());
+        return FAILED;
+      }
+      send_probe();
+      break;
+
+    case STATE_PROBE_RESPONSE:
+      if (read_response()) send_command(BAUD_RATES[target_index].command, STATE_COMMAND_RESPONSE);
+      else if (now_ms - state_ms > BAUD_RESPONSE_MS) state = STATE_PROBE;  // The next probe is sent BAUD_PROBE_INTERVAL_MS after the previous one
+      break;
+
+    case STATE_COMMAND_RESPONSE:
+      read_response();
+      if (now_ms - state_ms < BAUD_RESPONSE_MS) break;  // The module switches after its response, whose length depends on the rate
+      state = STATE_IDLE;
+      if (response_length < 2 || response[0] != 'O' || response[1] != 'K') {
+        target_index = rate_index;
+        comm.resume_serial(baud_rate());
+        return FAILED;
+      }
+      Serial.begin(BAUD_RATES[target_index].baud_rate);
+      send_probe();
+      state = STATE_VERIFY_RESPONSE;
+      break;
+
+    case STATE_VERIFY_RESPONSE:
+      if (read_response()) {
+        state = STATE_IDLE;
+        rate_index = target_index;
+        store();
+        comm.resume_serial(baud_rate());
+        return SWITCHED;
+      }
+      if (now_ms - state_ms < BAUD_RESPONSE_MS) break;
+      // The module switched, but the link doesn't work at the new rate. Nothing could be sent to the module anymore, so it is commanded back right away.
+      send_command(BAUD_RATES[rate_index].command, STATE_REVERT_RESPONSE);
+      break;
+
+    case STATE_REVERT_RESPONSE:
+      if (now_ms - state_ms < BAUD_RESPONSE_MS) break;  // The response can't be read at the new rate, so only its duration is waited for
+      state = STATE_IDLE;
+      target_index = rate_index;
+      Serial.begin(baud_rate());
+      comm.resume_serial(baud_rate());
+      return FAILED;
+  }
+  return SWITCHING;
+}
+
+void BaudRateSwitch::send_probe() {
+  discard_input();
+  response_length = 0;
+  Serial.print(F("AT"));
+  state = STATE_PROBE_RESPONSE;
+  state_ms = millis();
+}
+
+void BaudRateSwitch::send_command(char command, State next) {
+  discard_input();
+  response_length = 0;
+  Serial.print(F("AT+BAUD"));
+  Serial.print(command);
+  state = next;
+  state_ms = millis();
+}
+
+// Collects the available bytes of the response. Returns true once it starts with "OK".
+bool BaudRateSwitch::read_response() {
+  while (Serial.available()) {
+    const char c = Serial.read();
+    if (response_length < sizeof(response)) response[response_length++] = c;
+  }
+  return response_length >= 2 && response[0] == 'O' && response[1] == 'K';
+}
+
+void BaudRateSwitch::store() const {
+  const uint8_t record[BAUD_RECORD_SIZE]{ BAUD_RECORD_MARKER, rate_index, target_index };
+  eeprom_update_block(record, (void *)BAUD_RATE_EEPROM_ADDRESS, BAUD_RECORD_SIZE);  // Only writes the bytes that changed, which takes 3.3 ms each
+}
+
+// Counts a receive error. Returns true if the errors triggered a fallback to the next lower rate.
+bool BaudRateSwitch::count_receive_error() {
+  if (rate_index == 0 || state != STATE_IDLE) return false;
+  if (fallback_errors == 0) fallback_window_ms = millis();
+  if (++fallback_errors < BAUD_FALLBACK_ERRORS) return false;
+
+  fallback_errors = 0;
+  return request(lower_baud_rate());
+}
+
+// Rate in use
+uint32_t BaudRateSwitch::baud_rate() const {
+  return BAUD_RATES[rate_index].baud_rate;
+}
+
+// Next lower rate than the one in use, or the lowest one
+uint32_t BaudRateSwitch::lower_baud_rate() const {
+  return BAUD_RATES[rate_index > 0 ? rate_index - 1 : 0].baud_rate;
+}
@@ -0,0 +1,81 @@
+#ifndef BAUD_HPP
+#define BAUD_HPP
+
+#include <Arduino.h>
+#include "../storage.hpp"
+
+// Baud rate of the HC-06 as delivered (AT+BAUD8), which the controller falls back to
+#define BAUD_RATE_DEFAULT 115200
+// EEPROM address of the baud rate record, behind the parameter image
+#define BAUD_RATE_EEPROM_ADDRESS (STORAGE_EEPROM_ADDRESS + STORAGE_IMAGE_SIZE)
+
+/*
+Switches the UART of the controller and the one of the HC-06 Bluetooth module to another baud rate at runtime. The Bluetooth link itself has no baud rate, so the GUI doesn't change.
+The HC-06 only takes AT commands while no Bluetooth connection is established, since it forwards everything to the connected device otherwise. A switch therefore takes these steps:
+ 1. The GUI requests a rate by baud_rate. The controller announces the switch by EVENT_BAUD_RATE_SWITCH_PENDING, upon which the GUI disconnects.
+ 2. The serial buffer interrupt of comm is suspended and the module is probed by "AT" every BAUD_PROBE_INTERVAL_MS, until it answers "OK" because the connection was closed.
+ 3. "AT+BAUD<x>" programs the module, after which the UART is reopened at the new rate.
+ 4. The module is probed at the new rate. Only if it answers, the rate is stored and comm resumes with its polling interval adapted to the rate. Otherwise the module is commanded back
+    to the previous rate, at the new one, since a link that doesn't work at the new rate couldn't be recovered by AT commands later. The GUI reconnects meanwhile.
+If the module doesn't answer within BAUD_SWITCH_TIMEOUT_MS, the rate is kept.
+The rate the module is programmed to is stored in EEPROM together with the requested one, because the module keeps its rate across power cycles.
+At startup, setup() probes the module at every supported rate and programs it to the requested rate, so a switch that failed at runtime, e.g. a fallback, is completed then.
+While the link runs above BAUD_RATE_DEFAULT, receive errors are counted and BAUD_FALLBACK_ERRORS within BAUD_FALLBACK_WINDOW_MS trigger a switch to the next lower rate.
+
+At 16 MHz, the UART divider yields 222222 baud for 230400 (-3.5 %), which the HC-06 may or may not tolerate, hence the probe after a switch. The fallback recovers from links
+that pass the probe but lose bytes under load. 460800 isn't offered, since the divider yields 500000 baud for it (+8.5 %), which is beyond the tolerance of any receiver.
+*/
+class BaudRateSwitch {
+public:
+  enum Result : uint8_t {
+    IDLE,
+    SWITCHING,  // Waiting for the module, the serial buffer interrupt is suspended
+    SWITCHED,   // The rate was switched in this call
+    FAILED      // The module didn't answer in this call, so the rate was kept
+  };
+
+private:
+  static const uint16_t BAUD_ANNOUNCE_MS = 500;         // Time for the telemetry to carry the announcement to the GUI before the link is suspended
+  static const uint16_t BAUD_PROBE_INTERVAL_MS = 1500;  // The HC-06 takes a command as complete after a pause, so probes need to be spaced
+  static const uint16_t BAUD_RESPONSE_MS = 1000;
+  static const uint16_t BAUD_SWITCH_TIMEOUT_MS = 15000;
+  static const uint8_t BAUD_FALLBACK_ERRORS = 3;
+  static const uint16_t BAUD_FALLBACK_WINDOW_MS = 5000;
+
+  enum State : uint8_t {
+    STATE_IDLE,
+    STATE_ANNOUNCED,
+    STATE_PROBE,
+    STATE_PROBE_RESPONSE,
+    STATE_COMMAND_RESPONSE,
+    STATE_VERIFY_RESPONSE,
+    STATE_REVERT_RESPONSE
+  };
+
+  State state = STATE_IDLE;
+  uint8_t rate_index = 0;    // Index of the rate in use in BAUD_RATES
+  uint8_t target_index = 0;  // Index of the requested rate
+  uint32_t state_ms = 0;     // Start of the current state
+  uint32_t switch_ms = 0;    // Start of the switch
+  char response[12];
+  uint8_t response_length = 0;
+  uint8_t fallback_errors = 0;
+  uint32_t fallback_window_ms = 0;
+
+  static bool probe_blocking(uint32_t baud_rate);
+  static bool command_blocking(char command);
+  void send_probe();
+  void send_command(char command, State next);
+  bool read_response();
+  void store() const;
+
+public:
+  uint32_t setup();
+  bool request(uint32_t baud_rate);
+  Result run();
+  bool count_receive_error();
+  uint32_t baud_rate() const;
+  uint32_t lower_baud_rate() const;
+};
+
+#endif
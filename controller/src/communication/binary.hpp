@@ -0,0 +1,23 @@
+#ifndef BINARY_HPP
+#define BINARY_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+// Helpers for the packed binary encoding of the communication interfaces.
+// Values are copied in the native byte order, which is little endian on AVR. No padding is inserted between members.
+// The type used on the wire is given explicitly as template argument, so e.g. bin_write<float>() converts a double before writing it.
+
+template<typename T>
+inline void bin_write(uint8_t *dest, T value) {
+  memcpy(dest, &value, sizeof(T));
+}
+
+template<typename T>
+inline T bin_read(const uint8_t *src) {
+  T value;
+  memcpy(&value, src, sizeof(T));
+  return value;
+}
+
+#endif
@@ -1,6 +1,9 @@
 #include <Arduino.h>
 #include <util/atomic.h>
+#include <util/crc16.h>
 #include "comm.hpp"
+#include "parser.hpp"
+#include "../profiler.hpp"
 
 Communication comm;  // Define communication instance globally here
 
@@ -12,127 +15,212 @@ Communication::Communication() {
     bool -> false
     int, float, double -> 0
   */
+  rx_data.subscription = TransmitInterface::ALL_CHANNELS;  // Until the GUI subscribes to the channels it needs
   message_clear();
 }
 
-void Communication::setup() {
-#ifdef ENABLE_RX_INTERRUPT_POLLING
+void Communication::setup(uint32_t baud_rate) {
   /*
-  Set up timed interrupt for reading the hardware serial receive buffer (64 bytes) using timer/counter4 which is free to use on the MinSeg board.
-  The buffer is estimated to be full every 64 (Buffer size) * 86.806 µs (Real byte rate at 115200 baud rate) ~= 5 ms (Conservatively floored).
-  So the timer must trigger the buffer read interrupt routine faster than that.
+  Set up timed interrupt for reading the hardware serial receive buffer (64 bytes) and refilling the hardware serial transmit buffer (64 bytes) using timer/counter4 which is free to use on the MinSeg board.
+  The receive buffer is estimated to be full every 64 (Buffer size) * 86.806 µs (Real byte rate at 115200 baud rate) ~= 5 ms (Conservatively floored) and the transmit buffer is empty after the same time.
+  So the timer must trigger the interrupt routine faster than that. The transmit buffer is then drained by the interrupt of the Serial class byte by byte and never runs dry while packets are queued,
+  no matter how long loop() takes.
   */
   TCCR4A = 0;
   TCCR4B = 0;
   TCCR4B |= (1 << WGM42);               // Set CTC mode and clear counter on match with OCR4A.
   TCCR4B |= (1 << CS42) | (1 << CS40);  // At a clock speed of 16 MHz (Arduino Mega 2560) use prescale factor 1024 for counter increment every 64 µs
-  enable_rx_serial_buffer_read_interrupt();
-
-  /* Output Compare Register A has to be set to a value lower than 5 ms (Hardware buffer full rate) / 64 µs (Counter increment rate) = 78.125.
-  Lower values ensure a higher margin for delays in executing the read buffer routine and promise short interrupt times, since only few bytes have to be shifted from the hardware buffer to the local one.
-  However, high frequency interrupts can cause problematic delays in the actual control loop.
-  OCR3A is a 16 bit register. Accessing it requires to temporarily disable interrupts.
-  Choosing e.g. 78 here results in reading the buffer when it is filled with 78 (Output Compare Register value) * 64 µs (Counter increment rate) / 86.806 µs (Real byte rate at 115200 baud rate) ~= 57.5 bytes !< 64 (Buffer size)
-  Experiments suggest, that more frequent interrupting results in a higher receive success rate.
-  */
-  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-    OCR4A = (uint16_t)30;  // This value should be bewteen 1 and 78 when using prescale factor 1024
-  }
-#endif
+  set_serial_polling(baud_rate);
+  enable_serial_buffer_interrupt();
 
   pinMode(LED_BUILTIN, OUTPUT);  // Indicator LED on when packet receive in progress.
 }
 
-void Communication::rx_read_from_serial_to_local_buffer() {
-  if (Serial.available() == 63) message_enqueue_for_transmit(F("Receive Warning: INSUFFICIENT_RECEIVE_RATE"));  // Buffer full
-  while (Serial.available()) {
-    if (rx_buf_head < RX_BUFFER_SIZE) {
-      RX_BUFFER[rx_buf_head++] = Serial.read();  // Transfer bytes from hardware buffer to extended local buffer.
-    } else {
-      message_enqueue_for_transmit(F("Receive Error: INCOMING_DATA_RATE_TOO_FAST"));  // When the buffer is filled, it means that messages come in faster that they can be deserialized.
-      rx_buf_tail = 0;
-      rx_buf_head = 0;
-      break;
-    }
+/* 
+Adapts the interval of the serial buffer interrupt to the baud rate, so it moves about the same number of bytes per interrupt at any rate.
+Output Compare Register A has to be set to a value lower than 5 ms (Hardware buffer full rate at 115200 baud rate) / 64 µs (Counter increment rate) = 78.125.
+Lower values ensure a higher margin for delays in executing the read buffer routine and promise short interrupt times, since only few bytes have to be shifted from the hardware buffer to the local one.
+However, high frequency interrupts can cause problematic delays in the actual control loop.
+OCR4A is a 16 bit register. Accessing it requires to temporarily disable interrupts.
+Choosing e.g. 78 here results in reading the buffer when it is filled with 78 (Output Compare Register value) * 64 µs (Counter increment rate) / 86.806 µs (Real byte rate at 115200 baud rate) ~= 57.5 bytes !< 64 (Buffer size)
+Experiments suggest, that more frequent interrupting results in a higher receive success rate.
+At 115200 baud the value is 30, in whose period of 30 * 64 µs ~= 1.9 ms about 22 bytes are sent, so that many bytes are refilled by each interrupt. It is 15 at 230400 baud.
+*/
+void Communication::set_serial_polling(uint32_t baud_rate) {
+  const uint32_t compare = (SERIAL_POLLING_BAUD_TICKS + baud_rate / 2) / baud_rate;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    OCR4A = (uint16_t)constrain(compare, 1, 78);  // This value should be bewteen 1 and 78 when using prescale factor 1024
   }
 }
 
-Communication::ReceiveCode Communication::receive_packet() {
-  if (rx_buf_tail == rx_buf_head) return ReceiveCode::NO_DATA_AVAILABLE;
-  while (rx_buf_tail < rx_buf_head) {
-    // Read buffer at tail
-    uint8_t b = RX_BUFFER[rx_buf_tail];
+// Producer side of the rx ring buffer. Parses the packet header and moves the payload from the hardware buffer to the local rx buffer.
+void Communication::rx_read_from_serial_to_local_buffer() {
+  if (Serial.available() == 63) rx_warnings |= RxWarning::RX_WARNING_INSUFFICIENT_RECEIVE_RATE;  // Buffer full
+  while (true) {
+    if (rx_state == 4) {
+      // Wait for space in the rx buffer. Incoming bytes stay in the hardware buffer until the consumer has released enough packets.
+      if (!rx_reserve()) return;
+      rx_write = rx_message_start;
+      rx_state = 5;
+    }
+
+    if (rx_state == 5) {
+      // Transfer payload bytes from hardware buffer to extended local buffer.
+      while (Serial.available() && rx_write < rx_message_start + rx_message_length) RX_BUFFER[rx_write++] = Serial.read();
+      if (rx_write < rx_message_start + rx_message_length) return;  // Wait for more data
+
+      // Publish the packet. The compiler barrier makes sure that the slot is written before the head index.
+      RxSlot &slot = rx_slots[rx_slot_head % RX_SLOT_COUNT];
+      slot.start = rx_message_start;
+      slot.length = rx_message_length;
+      slot.type = rx_packet_type;
+      __asm__ __volatile__("" ::: "memory");
+      rx_slot_head++;
+      rx_state = 0;
+      continue;
+    }
+
+    if (!Serial.available()) return;
+    uint8_t b = Serial.read();
 
     if (b == PACKET_START_TOKEN) {
       digitalWrite(LED_BUILTIN, HIGH);
-      if (rx_state != 0) message_enqueue_for_transmit(F("Warning: PREVIOUS_PACKET_INCOMPLETE"));  // Previous message is corrupted since new start token is found but rx_state is not 0
-
-      rx_buf_tail++;
+      if (rx_state != 0) rx_warnings |= RxWarning::RX_WARNING_PREVIOUS_PACKET_INCOMPLETE;  // Previous message is corrupted since new start token is found but rx_state is not 0
       rx_state = 1;
       continue;
     }
 
     switch (rx_state) {
       case 1:
-        // Read the message length byte 1 (most significant byte) -> Big endian byte format
-        rx_message_length = 0;  // Reset variable since new message starts
-        rx_message_length = b << 8;
-
-        rx_buf_tail++;
+        // Read the packet type
+        rx_packet_type = b;
         rx_state = 2;
         break;
       case 2:
+        // Read the message length byte 1 (most significant byte) -> Big endian byte format
+        rx_message_length = b << 8;
+        rx_state = 3;
+        break;
+      case 3:
         // Read the message length byte 2 (least significant byte) -> Big endian byte format
         rx_message_length |= b;
 
-        // Verify that the message length doesn't exceed the buffer size
+        // Verify that the message length doesn't exceed the buffer size. If it does, discard it.
         if (rx_message_length > RX_BUFFER_SIZE) {
-          // If it exceeds the buffer size, discard it.
+          rx_warnings |= RxWarning::RX_WARNING_MESSAGE_EXCEEDS_RX_BUFFER_SIZE;
           rx_state = 0;
-          rx_buf_tail = 0;
-          rx_buf_head = 0;
-          return ReceiveCode::MESSAGE_EXCEEDS_RX_BUFFER_SIZE;
+          break;
         }
-        rx_packet_info.timestamp_us = micros();
-        rx_packet_info.message_length = rx_message_length;
-        rx_buf_tail++;
-        rx_message_start = rx_buf_tail;
-        rx_state = 3;
+        rx_packet_progress.timestamp_us = micros();
+        rx_packet_progress.message_length = rx_message_length;
+        rx_state = 4;
         break;
-      case 3:
-        // Wait for message to be complete
-        rx_buf_tail = min(rx_message_length + rx_message_start, rx_buf_head);
-        if (rx_message_length - (rx_buf_tail - rx_message_start) > 0) break;  // Wait for more data
-
-        // Reset receive state machine.
-        rx_state = 0;
-        if (rx_buf_tail == rx_buf_head) {  // Only roll back read progress indicators when there hasn't already been received new data.
-          rx_buf_tail = 0;
-          rx_buf_head = 0;
-        }
+    }
+  }
+}
 
-        // Try deserialization now that packet has been fully received. Don't use zero-copy mode since buffer may not be changed inplace as it is needed for the debug message.
-        StaticJsonDocument<JSON_DOC_SIZE_RX> rx_doc;
-        const DeserializationError err = deserializeJson(rx_doc, (const char *)RX_BUFFER + rx_message_start, rx_message_length);
+// Reserves a contiguous region of rx_message_length bytes for the payload that is currently received. Sets rx_message_start on success.
+// The occupied part of the buffer reaches from the start of the oldest unreleased slot up to rx_write. If that part already wraps around the end of the buffer, the new payload must fit in between.
+// Returns false if there isn't enough space yet.
+bool Communication::rx_reserve() {
+  const uint8_t tail = rx_slot_tail;
+  const uint8_t head = rx_slot_head;
+  if (head == tail) {
+    rx_message_start = 0;  // Every packet has been released, so start over at the beginning of the buffer
+    return true;
+  }
+  if ((uint8_t)(head - tail) >= RX_SLOT_COUNT) return false;
+
+  const uint16_t oldest_start = rx_slots[tail % RX_SLOT_COUNT].start;
+  const bool wrapped = rx_slots[(uint8_t)(head - 1) % RX_SLOT_COUNT].start < oldest_start;
+  if (wrapped) {
+    if (rx_write + rx_message_length >= oldest_start) return false;
+    rx_message_start = rx_write;
+  } else if (rx_write + rx_message_length <= RX_BUFFER_SIZE) {
+    rx_message_start = rx_write;
+  } else {
+    if (rx_message_length >= oldest_start) return false;
+    rx_message_start = 0;  // Wrap around
+  }
+  return true;
+}
 
-        if (err) {
-          message_append(F("Error: "));
-          message_append(err.f_str());
-          message_append(F(" when deserializing: "));
-          message_enqueue_for_transmit(RX_BUFFER + rx_message_start, rx_message_length);
-          return ReceiveCode::DESERIALIZATION_FAILED;
-        }
+static const __FlashStringHelper *parse_error_text(ReceiveParser::Error err) {
+  switch (err) {
+    case ReceiveParser::INCOMPLETE_INPUT: return F("IncompleteInput");
+    case ReceiveParser::INVALID_INPUT: return F("InvalidInput");
+    case ReceiveParser::TOO_DEEP: return F("TooDeep");
+    case ReceiveParser::NUMBER_TOO_LONG: return F("NumberTooLong");
+    default: return F("Ok");
+  }
+}
 
-        // Update rx_data when message is valid
-        rx_data.from_doc(rx_doc);
-        digitalWrite(LED_BUILTIN, LOW);
-        return ReceiveCode::PACKET_RECEIVED;
+// Consumer side of the rx ring buffer. Parses the oldest published packet in place and releases its slot afterwards. c.f. RX_PARSE_BUDGET_US
+Communication::ReceiveCode Communication::receive_packet() {
+  if (rx_warnings & RxWarning::RX_WARNING_MESSAGE_EXCEEDS_RX_BUFFER_SIZE) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      rx_warnings &= ~RxWarning::RX_WARNING_MESSAGE_EXCEEDS_RX_BUFFER_SIZE;
+    }
+    return ReceiveCode::MESSAGE_EXCEEDS_RX_BUFFER_SIZE;
+  }
 
-        break;
+  if (rx_slot_tail == rx_slot_head) {
+    if (rx_state == 0) return ReceiveCode::NO_DATA_AVAILABLE;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      rx_packet_info = rx_packet_progress;
     }
+    return ReceiveCode::RX_IN_PROGRESS;
   }
 
-  return ReceiveCode::RX_IN_PROGRESS;
+  const RxSlot slot = rx_slots[rx_slot_tail % RX_SLOT_COUNT];
+  rx_packet_info.message_length = slot.length;
+  rx_packet_info.updated_members = 0;
+  ReceiveCode code = ReceiveCode::PACKET_RECEIVED;
+
+  if (slot.type != PacketType::JSON_PACKET) {
+    code = ReceiveCode::UNKNOWN_PACKET_TYPE;  // Only JSON is accepted from the GUI.
+  } else {
+    if (!rx_parsing) {
+      rx_staged = rx_data;
+      rx_parser.reset();
+      rx_parse_offset = 0;
+      rx_parsing = true;
+    }
+
+    // Parse in chunks until the budget is used up. The rest of an invalid packet is skipped.
+    const uint32_t start_us = micros();
+    bool valid = true;
+    while (valid && rx_parse_offset < slot.length && micros() - start_us < RX_PARSE_BUDGET_US) {
+      const uint16_t chunk_size = min((uint16_t)(slot.length - rx_parse_offset), (uint16_t)RX_PARSE_CHUNK_SIZE);
+      valid = rx_parser.feed(RX_BUFFER + slot.start + rx_parse_offset, chunk_size);
+      rx_parse_offset += chunk_size;
+    }
+    if (valid && rx_parse_offset < slot.length) return ReceiveCode::PACKET_PARSING;  // The slot is kept until the packet is parsed completely
+    rx_parsing = false;
+
+    const ReceiveParser::Error err = rx_parser.finish();
+
+    if (err != ReceiveParser::OK) {
+      message_append(F("Error: "));
+      message_append(parse_error_text(err));
+      message_append(F(" when deserializing packet ["));
+      char msg_bytes_num[6];
+      itoa(slot.length, msg_bytes_num, 10);
+      message_append(msg_bytes_num, sizeof(msg_bytes_num));
+      message_enqueue_for_transmit(F(" Bytes]"));
+      code = ReceiveCode::DESERIALIZATION_FAILED;
+    } else {
+      // rx_data is read by the control step which interrupts loop(), so the members are applied with interrupts disabled. Members that loop() changed meanwhile are kept.
+      rx_packet_info.updated_members = rx_parser.updated_members();
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        rx_data.assign_members(rx_staged, rx_packet_info.updated_members);
+      }
+    }
+  }
+
+  rx_slot_tail++;  // Release slot
+  if (rx_slot_tail == rx_slot_head && rx_state == 0) digitalWrite(LED_BUILTIN, LOW);
+  return code;
 }
 
 /* 
@@ -140,79 +228,495 @@ If ENABLE_RX_INTERRUPT_POLLING is defined:
   Receives data from the local rx buffer which is filled by interrupt polling from the smaller buffer of the Serial class.
   The size of this buffer is not changable without modding the Arduino implementation, so this approach was developed.
   It is unclear if the resulting overhead when polling at a fixed rate by interrupt additioanlly to the interrupts caused when actually receiving data is affecting the runtime negatively.
+  Since the local buffer is a single producer single consumer ring buffer, the interrupt stays enabled while packets are deserialized.
 Otherwise:
   Receives data from the serial port buffer directly by polling when called in loop().
 
 Both methods read only the available chunk of data and then return thus leaving the message completion up for the next cycles.
 */
 Communication::ReceiveCode Communication::async_receive() {
-#ifdef ENABLE_RX_INTERRUPT_POLLING
-  // Freeze hardware buffer read routine during evaluation of local buffer.
-  disable_rx_serial_buffer_read_interrupt();
-#else
+#ifndef ENABLE_RX_INTERRUPT_POLLING
   // Introduce same routine as what is used in an ISR when ENABLE_RX_INTERRUPT_POLLING is set.
-  rx_read_from_serial_to_local_buffer();
+  if (!serial_suspended) rx_read_from_serial_to_local_buffer();
 #endif
 
+  // Report warnings that were raised by the producer
+  uint8_t warnings;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    warnings = rx_warnings;
+    rx_warnings &= RxWarning::RX_WARNING_MESSAGE_EXCEEDS_RX_BUFFER_SIZE;  // This one is returned as receive code
+  }
+  if (warnings & RxWarning::RX_WARNING_INSUFFICIENT_RECEIVE_RATE) event(Event::EVENT_INSUFFICIENT_RECEIVE_RATE);
+  if (warnings & RxWarning::RX_WARNING_PREVIOUS_PACKET_INCOMPLETE) event(Event::EVENT_PREVIOUS_PACKET_INCOMPLETE);
+
   // Call implementation
-  ReceiveCode code = receive_packet();
+  return receive_packet();
+}
 
-#ifdef ENABLE_RX_INTERRUPT_POLLING
-  // Reenable hardware buffer read interrupts during loop
-  enable_rx_serial_buffer_read_interrupt();
-#endif
+// Writes the PACKET_HEADER_SIZE bytes header (start token + packet type + payload length) to dest.
+// Sequence number and timestamp are left blank, since they are only filled in by stamp_tx_packet() when the packet starts transmission.
+void Communication::write_packet_header(PacketType type, uint16_t payload_length, char *dest) {
+  dest[0] = PACKET_START_TOKEN;
+  dest[1] = type;
 
-  return code;
+  // Big endian byte format for length information
+  dest[2] = highByte(payload_length);
+  dest[3] = lowByte(payload_length);
 }
 
-// Builds a packet from tx_doc with a 3 bytes header (start token (1 byte) + message length (2 bytes)) prepended in dest.
+// Builds a packet from tx_doc with the packet header prepended in dest.
 // Returns the length of the packet built by this function.
 size_t Communication::build_packet(const JsonDocument &tx_doc, char *dest, size_t dest_size) {
-  // There must be space for the three header bytes + json message length
-  if (dest_size < 3 + measureJson(tx_doc)) return 0;
+  // There must be space for the header bytes + json message length
+  if (dest_size < PACKET_HEADER_SIZE + measureJson(tx_doc)) return 0;
 
-  size_t data_len = serializeJson(tx_doc, dest + 3, dest_size - 3);
-  dest[0] = PACKET_START_TOKEN;
+  size_t data_len = serializeJson(tx_doc, dest + PACKET_HEADER_SIZE, dest_size - PACKET_HEADER_SIZE);
+  write_packet_header(PacketType::JSON_PACKET, data_len, dest);
+  return PACKET_HEADER_SIZE + data_len;
+}
 
-  // Big endian byte format for length information
-  dest[1] = highByte(data_len);
-  dest[2] = lowByte(data_len);
-  return 3 + data_len;  // 3 bytes header + Json msg length
+// Builds a binary telemetry packet from the channels of tx and the queued events with the packet header prepended in dest.
+// The payload consists of the schema hash of the transmit interface, the channel flags, the packed channels, the event count (1 byte), the event records
+// and a CRC-16/XMODEM calculated over all of them (Little endian byte format).
+// Returns the length of the packet built by this function.
+size_t Communication::build_packet(const TransmitInterface &tx, TransmitInterface::ChannelFlags channels, char *dest, size_t dest_size) {
+  const uint8_t event_records = pending_event_records();
+  size_t packet_size = binary_telemetry_packet_size(channels, event_records);
+  if (dest_size < packet_size) return 0;
+  size_t content_size = packet_size - PACKET_HEADER_SIZE - 2;
+
+  uint8_t *payload = (uint8_t *)dest + PACKET_HEADER_SIZE;
+  bin_write<uint32_t>(payload, INTERFACE_SCHEMA_HASH_TX);
+  bin_write<TransmitInterface::ChannelFlags>(payload + 4, channels);
+  uint8_t *events_dest = payload + 4 + sizeof(channels) + tx.to_bin(payload + 4 + sizeof(channels), channels);
+  events_dest[0] = event_records;
+  write_event_records(events_dest + 1);
+
+  uint16_t crc = 0;
+  for (size_t i = 0; i < content_size; i++) crc = _crc_xmodem_update(crc, payload[i]);
+  bin_write<uint16_t>(payload + content_size, crc);
+
+  write_packet_header(PacketType::BINARY_TELEMETRY_PACKET, content_size + 2, dest);
+  return packet_size;
 }
 
-// Appends a data packet inferred from tx_doc to the transmit buffer.
-Communication::TransmitCode Communication::enqueue_for_transmit(const JsonDocument &tx_doc) {
-  if (tx_doc.overflowed()) return TransmitCode::TX_DOC_OVERFLOW;
+// Returns the size of a binary telemetry packet including its header if only channels are subscribed and event_records are attached.
+size_t Communication::binary_telemetry_packet_size(TransmitInterface::ChannelFlags channels, uint8_t event_records) {
+  return PACKET_HEADER_SIZE + 4 + sizeof(channels) + TransmitInterface::bin_size(channels) + 1 + event_records * EVENT_RECORD_SIZE + 2;
+}
+
+// Number of event records sent with the next telemetry update, including the one for dropped events.
+uint8_t Communication::pending_event_records() const {
+  return event_count + (events_dropped > 0 ? 1 : 0);
+}
+
+// Writes the pending event records to dest, each as code (1 byte) and argument (2 bytes).
+void Communication::write_event_records(uint8_t *dest) const {
+  for (uint8_t i = 0; i < event_count; i++) {
+    dest[0] = events[i].code;
+    bin_write<uint16_t>(dest + 1, events[i].arg);
+    dest += EVENT_RECORD_SIZE;
+  }
+  if (events_dropped > 0) {
+    dest[0] = Event::EVENT_EVENTS_DROPPED;
+    bin_write<uint16_t>(dest + 1, events_dropped);
+  }
+}
+
+// Removes the oldest count events and dropped of the dropped events from the queue after they were sent.
+void Communication::release_events(uint8_t count, uint16_t dropped) {
+  memmove(events, events + count, (event_count - count) * sizeof(EventRecord));
+  event_count -= count;
+  events_dropped -= dropped;
+}
+
+// Removes the events of the telemetry packets that started transmission since the previous call from the queue.
+void Communication::release_sent_events() {
+  uint8_t count;
+  uint16_t dropped;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    count = events_sent;
+    dropped = events_dropped_sent;
+    events_sent = 0;
+    events_dropped_sent = 0;
+  }
+  release_events(count, dropped);
+}
+
+// Queues a status event, which is sent with the next telemetry update. Must only be called from loop().
+void Communication::event(Event code, uint16_t arg) {
+  release_sent_events();
+  if (event_count < EVENT_QUEUE_SIZE) events[event_count++] = EventRecord{ code, arg };
+  else if (events_dropped < UINT16_MAX) events_dropped++;
+}
+
+Communication::TxRing::TxRing(uint8_t *buffer, uint16_t size)
+  : buffer(buffer), size(size) {}
+
+// Returns the beginning of a contiguous region of length bytes behind the queued packets or nullptr if there isn't enough space.
+// The region must be written and committed before anything else is reserved.
+uint8_t *Communication::TxRing::reserve(uint16_t length) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (head == tail) {
+      head = 0;  // Every packet has been released, so start over at the beginning of the buffer
+      tail = 0;
+    }
+    if (head >= tail) {
+      if (size - head >= length) return buffer + head;
+      if (tail <= length) return nullptr;  // head must stay behind tail, since head == tail means empty
+      end = head;                         // Wrap around
+      head = 0;
+      return buffer;
+    }
+    if (tail - head <= length) return nullptr;
+    return buffer + head;
+  }
+  return nullptr;
+}
+
+// Publishes the packet written to the reserved region.
+void Communication::TxRing::commit(uint16_t length) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    head += length;
+  }
+}
 
-  // Create data packet. If there is no place for it in the buffer this function returns 0.
-  size_t packet_size = build_packet(tx_doc, TX_BUFFER + tx_buf_head, TX_BUFFER_SIZE - tx_buf_head);
+// Returns the oldest packet or nullptr if the ring is empty.
+uint8_t *Communication::TxRing::front() const {
+  return head == tail ? nullptr : buffer + tail;
+}
+
+// Releases the oldest packet of length bytes after it was transmitted.
+void Communication::TxRing::release(uint16_t length) {
+  tail += length;
+  if (head < tail && tail == end) tail = 0;
+}
+
+uint16_t Communication::TxRing::used() const {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    return head >= tail ? head - tail : end - tail + head;
+  }
+  return 0;
+}
+
+Communication::TxRing &Communication::tx_ring(TxLane lane) {
+  return lane == TxLane::TX_LANE_CRITICAL ? tx_critical : tx_status;
+}
+
+void Communication::count_tx_drop(TxLane lane) {
+  if (tx_dropped[lane] < UINT16_MAX) tx_dropped[lane]++;
+}
+
+// Returns the number of packets dropped in lane since the start, or replaced by a newer one for the telemetry lane. Saturates at UINT16_MAX.
+uint16_t Communication::tx_dropped_packets(TxLane lane) const {
+  return tx_dropped[lane];
+}
 
-  // Append packet to tx serial buffer if it was successfully created
-  if (packet_size > 0) {
-    tx_buf_head += packet_size;
+// Returns the slot the next telemetry packet is built in. That is the one of the waiting packet, which is withdrawn from the transmitter, or else the one that is not transmitted.
+uint8_t Communication::claim_telemetry_slot() {
+  uint8_t slot;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    slot = telemetry_pending;
+    telemetry_pending = NO_TELEMETRY_SLOT;
+    if (slot == NO_TELEMETRY_SLOT) slot = telemetry_in_flight == 0 ? 1 : 0;
+    else count_tx_drop(TxLane::TX_LANE_TELEMETRY);  // The waiting packet is replaced
+  }
+  return slot;
+}
+
+void Communication::publish_telemetry(uint8_t slot, uint16_t length, uint8_t carried_events, uint16_t carried_events_dropped) {
+  telemetry_frames[slot] = TelemetryFrame{ length, carried_events, carried_events_dropped };
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    telemetry_pending = slot;
+  }
+}
+
+// Appends a data packet inferred from tx_doc to lane.
+Communication::TransmitCode Communication::enqueue_for_transmit(const JsonDocument &tx_doc, TxLane lane) {
+  if (tx_doc.overflowed()) return TransmitCode::TX_DOC_OVERFLOW;
+
+  const size_t packet_size = PACKET_HEADER_SIZE + measureJson(tx_doc);
+  if (lane == TxLane::TX_LANE_TELEMETRY) {
+    if (packet_size > TX_TELEMETRY_SLOT_SIZE) return TransmitCode::TX_BUFFER_TOO_SMALL_TO_FIT_DATA;  // A waiting packet is only replaced by one that fits
+    const uint8_t slot = claim_telemetry_slot();
+    publish_telemetry(slot, build_packet(tx_doc, (char *)TX_TELEMETRY_SLOTS[slot], TX_TELEMETRY_SLOT_SIZE), 0, 0);
     return TransmitCode::TX_SUCCESS;
   }
-  if (3 + measureJson(tx_doc) > TX_BUFFER_SIZE) return TransmitCode::TX_BUFFER_TOO_SMALL_TO_FIT_DATA;  // This occurs if the data is too big to fit in the transmit buffer
-  return TransmitCode::TRANSMIT_RATE_TOO_LOW;                                                          // This occurs if the buffer cannot be depleted faster than new data is added. The buffer would overflow if the recent packet would be added, so it is discarded.
+
+  if (packet_size >= (lane == TxLane::TX_LANE_CRITICAL ? TX_CRITICAL_BUFFER_SIZE : TX_STATUS_BUFFER_SIZE)) return TransmitCode::TX_BUFFER_TOO_SMALL_TO_FIT_DATA;  // This occurs if the data is too big to fit in the lane
+  TxRing &ring = tx_ring(lane);
+  char *dest = (char *)ring.reserve(packet_size);
+  if (!dest) {
+    count_tx_drop(lane);
+    return TransmitCode::TRANSMIT_RATE_TOO_LOW;  // This occurs if the lane cannot be depleted faster than new data is added. The lane would overflow if the recent packet would be added, so it is discarded.
+  }
+  ring.commit(build_packet(tx_doc, dest, packet_size));
+  return TransmitCode::TX_SUCCESS;
 }
 
-// Forwards bytes from the transmit buffer to the hardware buffer that sends out serial data.
-// Returns the number of bytes that are left for transmission.
-uint16_t Communication::async_transmit() {
-  if (tx_buf_head > tx_buf_tail) {
-    uint8_t available_bytes = Serial.availableForWrite();  // check how much space is available in the serial buffer
-    if (available_bytes > 0) {
-      // write as much data as possible without blocking and update start counter to point to the start of the remaining data
-      tx_buf_tail += Serial.write(TX_BUFFER + tx_buf_tail, min(tx_buf_head - tx_buf_tail, available_bytes));
-
-      // reset counters if tx serial buffer was fully transmitted and is currently empty
-      if (tx_buf_tail == tx_buf_head) {
-        tx_buf_tail = 0;
-        tx_buf_head = 0;
-      }
+// Builds a binary telemetry packet with the channels of tx in the telemetry lane.
+Communication::TransmitCode Communication::enqueue_for_transmit(const TransmitInterface &tx, TransmitInterface::ChannelFlags channels) {
+  const uint8_t slot = claim_telemetry_slot();  // Before the sent events are released, since the claimed packet may just have started transmission
+  release_sent_events();
+  const uint8_t carried_events = event_count;
+  const uint16_t carried_events_dropped = events_dropped;
+  size_t packet_size = build_packet(tx, channels, (char *)TX_TELEMETRY_SLOTS[slot], TX_TELEMETRY_SLOT_SIZE);
+  if (packet_size == 0) return TransmitCode::TX_BUFFER_TOO_SMALL_TO_FIT_DATA;  // Doesn't occur, since a slot fits all channels and events, without a waiting packet then
+  publish_telemetry(slot, packet_size, carried_events, carried_events_dropped);
+  return TransmitCode::TX_SUCCESS;
+}
+
+// Appends a binary packet of type to the status lane. The payload consists of schema_hash, content and a CRC-16/XMODEM calculated over both (Little endian byte format).
+Communication::TransmitCode Communication::enqueue_for_transmit(PacketType type, uint32_t schema_hash, const uint8_t *content, size_t content_size) {
+  const size_t payload_size = 4 + content_size + 2;
+  if (PACKET_HEADER_SIZE + payload_size >= TX_STATUS_BUFFER_SIZE) return TransmitCode::TX_BUFFER_TOO_SMALL_TO_FIT_DATA;
+  uint8_t *dest = tx_status.reserve(PACKET_HEADER_SIZE + payload_size);
+  if (!dest) {
+    count_tx_drop(TxLane::TX_LANE_STATUS);
+    return TransmitCode::TRANSMIT_RATE_TOO_LOW;
+  }
+
+  uint8_t *payload = dest + PACKET_HEADER_SIZE;
+  bin_write<uint32_t>(payload, schema_hash);
+  memcpy(payload + 4, content, content_size);
+
+  uint16_t crc = 0;
+  for (size_t i = 0; i < 4 + content_size; i++) crc = _crc_xmodem_update(crc, payload[i]);
+  bin_write<uint16_t>(payload + 4 + content_size, crc);
+
+  write_packet_header(type, payload_size, (char *)dest);
+  tx_status.commit(PACKET_HEADER_SIZE + payload_size);
+  return TransmitCode::TX_SUCCESS;
+}
+
+// Builds the channels of tx_data the GUI subscribed to by rx_data.subscription and the queued events in the telemetry lane using the telemetry encoding selected by ENABLE_BINARY_TELEMETRY.
+// With JSON, the events are appended to the status lane in a document of their own as array of [code, argument] pairs.
+// tx_data is written by the control step which interrupts loop(), so a consistent snapshot is taken before encoding it.
+Communication::TransmitCode Communication::enqueue_tx_data() {
+  TransmitInterface tx_snapshot;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    tx_snapshot = tx_data;
+  }
+#ifdef ENABLE_BINARY_TELEMETRY
+  return enqueue_for_transmit(tx_snapshot, rx_data.subscription);
+#else
+  TransmitCode tx_code = enqueue_for_transmit(tx_snapshot.to_doc(rx_data.subscription), TxLane::TX_LANE_TELEMETRY);
+  if (tx_code != TransmitCode::TX_SUCCESS || pending_event_records() == 0) return tx_code;
+
+  StaticJsonDocument<JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(EVENT_QUEUE_SIZE + 1) + (EVENT_QUEUE_SIZE + 1) * JSON_ARRAY_SIZE(2)> events_doc;
+  JsonArray records = events_doc.createNestedArray(EVENTS_KEY);
+  for (uint8_t i = 0; i < event_count; i++) {
+    JsonArray record = records.createNestedArray();
+    record.add(events[i].code);
+    record.add(events[i].arg);
+  }
+  if (events_dropped > 0) {
+    JsonArray record = records.createNestedArray();
+    record.add(Event::EVENT_EVENTS_DROPPED);
+    record.add(events_dropped);
+  }
+  tx_code = enqueue_for_transmit(events_doc, TxLane::TX_LANE_STATUS);
+  if (tx_code == TransmitCode::TX_SUCCESS) release_events(event_count, events_dropped);
+  return tx_code;
+#endif
+}
+
+#ifdef ENABLE_SAMPLE_TELEMETRY
+// Records the members of tx_data listed in FROM_DEVICE_SAMPLE together with timestamp_us. Must only be called by the control step.
+// Members that are written by loop() instead of the control step may be recorded inconsistently.
+// Called by the control step before a step that is recorded. Returns the buffer of ControlKernel::STATE_SIZE bytes to save the kernel state to if the record needs to carry it, otherwise nullptr.
+// If the state of a previous recording wasn't sent yet, it is captured for a later step.
+uint8_t *Communication::capture_record_state() {
+  if (record_chain || record_state_attached) return nullptr;
+  record_state_captured = true;
+  return record_state;
+}
+
+void Communication::record_sample(uint32_t timestamp_us) {
+  const bool captured = record_state_captured;
+  record_state_captured = false;
+  if ((uint8_t)(sample_head - sample_tail) == SAMPLE_SLOT_COUNT) {
+    if (samples_dropped < UINT8_MAX) samples_dropped++;
+    record_chain = false;
+    return;
+  }
+
+  Sample &sample = samples[sample_head % SAMPLE_SLOT_COUNT];
+  sample.timestamp_us = timestamp_us;
+  sample.record = rx_data.recording;
+  if (sample.record) {
+    record_data.to_bin(sample.data);
+    if (captured) {
+      record_state_sample = sample_head;
+      record_state_attached = true;
+      record_chain = true;
     }
+  } else {
+    tx_data.sample_to_bin(sample.data);
+    record_chain = false;
   }
-  return tx_buf_head - tx_buf_tail;
+  sample_head++;  // Publish sample
+}
+
+// Appends a batch of recorded samples to the status lane, once SAMPLE_BATCH_SIZE samples are available or the oldest one waits for longer than SAMPLE_BATCH_MAX_DELAY_US.
+// The payload consists of the schema hash of the sample layout, the timestamp of the first sample, the sample count, the number of samples dropped since the previous batch,
+// the samples each prepended by its time delta in µs to the previous one (the first sample has a delta of 0), and a CRC-16/XMODEM calculated over all of it (Little endian byte format).
+// A batch ends before a sample whose time delta doesn't fit 16 bits, e.g. after the control was paused. That sample starts the next batch.
+// Records are sent the same way in record batches (RECORD_BATCH_PACKET) with the schema hash of the record layout. A batch ends where recording was switched on or off.
+// Their header continues with the CRC of the parameters, the format of the kernel arithmetic (ControlArithmetic::FORMAT), the size of the kernel state and the kernel state.
+// The state is only contained in the batch that starts with the record it was attached to (c.f. capture_record_state()) and has a size of 0 otherwise.
+Communication::TransmitCode Communication::enqueue_samples() {
+  const uint8_t tail = sample_tail;
+  const uint8_t available = sample_head - tail;
+  if (available == 0) return TransmitCode::TX_SUCCESS;
+  const Sample &first = samples[tail % SAMPLE_SLOT_COUNT];
+  if (available < SAMPLE_BATCH_SIZE && micros() - first.timestamp_us < SAMPLE_BATCH_MAX_DELAY_US) return TransmitCode::TX_SUCCESS;  // Wait for more samples
+
+  const bool state_attached = record_state_attached;
+  const uint8_t state_sample = record_state_sample;
+  uint8_t count = 1;
+  while (count < min(available, SAMPLE_BATCH_SIZE)
+         && samples[(uint8_t)(tail + count) % SAMPLE_SLOT_COUNT].record == first.record
+         && !(state_attached && (uint8_t)(tail + count) == state_sample)
+         && samples[(uint8_t)(tail + count) % SAMPLE_SLOT_COUNT].timestamp_us - samples[(uint8_t)(tail + count - 1) % SAMPLE_SLOT_COUNT].timestamp_us <= UINT16_MAX) {
+    count++;
+  }
+
+  const size_t data_size = first.record ? BIN_SIZE_RECORD : BIN_SIZE_SAMPLE;
+  const size_t sample_size = first.record ? RECORD_BATCH_RECORD_SIZE : SAMPLE_BATCH_SAMPLE_SIZE;
+  const bool with_state = state_attached && tail == state_sample;
+  const size_t header_size = first.record ? RECORD_BATCH_HEADER_SIZE + (with_state ? RECORD_STATE_SIZE : 0) : SAMPLE_BATCH_HEADER_SIZE;
+  const size_t payload_size = header_size + count * sample_size + 2;
+  uint8_t *packet = tx_status.reserve(PACKET_HEADER_SIZE + payload_size);
+  if (!packet) return TransmitCode::TRANSMIT_RATE_TOO_LOW;  // Samples are kept and sent later, so they don't count as dropped packets
+
+  uint8_t dropped;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    dropped = samples_dropped;
+    samples_dropped = 0;
+  }
+
+  uint8_t *payload = packet + PACKET_HEADER_SIZE;
+  bin_write<uint32_t>(payload, first.record ? INTERFACE_SCHEMA_HASH_RECORD : INTERFACE_SCHEMA_HASH_SAMPLE);
+  bin_write<uint32_t>(payload + 4, first.timestamp_us);
+  payload[8] = count;
+  payload[9] = dropped;
+  if (first.record) {
+    bin_write<uint16_t>(payload + SAMPLE_BATCH_HEADER_SIZE, tx_data.parameters_crc);
+    bin_write<uint16_t>(payload + SAMPLE_BATCH_HEADER_SIZE + 2, ControlArithmetic::FORMAT);
+    payload[SAMPLE_BATCH_HEADER_SIZE + 4] = with_state ? RECORD_STATE_SIZE : 0;
+    if (with_state) memcpy(payload + RECORD_BATCH_HEADER_SIZE, record_state, RECORD_STATE_SIZE);
+  }
+
+  uint8_t *dest = payload + header_size;
+  uint32_t prev_timestamp_us = first.timestamp_us;
+  for (uint8_t i = 0; i < count; i++) {
+    const Sample &sample = samples[(uint8_t)(tail + i) % SAMPLE_SLOT_COUNT];
+    bin_write<uint16_t>(dest, sample.timestamp_us - prev_timestamp_us);
+    memcpy(dest + 2, sample.data, data_size);
+    prev_timestamp_us = sample.timestamp_us;
+    dest += sample_size;
+  }
+
+  uint16_t crc = 0;
+  for (size_t i = 0; i < payload_size - 2; i++) crc = _crc_xmodem_update(crc, payload[i]);
+  bin_write<uint16_t>(payload + payload_size - 2, crc);
+
+  write_packet_header(first.record ? PacketType::RECORD_BATCH_PACKET : PacketType::SAMPLE_BATCH_PACKET, payload_size, (char *)packet);
+  tx_status.commit(PACKET_HEADER_SIZE + payload_size);
+  sample_tail = tail + count;  // Release samples
+  if (with_state) record_state_attached = false;
+  return TransmitCode::TX_SUCCESS;
+}
+#endif
+
+// Writes the sequence number and the current time in µs to the header of a packet that starts transmission (Big endian byte format like the length).
+// The packets are numbered in the order they are sent rather than built, so telemetry packets replaced in their lane don't leave gaps and the receiver can count a gap as loss.
+void Communication::stamp_tx_packet(uint8_t *packet) {
+  const uint32_t timestamp_us = micros();
+  packet[4] = highByte(tx_sequence);
+  packet[5] = lowByte(tx_sequence);
+  packet[6] = timestamp_us >> 24;
+  packet[7] = timestamp_us >> 16;
+  packet[8] = timestamp_us >> 8;
+  packet[9] = timestamp_us;
+  tx_sequence++;
+}
+
+// Selects the next packet to be transmitted from the lane with the highest priority that has one. Returns false if every lane is empty. Called from the serial buffer interrupt.
+bool Communication::next_tx_packet() {
+  for (uint8_t lane = TxLane::TX_LANE_CRITICAL; lane < TxLane::TX_LANE_TELEMETRY; lane++) {
+    uint8_t *packet = tx_ring((TxLane)lane).front();
+    if (packet) {
+      stamp_tx_packet(packet);
+      tx_packet = packet;
+      tx_packet_length = PACKET_HEADER_SIZE + ((packet[2] << 8) | packet[3]);
+      tx_packet_lane = (TxLane)lane;
+      tx_packet_remaining = tx_packet_length;
+      return true;
+    }
+  }
+
+  if (telemetry_pending == NO_TELEMETRY_SLOT) return false;
+  telemetry_in_flight = telemetry_pending;
+  telemetry_pending = NO_TELEMETRY_SLOT;
+  const TelemetryFrame &frame = telemetry_frames[telemetry_in_flight];
+  events_sent += frame.carried_events;  // The packet can't be replaced anymore
+  events_dropped_sent += frame.carried_events_dropped;
+  stamp_tx_packet(TX_TELEMETRY_SLOTS[telemetry_in_flight]);
+  tx_packet = TX_TELEMETRY_SLOTS[telemetry_in_flight];
+  tx_packet_length = frame.length;
+  tx_packet_lane = TxLane::TX_LANE_TELEMETRY;
+  tx_packet_remaining = tx_packet_length;
+  return true;
+}
+
+void Communication::finish_tx_packet() {
+  if (tx_packet_lane == TxLane::TX_LANE_TELEMETRY) telemetry_in_flight = NO_TELEMETRY_SLOT;
+  else tx_ring(tx_packet_lane).release(tx_packet_length);
+}
+
+// Returns the number of bytes that are queued in all lanes and not forwarded to the hardware buffer yet.
+uint16_t Communication::tx_pending_bytes() const {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    uint16_t bytes = tx_critical.used() + tx_status.used();  // Includes the packet being transmitted if it is from one of them
+    if (tx_packet_remaining > 0) {
+      if (tx_packet_lane == TxLane::TX_LANE_TELEMETRY) bytes += tx_packet_remaining;
+      else bytes -= tx_packet_length - tx_packet_remaining;
+    }
+    if (telemetry_pending != NO_TELEMETRY_SLOT) bytes += telemetry_frames[telemetry_pending].length;
+    return bytes;
+  }
+  return 0;
+}
+
+// Returns the transmit statistics since the previous call and restarts them
+Communication::TxDrain Communication::take_tx_drain() {
+  TxDrain drain;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    drain.sent_bytes = tx_drain.sent_bytes;
+    drain.ran_dry = tx_drain.ran_dry || serial_suspended;  // Nothing is sent while suspended, which must not be taken for the drain rate
+    tx_drain.sent_bytes = 0;
+    tx_drain.ran_dry = false;
+  }
+  return drain;
+}
+
+// Forwards bytes of the queued packets to the hardware buffer that sends out serial data. Called from the serial buffer interrupt.
+// Only as many bytes as there is space for are written, since the Serial class would wait for space with interrupts disabled otherwise.
+void Communication::tx_write_from_local_buffer_to_serial() {
+  while (tx_packet_remaining > 0 || next_tx_packet()) {
+    uint8_t available_bytes = Serial.availableForWrite();  // check how much space is available in the serial buffer
+    if (available_bytes == 0) return;
+
+    // write as much data as possible without blocking and advance to the remaining data
+    size_t written = Serial.write(tx_packet, min(tx_packet_remaining, available_bytes));
+    tx_packet += written;
+    tx_packet_remaining -= written;
+    tx_drain.sent_bytes += written;
+    if (tx_packet_remaining == 0) finish_tx_packet();
+  }
+  tx_drain.ran_dry = true;  // All lanes are empty, so the link isn't saturated
 }
 
 bool Communication::message_append(const __FlashStringHelper *msg) {
@@ -255,17 +759,22 @@ Communication::TransmitCode Communication::message_enqueue_for_transmit(const ch
   return tx_error;
 }
 
-// Transmits a message in a blocking manner. Returns as soon as the message is fully transmitted.
-// This should only be used when an alternative to the asynchronous approach of sending data by appending bytes to the transmit buffer and then forwarding them later to the hardware serial buffer is needed.
+// Transmits a message in a blocking manner. Returns as soon as the message is forwarded to the hardware serial buffer.
+// This should only be used when an alternative to the asynchronous approach of sending data by appending bytes to the transmit lanes and then forwarding them later by interrupt is needed.
+// The Serial class must not be written to directly instead, since the interrupt would corrupt the stream.
+// While the serial port is suspended, the message is dropped, since the lanes aren't depleted.
 void Communication::message_transmit_now(const __FlashStringHelper *msg) {
+  if (serial_suspended) {
+    message_clear();
+    return;
+  }
   message_append(msg);
   StaticJsonDocument<8 + TX_STATUS_MSG_BUFFER_SIZE> status_msg_doc;
   status_msg_doc[STATUS_MESSAGE_KEY] = TX_STATUS_MSG_BUFFER;
-  const size_t buf_size = 3 + measureJson(status_msg_doc);  // Account for 3 bytes header + json message length
-  char buffer[buf_size]{ 0 };
-  size_t status_msg_size = build_packet(status_msg_doc, buffer, buf_size);
-  while (async_transmit() > 0) {};        // Wait for pending data to be transmitted to not corrupt the stream
-  Serial.write(buffer, status_msg_size);  // blocks until all bytes including the null terminal have been written
+  while (tx_critical.used() > 0) {};  // Wait for the critical lane to be depleted, so the message fits
+  if (enqueue_for_transmit(status_msg_doc) == TransmitCode::TX_SUCCESS) {
+    while (tx_critical.used() > 0) {};
+  }
   message_clear();
 }
 
@@ -273,19 +782,48 @@ void Communication::message_clear() {
   strlcpy(TX_STATUS_MSG_BUFFER, "", TX_STATUS_MSG_BUFFER_SIZE);
 }
 
-#ifdef ENABLE_RX_INTERRUPT_POLLING
-// ----------------------- RX Serial Buffer Read Interrupt Handling ------------------------
+// ----------------------- Serial Buffer Interrupt Handling ------------------------
+/*
+The transmitter can't be driven by the data register empty interrupt of the USART directly, since the Serial class, which is also used for receiving, defines it already.
+Therefore the transmit buffer of the Serial class is refilled from the lanes by this timed interrupt instead.
+*/
 
-void Communication::enable_rx_serial_buffer_read_interrupt() {
+void Communication::enable_serial_buffer_interrupt() {
   TIMSK4 = 0;
   TIMSK4 |= (1 << OCIE4A);  // Enable compare match interrupt for OCR4A.
 }
 
-void Communication::disable_rx_serial_buffer_read_interrupt() {
+void Communication::disable_serial_buffer_interrupt() {
   TIMSK4 = 0;  // Clear timer interrupt mask
 }
 
+/*
+Hands the serial port over to the caller, e.g. to talk to the Bluetooth module (c.f. BaudRateSwitch). The packet being transmitted is completed first, so the stream stays intact,
+and the lanes keep their packets until resume_serial(). A partially received packet is discarded on resume.
+*/
+void Communication::suspend_serial() {
+  disable_serial_buffer_interrupt();
+  serial_suspended = true;
+  if (tx_packet_remaining > 0) {
+    Serial.write(tx_packet, tx_packet_remaining);  // Interrupts are enabled, so the Serial class waits for space in its buffer
+    tx_packet_remaining = 0;
+    finish_tx_packet();
+  }
+  Serial.flush();
+}
+
+// Takes the serial port back after suspend_serial(), which may have been reopened at another baud rate meanwhile
+void Communication::resume_serial(uint32_t baud_rate) {
+  set_serial_polling(baud_rate);
+  rx_state = 0;  // The interrupt is disabled, so the producer state can be reset
+  serial_suspended = false;
+  enable_serial_buffer_interrupt();
+}
+
 ISR(TIMER4_COMPA_vect) {
+#ifdef ENABLE_RX_INTERRUPT_POLLING
   comm.rx_read_from_serial_to_local_buffer();
-}
 #endif
+  PROFILE_SCOPE(TRANSMIT);
+  comm.tx_write_from_local_buffer_to_serial();
+}
@@ -3,26 +3,48 @@
 
 #include <Arduino.h>
 #include "interface.hpp"
+#include "parser.hpp"
+#include "../control/kernel.hpp"
 
 // Comment in/out to change receiving approach. If commented out, data is received by sequential polling inside loop().
 #define ENABLE_RX_INTERRUPT_POLLING
 
+// Comment in/out to change the telemetry encoding. If commented out, tx_data is serialized to JSON which is human readable for debugging but several times bigger.
+#define ENABLE_BINARY_TELEMETRY
+
+// Comment in/out to change high rate telemetry. If defined, the members of tx_data listed in FROM_DEVICE_SAMPLE of interface.json are recorded in every control cycle and sent in batches.
+// While rx_data.recording is set, record_data is recorded in their place, c.f. FROM_DEVICE_RECORD.
+#define ENABLE_SAMPLE_TELEMETRY
+
 class Communication {
 public:
   ReceiveInterface rx_data;
   TransmitInterface tx_data;
+  RecordInterface record_data;  // Inputs and outputs of the last control step
 
   struct PacketInfo {
     uint32_t timestamp_us = 0;
     uint16_t message_length = 0;
+    ReceiveInterface::MemberFlags updated_members = 0;  // Members of rx_data updated by the last received packet
   };
   PacketInfo rx_packet_info;
 
+  // Identifies the packet payload. Sent as the second header byte right after the start token.
+  enum PacketType : uint8_t {
+    JSON_PACKET = 'J',
+    BINARY_TELEMETRY_PACKET = 'B',
+    SAMPLE_BATCH_PACKET = 'S',
+    RECORD_BATCH_PACKET = 'R',
+    PROFILE_PACKET = 'P'
+  };
+
   enum ReceiveCode {
     NO_DATA_AVAILABLE,
     PACKET_RECEIVED,
     RX_IN_PROGRESS,
+    PACKET_PARSING,  // A received packet is being parsed, which is continued by the following calls
     MESSAGE_EXCEEDS_RX_BUFFER_SIZE,
+    UNKNOWN_PACKET_TYPE,
     DESERIALIZATION_FAILED
   };
 
@@ -33,50 +55,247 @@ public:
     TRANSMIT_RATE_TOO_LOW
   };
 
+  // Outgoing packets are queued in separate lanes. Between two packets, the transmitter picks the next one from the first lane in this order that has one.
+  enum TxLane : uint8_t {
+    TX_LANE_CRITICAL,   // Text messages, e.g. errors. Sent in order, new packets are dropped if the lane is full.
+    TX_LANE_STATUS,     // Events (JSON telemetry only), sample batches and profiles. Sent in order, new packets are dropped if the lane is full.
+    TX_LANE_TELEMETRY,  // The latest state of tx_data. A packet that is still waiting is replaced by a newer one, so the freshest state is sent.
+    TX_LANE_COUNT
+  };
+
+  // Bytes the transmitter forwarded to the hardware buffer since the previous take_tx_drain() and whether it ran out of packets meanwhile, c.f. TelemetryRate
+  struct TxDrain {
+    uint16_t sent_bytes = 0;
+    bool ran_dry = false;
+  };
+
 private:
-  // The buffer sizes take up almost half of the Arduino's memory! They cannot easily be extended further since communication needs also large amounts of dynamic memory (due to creation of JsonDocument instances).
+  // The buffer sizes take up almost half of the Arduino's memory! They cannot easily be extended further since communication needs also large amounts of dynamic memory (due to creation of JsonDocument instances for status messages).
   static const size_t TX_STATUS_MSG_BUFFER_SIZE = 128;
-  static const size_t TX_BUFFER_SIZE = 1500;  // Tx buffer should be bigger than the size of the outgoing messages to not fill up during a long delay caused by e.g. deserialization of an incoming message.
+  static const size_t TX_CRITICAL_BUFFER_SIZE = 256;  // Fits a single message of TX_STATUS_MSG_BUFFER_SIZE at least
+  static const size_t TX_STATUS_BUFFER_SIZE = 512;    // Lane buffers should be bigger than the packets queued during a long delay caused by e.g. deserialization of an incoming message.
   static const size_t TX_STATUS_MSG_TRUNC_IND_SIZE = 5;
   static const size_t RX_BUFFER_SIZE = 1500;
+  static const size_t PACKET_HEADER_SIZE = 10;                               // Start token (1 byte) + packet type (1 byte) + payload length (2 bytes) + sequence number (2 bytes) + timestamp (4 bytes)
+  static const uint32_t SERIAL_POLLING_BAUD_TICKS = 3456000;                 // Baud rate times the compare value of the serial buffer interrupt, c.f. set_serial_polling()
 
-  size_t tx_buf_tail = 0;  // Counter to indicate the progress of transmitting data from the tx local buffer. Points to the next byte to be written.
-  size_t tx_buf_head = 0;  // Counter to indicate the current length of data in the tx local buffer that is scheduled to be transmitted. Points to the last byte in the buffer.
+  /*
+  Status events are queued by event() and sent along with the next telemetry update instead of a text message each. If the queue is full, further events are dropped and counted.
+  The dropped count is sent as an EVENT_EVENTS_DROPPED event of its own.
+  */
+  struct EventRecord {
+    Event code;
+    uint16_t arg;
+  };
+  static const uint8_t EVENT_QUEUE_SIZE = 8;
+  static const size_t EVENT_RECORD_SIZE = 1 + 2;  // Code (1 byte) + argument (2 bytes)
+
+  EventRecord events[EVENT_QUEUE_SIZE];
+  uint8_t event_count = 0;
+  uint16_t events_dropped = 0;
+
+#ifdef ENABLE_BINARY_TELEMETRY
+  // Fits all channels and a full event queue
+  static const size_t TX_TELEMETRY_SLOT_SIZE = PACKET_HEADER_SIZE + 4 + sizeof(TransmitInterface::ChannelFlags) + BIN_SIZE_TX + 1 + (EVENT_QUEUE_SIZE + 1) * EVENT_RECORD_SIZE + 2;
+#else
+  static const size_t TX_TELEMETRY_SLOT_SIZE = 896;  // Fits all channels in JSON, which needs a lot more memory than the binary encoding
+#endif
+
+  /*
+  The critical and the status lane are single producer single consumer byte ring buffers of whole packets. A packet is never split at the end of the buffer.
+  Instead, the writer wraps around to the beginning if the remaining space doesn't fit it, which is marked by end (c.f. the rx buffer).
+  The length of a queued packet is taken from its header.
+  The producer is loop() (reserve(), commit() and used()), which accesses the indices with interrupts disabled. The consumer is the serial buffer interrupt (front() and release()).
+  */
+  class TxRing {
+    uint8_t *buffer;
+    uint16_t size;
+    uint16_t head = 0;  // Points to the next byte to be written
+    uint16_t tail = 0;  // Points to the oldest packet
+    uint16_t end = 0;   // End of the packets behind tail, if head has wrapped around
+
+  public:
+    TxRing(uint8_t *buffer, uint16_t size);
+    uint8_t *reserve(uint16_t length);
+    void commit(uint16_t length);
+    uint8_t *front() const;
+    void release(uint16_t length);
+    uint16_t used() const;
+  };
+
+  /*
+  The telemetry lane has two slots, so a new packet can be built while the other one is transmitted. The packet waiting in the other slot is replaced.
+  A binary telemetry packet carries the events queued when it was built. They are only removed from the event queue once its transmission starts,
+  so a replacing packet carries them again. The interrupt only counts the events that started transmission, loop() removes them from the queue.
+  */
+  struct TelemetryFrame {
+    uint16_t length;
+    uint8_t carried_events;
+    uint16_t carried_events_dropped;
+  };
+  static const uint8_t NO_TELEMETRY_SLOT = 0xFF;
 
-  uint8_t rx_state = 0;             // State variable for state machine that handles asynchronous packet receiving
-  volatile size_t rx_buf_tail = 0;  // Counter to indicate the progress of receiving data from the rx local buffer. Points to the next byte to be read.
-  volatile size_t rx_buf_head = 0;  // Counter to indicate the current length of data in the rx local buffer that is read later. Points to the last byte in the buffer.
-  size_t rx_message_start = 0;      // Points to the beginning of the currently received message.
+  uint8_t TX_CRITICAL_BUFFER[TX_CRITICAL_BUFFER_SIZE];
+  uint8_t TX_STATUS_BUFFER[TX_STATUS_BUFFER_SIZE];
+  uint8_t TX_TELEMETRY_SLOTS[2][TX_TELEMETRY_SLOT_SIZE];
+  TxRing tx_critical{ TX_CRITICAL_BUFFER, TX_CRITICAL_BUFFER_SIZE };
+  TxRing tx_status{ TX_STATUS_BUFFER, TX_STATUS_BUFFER_SIZE };
+  TelemetryFrame telemetry_frames[2];
+  volatile uint8_t telemetry_pending = NO_TELEMETRY_SLOT;    // Slot of the telemetry packet waiting for transmission. Taken by the consumer, claimed by the producer before it is replaced.
+  volatile uint8_t telemetry_in_flight = NO_TELEMETRY_SLOT;  // Slot of the telemetry packet being transmitted. Only written by the consumer.
+  volatile uint8_t events_sent = 0;                          // Events carried by telemetry packets that started transmission and aren't removed from the queue yet
+  volatile uint16_t events_dropped_sent = 0;
+  uint16_t tx_dropped[TX_LANE_COUNT]{ 0 };                   // Packets dropped or replaced per lane, saturating
+  volatile TxDrain tx_drain;                                 // Written by the consumer, taken by the producer
+
+  // Transmitter state, only accessed by the serial buffer interrupt. Packets are transmitted one after another, so lanes are only switched between two packets.
+  const uint8_t *tx_packet = nullptr;  // Next byte of the packet being transmitted
+  uint16_t tx_packet_length = 0;
+  uint16_t tx_packet_remaining = 0;
+  TxLane tx_packet_lane = TX_LANE_CRITICAL;
+  uint16_t tx_sequence = 0;  // Sequence number of the next packet that starts transmission
+  volatile bool serial_suspended = false;  // The serial port is handed over by suspend_serial()
+
+#ifdef ENABLE_SAMPLE_TELEMETRY
+  /*
+  The samples are kept in a single producer single consumer ring buffer. The producer is the control step that records a sample in every cycle by record_sample().
+  The consumer (enqueue_samples()) packs them into batches. If the transmit buffer is not depleted fast enough, samples are kept until the ring is full and only then dropped.
+  A slot holds either the members of FROM_DEVICE_SAMPLE or a record, and a batch only contains one kind.
+  */
+  static const size_t SAMPLE_DATA_SIZE = BIN_SIZE_RECORD > BIN_SIZE_SAMPLE ? BIN_SIZE_RECORD : BIN_SIZE_SAMPLE;
+  struct Sample {
+    uint32_t timestamp_us;
+    bool record;
+    uint8_t data[SAMPLE_DATA_SIZE];
+  };
+  static const uint8_t SAMPLE_SLOT_COUNT = 16;                         // Must be a power of 2
+  static const uint8_t SAMPLE_BATCH_SIZE = 8;                          // Samples per batch at most. A batch is sent as soon as they are recorded.
+  static const uint32_t SAMPLE_BATCH_MAX_DELAY_US = 100000;            // A smaller batch is sent if its oldest sample waits for longer than this
+  static const size_t SAMPLE_BATCH_HEADER_SIZE = 4 + 4 + 1 + 1;        // Schema hash (4 bytes) + timestamp of the first sample (4 bytes) + sample count (1 byte) + dropped sample count (1 byte)
+  static const size_t SAMPLE_BATCH_SAMPLE_SIZE = 2 + BIN_SIZE_SAMPLE;  // Time delta to the previous sample (2 bytes) + packed sample
+  static const size_t RECORD_BATCH_RECORD_SIZE = 2 + BIN_SIZE_RECORD;  // Same for a record
+  static const size_t RECORD_BATCH_HEADER_SIZE = SAMPLE_BATCH_HEADER_SIZE + 2 + 2 + 1;  // Sample batch header + parameters CRC (2 bytes) + kernel state format (2 bytes) + kernel state size (1 byte)
+  static const size_t RECORD_STATE_SIZE = ControlKernel<ControlArithmetic>::STATE_SIZE;
+
+  Sample samples[SAMPLE_SLOT_COUNT];
+  volatile uint8_t sample_head = 0;      // Index of the next sample to be recorded. Only written by the producer.
+  volatile uint8_t sample_tail = 0;      // Index of the oldest sample that hasn't been sent yet. Only written by the consumer.
+  volatile uint8_t samples_dropped = 0;  // Samples dropped since the last batch because the ring was full
+
+  /*
+  A replay of records needs the kernel state they continue from, so the first record of a recording carries the state before its step, and so does the record after one was dropped.
+  The producer fills record_state in capture_record_state() and attaches it to the next record in record_sample(). The consumer sends it with the batch of that record and releases it.
+  */
+  uint8_t record_state[RECORD_STATE_SIZE];
+  bool record_state_captured = false;           // The state was filled for the step that is being recorded. Only accessed by the producer.
+  bool record_chain = false;                    // The previous step was recorded, so the state of the next one follows from the records. Only accessed by the producer.
+  volatile uint8_t record_state_sample = 0;     // Index of the record the state is attached to
+  volatile bool record_state_attached = false;  // Set by the producer, reset by the consumer once the state was sent
+#endif
+
+  /*
+  The rx buffer is a single producer single consumer ring buffer.
+  The producer (rx_read_from_serial_to_local_buffer(), which is called from the timer ISR if ENABLE_RX_INTERRUPT_POLLING is defined) parses the packet header
+  and writes the payload to a contiguous region of the buffer. Completed packets are published as slots, which the consumer (receive_packet()) parses in place and releases afterwards.
+  A payload is never split at the end of the buffer. Instead, the producer wraps around to the beginning if the remaining space doesn't fit it.
+  Slot indices are 8 bit, so they can be accessed atomically by both sides without disabling interrupts.
+  */
+  struct RxSlot {
+    uint16_t start;
+    uint16_t length;
+    uint8_t type;
+  };
+  static const uint8_t RX_SLOT_COUNT = 4;  // Must be a power of 2
+
+  enum RxWarning : uint8_t {
+    RX_WARNING_INSUFFICIENT_RECEIVE_RATE = (1 << 0),
+    RX_WARNING_PREVIOUS_PACKET_INCOMPLETE = (1 << 1),
+    RX_WARNING_MESSAGE_EXCEEDS_RX_BUFFER_SIZE = (1 << 2)
+  };
+
+  RxSlot rx_slots[RX_SLOT_COUNT];
+  volatile uint8_t rx_slot_head = 0;  // Index of the next slot to be published. Only written by the producer.
+  volatile uint8_t rx_slot_tail = 0;  // Index of the oldest slot that hasn't been released yet. Only written by the consumer.
+  volatile uint8_t rx_warnings = 0;   // RxWarning flags set by the producer that are reported by the consumer.
+
+  // Producer state
+  volatile uint8_t rx_state = 0;  // State variable for state machine that handles asynchronous packet receiving
+  uint16_t rx_write = 0;          // Points to the next byte to be written in the rx buffer.
+  uint16_t rx_message_start = 0;  // Points to the beginning of the currently received message.
   uint16_t rx_message_length = 0;
+  uint8_t rx_packet_type = 0;
+  PacketInfo rx_packet_progress;  // Info about the packet that is currently received. Copied to rx_packet_info by the consumer.
+
+  /*
+  Consumer state. The oldest slot is parsed over as many calls of receive_packet() as needed, each of which stops after RX_PARSE_BUDGET_US, so a long packet doesn't stall loop().
+  The packet is parsed into the shadow rx_staged, whose members contained in the packet are applied to rx_data at once when the whole packet turned out to be valid.
+  So neither loop() nor the control step ever see a partially received set of parameters.
+  */
+  static const uint16_t RX_PARSE_BUDGET_US = 500;
+  static const uint8_t RX_PARSE_CHUNK_SIZE = 16;  // Bytes parsed between two checks of the budget
+  ReceiveInterface rx_staged;
+  ReceiveParser rx_parser{ rx_staged };
+  uint16_t rx_parse_offset = 0;  // Bytes of the oldest slot that have been parsed
+  bool rx_parsing = false;       // Whether parsing of the oldest slot has started
 
   const char PACKET_START_TOKEN{ '$' };
   const char STATUS_MESSAGE_KEY[4]{ "msg" };
+  const char EVENTS_KEY[4]{ "evt" };
 
   const char TX_STATUS_MSG_TRUNC_IND[TX_STATUS_MSG_TRUNC_IND_SIZE]{ " ..." };
   char TX_STATUS_MSG_BUFFER[TX_STATUS_MSG_BUFFER_SIZE]{ 0 };
-  char TX_BUFFER[TX_BUFFER_SIZE]{ 0 };
   char RX_BUFFER[RX_BUFFER_SIZE]{ 0 };
 
+  void write_packet_header(PacketType type, uint16_t payload_length, char *dest);
   size_t build_packet(const JsonDocument &tx_doc, char *dest, size_t dest_size);
+  size_t build_packet(const TransmitInterface &tx, TransmitInterface::ChannelFlags channels, char *dest, size_t dest_size);
+  uint8_t pending_event_records() const;
+  void write_event_records(uint8_t *dest) const;
+  void release_events(uint8_t count, uint16_t dropped);
+  void release_sent_events();
+  TxRing &tx_ring(TxLane lane);
+  void count_tx_drop(TxLane lane);
+  uint8_t claim_telemetry_slot();
+  void publish_telemetry(uint8_t slot, uint16_t length, uint8_t carried_events, uint16_t carried_events_dropped);
+  void stamp_tx_packet(uint8_t *packet);
+  bool next_tx_packet();
+  void finish_tx_packet();
+
+  void enable_serial_buffer_interrupt();
+  void disable_serial_buffer_interrupt();
+  void set_serial_polling(uint32_t baud_rate);
 
-#ifdef ENABLE_RX_INTERRUPT_POLLING
-  void enable_rx_serial_buffer_read_interrupt();
-  void disable_rx_serial_buffer_read_interrupt();
 public:
-#endif
+  // Called from the serial buffer interrupt. The rx part is called from async_receive() instead if ENABLE_RX_INTERRUPT_POLLING is not defined.
   void rx_read_from_serial_to_local_buffer();
+  void tx_write_from_local_buffer_to_serial();
 
 private:
+  bool rx_reserve();
   ReceiveCode receive_packet();
 
 public:
   Communication();
-  void setup();
+  void setup(uint32_t baud_rate);
+  void suspend_serial();
+  void resume_serial(uint32_t baud_rate);
 
   ReceiveCode async_receive();
 
-  TransmitCode enqueue_for_transmit(const JsonDocument &tx_doc);
-  uint16_t async_transmit();
+  TransmitCode enqueue_for_transmit(const JsonDocument &tx_doc, TxLane lane = TX_LANE_CRITICAL);
+  TransmitCode enqueue_for_transmit(const TransmitInterface &tx, TransmitInterface::ChannelFlags channels);
+  TransmitCode enqueue_for_transmit(PacketType type, uint32_t schema_hash, const uint8_t *content, size_t content_size);
+  TransmitCode enqueue_tx_data();
+  static size_t binary_telemetry_packet_size(TransmitInterface::ChannelFlags channels, uint8_t event_records = 0);
+#ifdef ENABLE_SAMPLE_TELEMETRY
+  uint8_t *capture_record_state();
+  void record_sample(uint32_t timestamp_us);
+  TransmitCode enqueue_samples();
+#endif
+  uint16_t tx_pending_bytes() const;
+  uint16_t tx_dropped_packets(TxLane lane) const;
+  TxDrain take_tx_drain();
+  void event(Event code, uint16_t arg = 0);
   bool message_append(const __FlashStringHelper *msg);
   bool message_append(const char *msg, size_t msg_len);
   TransmitCode message_enqueue_for_transmit(const __FlashStringHelper *msg);
@@ -1,12 +1,16 @@
 # This scripts translates the defined communication interfaces to C++ code.
 # The generated structs should be used for reading and writing data.
-# JsonDocument instances from the ArduinoJson library may only be used for deserialization and serialization.
+# Documents received by the controller are parsed by the streaming parser in parser.hpp by means of a generated field table of the receive interface.
+# JsonDocument instances from the ArduinoJson library may only be used for serialization.
+# Additionally, a packed little endian binary encoding of the transmit interface is generated, which is used for telemetry.
+# For host programs, the same interfaces are generated into a header-only library in tools/host_protocol, which decodes the binary encodings and encodes JSON packets without ArduinoJson.
+# The parameter files in data/parameters are compiled into profiles located in program memory of the controller (controller/src/profiles.hpp).
 
 Set-Location $PSScriptRoot
 
 Write-Output "Running C++ interface code generation ..."
 
-function CalculateJsonDocSize($interfaceDef, $allKeysConstCharPointers)  # Includes the size for storing copies char array values and assumes no deduplication and reading and writing from and to Stream.
+function CalculateJsonDocSize($interfaceDef, $allKeysConstCharPointers)  # Includes the size for storing copies char array values and assumes no deduplication. Keys are not copied if they are const char pointers or if deserialized in zero-copy mode.
 {
     $jsonMemberSize = 8  # Size in bytes that is needed by a single member in a json object on an AVR microchip architecture as used in Arduino MEGA
     $size = 0
@@ -69,45 +73,256 @@ function CreateInterfaceStruct($interfaceDef)
     }
     return $string
 }
-function CreateInterfaceStructFromDoc($interfaceDef)
+function GetMemberFlagsType($interfaceDef)  # Smallest unsigned integer type with a bit for each top level member
 {
-    function AssignStructMember($val, $accessor, [ref]$counter)
+    $count = @($interfaceDef.psobject.Properties).Count
+    if ($count -le 8) { return "uint8_t" }
+    if ($count -le 16) { return "uint16_t" }
+    return "uint32_t"
+}
+function CreateInterfaceMemberEnum($interfaceDef)
+{
+    $string = ""
+    $bit = 0
+    foreach ($prop in $interfaceDef.psobject.Properties)
     {
-        $string = ""
-        if ($val.GetType().Name -eq "String")
+        $string += "$( $prop.Name.ToUpper() ) = (1UL << $bit),`n"
+        $bit++
+    }
+    return $string
+}
+function CreateInterfaceAssignMembers($interfaceDef)
+{
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        if ($prop.Value -match "(?i)char")
         {
-            if ($val -match "\[(\d+)\]")
+            $string += "if (members & Member::$( $prop.Name.ToUpper() )) memcpy($( $prop.Name ), src.$( $prop.Name ), sizeof($( $prop.Name )));`n"
+        }
+        else
+        {
+            $string += "if (members & Member::$( $prop.Name.ToUpper() )) $( $prop.Name ) = src.$( $prop.Name );`n"
+        }
+    }
+    return $string
+}
+function CreateFieldTable($interfaceDef)  # Members in the order of the field table for the streaming parser: The top level members first, then the members of each nested struct one after another
+{
+    $fields = New-Object System.Collections.ArrayList
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        [void]$fields.Add([PSCustomObject]@{ Key = $prop.Name; Value = $prop.Value; Accessor = $prop.Name; MemberCount = 0; FirstMember = 0 })
+    }
+    for ($i = 0; $i -lt $fields.Count; $i++)  # The members of nested structs are appended while iterating
+    {
+        $field = $fields[$i]
+        if ($field.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $field.FirstMember = $fields.Count
+            foreach ($prop in $field.Value.psobject.Properties)
             {
-                # char arrays must be assigned using strlcpy
-                $size = [int]$Matches[1]
-                $string += "JsonVariant var$($counter.value) = doc[`"$($accessor.Replace('.', '`"][`"') )`"];`nif (!var$($counter.value).isNull()) strlcpy(this->$accessor, doc[`"$($accessor.Replace('.', '`"][`"') )`"] | `"`", $size);`n"
+                [void]$fields.Add([PSCustomObject]@{ Key = $prop.Name; Value = $prop.Value; Accessor = "$( $field.Accessor ).$( $prop.Name )"; MemberCount = 0; FirstMember = 0 })
+                $field.MemberCount++
             }
-            else
+        }
+    }
+    if ($fields.Count -ge 0xFD)
+    {
+        throw "The receive interface has $( $fields.Count ) members, but the parser supports 252 at most."
+    }
+    return ,$fields
+}
+function CreateFieldKeys($fields)  # Each key is stored in program memory only once
+{
+    $keys = New-Object System.Collections.Generic.List[string]
+    $string = ""
+    foreach ($field in $fields)
+    {
+        if (-not $keys.Contains($field.Key))
+        {
+            $keys.Add($field.Key)
+            $string += "static const char RX_KEY_$( $field.Key )[] PROGMEM = `"$( $field.Key )`";`n"
+        }
+    }
+    return $string
+}
+function CreateFieldEntries($fields)
+{
+    $string = ""
+    foreach ($field in $fields)
+    {
+        if ($field.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $string += "{ RX_KEY_$( $field.Key ), JsonField::OBJECT, $( $field.MemberCount ), $( $field.FirstMember ) },  // $( $field.Accessor )`n"
+        }
+        elseif ($field.Value -match "\[(\d+)\]")
+        {
+            $string += "{ RX_KEY_$( $field.Key ), JsonField::CHARS, $( $Matches[1] ), offsetof(ReceiveInterface, $( $field.Accessor )) },`n"
+        }
+        else
+        {
+            $type = ($field.Value -replace "_t$", "").ToUpper()  # Like UINT16 for uint16_t
+            $string += "{ RX_KEY_$( $field.Key ), JsonField::$type, 0, offsetof(ReceiveInterface, $( $field.Accessor )) },`n"
+        }
+    }
+    return $string
+}
+function CalculateObjectDepth($interfaceDef)  # Nesting depth of the objects in a document of the interface including the root object
+{
+    $depth = 0
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        if ($prop.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $depth = [Math]::Max($depth, (CalculateObjectDepth $prop.Value))
+        }
+    }
+    return $depth + 1
+}
+function CalculateMaxKeyLength($fields)
+{
+    return ($fields | ForEach-Object { $_.Key.Length } | Measure-Object -Maximum).Maximum
+}
+function GetProfileFiles()  # Parameter files in the ordinal order of their names, which defines the index of each profile
+{
+    $files = @(Get-ChildItem -Path "..\..\..\data\parameters" -Filter "*.json")
+    if ($files.Count -eq 0)
+    {
+        throw "No parameter files found in data/parameters."
+    }
+    $names = [string[]]($files | ForEach-Object { $_.Name })
+    $sorted = [System.IO.FileInfo[]]$files
+    [Array]::Sort($names, $sorted, [StringComparer]::Ordinal)
+    return ,$sorted
+}
+function CalculateProfilesCrc($files)  # CRC-16/XMODEM over the name and the content of each file, which the GUI calculates from its parameter files to check if they match the profiles
+{
+    $crc = 0
+    foreach ($file in $files)
+    {
+        $bytes = [System.Text.Encoding]::UTF8.GetBytes($file.Name) + [System.IO.File]::ReadAllBytes($file.FullName)
+        foreach ($byte in $bytes)
+        {
+            $crc = $crc -bxor ($byte -shl 8)
+            for ($bit = 0; $bit -lt 8; $bit++)
             {
-                $string = "JsonVariant var$($counter.value) = doc[`"$($accessor.Replace('.', '`"][`"') )`"];`nif (!var$($counter.value).isNull()) this->$accessor = var$($counter.value).as<$val>();`n"
+                $crc = if ($crc -band 0x8000) { (($crc -shl 1) -bxor 0x1021) -band 0xFFFF } else { ($crc -shl 1) -band 0xFFFF }
             }
         }
-        elseif ($val.GetType().Name -eq "PSCustomObject")
+    }
+    return "0x$( $crc.ToString("X4") )U"
+}
+function FormatProfileValue($type, $value)
+{
+    if ($type -match "(?i)char")
+    {
+        return "`"$value`""
+    }
+    if ($type -eq "bool")
+    {
+        return ([bool]$value).ToString().ToLower()
+    }
+    if ($type -eq "float" -or $type -eq "double")
+    {
+        return ([double]$value).ToString("R", [System.Globalization.CultureInfo]::InvariantCulture)
+    }
+    return ([long]$value).ToString([System.Globalization.CultureInfo]::InvariantCulture)
+}
+function CreateProfileInitializer($interfaceDef, $values, $fileName, $accessor)  # Aggregate initializer of the values in the order of the interface definition
+{
+    $items = New-Object System.Collections.Generic.List[string]
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $member = "$accessor.$( $prop.Name )"
+        $valueProp = if ($null -ne $values) { $values.psobject.Properties[$prop.Name] } else { $null }
+        if ($null -eq $valueProp)
+        {
+            throw "The parameter file $fileName lacks the member $member."
+        }
+        if ($prop.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $items.Add((CreateProfileInitializer $prop.Value $valueProp.Value $fileName $member))
+        }
+        else
+        {
+            $items.Add((FormatProfileValue $prop.Value $valueProp.Value))
+        }
+    }
+    return "{ $( $items -join ', ' ) }"
+}
+function CreateProfiles($files, $interfaceDef)
+{
+    $string = ""
+    for ($i = 0; $i -lt $files.Count; $i++)
+    {
+        $values = Get-Content -Raw -Path $files[$i].FullName | ConvertFrom-Json
+        $string += "// $( $i ): $( $files[$i].Name )`n$( CreateProfileInitializer $interfaceDef $values $files[$i].Name "parameters" ),`n"
+    }
+    return $string
+}
+function CountInterfaceChannels($interfaceDef)  # Number of members on the lowest level, each of which is a channel that can be subscribed to
+{
+    $count = 0
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        if ($prop.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $count += CountInterfaceChannels $prop.Value
+        }
+        else
+        {
+            $count++
+        }
+    }
+    return $count
+}
+function GetChannelFlagsType($interfaceDef)  # Smallest unsigned integer type with a bit for each channel
+{
+    $count = CountInterfaceChannels $interfaceDef
+    if ($count -le 8) { return "uint8_t" }
+    if ($count -le 16) { return "uint16_t" }
+    if ($count -le 32) { return "uint32_t" }
+    throw "The interface has $count channels, but subscriptions support 32 channels at most."
+}
+function GetChannelName($accessor)  # Like "SENSOR_WHEEL_ANGLE_RAD" for "sensor.wheel.angle_rad"
+{
+    return $accessor.Replace(".", "_").ToUpper()
+}
+function CreateInterfaceChannelEnum($interfaceDef)  # A flag for each channel in the order of definition followed by the combined flags of each nested struct
+{
+    function AddChannel($val, $accessor, [ref]$bit)
+    {
+        $string = ""
+        if ($val.GetType().Name -eq "PSCustomObject")
         {
+            $nested = @()
             foreach ($prop in $val.psobject.Properties)
             {
-                $string += AssignStructMember $prop.Value "$accessor.$( $prop.Name )" $counter
-                $counter.value++
+                $string += AddChannel $prop.Value "$accessor.$( $prop.Name )" $bit
+                $nested += GetChannelName "$accessor.$( $prop.Name )"
             }
+            $string += "$( GetChannelName $accessor ) = $( $nested -join " | " ),`n"
+        }
+        else
+        {
+            $string += "$( GetChannelName $accessor ) = (1UL << $( $bit.value )),`n"
+            $bit.value++
         }
         return $string
     }
 
-    $counter = 0
+    $bit = 0
     $string = ""
+    $all = @()
     foreach ($prop in $interfaceDef.psobject.Properties)
     {
-        $string += AssignStructMember $prop.Value $prop.Name ([ref] $counter)
-        $counter++
+        $string += AddChannel $prop.Value $prop.Name ([ref] $bit)
+        $all += GetChannelName $prop.Name
     }
-    return $string
+    return $string + "ALL_CHANNELS = $( $all -join " | " )`n"
 }
-function CreateInterfaceStructToDoc($interfaceDef)
+function CreateInterfaceStructToDoc($interfaceDef)  # Only the subscribed channels are assigned. Nested objects are only created if they contain any of them.
 {
     function AssignDocMember($val, $objName, $accessor, [ref]$counter)
     {
@@ -115,17 +330,18 @@ function CreateInterfaceStructToDoc($interfaceDef)
         $string = ""
         if ($val.GetType().Name -eq "String")
         {
-            $string = "$objName[`"$key`"] = this->$accessor;`n"
+            $string = "if (channels & Channel::$( GetChannelName $accessor )) $objName[`"$key`"] = this->$accessor;`n"
         }
         elseif ($val.GetType().Name -eq "PSCustomObject")
         {
             $nested_obj_name = "obj$($counter.value)"
-            $string = "JsonObject $nested_obj_name = $objName.createNestedObject(`"$key`");`n"
+            $string = "if (channels & Channel::$( GetChannelName $accessor )) {`nJsonObject $nested_obj_name = $objName.createNestedObject(`"$key`");`n"
             $counter.value++
             foreach ($prop in $val.psobject.Properties)
             {
                 $string += AssignDocMember $prop.Value $nested_obj_name "$accessor.$( $prop.Name )" $counter
             }
+            $string += "}`n"
         }
         return $string
     }
@@ -138,9 +354,348 @@ function CreateInterfaceStructToDoc($interfaceDef)
     }
     return $string
 }
+# Maps the interface types to the types that are used for the packed binary encoding and their size in bytes on the wire.
+# The binary encoding mirrors the memory layout on AVR, so double is only 4 bytes wide and encoded as float.
+$binaryWireTypes = @{
+    "bool" = "bool"; "char" = "char"; "float" = "float"; "double" = "float"; "int" = "int16_t";
+    "int8_t" = "int8_t"; "int16_t" = "int16_t"; "int32_t" = "int32_t"; "int64_t" = "int64_t";
+    "uint8_t" = "uint8_t"; "uint16_t" = "uint16_t"; "uint32_t" = "uint32_t"; "uint64_t" = "uint64_t"
+}
+$binaryWireSizes = @{
+    "bool" = 1; "char" = 1; "float" = 4; "double" = 4; "int" = 2;
+    "int8_t" = 1; "int16_t" = 2; "int32_t" = 4; "int64_t" = 8;
+    "uint8_t" = 1; "uint16_t" = 2; "uint32_t" = 4; "uint64_t" = 8
+}
+function CalculateBinarySize($interfaceDef)  # Size in bytes of the packed binary encoding without any padding.
+{
+    $size = 0
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        if ($prop.Value.GetType().Name -eq "String")
+        {
+            if ($prop.Value -match "\[(\d+)\]")
+            {
+                $size += [int]$Matches[1]
+            }
+            else
+            {
+                $size += $binaryWireSizes[$prop.Value]
+            }
+        }
+        elseif ($prop.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $size += CalculateBinarySize $prop.Value
+        }
+    }
+    return $size
+}
+function CreateSchemaString($interfaceDef, $accessor)  # Canonical representation of the interface layout like "sensor.wheel.angle_rad:double;..."
+{
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        if ($prop.Value.GetType().Name -eq "String")
+        {
+            $string += "$accessor$( $prop.Name ):$( $prop.Value );"
+        }
+        elseif ($prop.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $string += CreateSchemaString $prop.Value "$accessor$( $prop.Name )."
+        }
+    }
+    return $string
+}
+function CalculateSchemaHash($interfaceDef)  # 32 bit FNV-1a hash of the schema string. The GUI calculates the same hash to verify that both sides agree on the binary layout.
+{
+    $hash = [uint64]2166136261
+    foreach ($byte in [System.Text.Encoding]::ASCII.GetBytes((CreateSchemaString $interfaceDef "")))
+    {
+        $hash = $hash -bxor [uint64]$byte
+        $hash = ($hash * [uint64]16777619) % [uint64]4294967296
+    }
+    return "0x{0:X8}UL" -f $hash
+}
+function SelectInterfaceMembers($interfaceDef, $accessors, $accessor)  # Subset of the interface definition with the members whose accessors like "sensor.tilt.angle_rad" are listed. Listing a nested struct selects all of its members.
+{
+    $selection = [ordered]@{}
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $name = "$accessor$( $prop.Name )"
+        if ($accessors -contains $name)
+        {
+            $selection[$prop.Name] = $prop.Value
+        }
+        elseif ($prop.Value.GetType().Name -eq "PSCustomObject")
+        {
+            $nested = SelectInterfaceMembers $prop.Value $accessors "$name."
+            if (@($nested.psobject.Properties).Count -gt 0)
+            {
+                $selection[$prop.Name] = $nested
+            }
+        }
+    }
+    return [PSCustomObject]$selection
+}
+function CreateInterfaceStructToBin($interfaceDef)
+{
+    function AssignBinMember($val, $accessor, [ref]$offset)
+    {
+        $string = ""
+        if ($val.GetType().Name -eq "String")
+        {
+            if ($val -match "\[(\d+)\]")
+            {
+                # char arrays are copied as is
+                $size = [int]$Matches[1]
+                $string = "memcpy(dest + $( $offset.value ), this->$accessor, $size);`n"
+                $offset.value += $size
+            }
+            else
+            {
+                $string = "bin_write<$( $binaryWireTypes[$val] )>(dest + $( $offset.value ), this->$accessor);`n"
+                $offset.value += $binaryWireSizes[$val]
+            }
+        }
+        elseif ($val.GetType().Name -eq "PSCustomObject")
+        {
+            foreach ($prop in $val.psobject.Properties)
+            {
+                $string += AssignBinMember $prop.Value "$accessor.$( $prop.Name )" $offset
+            }
+        }
+        return $string
+    }
+
+    $offset = 0
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $string += AssignBinMember $prop.Value $prop.Name ([ref] $offset)
+    }
+    return $string
+}
+
+function CreateInterfaceStructToChannelBin($interfaceDef)  # Like CreateInterfaceStructToBin, but only the subscribed channels are packed one after another
+{
+    function AssignBinChannel($val, $accessor)
+    {
+        $string = ""
+        if ($val.GetType().Name -eq "String")
+        {
+            if ($val -match "\[(\d+)\]")
+            {
+                $size = [int]$Matches[1]
+                $string = "if (channels & Channel::$( GetChannelName $accessor )) {`nmemcpy(dest + size, this->$accessor, $size);`nsize += $size;`n}`n"
+            }
+            else
+            {
+                $string = "if (channels & Channel::$( GetChannelName $accessor )) {`nbin_write<$( $binaryWireTypes[$val] )>(dest + size, this->$accessor);`nsize += $( $binaryWireSizes[$val] );`n}`n"
+            }
+        }
+        elseif ($val.GetType().Name -eq "PSCustomObject")
+        {
+            foreach ($prop in $val.psobject.Properties)
+            {
+                $string += AssignBinChannel $prop.Value "$accessor.$( $prop.Name )"
+            }
+        }
+        return $string
+    }
+
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $string += AssignBinChannel $prop.Value $prop.Name
+    }
+    return $string
+}
+function CreateInterfaceChannelBinSize($interfaceDef)
+{
+    function AddChannelSize($val, $accessor)
+    {
+        $string = ""
+        if ($val.GetType().Name -eq "String")
+        {
+            $size = $binaryWireSizes[$val]
+            if ($val -match "\[(\d+)\]")
+            {
+                $size = [int]$Matches[1]
+            }
+            $string = "if (channels & Channel::$( GetChannelName $accessor )) size += $size;`n"
+        }
+        elseif ($val.GetType().Name -eq "PSCustomObject")
+        {
+            foreach ($prop in $val.psobject.Properties)
+            {
+                $string += AddChannelSize $prop.Value "$accessor.$( $prop.Name )"
+            }
+        }
+        return $string
+    }
+
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $string += AddChannelSize $prop.Value $prop.Name
+    }
+    return $string
+}
+
+function CreateProfileDefinition($sections)  # Statistics of each code section measured by the profiler in the order they are packed into a profile packet
+{
+    $definition = [ordered]@{}
+    foreach ($section in $sections)
+    {
+        $definition[$section] = [PSCustomObject][ordered]@{ "min_us" = "uint32_t"; "max_us" = "uint32_t"; "mean_us" = "uint32_t"; "count" = "uint16_t" }
+    }
+    return [PSCustomObject]$definition
+}
+function CreateProfileSectionEnum($sections)
+{
+    $string = ""
+    foreach ($section in $sections)
+    {
+        $string += "PROFILE_$( $section.ToUpper() ),`n"
+    }
+    return $string
+}
+
+function CreateEventEnum($events)
+{
+    $string = ""
+    foreach ($prop in $events.psobject.Properties)
+    {
+        $string += "EVENT_$( $prop.Name ),`n"
+    }
+    return $string
+}
+
+function CreateInterfaceStructFromChannelBin($interfaceDef)  # Inverse of CreateInterfaceStructToChannelBin for the host library
+{
+    function ReadBinChannel($val, $accessor)
+    {
+        $string = ""
+        if ($val.GetType().Name -eq "String")
+        {
+            if ($val -match "\[(\d+)\]")
+            {
+                $size = [int]$Matches[1]
+                $string = "if (channels & Channel::$( GetChannelName $accessor )) {`nmemcpy(this->$accessor, src + size, $size);`nsize += $size;`n}`n"
+            }
+            else
+            {
+                $string = "if (channels & Channel::$( GetChannelName $accessor )) {`nthis->$accessor = bin_read<$( $binaryWireTypes[$val] )>(src + size);`nsize += $( $binaryWireSizes[$val] );`n}`n"
+            }
+        }
+        elseif ($val.GetType().Name -eq "PSCustomObject")
+        {
+            foreach ($prop in $val.psobject.Properties)
+            {
+                $string += ReadBinChannel $prop.Value "$accessor.$( $prop.Name )"
+            }
+        }
+        return $string
+    }
+
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $string += ReadBinChannel $prop.Value $prop.Name
+    }
+    return $string
+}
+function CreateInterfaceStructFromBin($interfaceDef)  # Inverse of CreateInterfaceStructToBin
+{
+    function ReadBinMember($val, $accessor, [ref]$offset)
+    {
+        $string = ""
+        if ($val.GetType().Name -eq "String")
+        {
+            if ($val -match "\[(\d+)\]")
+            {
+                $size = [int]$Matches[1]
+                $string = "memcpy(this->$accessor, src + $( $offset.value ), $size);`n"
+                $offset.value += $size
+            }
+            else
+            {
+                $string = "this->$accessor = bin_read<$( $binaryWireTypes[$val] )>(src + $( $offset.value ));`n"
+                $offset.value += $binaryWireSizes[$val]
+            }
+        }
+        elseif ($val.GetType().Name -eq "PSCustomObject")
+        {
+            foreach ($prop in $val.psobject.Properties)
+            {
+                $string += ReadBinMember $prop.Value "$accessor.$( $prop.Name )" $offset
+            }
+        }
+        return $string
+    }
+
+    $offset = 0
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $string += ReadBinMember $prop.Value $prop.Name ([ref] $offset)
+    }
+    return $string
+}
+function CreateInterfaceStructToJson($interfaceDef)  # JSON encoding of the top level members whose flags are passed, for the host library
+{
+    function WriteJsonMember($val, $accessor)
+    {
+        $key = $accessor.Split(".")[-1]
+        $string = "json_key(json, `"$key`");`n"
+        if ($val.GetType().Name -eq "String")
+        {
+            if ($val -match "\[(\d+)\]")
+            {
+                $string += "json_value(json, (const char *)this->$accessor);`n"
+            }
+            else
+            {
+                $string += "json_value(json, this->$accessor);`n"
+            }
+        }
+        elseif ($val.GetType().Name -eq "PSCustomObject")
+        {
+            $string += "json += '{';`n"
+            foreach ($prop in $val.psobject.Properties)
+            {
+                $string += WriteJsonMember $prop.Value "$accessor.$( $prop.Name )"
+            }
+            $string += "json += '}';`n"
+        }
+        return $string
+    }
+
+    $string = ""
+    foreach ($prop in $interfaceDef.psobject.Properties)
+    {
+        $string += "if (members & Member::$( $prop.Name.ToUpper() )) {`n$( WriteJsonMember $prop.Value $prop.Name )}`n"
+    }
+    return $string
+}
+function CreateEventTexts($events)
+{
+    $string = ""
+    foreach ($prop in $events.psobject.Properties)
+    {
+        $text = $prop.Value.Replace('\', '\\').Replace('"', '\"')  # Escaped for a C string literal
+        $string += "`"$text`",`n"
+    }
+    return $string
+}
 
 $interfaceJsonContentString = Get-Content -Path "..\..\..\interface.json"
 $interfaceJsonObject = $interfaceJsonContentString | ConvertFrom-Json
+$sampleDef = SelectInterfaceMembers $interfaceJsonObject.FROM_DEVICE $interfaceJsonObject.FROM_DEVICE_SAMPLE ""  # Members of the transmit interface that are recorded in every control cycle
+$recordDef = $interfaceJsonObject.FROM_DEVICE_RECORD  # Inputs and outputs of the control step that are recorded in every control cycle while recording
+$profileDef = CreateProfileDefinition $interfaceJsonObject.FROM_DEVICE_PROFILE
+$receiveFields = CreateFieldTable $interfaceJsonObject.TO_DEVICE
+$profileFiles = GetProfileFiles
+$persistentDef = SelectInterfaceMembers $interfaceJsonObject.TO_DEVICE $interfaceJsonObject.TO_DEVICE_PERSISTENT ""  # Members of the receive interface that the controller stores in EEPROM
 
 $HPPfileString = "// This file is automatically generated. Any changes will be overwritten.
 
@@ -148,18 +703,62 @@ $HPPfileString = "// This file is automatically generated. Any changes will be o
 #define INTERFACE_HPP
 
 #include <ArduinoJson.h>
+#include `"binary.hpp`"
+#include `"json_field.hpp`"
 
-#define JSON_DOC_SIZE_RX $( CalculateJsonDocSize $interfaceJsonObject.TO_DEVICE $false )
+#define RX_FIELD_COUNT $( $receiveFields.Count )
+#define RX_ROOT_FIELD_COUNT $( @($interfaceJsonObject.TO_DEVICE.psobject.Properties).Count )
+#define RX_OBJECT_DEPTH $( CalculateObjectDepth $interfaceJsonObject.TO_DEVICE )
+#define RX_MAX_KEY_LENGTH $( CalculateMaxKeyLength $receiveFields )
 #define JSON_DOC_SIZE_TX $( CalculateJsonDocSize $interfaceJsonObject.FROM_DEVICE $true )
+#define BIN_SIZE_TX $( CalculateBinarySize $interfaceJsonObject.FROM_DEVICE )
+#define INTERFACE_SCHEMA_HASH_TX $( CalculateSchemaHash $interfaceJsonObject.FROM_DEVICE )
+#define BIN_SIZE_SAMPLE $( CalculateBinarySize $sampleDef )
+#define INTERFACE_SCHEMA_HASH_SAMPLE $( CalculateSchemaHash $sampleDef )
+#define BIN_SIZE_RECORD $( CalculateBinarySize $recordDef )
+#define INTERFACE_SCHEMA_HASH_RECORD $( CalculateSchemaHash $recordDef )
+#define PROFILE_SECTION_COUNT $( @($interfaceJsonObject.FROM_DEVICE_PROFILE).Count )
+#define BIN_SIZE_PROFILE $( CalculateBinarySize $profileDef )
+#define INTERFACE_SCHEMA_HASH_PROFILE $( CalculateSchemaHash $profileDef )
+#define BIN_SIZE_PERSISTENT $( CalculateBinarySize $persistentDef )
+#define INTERFACE_SCHEMA_HASH_PERSISTENT $( CalculateSchemaHash $persistentDef )
+
+// Code sections measured by the profiler in the order of FROM_DEVICE_PROFILE. Each section is packed as min_us, max_us, mean_us (uint32_t) and count (uint16_t).
+enum ProfileSection : uint8_t {
+$( CreateProfileSectionEnum $interfaceJsonObject.FROM_DEVICE_PROFILE )};
+
+// Status events in the order of FROM_DEVICE_EVENTS. An event is sent as its code and a uint16_t argument, which the receiver inserts into the text of the event.
+enum Event : uint8_t {
+$( CreateEventEnum $interfaceJsonObject.FROM_DEVICE_EVENTS )};
 
 struct ReceiveInterface {
 $( CreateInterfaceStruct $interfaceJsonObject.TO_DEVICE )
-void from_doc(StaticJsonDocument<JSON_DOC_SIZE_RX> &doc);
+// Flags of the top level members. The parser returns the flags of the members contained in a document, so receivers can skip work for members that weren't updated.
+typedef $( GetMemberFlagsType $interfaceJsonObject.TO_DEVICE ) MemberFlags;
+enum Member : MemberFlags {
+$( CreateInterfaceMemberEnum $interfaceJsonObject.TO_DEVICE )};
+static const JsonField FIELDS[RX_FIELD_COUNT];  // Table of the members for the streaming parser in parser.hpp
+void assign_members(const ReceiveInterface &src, MemberFlags members);  // Copies only the top level members whose flags are passed
+void persistent_to_bin(uint8_t *dest) const;  // Packs only the members listed in TO_DEVICE_PERSISTENT into BIN_SIZE_PERSISTENT bytes
+void persistent_from_bin(const uint8_t *src);  // Unpacks the members listed in TO_DEVICE_PERSISTENT from BIN_SIZE_PERSISTENT bytes
 };
 
 struct TransmitInterface {
 $( CreateInterfaceStruct $interfaceJsonObject.FROM_DEVICE )
-StaticJsonDocument<JSON_DOC_SIZE_TX> to_doc();
+// Flags of the members on the lowest level (channels) and of the nested structs combining them. Only the channels passed to to_doc() and to_bin() are encoded, so receivers can subscribe to the ones they need.
+typedef $( GetChannelFlagsType $interfaceJsonObject.FROM_DEVICE ) ChannelFlags;
+enum Channel : ChannelFlags {
+$( CreateInterfaceChannelEnum $interfaceJsonObject.FROM_DEVICE )};
+StaticJsonDocument<JSON_DOC_SIZE_TX> to_doc(ChannelFlags channels);
+size_t to_bin(uint8_t *dest, ChannelFlags channels) const;  // Packs the channels in the order of definition and returns their size, which is BIN_SIZE_TX at most
+static size_t bin_size(ChannelFlags channels);
+size_t sample_to_bin(uint8_t *dest) const;  // Packs only the members listed in FROM_DEVICE_SAMPLE
+};
+
+// Inputs and outputs of a control step, which are recorded in every control cycle while recording is set, c.f. FROM_DEVICE_RECORD
+struct RecordInterface {
+$( CreateInterfaceStruct $recordDef )
+size_t to_bin(uint8_t *dest) const;  // Packs BIN_SIZE_RECORD bytes
 };
 
 #endif
@@ -167,19 +766,170 @@ StaticJsonDocument<JSON_DOC_SIZE_TX> to_doc();
 
 $CPPfileString = "// This file is automatically generated. Any changes will be overwritten.
 
+#include <stddef.h>
 #include `"interface.hpp`"
 
-void ReceiveInterface::from_doc(StaticJsonDocument<JSON_DOC_SIZE_RX> &doc) {
-$( CreateInterfaceStructFromDoc $interfaceJsonObject.TO_DEVICE )}
+$( CreateFieldKeys $receiveFields )
+const JsonField ReceiveInterface::FIELDS[RX_FIELD_COUNT] PROGMEM = {
+$( CreateFieldEntries $receiveFields )};
 
-StaticJsonDocument<JSON_DOC_SIZE_TX> TransmitInterface::to_doc() {
+void ReceiveInterface::assign_members(const ReceiveInterface &src, MemberFlags members) {
+$( CreateInterfaceAssignMembers $interfaceJsonObject.TO_DEVICE )}
+
+void ReceiveInterface::persistent_to_bin(uint8_t *dest) const {
+$( CreateInterfaceStructToBin $persistentDef )}
+
+void ReceiveInterface::persistent_from_bin(const uint8_t *src) {
+$( CreateInterfaceStructFromBin $persistentDef )}
+
+StaticJsonDocument<JSON_DOC_SIZE_TX> TransmitInterface::to_doc(ChannelFlags channels) {
 StaticJsonDocument<JSON_DOC_SIZE_TX> doc;
 $( CreateInterfaceStructToDoc $interfaceJsonObject.FROM_DEVICE )
 return doc;
 }
+
+size_t TransmitInterface::to_bin(uint8_t *dest, ChannelFlags channels) const {
+size_t size = 0;
+$( CreateInterfaceStructToChannelBin $interfaceJsonObject.FROM_DEVICE )return size;
+}
+
+size_t TransmitInterface::bin_size(ChannelFlags channels) {
+size_t size = 0;
+$( CreateInterfaceChannelBinSize $interfaceJsonObject.FROM_DEVICE )return size;
+}
+
+size_t TransmitInterface::sample_to_bin(uint8_t *dest) const {
+$( CreateInterfaceStructToBin $sampleDef )
+return BIN_SIZE_SAMPLE;
+}
+
+size_t RecordInterface::to_bin(uint8_t *dest) const {
+$( CreateInterfaceStructToBin $recordDef )
+return BIN_SIZE_RECORD;
+}
+"
+
+$HostHPPfileString = "// This file is automatically generated. Any changes will be overwritten.
+
+#ifndef HOST_INTERFACE_HPP
+#define HOST_INTERFACE_HPP
+
+#include `"binary.hpp`"
+#include `"codec.hpp`"
+
+// Same definitions as in interface.hpp of the controller, which both may be included
+#define BIN_SIZE_TX $( CalculateBinarySize $interfaceJsonObject.FROM_DEVICE )
+#define INTERFACE_SCHEMA_HASH_TX $( CalculateSchemaHash $interfaceJsonObject.FROM_DEVICE )
+#define BIN_SIZE_SAMPLE $( CalculateBinarySize $sampleDef )
+#define INTERFACE_SCHEMA_HASH_SAMPLE $( CalculateSchemaHash $sampleDef )
+#define BIN_SIZE_RECORD $( CalculateBinarySize $recordDef )
+#define INTERFACE_SCHEMA_HASH_RECORD $( CalculateSchemaHash $recordDef )
+#define PROFILE_SECTION_COUNT $( @($interfaceJsonObject.FROM_DEVICE_PROFILE).Count )
+#define BIN_SIZE_PROFILE $( CalculateBinarySize $profileDef )
+#define INTERFACE_SCHEMA_HASH_PROFILE $( CalculateSchemaHash $profileDef )
+
+namespace host {
+
+enum ProfileSection : uint8_t {
+$( CreateProfileSectionEnum $interfaceJsonObject.FROM_DEVICE_PROFILE )};
+
+enum Event : uint8_t {
+$( CreateEventEnum $interfaceJsonObject.FROM_DEVICE_EVENTS )};
+
+// Texts of the events in the order of FROM_DEVICE_EVENTS. {} is replaced by the argument of an event.
+const char *const EVENT_TEXTS[] = {
+$( CreateEventTexts $interfaceJsonObject.FROM_DEVICE_EVENTS )};
+
+struct ReceiveInterface {
+$( CreateInterfaceStruct $interfaceJsonObject.TO_DEVICE )
+typedef $( GetMemberFlagsType $interfaceJsonObject.TO_DEVICE ) MemberFlags;
+enum Member : MemberFlags {
+$( CreateInterfaceMemberEnum $interfaceJsonObject.TO_DEVICE )};
+std::string to_json(MemberFlags members) const;  // Encodes the top level members whose flags are passed, e.g. as payload of encode_json_packet()
+};
+
+struct TransmitInterface {
+$( CreateInterfaceStruct $interfaceJsonObject.FROM_DEVICE )
+typedef $( GetChannelFlagsType $interfaceJsonObject.FROM_DEVICE ) ChannelFlags;
+enum Channel : ChannelFlags {
+$( CreateInterfaceChannelEnum $interfaceJsonObject.FROM_DEVICE )};
+size_t from_bin(const uint8_t *src, ChannelFlags channels);  // Unpacks the channels packed by the controller and returns their size. src must hold bin_size(channels) bytes.
+static size_t bin_size(ChannelFlags channels);
+void sample_from_bin(const uint8_t *src);  // Unpacks only the members listed in FROM_DEVICE_SAMPLE from BIN_SIZE_SAMPLE bytes
+};
+
+// Inputs and outputs of a control step in a record batch packet
+struct RecordInterface {
+$( CreateInterfaceStruct $recordDef )
+void from_bin(const uint8_t *src);  // Unpacks BIN_SIZE_RECORD bytes
+};
+
+// Statistics of the code sections in a profile packet
+struct ProfileInterface {
+$( CreateInterfaceStruct $profileDef )
+void from_bin(const uint8_t *src);  // Unpacks BIN_SIZE_PROFILE bytes
+};
+
+inline std::string ReceiveInterface::to_json(MemberFlags members) const {
+std::string json = `"{`";
+$( CreateInterfaceStructToJson $interfaceJsonObject.TO_DEVICE )json += '}';
+return json;
+}
+
+inline size_t TransmitInterface::from_bin(const uint8_t *src, ChannelFlags channels) {
+size_t size = 0;
+$( CreateInterfaceStructFromChannelBin $interfaceJsonObject.FROM_DEVICE )return size;
+}
+
+inline size_t TransmitInterface::bin_size(ChannelFlags channels) {
+size_t size = 0;
+$( CreateInterfaceChannelBinSize $interfaceJsonObject.FROM_DEVICE )return size;
+}
+
+inline void TransmitInterface::sample_from_bin(const uint8_t *src) {
+$( CreateInterfaceStructFromBin $sampleDef )}
+
+inline void RecordInterface::from_bin(const uint8_t *src) {
+$( CreateInterfaceStructFromBin $recordDef )}
+
+inline void ProfileInterface::from_bin(const uint8_t *src) {
+$( CreateInterfaceStructFromBin $profileDef )}
+
+}
+
+#endif
+"
+
+$ProfilesHPPfileString = "// This file is automatically generated. Any changes will be overwritten.
+
+#ifndef PROFILES_HPP
+#define PROFILES_HPP
+
+#include `"communication/interface.hpp`"
+
+#define PARAMETER_PROFILE_COUNT $( $profileFiles.Count )
+#define PARAMETER_PROFILES_CRC $( CalculateProfilesCrc $profileFiles )
+
+typedef decltype(ReceiveInterface::parameters) ParameterProfile;
+
+// Parameter sets of data/parameters in the ordinal order of their file names, which ReceiveInterface::parameter_profile selects by index. Located in program memory.
+extern const ParameterProfile PARAMETER_PROFILES[PARAMETER_PROFILE_COUNT];
+
+#endif
+"
+
+$ProfilesCPPfileString = "// This file is automatically generated. Any changes will be overwritten.
+
+#include `"profiles.hpp`"
+
+const ParameterProfile PARAMETER_PROFILES[PARAMETER_PROFILE_COUNT] PROGMEM = {
+$( CreateProfiles $profileFiles $interfaceJsonObject.TO_DEVICE.parameters )};
 "
 
 Set-Content -NoNewline -Path "interface.hpp" -Value $HPPfileString
 Set-Content -NoNewline -Path "interface.cpp" -Value $CPPfileString
+Set-Content -NoNewline -Path "..\..\..\tools\host_protocol\host_interface.hpp" -Value $HostHPPfileString
+Set-Content -NoNewline -Path "..\profiles.hpp" -Value $ProfilesHPPfileString
+Set-Content -NoNewline -Path "..\profiles.cpp" -Value $ProfilesCPPfileString
 
 Write-Output "C++ interface code generation finished!"
@@ -1,200 +1,635 @@
 // This file is automatically generated. Any changes will be overwritten.
 
+#include <stddef.h>
 #include "interface.hpp"
 
-void ReceiveInterface::from_doc(StaticJsonDocument<JSON_DOC_SIZE_RX> &doc) {
-JsonVariant var0 = doc["calibration"];
-if (!var0.isNull()) this->calibration = var0.as<bool>();
-JsonVariant var1 = doc["control_state"];
-if (!var1.isNull()) this->control_state = var1.as<bool>();
-JsonVariant var2 = doc["pos_setpoint_mm"];
-if (!var2.isNull()) this->pos_setpoint_mm = var2.as<double>();
-JsonVariant var3 = doc["parameters"]["variable"]["General"]["h_ms"];
-if (!var3.isNull()) this->parameters.variable.General.h_ms = var3.as<uint16_t>();
-JsonVariant var4 = doc["parameters"]["variable"]["General"]["alpha_off"];
-if (!var4.isNull()) this->parameters.variable.General.alpha_off = var4.as<double>();
-JsonVariant var5 = doc["parameters"]["variable"]["General"]["m_stop"];
-if (!var5.isNull()) this->parameters.variable.General.m_stop = var5.as<uint8_t>();
-JsonVariant var6 = doc["parameters"]["variable"]["General"]["m_start"];
-if (!var6.isNull()) this->parameters.variable.General.m_start = var6.as<uint8_t>();
-JsonVariant var8 = doc["parameters"]["variable"]["BalanceControl"]["k1"];
-if (!var8.isNull()) this->parameters.variable.BalanceControl.k1 = var8.as<double>();
-JsonVariant var9 = doc["parameters"]["variable"]["BalanceControl"]["k2"];
-if (!var9.isNull()) this->parameters.variable.BalanceControl.k2 = var9.as<double>();
-JsonVariant var10 = doc["parameters"]["variable"]["BalanceControl"]["k3"];
-if (!var10.isNull()) this->parameters.variable.BalanceControl.k3 = var10.as<double>();
-JsonVariant var12 = doc["parameters"]["variable"]["PositionControl"]["k4"];
-if (!var12.isNull()) this->parameters.variable.PositionControl.k4 = var12.as<double>();
-JsonVariant var13 = doc["parameters"]["variable"]["PositionControl"]["ki"];
-if (!var13.isNull()) this->parameters.variable.PositionControl.ki = var13.as<double>();
-JsonVariant var16 = doc["parameters"]["inferred"]["observer"]["gain"]["l11"];
-if (!var16.isNull()) this->parameters.inferred.observer.gain.l11 = var16.as<double>();
-JsonVariant var17 = doc["parameters"]["inferred"]["observer"]["gain"]["l12"];
-if (!var17.isNull()) this->parameters.inferred.observer.gain.l12 = var17.as<double>();
-JsonVariant var18 = doc["parameters"]["inferred"]["observer"]["gain"]["l13"];
-if (!var18.isNull()) this->parameters.inferred.observer.gain.l13 = var18.as<double>();
-JsonVariant var19 = doc["parameters"]["inferred"]["observer"]["gain"]["l21"];
-if (!var19.isNull()) this->parameters.inferred.observer.gain.l21 = var19.as<double>();
-JsonVariant var20 = doc["parameters"]["inferred"]["observer"]["gain"]["l22"];
-if (!var20.isNull()) this->parameters.inferred.observer.gain.l22 = var20.as<double>();
-JsonVariant var21 = doc["parameters"]["inferred"]["observer"]["gain"]["l23"];
-if (!var21.isNull()) this->parameters.inferred.observer.gain.l23 = var21.as<double>();
-JsonVariant var22 = doc["parameters"]["inferred"]["observer"]["gain"]["l31"];
-if (!var22.isNull()) this->parameters.inferred.observer.gain.l31 = var22.as<double>();
-JsonVariant var23 = doc["parameters"]["inferred"]["observer"]["gain"]["l32"];
-if (!var23.isNull()) this->parameters.inferred.observer.gain.l32 = var23.as<double>();
-JsonVariant var24 = doc["parameters"]["inferred"]["observer"]["gain"]["l33"];
-if (!var24.isNull()) this->parameters.inferred.observer.gain.l33 = var24.as<double>();
-JsonVariant var25 = doc["parameters"]["inferred"]["observer"]["gain"]["l41"];
-if (!var25.isNull()) this->parameters.inferred.observer.gain.l41 = var25.as<double>();
-JsonVariant var26 = doc["parameters"]["inferred"]["observer"]["gain"]["l42"];
-if (!var26.isNull()) this->parameters.inferred.observer.gain.l42 = var26.as<double>();
-JsonVariant var27 = doc["parameters"]["inferred"]["observer"]["gain"]["l43"];
-if (!var27.isNull()) this->parameters.inferred.observer.gain.l43 = var27.as<double>();
-JsonVariant var29 = doc["parameters"]["inferred"]["observer"]["phi"]["phi11"];
-if (!var29.isNull()) this->parameters.inferred.observer.phi.phi11 = var29.as<double>();
-JsonVariant var30 = doc["parameters"]["inferred"]["observer"]["phi"]["phi12"];
-if (!var30.isNull()) this->parameters.inferred.observer.phi.phi12 = var30.as<double>();
-JsonVariant var31 = doc["parameters"]["inferred"]["observer"]["phi"]["phi13"];
-if (!var31.isNull()) this->parameters.inferred.observer.phi.phi13 = var31.as<double>();
-JsonVariant var32 = doc["parameters"]["inferred"]["observer"]["phi"]["phi14"];
-if (!var32.isNull()) this->parameters.inferred.observer.phi.phi14 = var32.as<double>();
-JsonVariant var33 = doc["parameters"]["inferred"]["observer"]["phi"]["phi21"];
-if (!var33.isNull()) this->parameters.inferred.observer.phi.phi21 = var33.as<double>();
-JsonVariant var34 = doc["parameters"]["inferred"]["observer"]["phi"]["phi22"];
-if (!var34.isNull()) this->parameters.inferred.observer.phi.phi22 = var34.as<double>();
-JsonVariant var35 = doc["parameters"]["inferred"]["observer"]["phi"]["phi23"];
-if (!var35.isNull()) this->parameters.inferred.observer.phi.phi23 = var35.as<double>();
-JsonVariant var36 = doc["parameters"]["inferred"]["observer"]["phi"]["phi24"];
-if (!var36.isNull()) this->parameters.inferred.observer.phi.phi24 = var36.as<double>();
-JsonVariant var37 = doc["parameters"]["inferred"]["observer"]["phi"]["phi31"];
-if (!var37.isNull()) this->parameters.inferred.observer.phi.phi31 = var37.as<double>();
-JsonVariant var38 = doc["parameters"]["inferred"]["observer"]["phi"]["phi32"];
-if (!var38.isNull()) this->parameters.inferred.observer.phi.phi32 = var38.as<double>();
-JsonVariant var39 = doc["parameters"]["inferred"]["observer"]["phi"]["phi33"];
-if (!var39.isNull()) this->parameters.inferred.observer.phi.phi33 = var39.as<double>();
-JsonVariant var40 = doc["parameters"]["inferred"]["observer"]["phi"]["phi34"];
-if (!var40.isNull()) this->parameters.inferred.observer.phi.phi34 = var40.as<double>();
-JsonVariant var41 = doc["parameters"]["inferred"]["observer"]["phi"]["phi41"];
-if (!var41.isNull()) this->parameters.inferred.observer.phi.phi41 = var41.as<double>();
-JsonVariant var42 = doc["parameters"]["inferred"]["observer"]["phi"]["phi42"];
-if (!var42.isNull()) this->parameters.inferred.observer.phi.phi42 = var42.as<double>();
-JsonVariant var43 = doc["parameters"]["inferred"]["observer"]["phi"]["phi43"];
-if (!var43.isNull()) this->parameters.inferred.observer.phi.phi43 = var43.as<double>();
-JsonVariant var44 = doc["parameters"]["inferred"]["observer"]["phi"]["phi44"];
-if (!var44.isNull()) this->parameters.inferred.observer.phi.phi44 = var44.as<double>();
-JsonVariant var46 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx11"];
-if (!var46.isNull()) this->parameters.inferred.observer.innoGain.mx11 = var46.as<double>();
-JsonVariant var47 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx12"];
-if (!var47.isNull()) this->parameters.inferred.observer.innoGain.mx12 = var47.as<double>();
-JsonVariant var48 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx13"];
-if (!var48.isNull()) this->parameters.inferred.observer.innoGain.mx13 = var48.as<double>();
-JsonVariant var49 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx21"];
-if (!var49.isNull()) this->parameters.inferred.observer.innoGain.mx21 = var49.as<double>();
-JsonVariant var50 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx22"];
-if (!var50.isNull()) this->parameters.inferred.observer.innoGain.mx22 = var50.as<double>();
-JsonVariant var51 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx23"];
-if (!var51.isNull()) this->parameters.inferred.observer.innoGain.mx23 = var51.as<double>();
-JsonVariant var52 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx31"];
-if (!var52.isNull()) this->parameters.inferred.observer.innoGain.mx31 = var52.as<double>();
-JsonVariant var53 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx32"];
-if (!var53.isNull()) this->parameters.inferred.observer.innoGain.mx32 = var53.as<double>();
-JsonVariant var54 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx33"];
-if (!var54.isNull()) this->parameters.inferred.observer.innoGain.mx33 = var54.as<double>();
-JsonVariant var55 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx41"];
-if (!var55.isNull()) this->parameters.inferred.observer.innoGain.mx41 = var55.as<double>();
-JsonVariant var56 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx42"];
-if (!var56.isNull()) this->parameters.inferred.observer.innoGain.mx42 = var56.as<double>();
-JsonVariant var57 = doc["parameters"]["inferred"]["observer"]["innoGain"]["mx43"];
-if (!var57.isNull()) this->parameters.inferred.observer.innoGain.mx43 = var57.as<double>();
-JsonVariant var60 = doc["parameters"]["inferred"]["ff"]["phi"]["phi11"];
-if (!var60.isNull()) this->parameters.inferred.ff.phi.phi11 = var60.as<double>();
-JsonVariant var61 = doc["parameters"]["inferred"]["ff"]["phi"]["phi12"];
-if (!var61.isNull()) this->parameters.inferred.ff.phi.phi12 = var61.as<double>();
-JsonVariant var62 = doc["parameters"]["inferred"]["ff"]["phi"]["phi13"];
-if (!var62.isNull()) this->parameters.inferred.ff.phi.phi13 = var62.as<double>();
-JsonVariant var63 = doc["parameters"]["inferred"]["ff"]["phi"]["phi14"];
-if (!var63.isNull()) this->parameters.inferred.ff.phi.phi14 = var63.as<double>();
-JsonVariant var64 = doc["parameters"]["inferred"]["ff"]["phi"]["phi21"];
-if (!var64.isNull()) this->parameters.inferred.ff.phi.phi21 = var64.as<double>();
-JsonVariant var65 = doc["parameters"]["inferred"]["ff"]["phi"]["phi22"];
-if (!var65.isNull()) this->parameters.inferred.ff.phi.phi22 = var65.as<double>();
-JsonVariant var66 = doc["parameters"]["inferred"]["ff"]["phi"]["phi23"];
-if (!var66.isNull()) this->parameters.inferred.ff.phi.phi23 = var66.as<double>();
-JsonVariant var67 = doc["parameters"]["inferred"]["ff"]["phi"]["phi24"];
-if (!var67.isNull()) this->parameters.inferred.ff.phi.phi24 = var67.as<double>();
-JsonVariant var68 = doc["parameters"]["inferred"]["ff"]["phi"]["phi31"];
-if (!var68.isNull()) this->parameters.inferred.ff.phi.phi31 = var68.as<double>();
-JsonVariant var69 = doc["parameters"]["inferred"]["ff"]["phi"]["phi32"];
-if (!var69.isNull()) this->parameters.inferred.ff.phi.phi32 = var69.as<double>();
-JsonVariant var70 = doc["parameters"]["inferred"]["ff"]["phi"]["phi33"];
-if (!var70.isNull()) this->parameters.inferred.ff.phi.phi33 = var70.as<double>();
-JsonVariant var71 = doc["parameters"]["inferred"]["ff"]["phi"]["phi34"];
-if (!var71.isNull()) this->parameters.inferred.ff.phi.phi34 = var71.as<double>();
-JsonVariant var72 = doc["parameters"]["inferred"]["ff"]["phi"]["phi41"];
-if (!var72.isNull()) this->parameters.inferred.ff.phi.phi41 = var72.as<double>();
-JsonVariant var73 = doc["parameters"]["inferred"]["ff"]["phi"]["phi42"];
-if (!var73.isNull()) this->parameters.inferred.ff.phi.phi42 = var73.as<double>();
-JsonVariant var74 = doc["parameters"]["inferred"]["ff"]["phi"]["phi43"];
-if (!var74.isNull()) this->parameters.inferred.ff.phi.phi43 = var74.as<double>();
-JsonVariant var75 = doc["parameters"]["inferred"]["ff"]["phi"]["phi44"];
-if (!var75.isNull()) this->parameters.inferred.ff.phi.phi44 = var75.as<double>();
-JsonVariant var77 = doc["parameters"]["inferred"]["ff"]["gamma"]["gam1"];
-if (!var77.isNull()) this->parameters.inferred.ff.gamma.gam1 = var77.as<double>();
-JsonVariant var78 = doc["parameters"]["inferred"]["ff"]["gamma"]["gam2"];
-if (!var78.isNull()) this->parameters.inferred.ff.gamma.gam2 = var78.as<double>();
-JsonVariant var79 = doc["parameters"]["inferred"]["ff"]["gamma"]["gam3"];
-if (!var79.isNull()) this->parameters.inferred.ff.gamma.gam3 = var79.as<double>();
-JsonVariant var80 = doc["parameters"]["inferred"]["ff"]["gamma"]["gam4"];
-if (!var80.isNull()) this->parameters.inferred.ff.gamma.gam4 = var80.as<double>();
-JsonVariant var82 = doc["parameters"]["inferred"]["ff"]["Km"]["k1"];
-if (!var82.isNull()) this->parameters.inferred.ff.Km.k1 = var82.as<double>();
-JsonVariant var83 = doc["parameters"]["inferred"]["ff"]["Km"]["k2"];
-if (!var83.isNull()) this->parameters.inferred.ff.Km.k2 = var83.as<double>();
-JsonVariant var84 = doc["parameters"]["inferred"]["ff"]["Km"]["k3"];
-if (!var84.isNull()) this->parameters.inferred.ff.Km.k3 = var84.as<double>();
-JsonVariant var85 = doc["parameters"]["inferred"]["ff"]["Km"]["k4"];
-if (!var85.isNull()) this->parameters.inferred.ff.Km.k4 = var85.as<double>();
-JsonVariant var87 = doc["parameters"]["inferred"]["ff"]["Kc"];
-if (!var87.isNull()) this->parameters.inferred.ff.Kc = var87.as<double>();
+static const char RX_KEY_calibration[] PROGMEM = "calibration";
+static const char RX_KEY_control_state[] PROGMEM = "control_state";
+static const char RX_KEY_pos_setpoint_mm[] PROGMEM = "pos_setpoint_mm";
+static const char RX_KEY_parameters[] PROGMEM = "parameters";
+static const char RX_KEY_subscription[] PROGMEM = "subscription";
+static const char RX_KEY_parameter_profile[] PROGMEM = "parameter_profile";
+static const char RX_KEY_telemetry_limits[] PROGMEM = "telemetry_limits";
+static const char RX_KEY_baud_rate[] PROGMEM = "baud_rate";
+static const char RX_KEY_recording[] PROGMEM = "recording";
+static const char RX_KEY_variable[] PROGMEM = "variable";
+static const char RX_KEY_inferred[] PROGMEM = "inferred";
+static const char RX_KEY_min_interval_ms[] PROGMEM = "min_interval_ms";
+static const char RX_KEY_max_interval_ms[] PROGMEM = "max_interval_ms";
+static const char RX_KEY_General[] PROGMEM = "General";
+static const char RX_KEY_BalanceControl[] PROGMEM = "BalanceControl";
+static const char RX_KEY_PositionControl[] PROGMEM = "PositionControl";
+static const char RX_KEY_Fusion[] PROGMEM = "Fusion";
+static const char RX_KEY_observer[] PROGMEM = "observer";
+static const char RX_KEY_ff[] PROGMEM = "ff";
+static const char RX_KEY_h_ms[] PROGMEM = "h_ms";
+static const char RX_KEY_alpha_off[] PROGMEM = "alpha_off";
+static const char RX_KEY_m_stop[] PROGMEM = "m_stop";
+static const char RX_KEY_m_start[] PROGMEM = "m_start";
+static const char RX_KEY_k1[] PROGMEM = "k1";
+static const char RX_KEY_k2[] PROGMEM = "k2";
+static const char RX_KEY_k3[] PROGMEM = "k3";
+static const char RX_KEY_k4[] PROGMEM = "k4";
+static const char RX_KEY_ki[] PROGMEM = "ki";
+static const char RX_KEY_rate_hz[] PROGMEM = "rate_hz";
+static const char RX_KEY_tau_s[] PROGMEM = "tau_s";
+static const char RX_KEY_gain[] PROGMEM = "gain";
+static const char RX_KEY_phi[] PROGMEM = "phi";
+static const char RX_KEY_innoGain[] PROGMEM = "innoGain";
+static const char RX_KEY_gamma[] PROGMEM = "gamma";
+static const char RX_KEY_Km[] PROGMEM = "Km";
+static const char RX_KEY_Kc[] PROGMEM = "Kc";
+static const char RX_KEY_l11[] PROGMEM = "l11";
+static const char RX_KEY_l12[] PROGMEM = "l12";
+static const char RX_KEY_l13[] PROGMEM = "l13";
+static const char RX_KEY_l21[] PROGMEM = "l21";
+static const char RX_KEY_l22[] PROGMEM = "l22";
+static const char RX_KEY_l23[] PROGMEM = "l23";
+static const char RX_KEY_l31[] PROGMEM = "l31";
+static const char RX_KEY_l32[] PROGMEM = "l32";
+static const char RX_KEY_l33[] PROGMEM = "l33";
+static const char RX_KEY_l41[] PROGMEM = "l41";
+static const char RX_KEY_l42[] PROGMEM = "l42";
+static const char RX_KEY_l43[] PROGMEM = "l43";
+static const char RX_KEY_phi11[] PROGMEM = "phi11";
+static const char RX_KEY_phi12[] PROGMEM = "phi12";
+static const char RX_KEY_phi13[] PROGMEM = "phi13";
+static const char RX_KEY_phi14[] PROGMEM = "phi14";
+static const char RX_KEY_phi21[] PROGMEM = "phi21";
+static const char RX_KEY_phi22[] PROGMEM = "phi22";
+static const char RX_KEY_phi23[] PROGMEM = "phi23";
+static const char RX_KEY_phi24[] PROGMEM = "phi24";
+static const char RX_KEY_phi31[] PROGMEM = "phi31";
+static const char RX_KEY_phi32[] PROGMEM = "phi32";
+static const char RX_KEY_phi33[] PROGMEM = "phi33";
+static const char RX_KEY_phi34[] PROGMEM = "phi34";
+static const char RX_KEY_phi41[] PROGMEM = "phi41";
+static const char RX_KEY_phi42[] PROGMEM = "phi42";
+static const char RX_KEY_phi43[] PROGMEM = "phi43";
+static const char RX_KEY_phi44[] PROGMEM = "phi44";
+static const char RX_KEY_mx11[] PROGMEM = "mx11";
+static const char RX_KEY_mx12[] PROGMEM = "mx12";
+static const char RX_KEY_mx13[] PROGMEM = "mx13";
+static const char RX_KEY_mx21[] PROGMEM = "mx21";
+static const char RX_KEY_mx22[] PROGMEM = "mx22";
+static const char RX_KEY_mx23[] PROGMEM = "mx23";
+static const char RX_KEY_mx31[] PROGMEM = "mx31";
+static const char RX_KEY_mx32[] PROGMEM = "mx32";
+static const char RX_KEY_mx33[] PROGMEM = "mx33";
+static const char RX_KEY_mx41[] PROGMEM = "mx41";
+static const char RX_KEY_mx42[] PROGMEM = "mx42";
+static const char RX_KEY_mx43[] PROGMEM = "mx43";
+static const char RX_KEY_gam1[] PROGMEM = "gam1";
+static const char RX_KEY_gam2[] PROGMEM = "gam2";
+static const char RX_KEY_gam3[] PROGMEM = "gam3";
+static const char RX_KEY_gam4[] PROGMEM = "gam4";
+
+const JsonField ReceiveInterface::FIELDS[RX_FIELD_COUNT] PROGMEM = {
+{ RX_KEY_calibration, JsonField::BOOL, 0, offsetof(ReceiveInterface, calibration) },
+{ RX_KEY_control_state, JsonField::BOOL, 0, offsetof(ReceiveInterface, control_state) },
+{ RX_KEY_pos_setpoint_mm, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, pos_setpoint_mm) },
+{ RX_KEY_parameters, JsonField::OBJECT, 2, 9 },  // parameters
+{ RX_KEY_subscription, JsonField::UINT32, 0, offsetof(ReceiveInterface, subscription) },
+{ RX_KEY_parameter_profile, JsonField::UINT8, 0, offsetof(ReceiveInterface, parameter_profile) },
+{ RX_KEY_telemetry_limits, JsonField::OBJECT, 2, 11 },  // telemetry_limits
+{ RX_KEY_baud_rate, JsonField::UINT32, 0, offsetof(ReceiveInterface, baud_rate) },
+{ RX_KEY_recording, JsonField::BOOL, 0, offsetof(ReceiveInterface, recording) },
+{ RX_KEY_variable, JsonField::OBJECT, 4, 13 },  // parameters.variable
+{ RX_KEY_inferred, JsonField::OBJECT, 2, 17 },  // parameters.inferred
+{ RX_KEY_min_interval_ms, JsonField::UINT16, 0, offsetof(ReceiveInterface, telemetry_limits.min_interval_ms) },
+{ RX_KEY_max_interval_ms, JsonField::UINT16, 0, offsetof(ReceiveInterface, telemetry_limits.max_interval_ms) },
+{ RX_KEY_General, JsonField::OBJECT, 4, 19 },  // parameters.variable.General
+{ RX_KEY_BalanceControl, JsonField::OBJECT, 3, 23 },  // parameters.variable.BalanceControl
+{ RX_KEY_PositionControl, JsonField::OBJECT, 2, 26 },  // parameters.variable.PositionControl
+{ RX_KEY_Fusion, JsonField::OBJECT, 2, 28 },  // parameters.variable.Fusion
+{ RX_KEY_observer, JsonField::OBJECT, 3, 30 },  // parameters.inferred.observer
+{ RX_KEY_ff, JsonField::OBJECT, 4, 33 },  // parameters.inferred.ff
+{ RX_KEY_h_ms, JsonField::UINT16, 0, offsetof(ReceiveInterface, parameters.variable.General.h_ms) },
+{ RX_KEY_alpha_off, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.General.alpha_off) },
+{ RX_KEY_m_stop, JsonField::UINT8, 0, offsetof(ReceiveInterface, parameters.variable.General.m_stop) },
+{ RX_KEY_m_start, JsonField::UINT8, 0, offsetof(ReceiveInterface, parameters.variable.General.m_start) },
+{ RX_KEY_k1, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.BalanceControl.k1) },
+{ RX_KEY_k2, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.BalanceControl.k2) },
+{ RX_KEY_k3, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.BalanceControl.k3) },
+{ RX_KEY_k4, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.PositionControl.k4) },
+{ RX_KEY_ki, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.PositionControl.ki) },
+{ RX_KEY_rate_hz, JsonField::UINT16, 0, offsetof(ReceiveInterface, parameters.variable.Fusion.rate_hz) },
+{ RX_KEY_tau_s, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.variable.Fusion.tau_s) },
+{ RX_KEY_gain, JsonField::OBJECT, 12, 37 },  // parameters.inferred.observer.gain
+{ RX_KEY_phi, JsonField::OBJECT, 16, 49 },  // parameters.inferred.observer.phi
+{ RX_KEY_innoGain, JsonField::OBJECT, 12, 65 },  // parameters.inferred.observer.innoGain
+{ RX_KEY_phi, JsonField::OBJECT, 16, 77 },  // parameters.inferred.ff.phi
+{ RX_KEY_gamma, JsonField::OBJECT, 4, 93 },  // parameters.inferred.ff.gamma
+{ RX_KEY_Km, JsonField::OBJECT, 4, 97 },  // parameters.inferred.ff.Km
+{ RX_KEY_Kc, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.Kc) },
+{ RX_KEY_l11, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l11) },
+{ RX_KEY_l12, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l12) },
+{ RX_KEY_l13, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l13) },
+{ RX_KEY_l21, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l21) },
+{ RX_KEY_l22, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l22) },
+{ RX_KEY_l23, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l23) },
+{ RX_KEY_l31, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l31) },
+{ RX_KEY_l32, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l32) },
+{ RX_KEY_l33, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l33) },
+{ RX_KEY_l41, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l41) },
+{ RX_KEY_l42, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l42) },
+{ RX_KEY_l43, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.gain.l43) },
+{ RX_KEY_phi11, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi11) },
+{ RX_KEY_phi12, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi12) },
+{ RX_KEY_phi13, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi13) },
+{ RX_KEY_phi14, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi14) },
+{ RX_KEY_phi21, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi21) },
+{ RX_KEY_phi22, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi22) },
+{ RX_KEY_phi23, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi23) },
+{ RX_KEY_phi24, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi24) },
+{ RX_KEY_phi31, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi31) },
+{ RX_KEY_phi32, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi32) },
+{ RX_KEY_phi33, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi33) },
+{ RX_KEY_phi34, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi34) },
+{ RX_KEY_phi41, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi41) },
+{ RX_KEY_phi42, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi42) },
+{ RX_KEY_phi43, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi43) },
+{ RX_KEY_phi44, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.phi.phi44) },
+{ RX_KEY_mx11, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx11) },
+{ RX_KEY_mx12, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx12) },
+{ RX_KEY_mx13, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx13) },
+{ RX_KEY_mx21, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx21) },
+{ RX_KEY_mx22, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx22) },
+{ RX_KEY_mx23, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx23) },
+{ RX_KEY_mx31, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx31) },
+{ RX_KEY_mx32, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx32) },
+{ RX_KEY_mx33, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx33) },
+{ RX_KEY_mx41, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx41) },
+{ RX_KEY_mx42, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx42) },
+{ RX_KEY_mx43, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.observer.innoGain.mx43) },
+{ RX_KEY_phi11, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi11) },
+{ RX_KEY_phi12, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi12) },
+{ RX_KEY_phi13, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi13) },
+{ RX_KEY_phi14, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi14) },
+{ RX_KEY_phi21, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi21) },
+{ RX_KEY_phi22, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi22) },
+{ RX_KEY_phi23, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi23) },
+{ RX_KEY_phi24, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi24) },
+{ RX_KEY_phi31, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi31) },
+{ RX_KEY_phi32, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi32) },
+{ RX_KEY_phi33, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi33) },
+{ RX_KEY_phi34, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi34) },
+{ RX_KEY_phi41, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi41) },
+{ RX_KEY_phi42, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi42) },
+{ RX_KEY_phi43, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi43) },
+{ RX_KEY_phi44, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.phi.phi44) },
+{ RX_KEY_gam1, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.gamma.gam1) },
+{ RX_KEY_gam2, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.gamma.gam2) },
+{ RX_KEY_gam3, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.gamma.gam3) },
+{ RX_KEY_gam4, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.gamma.gam4) },
+{ RX_KEY_k1, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.Km.k1) },
+{ RX_KEY_k2, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.Km.k2) },
+{ RX_KEY_k3, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.Km.k3) },
+{ RX_KEY_k4, JsonField::DOUBLE, 0, offsetof(ReceiveInterface, parameters.inferred.ff.Km.k4) },
+};
+
+void ReceiveInterface::assign_members(const ReceiveInterface &src, MemberFlags members) {
+if (members & Member::CALIBRATION) calibration = src.calibration;
+if (members & Member::CONTROL_STATE) control_state = src.control_state;
+if (members & Member::POS_SETPOINT_MM) pos_setpoint_mm = src.pos_setpoint_mm;
+if (members & Member::PARAMETERS) parameters = src.parameters;
+if (members & Member::SUBSCRIPTION) subscription = src.subscription;
+if (members & Member::PARAMETER_PROFILE) parameter_profile = src.parameter_profile;
+if (members & Member::TELEMETRY_LIMITS) telemetry_limits = src.telemetry_limits;
+if (members & Member::BAUD_RATE) baud_rate = src.baud_rate;
+if (members & Member::RECORDING) recording = src.recording;
+}
+
+void ReceiveInterface::persistent_to_bin(uint8_t *dest) const {
+bin_write<uint16_t>(dest + 0, this->parameters.variable.General.h_ms);
+bin_write<float>(dest + 2, this->parameters.variable.General.alpha_off);
+bin_write<uint8_t>(dest + 6, this->parameters.variable.General.m_stop);
+bin_write<uint8_t>(dest + 7, this->parameters.variable.General.m_start);
+bin_write<float>(dest + 8, this->parameters.variable.BalanceControl.k1);
+bin_write<float>(dest + 12, this->parameters.variable.BalanceControl.k2);
+bin_write<float>(dest + 16, this->parameters.variable.BalanceControl.k3);
+bin_write<float>(dest + 20, this->parameters.variable.PositionControl.k4);
+bin_write<float>(dest + 24, this->parameters.variable.PositionControl.ki);
+bin_write<uint16_t>(dest + 28, this->parameters.variable.Fusion.rate_hz);
+bin_write<float>(dest + 30, this->parameters.variable.Fusion.tau_s);
+bin_write<float>(dest + 34, this->parameters.inferred.observer.gain.l11);
+bin_write<float>(dest + 38, this->parameters.inferred.observer.gain.l12);
+bin_write<float>(dest + 42, this->parameters.inferred.observer.gain.l13);
+bin_write<float>(dest + 46, this->parameters.inferred.observer.gain.l21);
+bin_write<float>(dest + 50, this->parameters.inferred.observer.gain.l22);
+bin_write<float>(dest + 54, this->parameters.inferred.observer.gain.l23);
+bin_write<float>(dest + 58, this->parameters.inferred.observer.gain.l31);
+bin_write<float>(dest + 62, this->parameters.inferred.observer.gain.l32);
+bin_write<float>(dest + 66, this->parameters.inferred.observer.gain.l33);
+bin_write<float>(dest + 70, this->parameters.inferred.observer.gain.l41);
+bin_write<float>(dest + 74, this->parameters.inferred.observer.gain.l42);
+bin_write<float>(dest + 78, this->parameters.inferred.observer.gain.l43);
+bin_write<float>(dest + 82, this->parameters.inferred.observer.phi.phi11);
+bin_write<float>(dest + 86, this->parameters.inferred.observer.phi.phi12);
+bin_write<float>(dest + 90, this->parameters.inferred.observer.phi.phi13);
+bin_write<float>(dest + 94, this->parameters.inferred.observer.phi.phi14);
+bin_write<float>(dest + 98, this->parameters.inferred.observer.phi.phi21);
+bin_write<float>(dest + 102, this->parameters.inferred.observer.phi.phi22);
+bin_write<float>(dest + 106, this->parameters.inferred.observer.phi.phi23);
+bin_write<float>(dest + 110, this->parameters.inferred.observer.phi.phi24);
+bin_write<float>(dest + 114, this->parameters.inferred.observer.phi.phi31);
+bin_write<float>(dest + 118, this->parameters.inferred.observer.phi.phi32);
+bin_write<float>(dest + 122, this->parameters.inferred.observer.phi.phi33);
+bin_write<float>(dest + 126, this->parameters.inferred.observer.phi.phi34);
+bin_write<float>(dest + 130, this->parameters.inferred.observer.phi.phi41);
+bin_write<float>(dest + 134, this->parameters.inferred.observer.phi.phi42);
+bin_write<float>(dest + 138, this->parameters.inferred.observer.phi.phi43);
+bin_write<float>(dest + 142, this->parameters.inferred.observer.phi.phi44);
+bin_write<float>(dest + 146, this->parameters.inferred.observer.innoGain.mx11);
+bin_write<float>(dest + 150, this->parameters.inferred.observer.innoGain.mx12);
+bin_write<float>(dest + 154, this->parameters.inferred.observer.innoGain.mx13);
+bin_write<float>(dest + 158, this->parameters.inferred.observer.innoGain.mx21);
+bin_write<float>(dest + 162, this->parameters.inferred.observer.innoGain.mx22);
+bin_write<float>(dest + 166, this->parameters.inferred.observer.innoGain.mx23);
+bin_write<float>(dest + 170, this->parameters.inferred.observer.innoGain.mx31);
+bin_write<float>(dest + 174, this->parameters.inferred.observer.innoGain.mx32);
+bin_write<float>(dest + 178, this->parameters.inferred.observer.innoGain.mx33);
+bin_write<float>(dest + 182, this->parameters.inferred.observer.innoGain.mx41);
+bin_write<float>(dest + 186, this->parameters.inferred.observer.innoGain.mx42);
+bin_write<float>(dest + 190, this->parameters.inferred.observer.innoGain.mx43);
+bin_write<float>(dest + 194, this->parameters.inferred.ff.phi.phi11);
+bin_write<float>(dest + 198, this->parameters.inferred.ff.phi.phi12);
+bin_write<float>(dest + 202, this->parameters.inferred.ff.phi.phi13);
+bin_write<float>(dest + 206, this->parameters.inferred.ff.phi.phi14);
+bin_write<float>(dest + 210, this->parameters.inferred.ff.phi.phi21);
+bin_write<float>(dest + 214, this->parameters.inferred.ff.phi.phi22);
+bin_write<float>(dest + 218, this->parameters.inferred.ff.phi.phi23);
+bin_write<float>(dest + 222, this->parameters.inferred.ff.phi.phi24);
+bin_write<float>(dest + 226, this->parameters.inferred.ff.phi.phi31);
+bin_write<float>(dest + 230, this->parameters.inferred.ff.phi.phi32);
+bin_write<float>(dest + 234, this->parameters.inferred.ff.phi.phi33);
+bin_write<float>(dest + 238, this->parameters.inferred.ff.phi.phi34);
+bin_write<float>(dest + 242, this->parameters.inferred.ff.phi.phi41);
+bin_write<float>(dest + 246, this->parameters.inferred.ff.phi.phi42);
+bin_write<float>(dest + 250, this->parameters.inferred.ff.phi.phi43);
+bin_write<float>(dest + 254, this->parameters.inferred.ff.phi.phi44);
+bin_write<float>(dest + 258, this->parameters.inferred.ff.gamma.gam1);
+bin_write<float>(dest + 262, this->parameters.inferred.ff.gamma.gam2);
+bin_write<float>(dest + 266, this->parameters.inferred.ff.gamma.gam3);
+bin_write<float>(dest + 270, this->parameters.inferred.ff.gamma.gam4);
+bin_write<float>(dest + 274, this->parameters.inferred.ff.Km.k1);
+bin_write<float>(dest + 278, this->parameters.inferred.ff.Km.k2);
+bin_write<float>(dest + 282, this->parameters.inferred.ff.Km.k3);
+bin_write<float>(dest + 286, this->parameters.inferred.ff.Km.k4);
+bin_write<float>(dest + 290, this->parameters.inferred.ff.Kc);
 }
 
-StaticJsonDocument<JSON_DOC_SIZE_TX> TransmitInterface::to_doc() {
+void ReceiveInterface::persistent_from_bin(const uint8_t *src) {
+this->parameters.variable.General.h_ms = bin_read<uint16_t>(src + 0);
+this->parameters.variable.General.alpha_off = bin_read<float>(src + 2);
+this->parameters.variable.General.m_stop = bin_read<uint8_t>(src + 6);
+this->parameters.variable.General.m_start = bin_read<uint8_t>(src + 7);
+this->parameters.variable.BalanceControl.k1 = bin_read<float>(src + 8);
+this->parameters.variable.BalanceControl.k2 = bin_read<float>(src + 12);
+this->parameters.variable.BalanceControl.k3 = bin_read<float>(src + 16);
+this->parameters.variable.PositionControl.k4 = bin_read<float>(src + 20);
+this->parameters.variable.PositionControl.ki = bin_read<float>(src + 24);
+this->parameters.variable.Fusion.rate_hz = bin_read<uint16_t>(src + 28);
+this->parameters.variable.Fusion.tau_s = bin_read<float>(src + 30);
+this->parameters.inferred.observer.gain.l11 = bin_read<float>(src + 34);
+this->parameters.inferred.observer.gain.l12 = bin_read<float>(src + 38);
+this->parameters.inferred.observer.gain.l13 = bin_read<float>(src + 42);
+this->parameters.inferred.observer.gain.l21 = bin_read<float>(src + 46);
+this->parameters.inferred.observer.gain.l22 = bin_read<float>(src + 50);
+this->parameters.inferred.observer.gain.l23 = bin_read<float>(src + 54);
+this->parameters.inferred.observer.gain.l31 = bin_read<float>(src + 58);
+this->parameters.inferred.observer.gain.l32 = bin_read<float>(src + 62);
+this->parameters.inferred.observer.gain.l33 = bin_read<float>(src + 66);
+this->parameters.inferred.observer.gain.l41 = bin_read<float>(src + 70);
+this->parameters.inferred.observer.gain.l42 = bin_read<float>(src + 74);
+this->parameters.inferred.observer.gain.l43 = bin_read<float>(src + 78);
+this->parameters.inferred.observer.phi.phi11 = bin_read<float>(src + 82);
+this->parameters.inferred.observer.phi.phi12 = bin_read<float>(src + 86);
+this->parameters.inferred.observer.phi.phi13 = bin_read<float>(src + 90);
+this->parameters.inferred.observer.phi.phi14 = bin_read<float>(src + 94);
+this->parameters.inferred.observer.phi.phi21 = bin_read<float>(src + 98);
+this->parameters.inferred.observer.phi.phi22 = bin_read<float>(src + 102);
+this->parameters.inferred.observer.phi.phi23 = bin_read<float>(src + 106);
+this->parameters.inferred.observer.phi.phi24 = bin_read<float>(src + 110);
+this->parameters.inferred.observer.phi.phi31 = bin_read<float>(src + 114);
+this->parameters.inferred.observer.phi.phi32 = bin_read<float>(src + 118);
+this->parameters.inferred.observer.phi.phi33 = bin_read<float>(src + 122);
+this->parameters.inferred.observer.phi.phi34 = bin_read<float>(src + 126);
+this->parameters.inferred.observer.phi.phi41 = bin_read<float>(src + 130);
+this->parameters.inferred.observer.phi.phi42 = bin_read<float>(src + 134);
+this->parameters.inferred.observer.phi.phi43 = bin_read<float>(src + 138);
+this->parameters.inferred.observer.phi.phi44 = bin_read<float>(src + 142);
+this->parameters.inferred.observer.innoGain.mx11 = bin_read<float>(src + 146);
+this->parameters.inferred.observer.innoGain.mx12 = bin_read<float>(src + 150);
+this->parameters.inferred.observer.innoGain.mx13 = bin_read<float>(src + 154);
+this->parameters.inferred.observer.innoGain.mx21 = bin_read<float>(src + 158);
+this->parameters.inferred.observer.innoGain.mx22 = bin_read<float>(src + 162);
+this->parameters.inferred.observer.innoGain.mx23 = bin_read<float>(src + 166);
+this->parameters.inferred.observer.innoGain.mx31 = bin_read<float>(src + 170);
+this->parameters.inferred.observer.innoGain.mx32 = bin_read<float>(src + 174);
+this->parameters.inferred.observer.innoGain.mx33 = bin_read<float>(src + 178);
+this->parameters.inferred.observer.innoGain.mx41 = bin_read<float>(src + 182);
+this->parameters.inferred.observer.innoGain.mx42 = bin_read<float>(src + 186);
+this->parameters.inferred.observer.innoGain.mx43 = bin_read<float>(src + 190);
+this->parameters.inferred.ff.phi.phi11 = bin_read<float>(src + 194);
+this->parameters.inferred.ff.phi.phi12 = bin_read<float>(src + 198);
+this->parameters.inferred.ff.phi.phi13 = bin_read<float>(src + 202);
+this->parameters.inferred.ff.phi.phi14 = bin_read<float>(src + 206);
+this->parameters.inferred.ff.phi.phi21 = bin_read<float>(src + 210);
+this->parameters.inferred.ff.phi.phi22 = bin_read<float>(src + 214);
+this->parameters.inferred.ff.phi.phi23 = bin_read<float>(src + 218);
+this->parameters.inferred.ff.phi.phi24 = bin_read<float>(src + 222);
+this->parameters.inferred.ff.phi.phi31 = bin_read<float>(src + 226);
+this->parameters.inferred.ff.phi.phi32 = bin_read<float>(src + 230);
+this->parameters.inferred.ff.phi.phi33 = bin_read<float>(src + 234);
+this->parameters.inferred.ff.phi.phi34 = bin_read<float>(src + 238);
+this->parameters.inferred.ff.phi.phi41 = bin_read<float>(src + 242);
+this->parameters.inferred.ff.phi.phi42 = bin_read<float>(src + 246);
+this->parameters.inferred.ff.phi.phi43 = bin_read<float>(src + 250);
+this->parameters.inferred.ff.phi.phi44 = bin_read<float>(src + 254);
+this->parameters.inferred.ff.gamma.gam1 = bin_read<float>(src + 258);
+this->parameters.inferred.ff.gamma.gam2 = bin_read<float>(src + 262);
+this->parameters.inferred.ff.gamma.gam3 = bin_read<float>(src + 266);
+this->parameters.inferred.ff.gamma.gam4 = bin_read<float>(src + 270);
+this->parameters.inferred.ff.Km.k1 = bin_read<float>(src + 274);
+this->parameters.inferred.ff.Km.k2 = bin_read<float>(src + 278);
+this->parameters.inferred.ff.Km.k3 = bin_read<float>(src + 282);
+this->parameters.inferred.ff.Km.k4 = bin_read<float>(src + 286);
+this->parameters.inferred.ff.Kc = bin_read<float>(src + 290);
+}
+
+StaticJsonDocument<JSON_DOC_SIZE_TX> TransmitInterface::to_doc(ChannelFlags channels) {
 StaticJsonDocument<JSON_DOC_SIZE_TX> doc;
+if (channels & Channel::SENSOR) {
 JsonObject obj0 = doc.createNestedObject("sensor");
+if (channels & Channel::SENSOR_WHEEL) {
 JsonObject obj1 = obj0.createNestedObject("wheel");
-obj1["angle_rad"] = this->sensor.wheel.angle_rad;
-obj1["angle_deriv_rad_s"] = this->sensor.wheel.angle_deriv_rad_s;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_RAD) obj1["angle_rad"] = this->sensor.wheel.angle_rad;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_DERIV_RAD_S) obj1["angle_deriv_rad_s"] = this->sensor.wheel.angle_deriv_rad_s;
+}
+if (channels & Channel::SENSOR_TILT) {
 JsonObject obj2 = obj0.createNestedObject("tilt");
-obj2["angle_rad"] = this->sensor.tilt.angle_rad;
-obj2["vel_rad_s"] = this->sensor.tilt.vel_rad_s;
-JsonObject obj3 = doc.createNestedObject("observer");
-JsonObject obj4 = obj3.createNestedObject("wheel");
-obj4["angle_rad"] = this->observer.wheel.angle_rad;
-obj4["vel_rad_s"] = this->observer.wheel.vel_rad_s;
-JsonObject obj5 = obj3.createNestedObject("tilt");
-obj5["angle_rad"] = this->observer.tilt.angle_rad;
-obj5["vel_rad_s"] = this->observer.tilt.vel_rad_s;
-JsonObject obj6 = obj3.createNestedObject("position");
-obj6["z_mm"] = this->observer.position.z_mm;
-JsonObject obj7 = doc.createNestedObject("ff_model");
-JsonObject obj8 = obj7.createNestedObject("wheel");
-obj8["angle_rad"] = this->ff_model.wheel.angle_rad;
-obj8["vel_rad_s"] = this->ff_model.wheel.vel_rad_s;
-JsonObject obj9 = obj7.createNestedObject("tilt");
-obj9["angle_rad"] = this->ff_model.tilt.angle_rad;
-obj9["vel_rad_s"] = this->ff_model.tilt.vel_rad_s;
-JsonObject obj10 = obj7.createNestedObject("position");
-obj10["z_mm"] = this->ff_model.position.z_mm;
-JsonObject obj11 = doc.createNestedObject("control");
-obj11["cycle_us"] = this->control.cycle_us;
-JsonObject obj12 = obj11.createNestedObject("signal");
-obj12["u"] = this->control.signal.u;
-obj12["u_bal"] = this->control.signal.u_bal;
-obj12["u_pos"] = this->control.signal.u_pos;
-obj12["u_ff"] = this->control.signal.u_ff;
-obj11["motor"] = this->control.motor;
-doc["calibrated"] = this->calibrated;
+if (channels & Channel::SENSOR_TILT_ANGLE_RAD) obj2["angle_rad"] = this->sensor.tilt.angle_rad;
+if (channels & Channel::SENSOR_TILT_VEL_RAD_S) obj2["vel_rad_s"] = this->sensor.tilt.vel_rad_s;
+}
+if (channels & Channel::SENSOR_MPU) {
+JsonObject obj3 = obj0.createNestedObject("mpu");
+if (channels & Channel::SENSOR_MPU_FIFO_SAMPLES) obj3["fifo_samples"] = this->sensor.mpu.fifo_samples;
+if (channels & Channel::SENSOR_MPU_FIFO_OVERFLOWS) obj3["fifo_overflows"] = this->sensor.mpu.fifo_overflows;
+}
+}
+if (channels & Channel::OBSERVER) {
+JsonObject obj4 = doc.createNestedObject("observer");
+if (channels & Channel::OBSERVER_WHEEL) {
+JsonObject obj5 = obj4.createNestedObject("wheel");
+if (channels & Channel::OBSERVER_WHEEL_ANGLE_RAD) obj5["angle_rad"] = this->observer.wheel.angle_rad;
+if (channels & Channel::OBSERVER_WHEEL_VEL_RAD_S) obj5["vel_rad_s"] = this->observer.wheel.vel_rad_s;
+}
+if (channels & Channel::OBSERVER_TILT) {
+JsonObject obj6 = obj4.createNestedObject("tilt");
+if (channels & Channel::OBSERVER_TILT_ANGLE_RAD) obj6["angle_rad"] = this->observer.tilt.angle_rad;
+if (channels & Channel::OBSERVER_TILT_VEL_RAD_S) obj6["vel_rad_s"] = this->observer.tilt.vel_rad_s;
+}
+if (channels & Channel::OBSERVER_POSITION) {
+JsonObject obj7 = obj4.createNestedObject("position");
+if (channels & Channel::OBSERVER_POSITION_Z_MM) obj7["z_mm"] = this->observer.position.z_mm;
+}
+}
+if (channels & Channel::FF_MODEL) {
+JsonObject obj8 = doc.createNestedObject("ff_model");
+if (channels & Channel::FF_MODEL_WHEEL) {
+JsonObject obj9 = obj8.createNestedObject("wheel");
+if (channels & Channel::FF_MODEL_WHEEL_ANGLE_RAD) obj9["angle_rad"] = this->ff_model.wheel.angle_rad;
+if (channels & Channel::FF_MODEL_WHEEL_VEL_RAD_S) obj9["vel_rad_s"] = this->ff_model.wheel.vel_rad_s;
+}
+if (channels & Channel::FF_MODEL_TILT) {
+JsonObject obj10 = obj8.createNestedObject("tilt");
+if (channels & Channel::FF_MODEL_TILT_ANGLE_RAD) obj10["angle_rad"] = this->ff_model.tilt.angle_rad;
+if (channels & Channel::FF_MODEL_TILT_VEL_RAD_S) obj10["vel_rad_s"] = this->ff_model.tilt.vel_rad_s;
+}
+if (channels & Channel::FF_MODEL_POSITION) {
+JsonObject obj11 = obj8.createNestedObject("position");
+if (channels & Channel::FF_MODEL_POSITION_Z_MM) obj11["z_mm"] = this->ff_model.position.z_mm;
+}
+}
+if (channels & Channel::CONTROL) {
+JsonObject obj12 = doc.createNestedObject("control");
+if (channels & Channel::CONTROL_CYCLE_US) obj12["cycle_us"] = this->control.cycle_us;
+if (channels & Channel::CONTROL_PERIOD) {
+JsonObject obj13 = obj12.createNestedObject("period");
+if (channels & Channel::CONTROL_PERIOD_MIN_US) obj13["min_us"] = this->control.period.min_us;
+if (channels & Channel::CONTROL_PERIOD_MAX_US) obj13["max_us"] = this->control.period.max_us;
+if (channels & Channel::CONTROL_PERIOD_MEAN_US) obj13["mean_us"] = this->control.period.mean_us;
+}
+if (channels & Channel::CONTROL_OVERRUNS) obj12["overruns"] = this->control.overruns;
+if (channels & Channel::CONTROL_SIGNAL) {
+JsonObject obj14 = obj12.createNestedObject("signal");
+if (channels & Channel::CONTROL_SIGNAL_U) obj14["u"] = this->control.signal.u;
+if (channels & Channel::CONTROL_SIGNAL_U_BAL) obj14["u_bal"] = this->control.signal.u_bal;
+if (channels & Channel::CONTROL_SIGNAL_U_POS) obj14["u_pos"] = this->control.signal.u_pos;
+if (channels & Channel::CONTROL_SIGNAL_U_FF) obj14["u_ff"] = this->control.signal.u_ff;
+}
+if (channels & Channel::CONTROL_MOTOR) obj12["motor"] = this->control.motor;
+}
+if (channels & Channel::CALIBRATED) doc["calibrated"] = this->calibrated;
+if (channels & Channel::CALIBRATION_PROGRESS) doc["calibration_progress"] = this->calibration_progress;
+if (channels & Channel::PARAMETERS_CRC) doc["parameters_crc"] = this->parameters_crc;
+if (channels & Channel::PARAMETER_PROFILES_CRC) doc["parameter_profiles_crc"] = this->parameter_profiles_crc;
+if (channels & Channel::TELEMETRY_INTERVAL_MS) doc["telemetry_interval_ms"] = this->telemetry_interval_ms;
+if (channels & Channel::BAUD_RATE) doc["baud_rate"] = this->baud_rate;
 
 return doc;
 }
+
+size_t TransmitInterface::to_bin(uint8_t *dest, ChannelFlags channels) const {
+size_t size = 0;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_RAD) {
+bin_write<float>(dest + size, this->sensor.wheel.angle_rad);
+size += 4;
+}
+if (channels & Channel::SENSOR_WHEEL_ANGLE_DERIV_RAD_S) {
+bin_write<float>(dest + size, this->sensor.wheel.angle_deriv_rad_s);
+size += 4;
+}
+if (channels & Channel::SENSOR_TILT_ANGLE_RAD) {
+bin_write<float>(dest + size, this->sensor.tilt.angle_rad);
+size += 4;
+}
+if (channels & Channel::SENSOR_TILT_VEL_RAD_S) {
+bin_write<float>(dest + size, this->sensor.tilt.vel_rad_s);
+size += 4;
+}
+if (channels & Channel::SENSOR_MPU_FIFO_SAMPLES) {
+bin_write<uint8_t>(dest + size, this->sensor.mpu.fifo_samples);
+size += 1;
+}
+if (channels & Channel::SENSOR_MPU_FIFO_OVERFLOWS) {
+bin_write<uint16_t>(dest + size, this->sensor.mpu.fifo_overflows);
+size += 2;
+}
+if (channels & Channel::OBSERVER_WHEEL_ANGLE_RAD) {
+bin_write<float>(dest + size, this->observer.wheel.angle_rad);
+size += 4;
+}
+if (channels & Channel::OBSERVER_WHEEL_VEL_RAD_S) {
+bin_write<float>(dest + size, this->observer.wheel.vel_rad_s);
+size += 4;
+}
+if (channels & Channel::OBSERVER_TILT_ANGLE_RAD) {
+bin_write<float>(dest + size, this->observer.tilt.angle_rad);
+size += 4;
+}
+if (channels & Channel::OBSERVER_TILT_VEL_RAD_S) {
+bin_write<float>(dest + size, this->observer.tilt.vel_rad_s);
+size += 4;
+}
+if (channels & Channel::OBSERVER_POSITION_Z_MM) {
+bin_write<float>(dest + size, this->observer.position.z_mm);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_WHEEL_ANGLE_RAD) {
+bin_write<float>(dest + size, this->ff_model.wheel.angle_rad);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_WHEEL_VEL_RAD_S) {
+bin_write<float>(dest + size, this->ff_model.wheel.vel_rad_s);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_TILT_ANGLE_RAD) {
+bin_write<float>(dest + size, this->ff_model.tilt.angle_rad);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_TILT_VEL_RAD_S) {
+bin_write<float>(dest + size, this->ff_model.tilt.vel_rad_s);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_POSITION_Z_MM) {
+bin_write<float>(dest + size, this->ff_model.position.z_mm);
+size += 4;
+}
+if (channels & Channel::CONTROL_CYCLE_US) {
+bin_write<uint32_t>(dest + size, this->control.cycle_us);
+size += 4;
+}
+if (channels & Channel::CONTROL_PERIOD_MIN_US) {
+bin_write<uint32_t>(dest + size, this->control.period.min_us);
+size += 4;
+}
+if (channels & Channel::CONTROL_PERIOD_MAX_US) {
+bin_write<uint32_t>(dest + size, this->control.period.max_us);
+size += 4;
+}
+if (channels & Channel::CONTROL_PERIOD_MEAN_US) {
+bin_write<uint32_t>(dest + size, this->control.period.mean_us);
+size += 4;
+}
+if (channels & Channel::CONTROL_OVERRUNS) {
+bin_write<uint16_t>(dest + size, this->control.overruns);
+size += 2;
+}
+if (channels & Channel::CONTROL_SIGNAL_U) {
+bin_write<float>(dest + size, this->control.signal.u);
+size += 4;
+}
+if (channels & Channel::CONTROL_SIGNAL_U_BAL) {
+bin_write<float>(dest + size, this->control.signal.u_bal);
+size += 4;
+}
+if (channels & Channel::CONTROL_SIGNAL_U_POS) {
+bin_write<float>(dest + size, this->control.signal.u_pos);
+size += 4;
+}
+if (channels & Channel::CONTROL_SIGNAL_U_FF) {
+bin_write<float>(dest + size, this->control.signal.u_ff);
+size += 4;
+}
+if (channels & Channel::CONTROL_MOTOR) {
+bin_write<int16_t>(dest + size, this->control.motor);
+size += 2;
+}
+if (channels & Channel::CALIBRATED) {
+bin_write<bool>(dest + size, this->calibrated);
+size += 1;
+}
+if (channels & Channel::CALIBRATION_PROGRESS) {
+bin_write<uint8_t>(dest + size, this->calibration_progress);
+size += 1;
+}
+if (channels & Channel::PARAMETERS_CRC) {
+bin_write<uint16_t>(dest + size, this->parameters_crc);
+size += 2;
+}
+if (channels & Channel::PARAMETER_PROFILES_CRC) {
+bin_write<uint16_t>(dest + size, this->parameter_profiles_crc);
+size += 2;
+}
+if (channels & Channel::TELEMETRY_INTERVAL_MS) {
+bin_write<uint16_t>(dest + size, this->telemetry_interval_ms);
+size += 2;
+}
+if (channels & Channel::BAUD_RATE) {
+bin_write<uint32_t>(dest + size, this->baud_rate);
+size += 4;
+}
+return size;
+}
+
+size_t TransmitInterface::bin_size(ChannelFlags channels) {
+size_t size = 0;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_RAD) size += 4;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_DERIV_RAD_S) size += 4;
+if (channels & Channel::SENSOR_TILT_ANGLE_RAD) size += 4;
+if (channels & Channel::SENSOR_TILT_VEL_RAD_S) size += 4;
+if (channels & Channel::SENSOR_MPU_FIFO_SAMPLES) size += 1;
+if (channels & Channel::SENSOR_MPU_FIFO_OVERFLOWS) size += 2;
+if (channels & Channel::OBSERVER_WHEEL_ANGLE_RAD) size += 4;
+if (channels & Channel::OBSERVER_WHEEL_VEL_RAD_S) size += 4;
+if (channels & Channel::OBSERVER_TILT_ANGLE_RAD) size += 4;
+if (channels & Channel::OBSERVER_TILT_VEL_RAD_S) size += 4;
+if (channels & Channel::OBSERVER_POSITION_Z_MM) size += 4;
+if (channels & Channel::FF_MODEL_WHEEL_ANGLE_RAD) size += 4;
+if (channels & Channel::FF_MODEL_WHEEL_VEL_RAD_S) size += 4;
+if (channels & Channel::FF_MODEL_TILT_ANGLE_RAD) size += 4;
+if (channels & Channel::FF_MODEL_TILT_VEL_RAD_S) size += 4;
+if (channels & Channel::FF_MODEL_POSITION_Z_MM) size += 4;
+if (channels & Channel::CONTROL_CYCLE_US) size += 4;
+if (channels & Channel::CONTROL_PERIOD_MIN_US) size += 4;
+if (channels & Channel::CONTROL_PERIOD_MAX_US) size += 4;
+if (channels & Channel::CONTROL_PERIOD_MEAN_US) size += 4;
+if (channels & Channel::CONTROL_OVERRUNS) size += 2;
+if (channels & Channel::CONTROL_SIGNAL_U) size += 4;
+if (channels & Channel::CONTROL_SIGNAL_U_BAL) size += 4;
+if (channels & Channel::CONTROL_SIGNAL_U_POS) size += 4;
+if (channels & Channel::CONTROL_SIGNAL_U_FF) size += 4;
+if (channels & Channel::CONTROL_MOTOR) size += 2;
+if (channels & Channel::CALIBRATED) size += 1;
+if (channels & Channel::CALIBRATION_PROGRESS) size += 1;
+if (channels & Channel::PARAMETERS_CRC) size += 2;
+if (channels & Channel::PARAMETER_PROFILES_CRC) size += 2;
+if (channels & Channel::TELEMETRY_INTERVAL_MS) size += 2;
+if (channels & Channel::BAUD_RATE) size += 4;
+return size;
+}
+
+size_t TransmitInterface::sample_to_bin(uint8_t *dest) const {
+bin_write<float>(dest + 0, this->sensor.tilt.angle_rad);
+bin_write<uint32_t>(dest + 4, this->control.cycle_us);
+bin_write<float>(dest + 8, this->control.signal.u);
+bin_write<int16_t>(dest + 12, this->control.motor);
+
+return BIN_SIZE_SAMPLE;
+}
+
+size_t RecordInterface::to_bin(uint8_t *dest) const {
+bin_write<float>(dest + 0, this->measurements.tilt_vel_rad_s);
+bin_write<float>(dest + 4, this->measurements.tilt_angle_rad);
+bin_write<float>(dest + 8, this->measurements.wheel_angle_rad);
+bin_write<float>(dest + 12, this->setpoint.pos_setpoint_mm);
+bin_write<bool>(dest + 16, this->setpoint.control_enabled);
+bin_write<bool>(dest + 17, this->reset);
+bin_write<uint32_t>(dest + 18, this->cycle_us);
+bin_write<float>(dest + 22, this->u);
+bin_write<int16_t>(dest + 26, this->motor);
+
+return BIN_SIZE_RECORD;
+}
@@ -4,9 +4,61 @@
 #define INTERFACE_HPP
 
 #include <ArduinoJson.h>
+#include "binary.hpp"
+#include "json_field.hpp"
 
-#define JSON_DOC_SIZE_RX 1261
-#define JSON_DOC_SIZE_TX 272
+#define RX_FIELD_COUNT 101
+#define RX_ROOT_FIELD_COUNT 9
+#define RX_OBJECT_DEPTH 5
+#define RX_MAX_KEY_LENGTH 17
+#define JSON_DOC_SIZE_TX 376
+#define BIN_SIZE_TX 107
+#define INTERFACE_SCHEMA_HASH_TX 0x8502D87AUL
+#define BIN_SIZE_SAMPLE 14
+#define INTERFACE_SCHEMA_HASH_SAMPLE 0x8F5D5114UL
+#define BIN_SIZE_RECORD 28
+#define INTERFACE_SCHEMA_HASH_RECORD 0xF9741B05UL
+#define PROFILE_SECTION_COUNT 10
+#define BIN_SIZE_PROFILE 140
+#define INTERFACE_SCHEMA_HASH_PROFILE 0x000B4939UL
+#define BIN_SIZE_PERSISTENT 294
+#define INTERFACE_SCHEMA_HASH_PERSISTENT 0xBF55EDFBUL
+
+// Code sections measured by the profiler in the order of FROM_DEVICE_PROFILE. Each section is packed as min_us, max_us, mean_us (uint32_t) and count (uint16_t).
+enum ProfileSection : uint8_t {
+PROFILE_LOOP,
+PROFILE_RECEIVE,
+PROFILE_PARAMETERS,
+PROFILE_TELEMETRY,
+PROFILE_SAMPLES,
+PROFILE_TRANSMIT,
+PROFILE_STEP,
+PROFILE_MPU,
+PROFILE_KERNEL,
+PROFILE_MOTOR,
+};
+
+// Status events in the order of FROM_DEVICE_EVENTS. An event is sent as its code and a uint16_t argument, which the receiver inserts into the text of the event.
+enum Event : uint8_t {
+EVENT_PACKET_RECEIVED,
+EVENT_PACKET_RECEIVING,
+EVENT_MESSAGE_EXCEEDS_RX_BUFFER_SIZE,
+EVENT_UNKNOWN_PACKET_TYPE,
+EVENT_DESERIALIZATION_FAILED,
+EVENT_INSUFFICIENT_RECEIVE_RATE,
+EVENT_PREVIOUS_PACKET_INCOMPLETE,
+EVENT_CALIBRATION_STARTED,
+EVENT_CALIBRATION_DONE,
+EVENT_EVENTS_DROPPED,
+EVENT_PARAMETERS_STORED,
+EVENT_PARAMETER_PROFILE_SELECTED,
+EVENT_UNKNOWN_PARAMETER_PROFILE,
+EVENT_BAUD_RATE_SWITCH_PENDING,
+EVENT_BAUD_RATE_SWITCHED,
+EVENT_BAUD_RATE_SWITCH_FAILED,
+EVENT_BAUD_RATE_FALLBACK,
+EVENT_UNSUPPORTED_BAUD_RATE,
+};
 
 struct ReceiveInterface {
 bool calibration;
@@ -29,6 +81,10 @@ struct {
 double k4;
 double ki;
 } PositionControl;
+struct {
+uint16_t rate_hz;
+double tau_s;
+} Fusion;
 } variable;
 struct {
 struct {
@@ -114,8 +170,32 @@ double Kc;
 } ff;
 } inferred;
 } parameters;
+uint32_t subscription;
+uint8_t parameter_profile;
+struct {
+uint16_t min_interval_ms;
+uint16_t max_interval_ms;
+} telemetry_limits;
+uint32_t baud_rate;
+bool recording;
 
-void from_doc(StaticJsonDocument<JSON_DOC_SIZE_RX> &doc);
+// Flags of the top level members. The parser returns the flags of the members contained in a document, so receivers can skip work for members that weren't updated.
+typedef uint16_t MemberFlags;
+enum Member : MemberFlags {
+CALIBRATION = (1UL << 0),
+CONTROL_STATE = (1UL << 1),
+POS_SETPOINT_MM = (1UL << 2),
+PARAMETERS = (1UL << 3),
+SUBSCRIPTION = (1UL << 4),
+PARAMETER_PROFILE = (1UL << 5),
+TELEMETRY_LIMITS = (1UL << 6),
+BAUD_RATE = (1UL << 7),
+RECORDING = (1UL << 8),
+};
+static const JsonField FIELDS[RX_FIELD_COUNT];  // Table of the members for the streaming parser in parser.hpp
+void assign_members(const ReceiveInterface &src, MemberFlags members);  // Copies only the top level members whose flags are passed
+void persistent_to_bin(uint8_t *dest) const;  // Packs only the members listed in TO_DEVICE_PERSISTENT into BIN_SIZE_PERSISTENT bytes
+void persistent_from_bin(const uint8_t *src);  // Unpacks the members listed in TO_DEVICE_PERSISTENT from BIN_SIZE_PERSISTENT bytes
 };
 
 struct TransmitInterface {
@@ -128,6 +208,10 @@ struct {
 double angle_rad;
 double vel_rad_s;
 } tilt;
+struct {
+uint8_t fifo_samples;
+uint16_t fifo_overflows;
+} mpu;
 } sensor;
 struct {
 struct {
@@ -158,6 +242,12 @@ double z_mm;
 struct {
 uint32_t cycle_us;
 struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+} period;
+uint16_t overruns;
+struct {
 double u;
 double u_bal;
 double u_pos;
@@ -166,8 +256,87 @@ double u_ff;
 int16_t motor;
 } control;
 bool calibrated;
+uint8_t calibration_progress;
+uint16_t parameters_crc;
+uint16_t parameter_profiles_crc;
+uint16_t telemetry_interval_ms;
+uint32_t baud_rate;
+
+// Flags of the members on the lowest level (channels) and of the nested structs combining them. Only the channels passed to to_doc() and to_bin() are encoded, so receivers can subscribe to the ones they need.
+typedef uint32_t ChannelFlags;
+enum Channel : ChannelFlags {
+SENSOR_WHEEL_ANGLE_RAD = (1UL << 0),
+SENSOR_WHEEL_ANGLE_DERIV_RAD_S = (1UL << 1),
+SENSOR_WHEEL = SENSOR_WHEEL_ANGLE_RAD | SENSOR_WHEEL_ANGLE_DERIV_RAD_S,
+SENSOR_TILT_ANGLE_RAD = (1UL << 2),
+SENSOR_TILT_VEL_RAD_S = (1UL << 3),
+SENSOR_TILT = SENSOR_TILT_ANGLE_RAD | SENSOR_TILT_VEL_RAD_S,
+SENSOR_MPU_FIFO_SAMPLES = (1UL << 4),
+SENSOR_MPU_FIFO_OVERFLOWS = (1UL << 5),
+SENSOR_MPU = SENSOR_MPU_FIFO_SAMPLES | SENSOR_MPU_FIFO_OVERFLOWS,
+SENSOR = SENSOR_WHEEL | SENSOR_TILT | SENSOR_MPU,
+OBSERVER_WHEEL_ANGLE_RAD = (1UL << 6),
+OBSERVER_WHEEL_VEL_RAD_S = (1UL << 7),
+OBSERVER_WHEEL = OBSERVER_WHEEL_ANGLE_RAD | OBSERVER_WHEEL_VEL_RAD_S,
+OBSERVER_TILT_ANGLE_RAD = (1UL << 8),
+OBSERVER_TILT_VEL_RAD_S = (1UL << 9),
+OBSERVER_TILT = OBSERVER_TILT_ANGLE_RAD | OBSERVER_TILT_VEL_RAD_S,
+OBSERVER_POSITION_Z_MM = (1UL << 10),
+OBSERVER_POSITION = OBSERVER_POSITION_Z_MM,
+OBSERVER = OBSERVER_WHEEL | OBSERVER_TILT | OBSERVER_POSITION,
+FF_MODEL_WHEEL_ANGLE_RAD = (1UL << 11),
+FF_MODEL_WHEEL_VEL_RAD_S = (1UL << 12),
+FF_MODEL_WHEEL = FF_MODEL_WHEEL_ANGLE_RAD | FF_MODEL_WHEEL_VEL_RAD_S,
+FF_MODEL_TILT_ANGLE_RAD = (1UL << 13),
+FF_MODEL_TILT_VEL_RAD_S = (1UL << 14),
+FF_MODEL_TILT = FF_MODEL_TILT_ANGLE_RAD | FF_MODEL_TILT_VEL_RAD_S,
+FF_MODEL_POSITION_Z_MM = (1UL << 15),
+FF_MODEL_POSITION = FF_MODEL_POSITION_Z_MM,
+FF_MODEL = FF_MODEL_WHEEL | FF_MODEL_TILT | FF_MODEL_POSITION,
+CONTROL_CYCLE_US = (1UL << 16),
+CONTROL_PERIOD_MIN_US = (1UL << 17),
+CONTROL_PERIOD_MAX_US = (1UL << 18),
+CONTROL_PERIOD_MEAN_US = (1UL << 19),
+CONTROL_PERIOD = CONTROL_PERIOD_MIN_US | CONTROL_PERIOD_MAX_US | CONTROL_PERIOD_MEAN_US,
+CONTROL_OVERRUNS = (1UL << 20),
+CONTROL_SIGNAL_U = (1UL << 21),
+CONTROL_SIGNAL_U_BAL = (1UL << 22),
+CONTROL_SIGNAL_U_POS = (1UL << 23),
+CONTROL_SIGNAL_U_FF = (1UL << 24),
+CONTROL_SIGNAL = CONTROL_SIGNAL_U | CONTROL_SIGNAL_U_BAL | CONTROL_SIGNAL_U_POS | CONTROL_SIGNAL_U_FF,
+CONTROL_MOTOR = (1UL << 25),
+CONTROL = CONTROL_CYCLE_US | CONTROL_PERIOD | CONTROL_OVERRUNS | CONTROL_SIGNAL | CONTROL_MOTOR,
+CALIBRATED = (1UL << 26),
+CALIBRATION_PROGRESS = (1UL << 27),
+PARAMETERS_CRC = (1UL << 28),
+PARAMETER_PROFILES_CRC = (1UL << 29),
+TELEMETRY_INTERVAL_MS = (1UL << 30),
+BAUD_RATE = (1UL << 31),
+ALL_CHANNELS = SENSOR | OBSERVER | FF_MODEL | CONTROL | CALIBRATED | CALIBRATION_PROGRESS | PARAMETERS_CRC | PARAMETER_PROFILES_CRC | TELEMETRY_INTERVAL_MS | BAUD_RATE
+};
+StaticJsonDocument<JSON_DOC_SIZE_TX> to_doc(ChannelFlags channels);
+size_t to_bin(uint8_t *dest, ChannelFlags channels) const;  // Packs the channels in the order of definition and returns their size, which is BIN_SIZE_TX at most
+static size_t bin_size(ChannelFlags channels);
+size_t sample_to_bin(uint8_t *dest) const;  // Packs only the members listed in FROM_DEVICE_SAMPLE
+};
+
+// Inputs and outputs of a control step, which are recorded in every control cycle while recording is set, c.f. FROM_DEVICE_RECORD
+struct RecordInterface {
+struct {
+double tilt_vel_rad_s;
+double tilt_angle_rad;
+double wheel_angle_rad;
+} measurements;
+struct {
+double pos_setpoint_mm;
+bool control_enabled;
+} setpoint;
+bool reset;
+uint32_t cycle_us;
+double u;
+int16_t motor;
 
-StaticJsonDocument<JSON_DOC_SIZE_TX> to_doc();
+size_t to_bin(uint8_t *dest) const;  // Packs BIN_SIZE_RECORD bytes
 };
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef JSON_FIELD_HPP
+#define JSON_FIELD_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+// The host tools keep the field tables in RAM
+#define PROGMEM
+#define PSTR(s) (s)
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#endif
+
+/*
+Entry of a field table that generate.ps1 creates for an interface, which the streaming JSON parser matches the keys of a document against (c.f. parser.hpp).
+The members of each nested struct are listed one after another, so the table is a trie over the key paths. The top level members come first.
+Tables and keys are located in program memory.
+*/
+struct JsonField {
+  enum Type : uint8_t {
+    OBJECT,  // Nested struct
+    BOOL,
+    CHARS,  // char array
+    FLOAT,
+    DOUBLE,
+    INT,
+    INT8,
+    INT16,
+    INT32,
+    INT64,
+    UINT8,
+    UINT16,
+    UINT32,
+    UINT64,
+  };
+
+  const char *key;
+  Type type;
+  uint8_t count;   // OBJECT: Number of members, CHARS: Size of the array
+  uint16_t index;  // OBJECT: Table index of the first member, otherwise offset of the member in the interface
+};
+
+#endif
@@ -0,0 +1,358 @@
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "parser.hpp"
+
+static bool is_whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_number_char(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static bool is_hex_digit(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static JsonField read_field(uint8_t index) {
+  JsonField f;
+  memcpy_P(&f, &ReceiveInterface::FIELDS[index], sizeof(f));
+  return f;
+}
+
+// Integers out of the range of the member are converted to 0 like ArduinoJson does
+template<typename T>
+static T to_unsigned(bool negative, uint32_t magnitude, uint32_t max) {
+  return (!negative || magnitude == 0) && magnitude <= max ? (T)magnitude : 0;
+}
+
+template<typename T>
+static T to_signed(bool negative, uint32_t magnitude, uint32_t max) {
+  if (!negative || magnitude == 0) return magnitude <= max ? (T)magnitude : 0;
+  return magnitude - 1 <= max ? -(T)(magnitude - 1) - 1 : 0;
+}
+
+ReceiveParser::ReceiveParser(ReceiveInterface &target)
+  : target(target) {
+  reset();
+}
+
+// Starts a new document. The target is left as it is, so members that aren't contained in the document keep their values.
+void ReceiveParser::reset() {
+  state = VALUE;
+  error = INCOMPLETE_INPUT;
+  members = 0;
+  depth = 0;
+  field = ROOT;
+  token_length = 0;
+  string_dest = nullptr;
+  string_space = 0;
+  unicode_digits = 0;
+}
+
+// Parses the next piece of the document. Returns false once the input turned out to be invalid, after which further input is ignored.
+bool ReceiveParser::feed(const char *data, size_t length) {
+  size_t i = 0;
+  while (i < length && state != FAILED) {
+    if (step(data[i])) i++;
+  }
+  return state != FAILED;
+}
+
+// Returns whether the document was complete and valid, after all of it has been fed
+ReceiveParser::Error ReceiveParser::finish() const {
+  if (state == DONE) return OK;
+  return state == FAILED ? error : INCOMPLETE_INPUT;
+}
+
+ReceiveInterface::MemberFlags ReceiveParser::updated_members() const {
+  return members;
+}
+
+// Processes a character. Returns false if the character terminated a number or literal without being part of it, so it has to be processed again in the next state.
+bool ReceiveParser::step(char c) {
+  switch (state) {
+    case VALUE:
+      if (!is_whitespace(c)) start_value(c);
+      return true;
+    case VALUE_OR_ARRAY_END:
+      if (c == ']') close();
+      else if (!is_whitespace(c)) start_value(c);
+      return true;
+    case KEY_OR_OBJECT_END:
+      if (c == '}') close();
+      else if (c == '"') state = KEY;
+      else if (!is_whitespace(c)) fail(INVALID_INPUT);
+      token_length = 0;
+      return true;
+    case KEY_START:
+      if (c == '"') state = KEY;
+      else if (!is_whitespace(c)) fail(INVALID_INPUT);
+      token_length = 0;
+      return true;
+    case KEY:
+      if (c == '"') finish_key();
+      else if (c == '\\') state = KEY_ESCAPE;
+      else if ((uint8_t)c < 0x20) fail(INVALID_INPUT);
+      else append_to_token(c);
+      return true;
+    case KEY_ESCAPE:
+      append_to_token(c);  // Not decoded, since the keys of the interface don't need to be escaped
+      state = KEY;
+      return true;
+    case COLON:
+      if (c == ':') state = VALUE;
+      else if (!is_whitespace(c)) fail(INVALID_INPUT);
+      return true;
+    case OBJECT_NEXT:
+      if (c == ',') state = KEY_START;
+      else if (c == '}') close();
+      else if (!is_whitespace(c)) fail(INVALID_INPUT);
+      return true;
+    case ARRAY_NEXT:
+      if (c == ',') {
+        field = IGNORED;
+        state = VALUE;
+      } else if (c == ']') {
+        close();
+      } else if (!is_whitespace(c)) {
+        fail(INVALID_INPUT);
+      }
+      return true;
+    case STRING:
+      if (c == '"') {
+        if (string_dest) *string_dest = '\0';
+        finish_value();
+      } else if (c == '\\') {
+        state = STRING_ESCAPE;
+      } else if ((uint8_t)c < 0x20) {
+        fail(INVALID_INPUT);
+      } else {
+        append_to_string(c);
+      }
+      return true;
+    case STRING_ESCAPE:
+      state = STRING;
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/': append_to_string(c); break;
+        case 'b': append_to_string('\b'); break;
+        case 'f': append_to_string('\f'); break;
+        case 'n': append_to_string('\n'); break;
+        case 'r': append_to_string('\r'); break;
+        case 't': append_to_string('\t'); break;
+        case 'u':
+          append_to_string('?');  // Characters beyond ASCII are not decoded
+          unicode_digits = 4;
+          state = STRING_UNICODE;
+          break;
+        default: fail(INVALID_INPUT);
+      }
+      return true;
+    case STRING_UNICODE:
+      if (!is_hex_digit(c)) fail(INVALID_INPUT);
+      else if (--unicode_digits == 0) state = STRING;
+      return true;
+    case NUMBER:
+      if (is_number_char(c)) {
+        append_to_token(c);
+        return true;
+      }
+      finish_number();
+      return state == FAILED;
+    case LITERAL:
+      if (c >= 'a' && c <= 'z') {
+        append_to_token(c);
+        return true;
+      }
+      finish_literal();
+      return state == FAILED;
+    case DONE:
+      if (!is_whitespace(c)) fail(INVALID_INPUT);
+      return true;
+    case FAILED:
+      return true;
+  }
+  return true;
+}
+
+void ReceiveParser::start_value(char c) {
+  if (depth == 0 && c != '{') {
+    fail(INVALID_INPUT);  // The root must be an object
+    return;
+  }
+
+  const bool known = field < RX_FIELD_COUNT;
+  const JsonField f = known ? read_field(field) : JsonField{};
+  if (c == '{') {
+    if (known && f.type == JsonField::OBJECT) mark_member();
+    if (open(field == ROOT || (known && f.type == JsonField::OBJECT) ? field : IGNORED)) state = KEY_OR_OBJECT_END;
+  } else if (c == '[') {
+    if (open(ARRAY)) state = VALUE_OR_ARRAY_END;
+    field = IGNORED;
+  } else if (c == '"') {
+    const bool chars = known && f.type == JsonField::CHARS;
+    if (chars) mark_member();
+    string_dest = chars ? (char *)&target + f.index : nullptr;
+    string_space = chars ? f.count : 0;
+    state = STRING;
+  } else if (c == '-' || (c >= '0' && c <= '9')) {
+    token_length = 0;
+    append_to_token(c);
+    state = NUMBER;
+  } else if (c >= 'a' && c <= 'z') {
+    token_length = 0;
+    append_to_token(c);
+    state = LITERAL;
+  } else {
+    fail(INVALID_INPUT);
+  }
+}
+
+bool ReceiveParser::open(uint8_t container) {
+  if (depth == MAX_DEPTH) {
+    fail(TOO_DEEP);
+    return false;
+  }
+  stack[depth++] = container;
+  return true;
+}
+
+void ReceiveParser::close() {
+  depth--;
+  finish_value();
+}
+
+// Continues with the container of the value that was read or ends the document if it was the root object
+void ReceiveParser::finish_value() {
+  if (depth == 0) state = DONE;
+  else state = stack[depth - 1] == ARRAY ? ARRAY_NEXT : OBJECT_NEXT;
+}
+
+// Looks the key up among the members of the innermost open object
+void ReceiveParser::finish_key() {
+  field = IGNORED;
+  state = COLON;
+  const uint8_t parent = stack[depth - 1];
+  if (token_length == TOKEN_BUFFER_SIZE || parent == IGNORED) return;
+  token[token_length] = '\0';
+
+  uint8_t first = 0;
+  uint8_t count = RX_ROOT_FIELD_COUNT;
+  if (parent != ROOT) {
+    const JsonField p = read_field(parent);
+    first = p.index;
+    count = p.count;
+  }
+  for (uint8_t i = first; i < first + count; i++) {
+    if (strcmp_P(token, read_field(i).key) == 0) {
+      field = i;
+      return;
+    }
+  }
+}
+
+void ReceiveParser::finish_number() {
+  if (token_length == TOKEN_BUFFER_SIZE) {
+    fail(NUMBER_TOO_LONG);
+    return;
+  }
+  token[token_length] = '\0';
+  char *end;
+  const double value = strtod(token, &end);
+  if (end != token + token_length) {
+    fail(INVALID_INPUT);
+    return;
+  }
+  finish_value();
+  if (field >= RX_FIELD_COUNT) return;
+
+  const JsonField f = read_field(field);
+  if (f.type == JsonField::OBJECT || f.type == JsonField::BOOL || f.type == JsonField::CHARS) return;  // Numbers for other members are ignored
+  mark_member();
+  void *dest = (uint8_t *)&target + f.index;
+  if (f.type == JsonField::FLOAT) {
+    *(float *)dest = value;
+    return;
+  }
+  if (f.type == JsonField::DOUBLE) {
+    *(double *)dest = value;
+    return;
+  }
+
+  // Integers are converted exactly instead of by means of value, which is single precision on AVR
+  const bool negative = token[0] == '-';
+  uint32_t magnitude = 0;
+  if (strpbrk(token, ".eE") == nullptr) {
+    errno = 0;
+    magnitude = strtoul(token + negative, nullptr, 10);
+    if (errno == ERANGE) magnitude = 0;
+  } else if (fabs(value) < 4294967296.0) {
+    magnitude = fabs(value);
+  }
+  switch (f.type) {
+    case JsonField::INT: *(int *)dest = to_signed<int>(negative, magnitude, INT_MAX); break;
+    case JsonField::INT8: *(int8_t *)dest = to_signed<int8_t>(negative, magnitude, INT8_MAX); break;
+    case JsonField::INT16: *(int16_t *)dest = to_signed<int16_t>(negative, magnitude, INT16_MAX); break;
+    case JsonField::INT32: *(int32_t *)dest = to_signed<int32_t>(negative, magnitude, INT32_MAX); break;
+    case JsonField::INT64: *(int64_t *)dest = to_signed<int64_t>(negative, magnitude, UINT32_MAX); break;
+    case JsonField::UINT8: *(uint8_t *)dest = to_unsigned<uint8_t>(negative, magnitude, UINT8_MAX); break;
+    case JsonField::UINT16: *(uint16_t *)dest = to_unsigned<uint16_t>(negative, magnitude, UINT16_MAX); break;
+    case JsonField::UINT32: *(uint32_t *)dest = to_unsigned<uint32_t>(negative, magnitude, UINT32_MAX); break;
+    case JsonField::UINT64: *(uint64_t *)dest = to_unsigned<uint64_t>(negative, magnitude, UINT32_MAX); break;
+    default: break;
+  }
+}
+
+void ReceiveParser::finish_literal() {
+  if (token_length == TOKEN_BUFFER_SIZE) {
+    fail(INVALID_INPUT);
+    return;
+  }
+  token[token_length] = '\0';
+  bool value;
+  if (strcmp_P(token, PSTR("true")) == 0) {
+    value = true;
+  } else if (strcmp_P(token, PSTR("false")) == 0) {
+    value = false;
+  } else if (strcmp_P(token, PSTR("null")) == 0) {
+    finish_value();  // Null values leave the member unchanged
+    return;
+  } else {
+    fail(INVALID_INPUT);
+    return;
+  }
+  finish_value();
+  if (field >= RX_FIELD_COUNT) return;
+
+  const JsonField f = read_field(field);
+  if (f.type != JsonField::BOOL) return;  // Literals for other members are ignored
+  mark_member();
+  *(bool *)((uint8_t *)&target + f.index) = value;
+}
+
+void ReceiveParser::append_to_token(char c) {
+  if (token_length < TOKEN_BUFFER_SIZE - 1) token[token_length++] = c;
+  else token_length = TOKEN_BUFFER_SIZE;
+}
+
+// Appends to the char array member if the string is read into one. Longer strings are truncated.
+void ReceiveParser::append_to_string(char c) {
+  if (string_space > 1) {
+    *string_dest++ = c;
+    string_space--;
+  }
+}
+
+// Flags the top level member whose value is stored, or whose object is opened. Values that are ignored don't flag their member.
+void ReceiveParser::mark_member() {
+  if (depth == 1 && field < RX_ROOT_FIELD_COUNT) members |= (ReceiveInterface::MemberFlags)1 << field;
+}
+
+void ReceiveParser::fail(Error e) {
+  error = e;
+  state = FAILED;
+}
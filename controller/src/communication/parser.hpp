@@ -0,0 +1,93 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include "interface.hpp"
+
+/*
+Streaming JSON parser that writes the values of a document straight into the members of a ReceiveInterface, without building a document in memory.
+Keys are looked up in the generated field table ReceiveInterface::FIELDS one level at a time, so a member is found by comparing with the keys of its siblings only.
+The input is consumed byte by byte and may be passed in pieces of any size, so parsing a document can be spread over several calls. The parser only keeps the open objects
+and the key or number that is currently read. reset() prepares the parser for the next document, which is parsed into the same target.
+
+Members that aren't contained in the document are left unchanged and null values are ignored. Values are converted like ArduinoJson converts them,
+except that a value of another JSON type than the member (e.g. a string for a number) is ignored as well. Unknown keys are skipped including their values.
+updated_members() flags the top level members that a value was stored into, so a member whose value was ignored counts as not contained.
+Numbers are converted by strtod() and integers are limited to 32 bits, as ArduinoJson does on AVR.
+*/
+class ReceiveParser {
+public:
+  enum Error : uint8_t {
+    OK,
+    INCOMPLETE_INPUT,
+    INVALID_INPUT,
+    TOO_DEEP,  // Unknown values are nested deeper than the receive interface
+    NUMBER_TOO_LONG,
+  };
+
+private:
+  static const uint8_t MAX_DEPTH = RX_OBJECT_DEPTH + 2;  // Leaves some levels to skip unknown values with
+  static const uint8_t TOKEN_BUFFER_SIZE = 32;            // Longest key, number or literal + 1
+  static_assert(RX_MAX_KEY_LENGTH < TOKEN_BUFFER_SIZE, "The keys of the receive interface must fit the token buffer");
+
+  // Markers of the field that is read and of the open containers, which don't refer to an entry of the field table
+  static const uint8_t ROOT = 0xFF;     // The root object
+  static const uint8_t IGNORED = 0xFE;  // A value of an unknown key, an element of an array or a value of another type than its member
+  static const uint8_t ARRAY = 0xFD;    // An open array, whose elements are ignored
+
+  enum State : uint8_t {
+    VALUE,
+    VALUE_OR_ARRAY_END,
+    KEY_OR_OBJECT_END,
+    KEY_START,
+    KEY,
+    KEY_ESCAPE,
+    COLON,
+    OBJECT_NEXT,
+    ARRAY_NEXT,
+    STRING,
+    STRING_ESCAPE,
+    STRING_UNICODE,
+    NUMBER,
+    LITERAL,
+    DONE,
+    FAILED,
+  };
+
+  ReceiveInterface &target;
+  State state;
+  Error error;
+  ReceiveInterface::MemberFlags members;
+
+  uint8_t stack[MAX_DEPTH];
+  uint8_t depth;
+  uint8_t field;  // Field of the value that is read, which is a table index or a marker
+
+  char token[TOKEN_BUFFER_SIZE];  // Key, number or literal that is read. A key that doesn't fit is marked by token_length = TOKEN_BUFFER_SIZE.
+  uint8_t token_length;
+  char *string_dest;  // Remaining space of the char array member a string is read into
+  uint8_t string_space;
+  uint8_t unicode_digits;
+
+  bool step(char c);
+  void start_value(char c);
+  bool open(uint8_t container);
+  void close();
+  void finish_value();
+  void finish_key();
+  void finish_number();
+  void finish_literal();
+  void append_to_token(char c);
+  void append_to_string(char c);
+  void mark_member();
+  void fail(Error e);
+
+public:
+  ReceiveParser(ReceiveInterface &target);
+
+  void reset();
+  bool feed(const char *data, size_t length);
+  Error finish() const;
+  ReceiveInterface::MemberFlags updated_members() const;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "telemetry_rate.hpp"
+
+TelemetryRate::TelemetryRate(uint32_t baud_rate) {
+  set_baud_rate(baud_rate);
+}
+
+// Restarts the estimate of the drain rate from the byte rate of the given baud rate, e.g. after the baud rate was switched
+void TelemetryRate::set_baud_rate(uint32_t baud_rate) {
+  drain_bytes_per_ms = baud_rate / 10 / 1000.0;  // Each byte takes 10 bits including start and stop bit
+}
+
+// Schedules the next telemetry packet. Called right after a telemetry packet was enqueued with the bytes that are queued now and the transmit statistics since the previous call.
+// Limits of 0 select the defaults, c.f. TELEMETRY_DEFAULT_MIN_INTERVAL_MS and TELEMETRY_DEFAULT_MAX_INTERVAL_MS.
+void TelemetryRate::update(uint32_t now_ms, uint16_t pending_bytes, const Communication::TxDrain &drain, uint16_t min_interval_ms, uint16_t max_interval_ms) {
+  const uint32_t elapsed_ms = now_ms - last_update_ms;
+  last_update_ms = now_ms;
+  if (!drain.ran_dry && elapsed_ms > 0) drain_bytes_per_ms += ((float)drain.sent_bytes / elapsed_ms - drain_bytes_per_ms) * DRAIN_SMOOTHING;
+
+  if (min_interval_ms == 0) min_interval_ms = TELEMETRY_DEFAULT_MIN_INTERVAL_MS;
+  if (max_interval_ms == 0) max_interval_ms = TELEMETRY_DEFAULT_MAX_INTERVAL_MS;
+  max_interval_ms = max(max_interval_ms, min_interval_ms);
+
+  const float drain_ms = drain_bytes_per_ms > 0 ? pending_bytes / drain_bytes_per_ms : max_interval_ms;
+  interval = constrain(drain_ms + 0.5f, min_interval_ms, max_interval_ms);
+}
+
+// Interval after which the next telemetry packet is to be enqueued
+uint16_t TelemetryRate::interval_ms() const {
+  return interval;
+}
@@ -0,0 +1,34 @@
+#ifndef TELEMETRY_RATE_HPP
+#define TELEMETRY_RATE_HPP
+
+#include <Arduino.h>
+#include "comm.hpp"
+
+// Limits of the telemetry interval that are used as long as the GUI didn't send any (telemetry_limits = 0)
+#define TELEMETRY_DEFAULT_MIN_INTERVAL_MS 6  // The default control period, since the telemetry doesn't change faster than that
+#define TELEMETRY_DEFAULT_MAX_INTERVAL_MS 200
+
+/*
+Adapts the interval in which tx_data is enqueued to the occupancy of the link, so the telemetry takes the bandwidth the other lanes leave without waiting in its lane for long.
+After each telemetry packet was enqueued, the next one is scheduled for when the transmitter will have sent all bytes that are queued by then, i.e. the new packet and those of the other lanes.
+This time is estimated from the drain rate of the transmit lanes. The drain rate is only measured over intervals in which the transmitter never ran out of packets,
+because it sends less than the link is able to otherwise. It starts from the byte rate of the baud rate, so smaller subscriptions, fewer sample batches or a smaller encoding
+shorten the interval right away, while bigger ones lengthen it.
+The interval is limited to the range received from the GUI.
+*/
+class TelemetryRate {
+  static constexpr float DRAIN_SMOOTHING = 0.125;  // Weight of a new measurement of the drain rate
+
+  float drain_bytes_per_ms;
+  uint32_t last_update_ms = 0;
+  uint16_t interval = TELEMETRY_DEFAULT_MIN_INTERVAL_MS;
+
+public:
+  TelemetryRate(uint32_t baud_rate);
+
+  void set_baud_rate(uint32_t baud_rate);
+  void update(uint32_t now_ms, uint16_t pending_bytes, const Communication::TxDrain &drain, uint16_t min_interval_ms, uint16_t max_interval_ms);
+  uint16_t interval_ms() const;
+};
+
+#endif
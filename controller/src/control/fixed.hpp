@@ -0,0 +1,97 @@
+#ifndef FIXED_HPP
+#define FIXED_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+Q-format fixed point numbers. A value is stored as a 32 bit integer with FRAC_BITS fractional bits, c.f. https://en.wikipedia.org/wiki/Q_(number_format).
+The AVR has no floating point unit, so every floating point operation is emulated in software. Fixed point additions instead are plain integer additions
+and multiplications use the hardware multiplier. Values that don't fit the range of the format saturate when converted from floating point.
+This header does not depend on the Arduino core, so it can be compiled on the host as well.
+*/
+template<uint8_t FRAC_BITS>
+struct Fixed {
+  int32_t raw;
+
+  static Fixed from_double(double value) {
+    double scaled = value * (double)(1UL << FRAC_BITS);
+    Fixed result;
+    if (scaled >= (double)INT32_MAX) result.raw = INT32_MAX;
+    else if (scaled <= (double)INT32_MIN) result.raw = INT32_MIN;
+    else result.raw = lround(scaled);
+    return result;
+  }
+
+  double to_double() const {
+    return raw * (1.0 / (1UL << FRAC_BITS));
+  }
+
+  Fixed operator+(Fixed other) const {
+    Fixed result;
+    result.raw = raw + other.raw;
+    return result;
+  }
+
+  Fixed operator-(Fixed other) const {
+    Fixed result;
+    result.raw = raw - other.raw;
+    return result;
+  }
+
+  bool operator==(Fixed other) const {
+    return raw == other.raw;
+  }
+
+  bool operator!=(Fixed other) const {
+    return raw != other.raw;
+  }
+};
+
+/*
+Sums up products of coefficients (COEFF_FRAC_BITS) and signals (SIGNAL_FRAC_BITS) without intermediate rounding.
+The products are accumulated in 64 bit with COEFF_FRAC_BITS + SIGNAL_FRAC_BITS fractional bits and only rounded to the signal format when the result is taken.
+*/
+template<uint8_t COEFF_FRAC_BITS, uint8_t SIGNAL_FRAC_BITS>
+struct FixedAccumulator {
+  int64_t raw = 0;
+
+  void mac(Fixed<COEFF_FRAC_BITS> coeff, Fixed<SIGNAL_FRAC_BITS> signal) {
+    raw += (int64_t)coeff.raw * signal.raw;
+  }
+
+  void msc(Fixed<COEFF_FRAC_BITS> coeff, Fixed<SIGNAL_FRAC_BITS> signal) {
+    raw -= (int64_t)coeff.raw * signal.raw;
+  }
+
+  Fixed<SIGNAL_FRAC_BITS> result() const {
+    int64_t rounded = (raw + HALF) >> COEFF_FRAC_BITS;
+    Fixed<SIGNAL_FRAC_BITS> result;
+    if (rounded > INT32_MAX) result.raw = INT32_MAX;
+    else if (rounded < INT32_MIN) result.raw = INT32_MIN;
+    else result.raw = (int32_t)rounded;
+    return result;
+  }
+
+  /*
+  Error feedback for recursively calculated states. The rounding error of result() is returned as residue and added to the next accumulation of the same state.
+  Otherwise, the rounding errors add up to a bias that is amplified by slow poles, e.g. of the feedforward model.
+  Only the lower 32 bits are involved, so this is far cheaper than keeping the states in 64 bit.
+  */
+  typedef int32_t Residue;
+
+  void feed(Residue residue) {
+    raw += residue;
+  }
+
+  Fixed<SIGNAL_FRAC_BITS> result(Residue &residue) const {
+    residue = (int32_t)(((uint32_t)raw + HALF) & MASK) - HALF;
+    return result();
+  }
+
+private:
+  static const int32_t HALF = (int32_t)1 << (COEFF_FRAC_BITS - 1);
+  static const uint32_t MASK = ((uint32_t)1 << COEFF_FRAC_BITS) - 1;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef HAL_HPP
+#define HAL_HPP
+
+#include <stdint.h>
+
+/*
+Hardware abstraction of the control step. ControlStep::run() only accesses sensors, setpoints and the motor through a class with the following members,
+which is passed as template parameter. So the very same control code runs on the target (TargetHal in controller.ino) and in the host simulation (tools/plant_simulation):
+  ControlMeasurements measure();    Returns the sensor readings of the current cycle
+  ControlSetpoint setpoint();       Returns the setpoint and control state commanded by the GUI
+  void actuate(int16_t motor_val);  Applies the motor PWM value, whose sign is the rotation direction
+The members are called once per cycle in this order.
+This header does not depend on the Arduino core, so it can be compiled on the host as well.
+*/
+
+struct ControlMeasurements {
+  double tilt_vel_rad_s;
+  double tilt_angle_rad;
+  double wheel_angle_rad;
+};
+
+struct ControlSetpoint {
+  double pos_setpoint_mm;
+  bool control_enabled;
+};
+
+#endif
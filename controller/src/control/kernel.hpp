@@ -0,0 +1,384 @@
+#ifndef KERNEL_HPP
+#define KERNEL_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include "fixed.hpp"
+
+// Comment in/out to change the arithmetic of the control kernel. If commented out, the kernel computes with software emulated floating point numbers (double is a 32 bit float on AVR).
+#define ENABLE_FIXED_POINT_CONTROL
+
+/*
+Number formats of the fixed point kernel.
+Coefficients are Q9.22 numbers which covers the range of +/- 512 with a resolution of 2.4e-7. The largest gains and matrix entries in data/parameters are about 100.
+Signals and states are Q15.16 numbers which covers the range of +/- 32768 with a resolution of 1.5e-5. This fits the wheel angle in rad for several hundred meters of travel.
+Recursively calculated states use error feedback of the rounding (see FixedAccumulator::result()), so their rounding errors don't add up.
+The host tool in tools/fixed_point_check compares both kernels on the parameter sets to check that these formats are sufficient.
+*/
+#define CONTROL_COEFF_FRAC_BITS 22
+#define CONTROL_SIGNAL_FRAC_BITS 16
+
+// Arithmetic policies of the control kernel. They define the number types and how to convert from and to the floating point values of the interfaces.
+template<typename T>
+struct FloatingPointArithmetic {
+  typedef T Signal;
+  typedef T Coefficient;
+
+  struct Accumulator {
+    T raw = 0;
+
+    void mac(Coefficient coeff, Signal signal) {
+      raw += coeff * signal;
+    }
+
+    void msc(Coefficient coeff, Signal signal) {
+      raw -= coeff * signal;
+    }
+
+    Signal result() const {
+      return raw;
+    }
+
+    // There is no rounding to the signal format, so no error feedback is required.
+    struct Residue {};
+
+    void feed(Residue) {}
+
+    Signal result(Residue &) const {
+      return raw;
+    }
+  };
+
+  static Signal signal(double value) {
+    return value;
+  }
+
+  static Coefficient coefficient(double value) {
+    return value;
+  }
+
+  static double to_double(Signal value) {
+    return value;
+  }
+
+  static const uint16_t FORMAT = 0;  // Identifies the number formats, c.f. ControlKernel::save_state()
+};
+
+template<uint8_t COEFF_FRAC_BITS, uint8_t SIGNAL_FRAC_BITS>
+struct FixedPointArithmetic {
+  typedef Fixed<SIGNAL_FRAC_BITS> Signal;
+  typedef Fixed<COEFF_FRAC_BITS> Coefficient;
+  typedef FixedAccumulator<COEFF_FRAC_BITS, SIGNAL_FRAC_BITS> Accumulator;
+
+  static Signal signal(double value) {
+    return Signal::from_double(value);
+  }
+
+  static Coefficient coefficient(double value) {
+    return Coefficient::from_double(value);
+  }
+
+  static double to_double(Signal value) {
+    return value.to_double();
+  }
+
+  static const uint16_t FORMAT = (uint16_t)COEFF_FRAC_BITS << 8 | SIGNAL_FRAC_BITS;
+};
+
+/*
+Row-major matrix that only stores its nonzero entries, so the hot loop doesn't multiply by zero. This skips e.g. the couplings of tilt and wheel dynamics that the observer design leaves out.
+Entries that become zero when converted to the coefficient format are dropped as well.
+*/
+template<typename Arithmetic, uint8_t ROWS, uint8_t COLS>
+struct SparseMatrix {
+  typedef typename Arithmetic::Signal Signal;
+  typedef typename Arithmetic::Coefficient Coefficient;
+  typedef typename Arithmetic::Accumulator Accumulator;
+
+  struct Entry {
+    uint8_t col;
+    Coefficient coeff;
+  };
+  Entry entries[ROWS * COLS];
+  uint8_t row_start[ROWS + 1];  // Entries of row i are entries[row_start[i]] up to but excluding entries[row_start[i + 1]]
+
+  void compile(const double dense[ROWS][COLS]) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < ROWS; i++) {
+      row_start[i] = n;
+      for (uint8_t j = 0; j < COLS; j++) {
+        const Coefficient coeff = Arithmetic::coefficient(dense[i][j]);
+        if (coeff == Coefficient()) continue;
+        entries[n].col = j;
+        entries[n].coeff = coeff;
+        n++;
+      }
+    }
+    row_start[ROWS] = n;
+  }
+
+  bool empty() const {
+    return row_start[ROWS] == 0;
+  }
+
+  // Adds row i multiplied by the vector v to acc
+  void mac_row(uint8_t i, const Signal v[COLS], Accumulator &acc) const {
+    const Entry *entry = entries + row_start[i];
+    const Entry *const end = entries + row_start[i + 1];
+    for (; entry != end; entry++) acc.mac(entry->coeff, v[entry->col]);
+  }
+};
+
+/*
+Optional stages of the control pipeline. The parameter sets of data/parameters use different topologies, e.g. without observer, feedforward or integral action.
+The kernel step is instantiated for every combination of the kernel stages, so the stages a parameter set doesn't use are compiled away instead of being computed with zero parameters.
+*/
+enum ControlStage : uint8_t {
+  OBSERVER_STAGE = (1 << 0),     // Observer that estimates the states. Otherwise, the states are the measurements weighted by the innovation gain.
+  FEEDFORWARD_STAGE = (1 << 1),  // Feedforward model and control signal (Kc != 0)
+  INTEGRAL_STAGE = (1 << 2),     // Integral action of the position control (ki != 0)
+  DEADZONE_STAGE = (1 << 3)      // Motor deadzone compensation (m_stop != 0 or m_start != 0). Applied to the motor output, not by the kernel.
+};
+const uint8_t CONTROL_KERNEL_STAGES = OBSERVER_STAGE | FEEDFORWARD_STAGE | INTEGRAL_STAGE;
+
+/*
+Observer, feedforward model, feedback and integral action of the balance and position control.
+All parameters are compiled to the number format of the arithmetic by CompiledParameters::compile(), which is only done when parameters were received rather than in every cycle.
+The state vectors are ordered like the system states: tilt velocity, tilt angle, wheel velocity, wheel angle. The measurements are tilt velocity, tilt angle and wheel angle.
+*/
+template<typename Arithmetic>
+class ControlKernel {
+public:
+  typedef typename Arithmetic::Signal Signal;
+  typedef typename Arithmetic::Coefficient Coefficient;
+  typedef typename Arithmetic::Accumulator Accumulator;
+  typedef typename Accumulator::Residue Residue;
+
+  /*
+  Parameters in the layout the step consumes them. Matrices that are applied to the same vector are fused, so the step runs a single pass over their coefficients:
+    x(k+1) = [Phi_o | L] * [x(k); y]         observer prediction
+    u_ff = [-Km | Kc] * [x_m(k); r]          feedforward
+    x_m(k+1) = [Phi_m | gamma] * [x_m(k); u_ff]  feedforward model prediction
+  */
+  struct CompiledParameters {
+    SparseMatrix<Arithmetic, 4, 7> observer;    // Observer state matrix and gain
+    SparseMatrix<Arithmetic, 4, 3> correction;  // Observer innovation gain
+    SparseMatrix<Arithmetic, 1, 5> feedforward;  // Feedforward model state feedback and setpoint gain
+    SparseMatrix<Arithmetic, 4, 5> model;        // Feedforward model state and input matrix
+    Coefficient k_bal[3];  // Balance control gains k1, k2, k3
+    Coefficient k4;        // Position control gain
+    Coefficient h_ki;      // Sampling time in s times the integral action gain
+    Signal alpha_off;      // Tilt angle offset in rad
+    uint8_t m_stop;        // Motor deadzone thresholds in PWM steps. Applied to the motor output, not by the kernel.
+    uint8_t m_start;
+    uint8_t stages;        // ControlStage flags of the stages the parameters make use of
+
+    // Compiles the parameters of the receive interface. The sampling time is passed separately, since the control step is not necessarily scheduled with h_ms.
+    template<typename ReceiveParameters>
+    void compile(const ReceiveParameters &p, double h_s) {
+      const auto &o = p.inferred.observer;
+      const double observer_dense[4][7] = {
+        { o.phi.phi11, o.phi.phi12, o.phi.phi13, o.phi.phi14, o.gain.l11, o.gain.l12, o.gain.l13 },
+        { o.phi.phi21, o.phi.phi22, o.phi.phi23, o.phi.phi24, o.gain.l21, o.gain.l22, o.gain.l23 },
+        { o.phi.phi31, o.phi.phi32, o.phi.phi33, o.phi.phi34, o.gain.l31, o.gain.l32, o.gain.l33 },
+        { o.phi.phi41, o.phi.phi42, o.phi.phi43, o.phi.phi44, o.gain.l41, o.gain.l42, o.gain.l43 }
+      };
+      const double correction_dense[4][3] = {
+        { o.innoGain.mx11, o.innoGain.mx12, o.innoGain.mx13 },
+        { o.innoGain.mx21, o.innoGain.mx22, o.innoGain.mx23 },
+        { o.innoGain.mx31, o.innoGain.mx32, o.innoGain.mx33 },
+        { o.innoGain.mx41, o.innoGain.mx42, o.innoGain.mx43 }
+      };
+      const auto &ff = p.inferred.ff;
+      const double feedforward_dense[1][5] = {
+        { -ff.Km.k1, -ff.Km.k2, -ff.Km.k3, -ff.Km.k4, ff.Kc }
+      };
+      const double model_dense[4][5] = {
+        { ff.phi.phi11, ff.phi.phi12, ff.phi.phi13, ff.phi.phi14, ff.gamma.gam1 },
+        { ff.phi.phi21, ff.phi.phi22, ff.phi.phi23, ff.phi.phi24, ff.gamma.gam2 },
+        { ff.phi.phi31, ff.phi.phi32, ff.phi.phi33, ff.phi.phi34, ff.gamma.gam3 },
+        { ff.phi.phi41, ff.phi.phi42, ff.phi.phi43, ff.phi.phi44, ff.gamma.gam4 }
+      };
+      observer.compile(observer_dense);
+      correction.compile(correction_dense);
+      feedforward.compile(feedforward_dense);
+      model.compile(model_dense);
+
+      k_bal[0] = Arithmetic::coefficient(p.variable.BalanceControl.k1);
+      k_bal[1] = Arithmetic::coefficient(p.variable.BalanceControl.k2);
+      k_bal[2] = Arithmetic::coefficient(p.variable.BalanceControl.k3);
+      k4 = Arithmetic::coefficient(p.variable.PositionControl.k4);
+      h_ki = Arithmetic::coefficient(h_s * p.variable.PositionControl.ki);
+      alpha_off = Arithmetic::signal(p.variable.General.alpha_off);
+      m_stop = p.variable.General.m_stop;
+      m_start = p.variable.General.m_start;
+
+      stages = 0;
+      if (!observer.empty()) stages |= OBSERVER_STAGE;
+      if (ff.Kc != 0) stages |= FEEDFORWARD_STAGE;  // Without setpoint gain, the feedforward model stays in its initial state of zero
+      if (h_ki != Coefficient()) stages |= INTEGRAL_STAGE;
+      if (p.variable.General.m_stop != 0 || p.variable.General.m_start != 0) stages |= DEADZONE_STAGE;
+    }
+  };
+
+  CompiledParameters parameters = CompiledParameters();
+
+  // Persistent states
+  Signal x[4] = {};    // Observer states that are calculated recursively by the observer's state equation
+  Signal x_m[4] = {};  // Feedforward model states that are calculated recursively by the feedforward model's state equation
+  Accumulator xi;      // Integral action for position control, i.e. the integrated error already weighted with ki. It is kept in the accumulator format, since the increments are often below the signal resolution.
+  Residue x_residue[4] = {}, x_m_residue[4] = {};  // Rounding errors of the recursively calculated states
+
+  // Results of the last step
+  Signal x_corr[4] = {};   // Observer states that are corrected to contain the observer's direct term (using the most recent measurement y)
+  Signal x_m_curr[4] = {};  // Feedforward model states of this cycle, i.e. before they were predicted for the next one
+  Signal x_m2_with_offset = Signal();  // Feedforward model tilt angle including the configured tilt angle offset
+  Signal u = Signal(), u_bal = Signal(), u_pos = Signal(), u_ff = Signal();
+
+  // Resets the positional states to be able to restart the control from the initial position
+  void reset_model() {
+    xi = Accumulator();
+    for (uint8_t i = 0; i < 4; i++) {
+      x_m[i] = Signal();
+      x_m_residue[i] = Residue();
+    }
+  }
+
+  // Persistent states in the memory layout of their number format, which is the same on AVR and x86 (little endian). The kernel can be resumed from them on the host, c.f. tools/replay.
+  static const size_t STATE_SIZE = sizeof(x) + sizeof(x_m) + sizeof(xi) + sizeof(x_residue) + sizeof(x_m_residue);
+
+  void save_state(uint8_t *dest) const {
+    memcpy(dest, x, sizeof(x));
+    memcpy(dest += sizeof(x), x_m, sizeof(x_m));
+    memcpy(dest += sizeof(x_m), &xi, sizeof(xi));
+    memcpy(dest += sizeof(xi), x_residue, sizeof(x_residue));
+    memcpy(dest += sizeof(x_residue), x_m_residue, sizeof(x_m_residue));
+  }
+
+  void load_state(const uint8_t *src) {
+    memcpy(x, src, sizeof(x));
+    memcpy(x_m, src += sizeof(x), sizeof(x_m));
+    memcpy(&xi, src += sizeof(x_m), sizeof(xi));
+    memcpy(x_residue, src += sizeof(xi), sizeof(x_residue));
+    memcpy(x_m_residue, src += sizeof(x_residue), sizeof(x_m_residue));
+  }
+
+  // Executes one control cycle with the measurements y1 (tilt velocity), y2 (tilt angle), y3 (wheel angle) and the wheel angle setpoint r.
+  void step(Signal y1, Signal y2, Signal y3, Signal r, bool control_enabled) {
+    const uint8_t stages = parameters.stages & CONTROL_KERNEL_STAGES;
+    if (stages != active_stages) {
+      reset_disabled_stages(stages);
+      active_stages = stages;
+    }
+
+    // One case per combination of the kernel stages
+    switch (stages) {
+      case 0: step_stages<0>(y1, y2, y3, r, control_enabled); break;
+      case 1: step_stages<1>(y1, y2, y3, r, control_enabled); break;
+      case 2: step_stages<2>(y1, y2, y3, r, control_enabled); break;
+      case 3: step_stages<3>(y1, y2, y3, r, control_enabled); break;
+      case 4: step_stages<4>(y1, y2, y3, r, control_enabled); break;
+      case 5: step_stages<5>(y1, y2, y3, r, control_enabled); break;
+      case 6: step_stages<6>(y1, y2, y3, r, control_enabled); break;
+      case 7: step_stages<7>(y1, y2, y3, r, control_enabled); break;
+    }
+  }
+
+private:
+  uint8_t active_stages = 0;  // Stages of the previous step
+
+  // The step of a disabled stage doesn't update its states, so they are cleared once. This is what the full kernel would calculate from zero parameters.
+  void reset_disabled_stages(uint8_t stages) {
+    for (uint8_t i = 0; i < 4; i++) {
+      if (!(stages & OBSERVER_STAGE)) {
+        x[i] = Signal();
+        x_residue[i] = Residue();
+      }
+      if (!(stages & FEEDFORWARD_STAGE)) {
+        x_m[i] = Signal();
+        x_m_curr[i] = Signal();
+        x_m_residue[i] = Residue();
+      }
+    }
+    if (!(stages & INTEGRAL_STAGE)) xi = Accumulator();
+  }
+
+  template<uint8_t STAGES>
+  void step_stages(Signal y1, Signal y2, Signal y3, Signal r, bool control_enabled) {
+    const CompiledParameters &p = parameters;
+    const bool observer = STAGES & OBSERVER_STAGE;
+    const bool feedforward = STAGES & FEEDFORWARD_STAGE;
+    const bool integral = STAGES & INTEGRAL_STAGE;
+
+    // Correct state estimate. Without observer the states are zero, so only the measurements are weighted.
+    Signal y_err[3] = { y1, y2, y3 };
+    if (observer) {
+      y_err[0] = y1 - x[0];
+      y_err[1] = y2 - x[1];
+      y_err[2] = y3 - x[3];
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+      Accumulator acc;
+      p.correction.mac_row(i, y_err, acc);
+      x_corr[i] = observer ? x[i] + acc.result() : acc.result();
+    }
+
+    // Feedforward control signal. Without feedforward the model states stay zero (c.f. reset_disabled_stages()).
+    if (feedforward) {
+      x_m2_with_offset = x_m[1] + p.alpha_off;  // Account for the configured tilt angle offset
+      const Signal x_m_r[5] = { x_m[0], x_m[1], x_m[2], x_m[3], r };
+      Accumulator acc_ff;
+      p.feedforward.mac_row(0, x_m_r, acc_ff);
+      u_ff = acc_ff.result();
+    } else {
+      x_m2_with_offset = p.alpha_off;
+      u_ff = Signal();
+    }
+
+    // Feedback control signal
+    Accumulator acc_bal;
+    acc_bal.mac(p.k_bal[0], x_m[0] - x_corr[0]);
+    acc_bal.mac(p.k_bal[1], x_m2_with_offset - x_corr[1]);
+    acc_bal.mac(p.k_bal[2], x_m[2] - x_corr[2]);
+    u_bal = acc_bal.result();
+
+    Accumulator acc_pos;
+    acc_pos.mac(p.k4, x_m[3] - x_corr[3]);
+    u_pos = integral ? acc_pos.result() - xi.result() : acc_pos.result();
+
+    u = control_enabled ? u_bal + u_pos + u_ff : Signal();
+
+    // Calculate (predict) next cycle values (k+1)
+    if (observer) {
+      const Signal x_y[7] = { x[0], x[1], x[2], x[3], y1, y2, y3 };
+      for (uint8_t i = 0; i < 4; i++) {
+        Accumulator acc;
+        acc.feed(x_residue[i]);
+        p.observer.mac_row(i, x_y, acc);
+        x[i] = acc.result(x_residue[i]);
+      }
+    }
+    if (feedforward) {
+      const Signal x_m_u[5] = { x_m[0], x_m[1], x_m[2], x_m[3], u_ff };
+      for (uint8_t i = 0; i < 4; i++) {
+        x_m_curr[i] = x_m[i];
+
+        Accumulator acc_m;
+        acc_m.feed(x_m_residue[i]);
+        p.model.mac_row(i, x_m_u, acc_m);
+        x_m[i] = acc_m.result(x_m_residue[i]);
+      }
+    }
+
+    // If feedforward is defined use x_m4 as the setpoint of the integral action instead of r
+    if (integral) xi.mac(p.h_ki, (feedforward ? x_m[3] : r) - x_corr[3]);
+  }
+};
+
+#ifdef ENABLE_FIXED_POINT_CONTROL
+typedef FixedPointArithmetic<CONTROL_COEFF_FRAC_BITS, CONTROL_SIGNAL_FRAC_BITS> ControlArithmetic;
+#else
+typedef FloatingPointArithmetic<double> ControlArithmetic;
+#endif
+
+#endif
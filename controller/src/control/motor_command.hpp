@@ -0,0 +1,55 @@
+#ifndef MOTOR_COMMAND_HPP
+#define MOTOR_COMMAND_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+// Voltage the control signal is limited to, which is the supply voltage of the motor driver
+#define MOTOR_SATURATION_V 9
+
+/*
+Converts the voltage of the control signal to a PWM value for the motor driver. The sign of the PWM value is the rotation direction.
+Voltages beyond +/- saturation are limited. The voltage is scaled to a PWM value by a single multiplication and the deadzone compensation is looked up in a table
+of the compensated value of every PWM value, so a conversion takes no division. The table is only rebuilt when the thresholds change, c.f. set_deadzone().
+With DEADZONE_COMPENSATION, PWM values below stop_threshold are set to zero and the others are mapped to the range from start_threshold on, where the motor starts to turn.
+Otherwise, the table is bypassed (which is equivalent to thresholds of zero), so the compensation is compiled away for parameter sets that don't use it.
+This header does not depend on the Arduino core, so it can be compiled on the host as well.
+*/
+class MotorCommand {
+  double pwm_per_volt;
+  uint8_t stop_threshold = 0;
+  uint8_t start_threshold = 0;
+  uint8_t compensated[UINT8_MAX + 1];
+
+  void build_table() {
+    for (uint16_t pwm = 0; pwm <= UINT8_MAX; pwm++) {
+      compensated[pwm] = pwm < stop_threshold ? 0 : start_threshold + pwm * (UINT8_MAX - start_threshold) / UINT8_MAX;
+    }
+  }
+
+public:
+  explicit MotorCommand(double saturation)
+    : pwm_per_volt(UINT8_MAX / saturation) {
+    build_table();
+  }
+
+  // Rebuilds the table if the thresholds differ from those it was built for. That takes longer than a conversion, but only happens after a parameter change.
+  void set_deadzone(uint8_t stop, uint8_t start) {
+    if (stop == stop_threshold && start == start_threshold) return;
+    stop_threshold = stop;
+    start_threshold = start;
+    build_table();
+  }
+
+  template<bool DEADZONE_COMPENSATION>
+  int16_t convert(double volt) const {
+    const double pwm = fabs(volt) * pwm_per_volt;
+    const uint8_t linear = pwm < UINT8_MAX ? (uint8_t)pwm : UINT8_MAX;
+    const uint8_t motor_val = DEADZONE_COMPENSATION ? compensated[linear] : linear;
+
+    // Positive means to rotate in positive direction
+    return volt < 0 ? -motor_val : motor_val;
+  }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef PERIOD_HPP
+#define PERIOD_HPP
+
+#include <stdint.h>
+
+// Period that is used as long as no sampling time has been received (h_ms = 0)
+#define CONTROL_DEFAULT_PERIOD_MS 6
+// Longest period that fits into the 16 bit compare register of the control scheduler at 4 µs per tick
+#define CONTROL_MAX_PERIOD_MS 262
+
+/*
+Returns the period in ms the control step is scheduled with for the sampling time h_ms of the parameters, which is the sampling time the kernel is compiled for.
+A period of 0 selects CONTROL_DEFAULT_PERIOD_MS and periods above CONTROL_MAX_PERIOD_MS are limited, c.f. ControlScheduler::set_period_ms().
+This header does not depend on the Arduino core, so it can be compiled on the host as well.
+*/
+inline uint16_t control_period_ms(uint16_t h_ms) {
+  if (h_ms == 0) return CONTROL_DEFAULT_PERIOD_MS;
+  return h_ms < CONTROL_MAX_PERIOD_MS ? h_ms : CONTROL_MAX_PERIOD_MS;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef STEP_HPP
+#define STEP_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include "hal.hpp"
+#include "kernel.hpp"
+#include "motor_command.hpp"
+
+const double WHEEL_RAD_TO_MM = 130.0 / (2 * M_PI);
+const double WHEEL_MM_TO_RAD = 1 / WHEEL_RAD_TO_MM;
+
+/*
+Hardware independent part of the control step. Converts the measurements and the setpoint of the HAL (c.f. hal.hpp) to the number format of the arithmetic,
+executes the kernel and converts the control signal to the motor PWM value, which is applied by the HAL.
+This header does not depend on the Arduino core, so it can be compiled on the host as well.
+*/
+template<typename Arithmetic>
+class ControlStep {
+public:
+  typedef ControlKernel<Arithmetic> Kernel;
+
+  Kernel kernel;
+
+  // Results of the last step
+  double u = 0;           // Control signal in V
+  int16_t motor_val = 0;  // Motor PWM value
+
+  MotorCommand motor_command{ MOTOR_SATURATION_V };
+
+  template<typename Hal>
+  void run(Hal &hal) {
+    const ControlMeasurements y = hal.measure();
+    const ControlSetpoint setpoint = hal.setpoint();
+    const typename Arithmetic::Signal r = Arithmetic::signal(-setpoint.pos_setpoint_mm * WHEEL_MM_TO_RAD);  // Wheel angle setpoint in rad
+    kernel.step(Arithmetic::signal(y.tilt_vel_rad_s), Arithmetic::signal(y.tilt_angle_rad), Arithmetic::signal(y.wheel_angle_rad), r, setpoint.control_enabled);
+
+    u = Arithmetic::to_double(kernel.u);
+    const typename Kernel::CompiledParameters &p = kernel.parameters;
+    if (p.stages & DEADZONE_STAGE) {
+      motor_command.set_deadzone(p.m_stop, p.m_start);  // The table is rebuilt here rather than on compiling the parameters, so the step never reads a partially built one
+      motor_val = motor_command.convert<true>(u);
+    } else {
+      motor_val = motor_command.convert<false>(u);
+    }
+    hal.actuate(motor_val);
+  }
+};
+
+#endif
@@ -1,31 +1,29 @@
 #include <stdint.h>
 #include <Arduino.h>
+#include <util/atomic.h>
 #include "encoder.hpp"
 
 volatile int32_t enc_counter = 0;
+volatile uint32_t enc_edge_us = 0;
+
+const double ENC_RAD_PER_COUNT = 0.5 * DEG_TO_RAD;
+
+// Counter change for a transition from the previous to the current state of the pins, indexed by (prev << 2) | curr with channel B in bit 0 and channel A in bit 1.
+// Transitions without or with both channels changed are not counted, since they are no valid quadrature edge.
+// Equivalent to the algorithm by Rene Sommer (XOR of the previous state with swapped channels and the current state) for the valid transitions.
+static const int8_t ENC_TRANSITIONS[16] = { 0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0 };
 
 void encoder_isr() {
-  uint8_t curr_ab = 0;
-  if (digitalRead(ENC_PIN_CHA)) curr_ab |= (1 << 0);  // Writing channel A bit
-  if (digitalRead(ENC_PIN_CHB)) curr_ab |= (1 << 1);  // Writing channel B bit
-  static uint8_t prev_ab = curr_ab;  // At initialization prev_ab is equal to curr_ab
-
-  // Rene Sommer algorithm
-  // Swap bits A and B according to https://www.codevscolor.com/c-program-swap-two-bits-of-number
-  unsigned char a = (prev_ab >> 1) & 1;  // Bit A
-  unsigned char b = (prev_ab >> 0) & 1;  // Bit B
-  unsigned char xorbit = (a ^ b);
-  xorbit = (xorbit << 0) | (xorbit << 1);
-  unsigned char prev_ba = prev_ab ^ xorbit;
-
-  // XOR with next value yields direction
-  if ((prev_ba ^ curr_ab) == 1) enc_counter++; else enc_counter--;
-
-  prev_ab = curr_ab;
+  const uint8_t curr = (ENC_PIN_REG >> ENC_PIN_REG_SHIFT) & 0b11;  // Both channels at once instead of two digitalRead() calls
+  static uint8_t prev = curr;                                       // At initialization prev is equal to curr
+
+  enc_counter += ENC_TRANSITIONS[(prev << 2) | curr];
+  enc_edge_us = micros();
+  prev = curr;
 }
 
-Encoder::Encoder(uint8_t cha_pin, uint8_t chb_pin, void (*isr)(), volatile int32_t& counter, uint32_t freq_hz)
-  : Sensor(freq_hz), cha_pin(cha_pin), chb_pin(chb_pin), isr(isr), counter(counter) {}
+Encoder::Encoder(uint8_t cha_pin, uint8_t chb_pin, void (*isr)(), volatile int32_t& counter, volatile uint32_t& edge_us)
+  : cha_pin(cha_pin), chb_pin(chb_pin), isr(isr), counter(counter), edge_us(edge_us) {}
 
 void Encoder::setup() {
   pinMode(cha_pin, INPUT);
@@ -37,9 +35,26 @@ void Encoder::setup() {
 
 // Reset encoder values
 void Encoder::reset() {
-  this->counter = 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    this->counter = 0;
+  }
+  latched_counter = 0;
+  prev_latched_counter = 0;
+}
+
+double Encoder::read() {
+  prev_latched_counter = latched_counter;
+  prev_latched_edge_us = latched_edge_us;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {  // The counter and the time of its last change must be from the same edge
+    latched_counter = this->counter;
+    latched_edge_us = this->edge_us;
+  }
+  return latched_counter * ENC_RAD_PER_COUNT;
 }
 
-double Encoder::get_value() {
-  return this->counter * 0.5 * DEG_TO_RAD;
+// Hides the finite difference of the base class, which is used as fallback if there was no edge since the previous latch.
+double Encoder::derivative() const {
+  const uint32_t edge_period_us = latched_edge_us - prev_latched_edge_us;
+  if (latched_counter == prev_latched_counter || edge_period_us == 0) return Sensor::derivative();
+  return (latched_counter - prev_latched_counter) * ENC_RAD_PER_COUNT / edge_period_us * 1e6;
 }
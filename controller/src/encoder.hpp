@@ -7,26 +7,39 @@
 // This setting defines what is forwards and what backwards
 #define ENC_PIN_CHA PD3
 #define ENC_PIN_CHB PD2
+// Input register and bit of the lower encoder pin, which encoder_isr() reads both pins from at once. On the Arduino Mega 2560 digital pin 2 is PE4 and pin 3 is PE5.
+#define ENC_PIN_REG PINE
+#define ENC_PIN_REG_SHIFT 4
 
 extern volatile int32_t enc_counter;
+extern volatile uint32_t enc_edge_us;
 
 uint8_t read_ab();
 
 void encoder_isr();
 
-class Encoder : public Sensor {
+/*
+The angle is the counter latched once per cycle. derivative() estimates the velocity from the counts between the last edges before the previous and the current latch
+divided by the time between these edges, which is accurate at low speeds as well. If no edge occurred since the previous latch, the finite difference over the cycle is used instead.
+*/
+class Encoder : public Sensor<Encoder> {
 private:
   uint8_t cha_pin, chb_pin;
   void (*isr)();
   volatile int32_t& counter;
-
-  virtual double get_value() override;
+  volatile uint32_t& edge_us;
+  int32_t latched_counter = 0;
+  uint32_t latched_edge_us = 0;
+  int32_t prev_latched_counter = 0;
+  uint32_t prev_latched_edge_us = 0;
 
 public:
-  Encoder(uint8_t cha_pin, uint8_t chb_pin, void (*isr)(), volatile int32_t& counter, uint32_t freq_hz = 0);
+  Encoder(uint8_t cha_pin, uint8_t chb_pin, void (*isr)(), volatile int32_t& counter, volatile uint32_t& edge_us);
 
   void setup();
-  virtual void reset();
+  void reset();
+  double read();
+  double derivative() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include <util/atomic.h>
+#include "motor.hpp"
+
+#if MOTOR_PWM_PRESCALER == 1
+#define MOTOR_PWM_CLOCK_SELECT (1 << CS30)
+#elif MOTOR_PWM_PRESCALER == 8
+#define MOTOR_PWM_CLOCK_SELECT (1 << CS31)
+#elif MOTOR_PWM_PRESCALER == 64
+#define MOTOR_PWM_CLOCK_SELECT ((1 << CS31) | (1 << CS30))
+#else
+#error "MOTOR_PWM_PRESCALER must be 1, 8 or 64"
+#endif
+
+// Stops the motor and sets up timer/counter3 for the positive direction. Timer/counter0 is already running in fast PWM mode for millis(), which the negative direction shares.
+void setup_motor() {
+  PORTG &= ~(1 << PG5);
+  PORTE &= ~(1 << PE3);
+  DDRG |= (1 << DDG5);
+  DDRE |= (1 << DDE3);
+
+  TCCR3A = (1 << WGM30);                           // Fast PWM mode with 8 bit resolution, the output is connected by write_motor()
+  TCCR3B = (1 << WGM32) | MOTOR_PWM_CLOCK_SELECT;  // Timer/counter3 is only used for the motor on the MinSeg board
+  OCR3A = 0;
+}
+
+void write_motor(int16_t motor_val) {
+  // Positive means to rotate in positive direction
+  if (motor_val < 0) {
+    TCCR3A &= ~(1 << COM3A1);
+    OCR0B = min(-motor_val, UINT8_MAX);
+    TCCR0A |= (1 << COM0B1);  // Non-inverting output
+  } else {
+    TCCR0A &= ~(1 << COM0B1);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      OCR3A = min(motor_val, UINT8_MAX);  // OCR3A is a 16 bit register. Accessing it requires to temporarily disable interrupts, since the control step can be interrupted.
+    }
+    if (motor_val > 0) TCCR3A |= (1 << COM3A1);
+    else TCCR3A &= ~(1 << COM3A1);
+  }
+}
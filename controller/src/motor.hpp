@@ -0,0 +1,25 @@
+#ifndef MOTOR_HPP
+#define MOTOR_HPP
+
+#include <Arduino.h>
+
+// Motor driver pins. On the Arduino Mega 2560 digital pin 4 (PD4) is PG5, the output compare pin OC0B of timer/counter0, and pin 5 (PD5) is PE3, the output compare pin OC3A of timer/counter3.
+#define MOTOR_PIN_NEG PD4
+#define MOTOR_PIN_POS PD5
+
+/*
+Prescaler of timer/counter3, which sets the PWM frequency of the positive direction in fast PWM mode to 16 MHz / 256 / MOTOR_PWM_PRESCALER: 1 -> 62.5 kHz, 8 -> 7.8 kHz, 64 -> 977 Hz.
+The negative direction runs on timer/counter0, whose prescaler must stay 64 for millis() and micros(), so it is fixed at 977 Hz. The default matches both directions (the Arduino core runs pin 5 at 490 Hz),
+since the motor deadzone m_stop and m_start depends on the PWM frequency. Only raise it together with thresholds measured for each direction.
+*/
+#define MOTOR_PWM_PRESCALER 64
+
+/*
+Writes the PWM value motor_val to the motor driver pins by their output compare registers, which is a few cycles instead of the pin lookup of analogWrite(). Its sign is the rotation direction.
+The output of the idle pin is disconnected, so the port drives it low, since a compare value of 0 still yields a spike of one timer tick in fast PWM mode.
+Voltages are converted to PWM values by MotorCommand in control/motor_command.hpp, which doesn't depend on the hardware.
+*/
+void setup_motor();
+void write_motor(int16_t motor_val);
+
+#endif
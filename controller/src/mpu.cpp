@@ -1,30 +1,48 @@
 #include "Arduino.h"
+#include <util/atomic.h>
 #include "mpu.hpp"
 
-float get_tilt_angle_from_euler(MPU9250 *mpu) {
+const uint8_t MPU_I2C_ADDRESS = 0x68;
+
+// Registers of the MPU9250 (c.f. MPU-9250 Register Map and Descriptions Revision 1.6) that are accessed directly instead of through the library
+const uint8_t MPU_REG_SMPLRT_DIV = 0x19;
+const uint8_t MPU_REG_FIFO_EN = 0x23;
+const uint8_t MPU_REG_ACCEL_XOUT_H = 0x3B;  // Followed by the temperature and gyro registers
+const uint8_t MPU_REG_USER_CTRL = 0x6A;
+const uint8_t MPU_REG_FIFO_COUNTH = 0x72;
+const uint8_t MPU_REG_FIFO_R_W = 0x74;
+const uint8_t MPU_FIFO_EN_ACCEL_GYRO = 0x78;  // Gyro x, y, z and accelerometer
+const uint8_t MPU_USER_CTRL_FIFO_EN = 0x40;
+const uint8_t MPU_USER_CTRL_FIFO_RST = 0x04;
+
+const uint8_t MPU_DATA_REGISTERS_SIZE = 14;  // Accelerometer x, y, z, temperature and gyro x, y, z, each 16 bit big endian
+
+// Resolutions of the full scale ranges selected in setup()
+const float MPU_ACC_G_PER_LSB = 2.0 / 32768;      // ACCEL_FS_SEL::A2G
+const float MPU_GYRO_DPS_PER_LSB = 250.0 / 32768;  // GYRO_FS_SEL::G250DPS
+
+float get_tilt_angle_from_euler(MinSegMPU *mpu) {
   return mpu->getEulerX() * DEG_TO_RAD + HALF_PI;
 }
 
-float get_tilt_angle_from_acc(MPU9250 *mpu) {
-  return atan2(mpu->getAccZ(), -mpu->getAccY());
+float get_tilt_angle_from_acc(MinSegMPU *mpu) {
+  return atan2(mpu->acc_g[2], -mpu->acc_g[1]);
 }
 
-float get_tilt_vel(MPU9250 *mpu) {
-  return mpu->getGyroX() * DEG_TO_RAD;
+float get_tilt_angle_fused(MinSegMPU *mpu) {
+  return mpu->fused_tilt_angle_rad;
 }
 
-MPUMeasurement::MPUMeasurement(MPU9250 *mpu, float (*getter)(MPU9250 *), uint32_t freq_hz)
-  : Sensor(freq_hz), mpu(mpu), getter(getter) {}
-
-double MPUMeasurement::get_value() {
-  return getter(mpu);
+float get_tilt_vel(MinSegMPU *mpu) {
+  return mpu->gyro_dps[0] * DEG_TO_RAD;
 }
 
 MinSegMPU::MinSegMPU()
   : MPU9250(),
-    tilt_angle_from_euler_rad{ this, &get_tilt_angle_from_euler },
-    tilt_angle_from_acc_rad{ this, &get_tilt_angle_from_acc },
-    tilt_vel_rad_s{ this, &get_tilt_vel } {}
+    tilt_angle_from_euler_rad{ this },
+    tilt_angle_from_acc_rad{ this },
+    tilt_angle_fused_rad{ this },
+    tilt_vel_rad_s{ this } {}
 
 void MinSegMPU::setup() {
   Wire.begin();
@@ -35,8 +53,10 @@ void MinSegMPU::setup() {
   mpu_setting.gyro_fs_sel = GYRO_FS_SEL::G250DPS;          // Gyro range in +/- dps (degrees per second)
   mpu_setting.accel_dlpf_cfg = ACCEL_DLPF_CFG::DLPF_45HZ;  // Accelerometer digital low pass filter bandwith
   mpu_setting.gyro_dlpf_cfg = GYRO_DLPF_CFG::DLPF_41HZ;    // Gyro digital low pass filter bandwith
-  mpu_setting.fifo_sample_rate = FIFO_SAMPLE_RATE::SMPL_200HZ;  // The sample rate determines how fast the fifo buffer is written. If much faster than read, it will overflow!
-  MPU9250::setup(0x68, mpu_setting);
+  mpu_setting.fifo_sample_rate = FIFO_SAMPLE_RATE::SMPL_200HZ;  // MPU_DEFAULT_SAMPLE_RATE_HZ until set_fusion() selects another rate. update() averages up to MPU_FIFO_MAX_SAMPLES, so it should be called at least every 40 ms.
+  MPU9250::setup(MPU_I2C_ADDRESS, mpu_setting);
+  enable_fifo();
+  twi_transfer.setup();
 
   // Filter for removing yaw angle drift using 9-DOF sensor fusion
   selectFilter(QuatFilterSel::NONE);  // Don't rely on the sensor fusion methods supported by the library. A Kalman filter is used in the control cycle instead.
@@ -46,12 +66,168 @@ void MinSegMPU::setup() {
   setMagneticDeclination(5.016667);
 }
 
-// Change and reduce update function to make it quicker (Original function is hidden). 
-// Basically, everything that is unnecessary for the implementation using just the raw acceleration and gyro data is removed.
-// If one would like to use the sensor fusion filter methods supported by the library and have direct access to absolute angles, 
+// Resets the FIFO and lets the sensor write accelerometer and gyro samples to it. Must be called again after calibrateAccelGyro(), which reconfigures the FIFO.
+// The biases are applied by the offset registers of the sensor, so the samples in the FIFO contain them as well. An acquisition completed before is discarded.
+// Uses the Wire library, so no acquisition must be running (c.f. wait_for_acquisition()).
+void MinSegMPU::enable_fifo() {
+  acquisitions[acquiring_index].samples = 0;
+  write_register(MPU_REG_USER_CTRL, MPU_USER_CTRL_FIFO_RST);
+  write_register(MPU_REG_FIFO_EN, MPU_FIFO_EN_ACCEL_GYRO);
+  write_register(MPU_REG_USER_CTRL, MPU_USER_CTRL_FIFO_EN);
+}
+
+/*
+Sets the rate at which the sensor writes samples to the FIFO and the time constant of the complementary filter (c.f. the class comment). Both take effect with the next acquisition.
+The sensor supports 1 kHz / n for n = 1 ... 256, so the rate is rounded to the nearest one of those. 0 selects MPU_DEFAULT_SAMPLE_RATE_HZ.
+The rate must be low enough, that at most MPU_FIFO_MAX_SAMPLES are written between two calls of update(). Otherwise the FIFO is reset every time.
+*/
+void MinSegMPU::set_fusion(uint16_t sample_rate_hz, float tau_s) {
+  if (sample_rate_hz == 0) sample_rate_hz = MPU_DEFAULT_SAMPLE_RATE_HZ;
+  const uint16_t period_ms = constrain((1000 + sample_rate_hz / 2) / sample_rate_hz, 1, 256);
+  const float dt_s = period_ms * 1e-3;
+  const float alpha = tau_s > 0 ? tau_s / (tau_s + dt_s) : 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {  // update() is called from the control step
+    if (period_ms - 1 != rate_divider) {
+      rate_divider = period_ms - 1;
+      rate_divider_pending = true;
+    }
+    fusion_alpha = alpha;
+    fusion_rad_per_lsb = MPU_GYRO_DPS_PER_LSB * DEG_TO_RAD * dt_s;
+  }
+}
+
+// Replaces the update function of the library (Original function is hidden).
+// Instead of the most recent sample of the data registers, the samples of the last acquisition from the FIFO are averaged into acc_g and gyro_dps.
+// If one would like to use the sensor fusion filter methods supported by the library and have direct access to absolute angles,
 // this should be commented, since the necessary data is not written with this reduced implementation.
+// If more samples were pending than are averaged at most, e.g. for long control periods, the FIFO was reset and only the most recent sample of the data registers was read.
+// Returns false and keeps the previous values if no new sample is available. If the previous acquisition is still running, no next one is started either.
 bool MinSegMPU::update() {
-  if (!available()) return false;
-  update_accel_gyro();
+  fifo_samples = 0;
+  bool running;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {  // Also keeps the compiler from reading the buffer before the flag
+    running = acquiring;
+  }
+  if (running) return false;
+
+  const Acquisition &acquisition = acquisitions[acquiring_index];
+  acquiring_index ^= 1;
+  start_acquisition();  // Into the other buffer while this one is evaluated
+
+  if (acquisition.samples == 0) return false;
+  const uint8_t *data = acquisition.data;
+  if (acquisition.from_registers) {
+    if (fifo_overflows < UINT16_MAX) fifo_overflows++;
+    for (uint8_t i = 0; i < 3; i++) {
+      acc_g[i] = (int16_t)((data[2 * i] << 8) | data[2 * i + 1]) * MPU_ACC_G_PER_LSB;
+      gyro_dps[i] = (int16_t)((data[8 + 2 * i] << 8) | data[8 + 2 * i + 1]) * MPU_GYRO_DPS_PER_LSB;
+    }
+    fused_tilt_angle_rad = get_tilt_angle_from_acc(this);  // The time since the previous sample is unknown, so the filter restarts from the accelerometer angle
+    fifo_samples = 1;
+    return true;
+  }
+
+  const uint8_t samples = acquisition.samples;
+  int32_t sums[6] = { 0, 0, 0, 0, 0, 0 };
+  for (uint8_t i = 0; i < samples * MPU_FIFO_SAMPLE_SIZE; i += 2) sums[(i / 2) % 6] += (int16_t)((data[i] << 8) | data[i + 1]);
+
+  for (uint8_t i = 0; i < 3; i++) {
+    acc_g[i] = sums[i] * MPU_ACC_G_PER_LSB / samples;
+    gyro_dps[i] = sums[i + 3] * MPU_GYRO_DPS_PER_LSB / samples;
+  }
+  fuse_samples(data, samples);
+  fifo_samples = samples;
   return true;
 }
+
+// Runs the complementary filter for each FIFO sample. It starts from the accelerometer angle, which is also used if the filter is disabled by a time constant of 0.
+void MinSegMPU::fuse_samples(const uint8_t *data, uint8_t samples) {
+  if (fusion_alpha == 0 || !fusion_initialized) {
+    fused_tilt_angle_rad = get_tilt_angle_from_acc(this);
+    fusion_initialized = true;
+    return;
+  }
+  for (uint8_t i = 0; i < samples * MPU_FIFO_SAMPLE_SIZE; i += MPU_FIFO_SAMPLE_SIZE) {
+    const int16_t acc_y = (int16_t)((data[i + 2] << 8) | data[i + 3]);
+    const int16_t acc_z = (int16_t)((data[i + 4] << 8) | data[i + 5]);
+    const int16_t gyro_x = (int16_t)((data[i + 6] << 8) | data[i + 7]);
+    const float acc_angle_rad = atan2((float)acc_z, -(float)acc_y);  // Like get_tilt_angle_from_acc(), the resolution cancels out
+    fused_tilt_angle_rad = fusion_alpha * (fused_tilt_angle_rad + gyro_x * fusion_rad_per_lsb) + (1 - fusion_alpha) * acc_angle_rad;
+  }
+}
+
+// Blocks until a running acquisition has finished. Must be called before the Wire library is used, e.g. for the calibration, after the control step was stopped.
+void MinSegMPU::wait_for_acquisition() {
+  while (acquiring) {}
+}
+
+// Starts reading the FIFO count. The remaining transfers of the acquisition are started from the callback of the previous one.
+void MinSegMPU::start_acquisition() {
+  Acquisition &acquisition = acquisitions[acquiring_index];
+  acquisition.samples = 0;
+  acquisition.from_registers = false;
+  acquiring = true;
+  bool started;
+  if (rate_divider_pending) {
+    rate_divider_pending = false;
+    acquisition_step = WRITE_RATE_DIVIDER;
+    started = twi_transfer.start_write(MPU_I2C_ADDRESS, MPU_REG_SMPLRT_DIV, rate_divider, &on_transfer_finished, this);
+  } else {
+    acquisition_step = READ_COUNT;
+    started = twi_transfer.start_read(MPU_I2C_ADDRESS, MPU_REG_FIFO_COUNTH, acquisition.data, 2, &on_transfer_finished, this);
+  }
+  if (!started) continue_acquisition(false);
+}
+
+// Called from the interrupt of the transfer whenever a transfer of the acquisition has finished. Called with success = false if the first transfer couldn't be started.
+void MinSegMPU::continue_acquisition(bool success) {
+  Acquisition &acquisition = acquisitions[acquiring_index];
+  bool started = false;
+  if (success) {
+    switch (acquisition_step) {
+      case WRITE_RATE_DIVIDER:
+        acquisition_step = READ_COUNT;
+        started = twi_transfer.start_read(MPU_I2C_ADDRESS, MPU_REG_FIFO_COUNTH, acquisition.data, 2, &on_transfer_finished, this);
+        break;
+      case READ_COUNT:
+        {
+          const uint16_t count = ((uint16_t)(acquisition.data[0] & 0x1F) << 8) | acquisition.data[1];
+          // The FIFO overwrites the oldest bytes if it is full (512 bytes are no multiple of the sample size), after which the samples are not aligned anymore
+          if (count % MPU_FIFO_SAMPLE_SIZE != 0 || count / MPU_FIFO_SAMPLE_SIZE > MPU_FIFO_MAX_SAMPLES) {
+            acquisition_step = RESET_FIFO;
+            started = twi_transfer.start_write(MPU_I2C_ADDRESS, MPU_REG_USER_CTRL, MPU_USER_CTRL_FIFO_EN | MPU_USER_CTRL_FIFO_RST, &on_transfer_finished, this);
+          } else if (count > 0) {
+            acquisition_step = READ_FIFO;
+            fifo_read_samples = count / MPU_FIFO_SAMPLE_SIZE;
+            started = twi_transfer.start_read(MPU_I2C_ADDRESS, MPU_REG_FIFO_R_W, acquisition.data, count, &on_transfer_finished, this);
+          }
+        }
+        break;
+      case RESET_FIFO:
+        acquisition_step = READ_REGISTERS;
+        started = twi_transfer.start_read(MPU_I2C_ADDRESS, MPU_REG_ACCEL_XOUT_H, acquisition.data, MPU_DATA_REGISTERS_SIZE, &on_transfer_finished, this);
+        break;
+      case READ_REGISTERS:
+        acquisition.from_registers = true;
+        acquisition.samples = 1;
+        break;
+      case READ_FIFO:
+        acquisition.samples = fifo_read_samples;
+        break;
+    }
+  } else if (acquisition_step == WRITE_RATE_DIVIDER) {
+    rate_divider_pending = true;  // Retried by the next acquisition
+  }
+  if (!started) acquiring = false;
+}
+
+void MinSegMPU::on_transfer_finished(void *context, bool success) {
+  static_cast<MinSegMPU *>(context)->continue_acquisition(success);
+}
+
+void MinSegMPU::write_register(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(MPU_I2C_ADDRESS);
+  Wire.write(reg);
+  Wire.write(value);
+  Wire.endTransmission();
+}
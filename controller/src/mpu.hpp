@@ -3,28 +3,100 @@
 #define MPU_HPP
 
 #include "sensor.hpp"
+#include "twi.hpp"
 #include <MPU9250.h>
 
-class MPUMeasurement : public Sensor {
-  MPU9250 *mpu;
-  float (*getter)(MPU9250 *);
+const uint8_t MPU_FIFO_SAMPLE_SIZE = 12;  // Accelerometer x, y, z followed by gyro x, y, z, each 16 bit big endian
+const uint8_t MPU_FIFO_MAX_SAMPLES = 8;   // Samples averaged at most, which is 40 ms at 200 Hz. If more are pending, the FIFO is reset instead of reading outdated samples.
+const uint16_t MPU_DEFAULT_SAMPLE_RATE_HZ = 200;
+
+class MinSegMPU;
+
+float get_tilt_angle_from_euler(MinSegMPU *mpu);
+float get_tilt_angle_from_acc(MinSegMPU *mpu);
+float get_tilt_angle_fused(MinSegMPU *mpu);
+float get_tilt_vel(MinSegMPU *mpu);
+
+// A value computed from the samples evaluated by the last MinSegMPU::update(). The getter is resolved at compile time.
+template <float (*getter)(MinSegMPU *)>
+class MPUMeasurement : public Sensor<MPUMeasurement<getter>> {
+  MinSegMPU *mpu;
 
 public:
-  MPUMeasurement(MPU9250 *mpu, float (*getter)(MPU9250 *), uint32_t freq_hz = 0);
+  MPUMeasurement(MinSegMPU *mpu)
+    : mpu(mpu) {}
 
-  double get_value() override;
+  double read() {
+    return getter(mpu);
+  }
 };
 
+/*
+The accelerometer and gyro samples are written to the FIFO of the MPU9250 at the fifo_sample_rate of the setup. The FIFO is drained and all samples written since the previous
+acquisition are averaged, so the measurements are low pass filtered and no sample is missed regardless of how often update() is called.
+The FIFO is read by non-blocking transfers into one of two buffers, while update() evaluates the other one. Each update() evaluates the acquisition completed since the previous call
+and starts the next one, so the I2C transfers overlap with the rest of the control step and loop(). The samples are therefore one call older than with a blocking read.
+
+The tilt angle is fused from every sample by a complementary filter, which integrates the gyro rate and corrects the drift by the angle from the accelerometer with the time constant tau_s:
+angle = alpha * (angle + rate * dt) + (1 - alpha) * acc_angle, alpha = tau_s / (tau_s + dt), dt = 1 / sample rate
+So the noise of the accelerometer angle is filtered at the sample rate of the sensor instead of the control rate. If tau_s is 0, the fused angle is the angle of the averaged accelerometer samples.
+*/
 class MinSegMPU : public MPU9250 {
 public:
-  MPUMeasurement tilt_angle_from_euler_rad;
-  MPUMeasurement tilt_angle_from_acc_rad;
-  MPUMeasurement tilt_vel_rad_s;
+  MPUMeasurement<&get_tilt_angle_from_euler> tilt_angle_from_euler_rad;
+  MPUMeasurement<&get_tilt_angle_from_acc> tilt_angle_from_acc_rad;
+  MPUMeasurement<&get_tilt_angle_fused> tilt_angle_fused_rad;
+  MPUMeasurement<&get_tilt_vel> tilt_vel_rad_s;
+
+  float acc_g[3] = { 0, 0, 0 };     // Average of the samples evaluated by the last successful update()
+  float gyro_dps[3] = { 0, 0, 0 };  // Average of the samples evaluated by the last successful update()
+  uint8_t fifo_samples = 0;         // Number of samples averaged by the last update()
+  uint16_t fifo_overflows = 0;      // Number of times the FIFO was reset, because it overflowed or more samples were pending than are averaged at most. Saturates.
+  float fused_tilt_angle_rad = 0;   // Complementary filter state after the samples evaluated by the last successful update()
 
   MinSegMPU();
 
   void setup();
+  void enable_fifo();
+  void set_fusion(uint16_t sample_rate_hz, float tau_s);
   bool update();
+  void wait_for_acquisition();
+
+private:
+  enum AcquisitionStep : uint8_t {
+    WRITE_RATE_DIVIDER,
+    READ_COUNT,
+    RESET_FIFO,
+    READ_REGISTERS,
+    READ_FIFO,
+  };
+
+  struct Acquisition {
+    uint8_t data[MPU_FIFO_MAX_SAMPLES * MPU_FIFO_SAMPLE_SIZE];
+    uint8_t samples = 0;            // Number of samples in data, 0 if none was available or the acquisition failed
+    bool from_registers = false;    // The FIFO was reset and data holds the data registers (including temperature) instead of FIFO samples
+  };
+
+  Acquisition acquisitions[2];
+  uint8_t acquiring_index = 0;     // Buffer that the running or last acquisition writes to
+  volatile bool acquiring = false;
+  AcquisitionStep acquisition_step;
+  uint8_t fifo_read_samples;       // Samples requested by the running FIFO read
+  uint8_t rate_divider = 1000 / MPU_DEFAULT_SAMPLE_RATE_HZ - 1;  // Sample rate = 1 kHz / (1 + rate_divider). setup() selects the default rate.
+  volatile bool rate_divider_pending = false;                     // rate_divider is written to the sensor before the next acquisition
+
+  // Complementary filter, c.f. set_fusion()
+  float fusion_alpha = 0;
+  float fusion_rad_per_lsb = 0;  // Gyro resolution in rad times the sample period
+  bool fusion_initialized = false;
+
+  void fuse_samples(const uint8_t *data, uint8_t samples);
+
+  void start_acquisition();
+  void continue_acquisition(bool success);
+  static void on_transfer_finished(void *context, bool success);
+
+  void write_register(uint8_t reg, uint8_t value);
 };
 
 #endif
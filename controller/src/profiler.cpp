@@ -0,0 +1,40 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "profiler.hpp"
+
+#ifdef ENABLE_PROFILING
+Profiler profiler;  // Define profiler instance globally here
+
+Profiler::Probe::Probe(ProfileSection section)
+  : section(section), start_us(micros()) {}
+
+Profiler::Probe::~Probe() {
+  profiler.record(section, micros() - start_us);
+}
+
+void Profiler::record(ProfileSection section, uint32_t duration_us) {
+  SectionStats &stats = sections[section];
+  stats.min_us = min(stats.min_us, duration_us);
+  stats.max_us = max(stats.max_us, duration_us);
+  stats.sum_us += duration_us;
+  if (stats.count < UINT16_MAX) stats.count++;
+}
+
+// Packs the statistics collected since the last call in the order of ProfileSection and resets them. Returns the packed size, which is BIN_SIZE_PROFILE.
+// Sections without any record are packed with all values 0.
+size_t Profiler::take_to_bin(uint8_t *dest) {
+  for (uint8_t i = 0; i < PROFILE_SECTION_COUNT; i++) {
+    SectionStats taken;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {  // The sections of the control step are recorded from the timer interrupt
+      taken = sections[i];
+      sections[i] = SectionStats();
+    }
+    bin_write<uint32_t>(dest, taken.count > 0 ? taken.min_us : 0);
+    bin_write<uint32_t>(dest + 4, taken.max_us);
+    bin_write<uint32_t>(dest + 8, taken.count > 0 ? taken.sum_us / taken.count : 0);
+    bin_write<uint16_t>(dest + 12, taken.count);
+    dest += 14;
+  }
+  return BIN_SIZE_PROFILE;
+}
+#endif
@@ -0,0 +1,52 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <Arduino.h>
+#include "communication/interface.hpp"
+
+// Comment in to enable profiling, e.g. to plot the execution times of the sections in the GUI. Each probe takes two calls of micros(), also in the control step and the serial
+// buffer interrupt, so profiling is off by default. If commented out, the probes are compiled out entirely and no profile packets are sent. The benchmark measures without them.
+// #define ENABLE_PROFILING
+
+#ifdef ENABLE_PROFILING
+/*
+Measures the execution time of the code sections listed under FROM_DEVICE_PROFILE in interface.json by means of micros(), which has a resolution of 4 µs and takes a few µs itself.
+Sections of loop() include the time of the interrupts that occur meanwhile, in particular the control step. Sections of the control step only include the time of the serial buffer interrupt.
+Each section must only be recorded from one context (Either loop(), the control step or the serial buffer interrupt), since the statistics of a section are updated without disabling interrupts.
+*/
+class Profiler {
+public:
+  struct SectionStats {
+    uint32_t min_us = UINT32_MAX;
+    uint32_t max_us = 0;
+    uint32_t sum_us = 0;
+    uint16_t count = 0;
+  };
+
+  // Records the time from its construction to the end of its scope
+  class Probe {
+    ProfileSection section;
+    uint32_t start_us;
+
+  public:
+    Probe(ProfileSection section);
+    ~Probe();
+  };
+
+private:
+  SectionStats sections[PROFILE_SECTION_COUNT];
+
+public:
+  void record(ProfileSection section, uint32_t duration_us);
+  size_t take_to_bin(uint8_t *dest);
+};
+
+extern Profiler profiler;
+
+// Profiles the rest of the enclosing scope as section, e.g. PROFILE_SCOPE(RECEIVE) for PROFILE_RECEIVE
+#define PROFILE_SCOPE(section) Profiler::Probe profile_probe_##section(ProfileSection::PROFILE_##section)
+#else
+#define PROFILE_SCOPE(section)
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+// This file is automatically generated. Any changes will be overwritten.
+
+#include "profiles.hpp"
+
+const ParameterProfile PARAMETER_PROFILES[PARAMETER_PROFILE_COUNT] PROGMEM = {
+// 0: opti_balance_no_observer.json
+{ { { 6, -0.012, 1, 30 }, { -12.058, -77.398, -0.976 }, { 0, 0 }, { 200, 0 } }, { { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0 } }, { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, 0 } } },
+// 1: opti_no_i_no_ff.json
+{ { { 6, -0.012, 1, 30 }, { -12.058, -77.398, -0.976 }, { -0.377, 0 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, 0 } } },
+// 2: opti_no_i_with_ff.json
+{ { { 6, -0.012, 1, 30 }, { -12.058, -77.398, -0.976 }, { -0.377, 0 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0.9976018, 0.22727551, 0.08080876, 0, 0.00598472, 1.00074089, 0.00038438, 0, 0.04973205, -0.40153039, 0.01400607, 0, 0.00024092, -0.00192853, 0.00130692, 1 }, { -0.190784, -0.0009074, 2.32725259, 0.01107714 }, { -11.25011093, -63.27131886, -0.91289088, -0.24527782 }, -0.24527782 } } },
+// 3: opti_with_i_no_ff.json
+{ { { 6, -0.012, 1, 30 }, { -13.81, -86.052, -1.119 }, { -0.82, 0.376 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, 0 } } },
+// 4: opti_with_i_with_ff.json
+{ { { 6, -0.012, 1, 30 }, { -13.81, -86.052, -1.119 }, { -0.82, 0.376 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0.9976018, 0.22727551, 0.08080876, 0, 0.00598472, 1.00074089, 0.00038438, 0, 0.04973205, -0.40153039, 0.01400607, 0, 0.00024092, -0.00192853, 0.00130692, 1 }, { -0.190784, -0.0009074, 2.32725259, 0.01107714 }, { -11.25011093, -63.27131886, -0.91289088, -0.24527782 }, -0.24527782 } } },
+// 5: testing.json
+{ { { 6, -0.012, 1, 30 }, { -13.81, -86.052, -1.119 }, { -0.82, 0.376 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0.9976018, 0.22727551, 0.08080876, 0, 0.00598472, 1.00074089, 0.00038438, 0, 0.04973205, -0.40153039, 0.01400607, 0, 0.00024092, -0.00192853, 0.00130692, 1 }, { -0.190784, -0.0009074, 2.32725259, 0.01107714 }, { -11.25011093, -63.27131886, -0.91289088, -0.24527782 }, -0.24527782 } } },
+// 6: tuned_guidable.json
+{ { { 6, -0.012, 1, 30 }, { -15.81, -106.052, -1.018 }, { 0, 0 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, 0 } } },
+// 7: tuned_with_i_with_ff.json
+{ { { 6, -0.012, 1, 30 }, { -15.81, -106.052, -1.018 }, { -0.72, 0.3 }, { 200, 0 } }, { { { 0.99999722, 2E-08, 0, 0.006, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 1.31120427 }, { 2.78E-06, -2E-08, 0, 0, 0, 0.99401797, 0, 0, 0, 0, 1, -86.53732899, 0, 0, 0.006, -0.31120427 }, { 0.99999722, 2E-08, 0, 2E-08, 0.00598203, 0, 0, 0, 86.53732899, 0, 0, 0.7919803 } }, { { 0.9976018, 0.22727551, 0.08080876, 0, 0.00598472, 1.00074089, 0.00038438, 0, 0.04973205, -0.40153039, 0.01400607, 0, 0.00024092, -0.00192853, 0.00130692, 1 }, { -0.190784, -0.0009074, 2.32725259, 0.01107714 }, { -11.25011093, -63.27131886, -0.91289088, -0.24527782 }, -0.24527782 } } },
+};
@@ -0,0 +1,16 @@
+// This file is automatically generated. Any changes will be overwritten.
+
+#ifndef PROFILES_HPP
+#define PROFILES_HPP
+
+#include "communication/interface.hpp"
+
+#define PARAMETER_PROFILE_COUNT 8
+#define PARAMETER_PROFILES_CRC 0xBE9DU
+
+typedef decltype(ReceiveInterface::parameters) ParameterProfile;
+
+// Parameter sets of data/parameters in the ordinal order of their file names, which ReceiveInterface::parameter_profile selects by index. Located in program memory.
+extern const ParameterProfile PARAMETER_PROFILES[PARAMETER_PROFILE_COUNT];
+
+#endif
@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "scheduler.hpp"
+
+ControlScheduler control_scheduler;  // Define scheduler instance globally here
+
+// Configures timer/counter5 to call step every period_ms. The scheduler is not running until start() is called.
+void ControlScheduler::setup(void (*step)(), uint16_t period_ms) {
+  this->step = step;
+
+  TCCR5A = 0;
+  TCCR5B = 0;
+  TCCR5B |= (1 << WGM52);               // Set CTC mode and clear counter on match with OCR5A.
+  TCCR5B |= (1 << CS51) | (1 << CS50);  // At a clock speed of 16 MHz (Arduino Mega 2560) use prescale factor 64 for counter increment every 4 µs
+  set_period_ms(period_ms);
+}
+
+void ControlScheduler::start() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    prev_step_valid = false;
+    TCNT5 = 0;
+    TIFR5 = (1 << OCF5A);     // Discard a compare match that may have been flagged while stopped
+    TIMSK5 |= (1 << OCIE5A);  // Enable compare match interrupt for OCR5A.
+  }
+}
+
+void ControlScheduler::stop() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    TIMSK5 &= ~(1 << OCIE5A);
+  }
+}
+
+// Changes the period of the control step to control_period_ms(period_ms), i.e. a period of 0 selects CONTROL_DEFAULT_PERIOD_MS and periods above CONTROL_MAX_PERIOD_MS are limited.
+// Can be called repeatedly with the same value, the timer is only reprogrammed on change.
+void ControlScheduler::set_period_ms(uint16_t period_ms) {
+  if (period_ms == requested_period_ms && applied_period_ms != 0) return;
+  requested_period_ms = period_ms;
+
+  const uint16_t applied = control_period_ms(period_ms);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    applied_period_ms = applied;
+    OCR5A = applied * 250 - 1;  // 250 ticks of 4 µs per millisecond. OCR5A is a 16 bit register. Accessing it requires to temporarily disable interrupts.
+    TCNT5 = 0;                  // Otherwise the counter would run up to 0xFFFF first if the new compare value is below the current count
+    prev_step_valid = false;    // The period in which the change happened is not representative
+  }
+}
+
+// Returns the period in ms the step is actually scheduled with.
+uint16_t ControlScheduler::period_ms() const {
+  return applied_period_ms;
+}
+
+// Returns the time in µs at which the current step started. Only meant to be called from within the step.
+uint32_t ControlScheduler::step_start_us() const {
+  return prev_step_us;
+}
+
+// Returns the measured time between the start of the previous and the current step. Only meant to be called from within the step.
+uint32_t ControlScheduler::last_period_us() const {
+  return step_period_us;
+}
+
+// Returns the statistics collected since the last call and resets them.
+ControlScheduler::PeriodStats ControlScheduler::take_stats() {
+  PeriodStats taken;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    taken = stats;
+    stats = PeriodStats();
+  }
+  return taken;
+}
+
+void ControlScheduler::run_step() {
+  if (step_running) {
+    stats.overruns++;
+    return;
+  }
+  step_running = true;
+
+  uint32_t now_us = micros();
+  if (prev_step_valid) {
+    step_period_us = now_us - prev_step_us;
+    stats.min_us = min(stats.min_us, step_period_us);
+    stats.max_us = max(stats.max_us, step_period_us);
+    stats.sum_us += step_period_us;
+    stats.count++;
+  }
+  prev_step_us = now_us;
+  prev_step_valid = true;
+
+  step();
+
+  step_running = false;
+}
+
+// ISR_NOBLOCK enables interrupts right at the beginning of the routine, so the step itself can be interrupted.
+ISR(TIMER5_COMPA_vect, ISR_NOBLOCK) {
+  control_scheduler.run_step();
+}
@@ -0,0 +1,51 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <Arduino.h>
+#include "control/period.hpp"
+
+/*
+Calls the control step at a fixed rate from the compare match interrupt of timer/counter5, which is free to use on the MinSeg board (Timer4 is used for rx polling).
+The interrupt is declared non-blocking, so serial, encoder and TWI transfer interrupts stay serviceable while the step runs. The step acquires the MPU samples by non-blocking transfers,
+so the Wire library must not be used while the scheduler is running.
+If a step takes longer than the period, the next compare match finds the step still running. It is skipped and counted as overrun, so the schedule stays on its time grid.
+*/
+class ControlScheduler {
+public:
+  struct PeriodStats {
+    uint32_t min_us = UINT32_MAX;
+    uint32_t max_us = 0;
+    uint32_t sum_us = 0;
+    uint16_t count = 0;
+    uint16_t overruns = 0;
+  };
+
+private:
+  void (*step)() = nullptr;
+  uint16_t requested_period_ms = 0;
+  uint16_t applied_period_ms = 0;
+
+  volatile bool step_running = false;
+  volatile bool prev_step_valid = false;  // False if there is no previous step to measure the period against
+  uint32_t prev_step_us = 0;
+  uint32_t step_period_us = 0;
+  PeriodStats stats;
+
+public:
+  void setup(void (*step)(), uint16_t period_ms);
+  void start();
+  void stop();
+
+  void set_period_ms(uint16_t period_ms);
+  uint16_t period_ms() const;
+
+  uint32_t step_start_us() const;
+  uint32_t last_period_us() const;
+  PeriodStats take_stats();
+
+  void run_step();
+};
+
+extern ControlScheduler control_scheduler;
+
+#endif
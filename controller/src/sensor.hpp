@@ -3,28 +3,41 @@
 
 #include <Arduino.h>
 
+// Value of a sensor latched in one cycle along with the previous one
+struct SensorReading {
+  double value;
+  double prev_value;
+  uint32_t dt_us;     // Time between the previous and the current latch
+  double derivative;  // Estimated by the sensor, by default the backwards euler difference of value and prev_value over dt_us
+};
+
+/*
+Base of the sensors, which are resolved at compile time (Curiously recurring template pattern). Derived must provide double read(), which reads the current value.
+It may hide derivative() with an estimate of its own, which is called right after read() in the same latch.
+All sensors of a cycle are latched with the same timestamp, c.f. SensorSnapshot in controller.ino.
+*/
+template <typename Derived>
 class Sensor {
 private:
   double value = 0;
-  uint32_t value_ts_us = 0;
   double prev_value = 0;
-  uint32_t prev_value_ts_us = 0;
-  double integrator = 0;
-  uint32_t prev_cycle_num = 0;
-
-  virtual double get_value() = 0;
-
-protected:
-  const uint32_t freq_hz;
+  uint32_t ts_us = 0;
+  uint32_t dt_us = 0;
 
 public:
-  static uint8_t cycle_num;  // Overflow will happen but this doesn't concern since this number still offers the opportunity to compare cycles
-
-  Sensor(uint32_t freq_hz = 0);
-
-  double operator()();
-  double derivative();
-  double integral();
+  SensorReading latch(uint32_t ts_us) {
+    Derived &derived = static_cast<Derived &>(*this);
+    prev_value = value;
+    value = derived.read();
+    dt_us = ts_us - this->ts_us;
+    this->ts_us = ts_us;
+    return SensorReading{ value, prev_value, dt_us, derived.derivative() };
+  }
+
+  double derivative() const {
+    if (dt_us == 0) return 0;
+    return (value - prev_value) / dt_us * 1e6;  // Backwards euler
+  }
 };
 
 #endif
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "storage.hpp"
+#include "profiles.hpp"
+
+#define STORAGE_CRC_OFFSET (4 + BIN_SIZE_PERSISTENT)
+
+static uint16_t calculate_crc(const uint8_t *image) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < STORAGE_CRC_OFFSET; i++) crc = _crc_xmodem_update(crc, image[i]);
+  return crc;
+}
+
+// Reads the image from the EEPROM and unpacks it into rx if it is valid. Otherwise rx is left unchanged. Must be called before the first store().
+bool ParameterStorage::load(ReceiveInterface &rx) {
+  eeprom_read_block(image, (const void *)STORAGE_EEPROM_ADDRESS, STORAGE_IMAGE_SIZE);
+  const uint16_t crc = calculate_crc(image);
+  if (bin_read<uint32_t>(image) != INTERFACE_SCHEMA_HASH_PERSISTENT || bin_read<uint16_t>(image + STORAGE_CRC_OFFSET) != crc) return false;
+
+  rx.persistent_from_bin(image + 4);
+  image_crc = crc;
+  return true;
+}
+
+// Packs the image of rx, which is written by the following calls of run(). An image that is still being written is replaced.
+void ParameterStorage::store(const ReceiveInterface &rx) {
+  bin_write<uint32_t>(image, INTERFACE_SCHEMA_HASH_PERSISTENT);
+  rx.persistent_to_bin(image + 4);
+  image_crc = calculate_crc(image);
+  bin_write<uint16_t>(image + STORAGE_CRC_OFFSET, image_crc);
+  write_index = 0;
+}
+
+// Skips the bytes the EEPROM already holds and starts writing the next differing one, if the EEPROM is ready. Returns true once, when the last byte of the image has been handled.
+bool ParameterStorage::run() {
+  if (write_index == STORAGE_IMAGE_SIZE || !eeprom_is_ready()) return false;
+
+  while (write_index < STORAGE_IMAGE_SIZE) {
+    uint8_t *address = (uint8_t *)STORAGE_EEPROM_ADDRESS + write_index;
+    const uint8_t value = image[write_index++];
+    if (eeprom_read_byte(address) != value) {
+      eeprom_write_byte(address, value);
+      break;
+    }
+  }
+  return write_index == STORAGE_IMAGE_SIZE;
+}
+
+// CRC of the image that was loaded or stored last, which identifies the parameters in use. 0 if there is none.
+uint16_t ParameterStorage::crc() const {
+  return image_crc;
+}
+
+// Copies the parameters of the profile with the given index from program memory into rx, c.f. profiles.hpp. rx is left unchanged if there is no such profile.
+bool load_parameter_profile(uint8_t index, ReceiveInterface &rx) {
+  if (index >= PARAMETER_PROFILE_COUNT) return false;
+  memcpy_P(&rx.parameters, &PARAMETER_PROFILES[index], sizeof(rx.parameters));
+  return true;
+}
@@ -0,0 +1,33 @@
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+#include <Arduino.h>
+#include "communication/interface.hpp"
+
+// EEPROM address of the stored image
+#define STORAGE_EEPROM_ADDRESS 0
+// Schema hash (4) + members listed in TO_DEVICE_PERSISTENT + CRC-16/XMODEM (2)
+#define STORAGE_IMAGE_SIZE (4 + BIN_SIZE_PERSISTENT + 2)
+
+/*
+Keeps the members of the receive interface listed under TO_DEVICE_PERSISTENT in interface.json (the control parameters) in EEPROM, so the controller can balance right after a power cycle.
+The image is packed like the binary packets: INTERFACE_SCHEMA_HASH_PERSISTENT, the packed members and a CRC-16/XMODEM over both (Little endian byte format).
+An image written by a firmware with a different interface or an incompletely written one is not loaded.
+Writing an EEPROM byte takes 3.3 ms, so store() only packs the image and each run() writes at most one byte that differs from the EEPROM. It is meant to be called from every iteration of loop(),
+so the about 300 bytes of an image take about a second to write, without blocking the communication meanwhile.
+*/
+class ParameterStorage {
+  uint8_t image[STORAGE_IMAGE_SIZE];
+  uint16_t image_crc = 0;
+  uint16_t write_index = STORAGE_IMAGE_SIZE;  // Next byte of image to compare with the EEPROM. STORAGE_IMAGE_SIZE if the image is written completely.
+
+public:
+  bool load(ReceiveInterface &rx);
+  void store(const ReceiveInterface &rx);
+  bool run();
+  uint16_t crc() const;
+};
+
+bool load_parameter_profile(uint8_t index, ReceiveInterface &rx);
+
+#endif
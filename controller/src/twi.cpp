@@ -0,0 +1,143 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include <util/twi.h>
+#include "twi.hpp"
+
+TWITransfer twi_transfer;  // Define transfer instance globally here
+
+// The TWI interrupt enable bit (TWIE) is never set, so the interrupt of the Wire library does not interfere
+#define TWCR_CONTINUE (_BV(TWEN) | _BV(TWINT))
+
+// Configures timer/counter1 to service running transfers every TWI_SERVICE_PERIOD_US. The timer only interrupts while a transfer is running.
+void TWITransfer::setup() {
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TCCR1B |= (1 << WGM12);  // Set CTC mode and clear counter on match with OCR1A.
+  TCCR1B |= (1 << CS11);   // At a clock speed of 16 MHz (Arduino Mega 2560) use prescale factor 8 for counter increment every 0.5 µs
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    OCR1A = TWI_SERVICE_PERIOD_US * 2 - 1;  // OCR1A is a 16 bit register. Accessing it requires to temporarily disable interrupts.
+    TIMSK1 &= ~(1 << OCIE1A);
+  }
+}
+
+bool TWITransfer::idle() const {
+  return state == IDLE;
+}
+
+// Starts reading count registers beginning at reg. The bytes are written to dest, which must stay valid until callback is called.
+// Returns false without starting if another transfer is running.
+bool TWITransfer::start_read(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t count, Callback callback, void *context) {
+  if (count == 0 || !idle()) return false;
+  this->dest = dest;
+  this->count = count;
+  return start(address, reg, callback, context);
+}
+
+// Starts writing value to register reg. Returns false without starting if another transfer is running.
+bool TWITransfer::start_write(uint8_t address, uint8_t reg, uint8_t value, Callback callback, void *context) {
+  if (!idle()) return false;
+  this->dest = nullptr;
+  this->value = value;
+  return start(address, reg, callback, context);
+}
+
+bool TWITransfer::start(uint8_t address, uint8_t reg, Callback callback, void *context) {
+  this->address = address;
+  this->reg = reg;
+  this->callback = callback;
+  this->context = context;
+  received = 0;
+  services = 0;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    state = PENDING;  // The start condition is sent by the first service, since the stop condition of a previous transfer may still be pending
+    TCNT1 = 0;
+    TIFR1 = (1 << OCF1A);  // Discard a compare match that may have been flagged while stopped
+    TIMSK1 |= (1 << OCIE1A);
+  }
+  return true;
+}
+
+void TWITransfer::finish(bool success) {
+  if (!success) TWCR = TWCR_CONTINUE | _BV(TWSTO);  // Release the bus
+  TIMSK1 &= ~(1 << OCIE1A);
+  state = IDLE;
+  if (callback) callback(context, success);
+}
+
+// Advances the running transfer by one step if the TWI has finished the previous one. Called from the timer interrupt.
+void TWITransfer::service() {
+  if (state == IDLE) return;
+  if (++services > TWI_TIMEOUT_SERVICES) {
+    finish(false);
+    return;
+  }
+
+  if (state == PENDING) {
+    if (TWCR & _BV(TWSTO)) return;
+    TWCR = TWCR_CONTINUE | _BV(TWSTA);
+    state = START_SENT;
+    return;
+  }
+  if (!(TWCR & _BV(TWINT))) return;  // The TWI is still busy with the current byte or condition
+
+  const uint8_t status = TW_STATUS;
+  switch (state) {
+    case START_SENT:
+      if (status != TW_START) break;
+      TWDR = (address << 1) | TW_WRITE;
+      TWCR = TWCR_CONTINUE;
+      state = SLA_W_SENT;
+      return;
+    case SLA_W_SENT:
+      if (status != TW_MT_SLA_ACK) break;
+      TWDR = reg;
+      TWCR = TWCR_CONTINUE;
+      state = REGISTER_SENT;
+      return;
+    case REGISTER_SENT:
+      if (status != TW_MT_DATA_ACK) break;
+      if (dest) {
+        TWCR = TWCR_CONTINUE | _BV(TWSTA);
+        state = REP_START_SENT;
+      } else {
+        TWDR = value;
+        TWCR = TWCR_CONTINUE;
+        state = VALUE_SENT;
+      }
+      return;
+    case VALUE_SENT:
+      if (status != TW_MT_DATA_ACK) break;
+      TWCR = TWCR_CONTINUE | _BV(TWSTO);
+      finish(true);
+      return;
+    case REP_START_SENT:
+      if (status != TW_REP_START) break;
+      TWDR = (address << 1) | TW_READ;
+      TWCR = TWCR_CONTINUE;
+      state = SLA_R_SENT;
+      return;
+    case SLA_R_SENT:
+      if (status != TW_MR_SLA_ACK) break;
+      TWCR = TWCR_CONTINUE | (count > 1 ? _BV(TWEA) : 0);  // Acknowledge all but the last byte, so the slave stops sending
+      state = RECEIVING;
+      return;
+    case RECEIVING:
+      if (status != TW_MR_DATA_ACK && status != TW_MR_DATA_NACK) break;
+      dest[received++] = TWDR;
+      if (received < count) {
+        TWCR = TWCR_CONTINUE | (received + 1 < count ? _BV(TWEA) : 0);
+      } else {
+        TWCR = TWCR_CONTINUE | _BV(TWSTO);
+        finish(true);
+      }
+      return;
+    default:
+      break;
+  }
+  finish(false);  // Unexpected status, e.g. the slave did not acknowledge
+}
+
+ISR(TIMER1_COMPA_vect) {
+  twi_transfer.service();
+}
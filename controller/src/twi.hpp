@@ -0,0 +1,59 @@
+#ifndef TWI_HPP
+#define TWI_HPP
+
+#include <Arduino.h>
+
+// Period in µs in which a running transfer is serviced. Slightly longer than a byte at 400 kHz (9 clock cycles), so most services find the TWI ready.
+#define TWI_SERVICE_PERIOD_US 25
+// A transfer that does not complete within this number of services (10 ms) is aborted, e.g. if the sensor does not respond or the bus is stuck
+#define TWI_TIMEOUT_SERVICES 400
+
+/*
+Non-blocking register transfers as I2C master. A transfer is started and returns immediately, the bytes are moved in the background and a callback is called on completion.
+The TWI interrupt vector is already defined by the Wire library, which the MPU9250 library links. Therefore the TWI is run with its interrupt disabled and the transfer is advanced
+from the compare match interrupt of timer/counter1 instead, which is only enabled while a transfer is running (Timer1 is free to use on the MinSeg board, pin 11 and 12 must not be used for PWM).
+The bit rate configured by Wire.setClock() is used. Transfers and the Wire library must not be used at the same time, i.e. wait for idle() before using Wire.
+*/
+class TWITransfer {
+public:
+  // Called from the interrupt when the transfer has finished. The TWI is already idle, so the callback may start the next transfer right away.
+  typedef void (*Callback)(void *context, bool success);
+
+private:
+  enum State : uint8_t {
+    IDLE,
+    PENDING,         // Waiting for the stop condition of the previous transfer to be sent before the start condition
+    START_SENT,
+    SLA_W_SENT,      // Slave address with write bit
+    REGISTER_SENT,
+    VALUE_SENT,
+    REP_START_SENT,  // Repeated start to read right after the register address is set
+    SLA_R_SENT,      // Slave address with read bit
+    RECEIVING,
+  };
+
+  volatile State state = IDLE;
+  uint8_t address;
+  uint8_t reg;
+  uint8_t value;
+  uint8_t *dest;
+  uint8_t count;
+  uint8_t received;
+  uint16_t services;
+  Callback callback;
+  void *context;
+
+  bool start(uint8_t address, uint8_t reg, Callback callback, void *context);
+  void finish(bool success);
+
+public:
+  void setup();
+  bool idle() const;
+  bool start_read(uint8_t address, uint8_t reg, uint8_t *dest, uint8_t count, Callback callback, void *context);
+  bool start_write(uint8_t address, uint8_t reg, uint8_t value, Callback callback, void *context);
+  void service();
+};
+
+extern TWITransfer twi_transfer;
+
+#endif
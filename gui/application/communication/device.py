@@ -1,31 +1,73 @@
 import time
 import json
+import struct
+import binascii
 import warnings
 import select
 import configuration as config
 
+from typing import Callable
+
 from bluetooth import discover_devices, BluetoothSocket
 from ..helper import PROGRAM_START_TIMESTAMP, program_uptime
-from .interface import DataInterface, DataInterfaceDefinition, JsonInterfaceReader
+from .interface import DataInterface, DataInterfaceDefinition, JsonInterfaceReader, BinaryInterfaceLayout, SampleHistory, UnmatchedKeyError
+from .link import LinkStatistics
 
 INTERFACE_JSON = JsonInterfaceReader(config.JSON_INTERFACE_DEFINITION_PATH)
 
 
 class ReceiveInterface(DataInterface):
     STATUS_MESSAGE_KEY = "msg"
-    DEFINITION = DataInterfaceDefinition((STATUS_MESSAGE_KEY, str), **INTERFACE_JSON.from_device)
+    EVENTS_KEY = "evt"  # Only used by the JSON telemetry encoding. Events are translated to status messages and not stored themselves.
+    PROFILE_KEY = "profile"
+    EVENT_TEXTS = INTERFACE_JSON.from_device_events
+    EVENT_CODES = INTERFACE_JSON.from_device_event_codes
+    DEFINITION = DataInterfaceDefinition((STATUS_MESSAGE_KEY, str), (PROFILE_KEY, INTERFACE_JSON.from_device_profile), **INTERFACE_JSON.from_device)
+    BINARY_LAYOUT = BinaryInterfaceLayout(INTERFACE_JSON.from_device)
+    SAMPLE_LAYOUT = BinaryInterfaceLayout(INTERFACE_JSON.from_device_sample)
+    PROFILE_LAYOUT = BinaryInterfaceLayout(INTERFACE_JSON.from_device_profile)
+    SAMPLE_HISTORY_LENGTH = 20000  # About two minutes at the default control cycle of 6 ms
 
     def __init__(self):
-        super().__init__(self.DEFINITION, lambda: self._last_receive_ts - PROGRAM_START_TIMESTAMP)
+        super().__init__(self.DEFINITION, self.receive_time)
         self._last_receive_ts = 0
+        self.samples = SampleHistory(self.SAMPLE_LAYOUT.keys, self.SAMPLE_HISTORY_LENGTH)
+        self._event_callbacks: dict[int, Callable[[int], None]] = {}
 
     def update_receive_time(self):
         self._last_receive_ts = time.perf_counter()
 
+    def receive_time(self):
+        return self._last_receive_ts - PROGRAM_START_TIMESTAMP
+
     @property
     def status_message(self):
         return self.__getitem__(self.STATUS_MESSAGE_KEY)
 
+    def execute_on_event(self, name: str, callback: Callable[[int], None]):
+        """
+        Adds a callback that is executed when the event specified by name is received, after the status message was set.
+
+        :param name: The name of an event listed under FROM_DEVICE_EVENTS.
+        :param callback: The callback to be executed on receiving the event. The callback receives the argument of the event and should return nothing.
+        """
+        if name in self.EVENT_CODES:
+            self._event_callbacks[self.EVENT_CODES[name]] = callback
+        else:
+            raise UnmatchedKeyError(name, self.EVENT_CODES)
+
+    def update_events(self, events: list[tuple[int, int]]):
+        """
+        Sets the status message to the text of each event in turn, so the callbacks of the status message are executed for every event.
+
+        :param events: Pairs of event code and argument in the order the events occurred.
+        """
+        for code, arg in events:
+            text = self.EVENT_TEXTS[code].format(arg) if code < len(self.EVENT_TEXTS) else f"Unknown event {code} ({arg})"
+            self.update({self.STATUS_MESSAGE_KEY: text})
+            if code in self._event_callbacks:
+                self._event_callbacks[code](arg)
+
 
 class TransmitInterface(DataInterface):
     DEFINITION = DataInterfaceDefinition(**INTERFACE_JSON.to_device)
@@ -37,8 +79,31 @@ class TransmitInterface(DataInterface):
 class BluetoothDevice:
     MSG_START_TOKEN = b'$'
     MSG_START_TOKEN_LEN = len(MSG_START_TOKEN)
+    MSG_TYPE_LEN = 1
     MSG_SIZE_HINT_LEN = 2
-    MSG_HEADER_LEN = MSG_START_TOKEN_LEN + MSG_SIZE_HINT_LEN
+    MSG_STAMP_FORMAT = struct.Struct(">HI")  # Sequence number and device timestamp in µs, only contained in the header of packets from the device
+    MSG_HEADER_LEN = MSG_START_TOKEN_LEN + MSG_TYPE_LEN + MSG_SIZE_HINT_LEN + MSG_STAMP_FORMAT.size
+
+    # Packet types that follow the start token. Must match Communication::PacketType of the controller.
+    PACKET_TYPE_JSON = b'J'
+    PACKET_TYPE_BINARY_TELEMETRY = b'B'
+    PACKET_TYPE_SAMPLE_BATCH = b'S'
+    PACKET_TYPE_RECORD_BATCH = b'R'  # Recorded control steps for the replay on the host (tools/replay), which the GUI doesn't plot
+    PACKET_TYPE_PROFILE = b'P'
+    PACKET_TYPES = [PACKET_TYPE_JSON, PACKET_TYPE_BINARY_TELEMETRY, PACKET_TYPE_SAMPLE_BATCH, PACKET_TYPE_RECORD_BATCH, PACKET_TYPE_PROFILE]
+
+    # Binary telemetry payload: schema hash (4 bytes) + channel flags + packed channels + event count (1 byte) + events each as code (1 byte) and argument (2 bytes)
+    # + CRC-16/XMODEM (2 bytes), all little endian
+    # Profile payload: schema hash (4 bytes) + packed statistics of each profiled section + CRC-16/XMODEM (2 bytes), all little endian
+    BINARY_SCHEMA_HASH_FORMAT = struct.Struct("<I")
+    BINARY_CRC_FORMAT = struct.Struct("<H")
+
+    # Sample batch payload: schema hash (4 bytes) + timestamp of the first sample in µs (4 bytes) + sample count (1 byte) + dropped sample count (1 byte)
+    # + samples each prepended by its time delta to the previous one in µs (2 bytes) + CRC-16/XMODEM (2 bytes), all little endian
+    SAMPLE_BATCH_HEADER_FORMAT = struct.Struct("<IIBB")
+    SAMPLE_DELTA_FORMAT = struct.Struct("<H")
+    EVENT_COUNT_FORMAT = struct.Struct("<B")
+    EVENT_FORMAT = struct.Struct("<BH")
     CONNECT_TIMEOUT_SEC = 10
     RX_CHUNK_SIZE = 4096
     ALLOWED_RX_BUFFERBLOAT = 1024
@@ -56,11 +121,16 @@ class BluetoothDevice:
         self._socket: BluetoothSocket | None = None
         self._rx_data = ReceiveInterface()
         self._tx_data = TransmitInterface()
+        self._link = LinkStatistics()
 
     @property
     def tx_data(self):
         return self._tx_data
 
+    @property
+    def link(self):
+        return self._link
+
     @property
     def rx_data(self):
         return self._rx_data
@@ -71,6 +141,7 @@ class BluetoothDevice:
             self._socket.settimeout(self.CONNECT_TIMEOUT_SEC)
             self._socket.connect((self._address, 1))
             self._connected = True
+            self._link.reset()
 
     def disconnect(self):
         if self._connected:
@@ -107,7 +178,7 @@ class BluetoothDevice:
 
             # Send data specified in the arguments
             json_data = json.dumps(data, separators=(',', ':'), cls=DataInterface.JSONEncoder).encode()
-            packet = self.MSG_START_TOKEN + len(json_data).to_bytes(2, "big") + json_data
+            packet = self.MSG_START_TOKEN + self.PACKET_TYPE_JSON + len(json_data).to_bytes(2, "big") + json_data
 
             # Send the packet
             self._socket.sendall(packet)
@@ -119,49 +190,126 @@ class BluetoothDevice:
             if select.select([self._socket], [], [], 0)[0]:  # Check for available data
                 self._socket.settimeout(1)
 
-                # Receive header that contains start bit and message length
+                # Receive header that contains start token, packet type, message length, sequence number and device timestamp
                 while True:
-                    b = self._socket.recv(self.RX_CHUNK_SIZE)
-                    if b == b'':  # If socket was closed from other side
-                        raise ConnectionAbortedError("Connection was closed from the other side.")
-                    self._rx_buffer.extend(b)
                     msg_start = self._rx_buffer.find(self.MSG_START_TOKEN)
                     if msg_start != -1:
-                        break
-                self._rx_buffer = self._rx_buffer[msg_start:]  # Remove msg start token from buffer
-
-                while len(self._rx_buffer) < self.MSG_HEADER_LEN:
-                    b = self._socket.recv(self.RX_CHUNK_SIZE)
-                    if b == b'':  # If socket was closed from other side
-                        raise ConnectionAbortedError("Connection was closed from the other side.")
-                    self._rx_buffer.extend(b)
-                msg_len = int.from_bytes(self._rx_buffer[self.MSG_START_TOKEN_LEN:self.MSG_START_TOKEN_LEN + self.MSG_SIZE_HINT_LEN], "big")
+                        self._rx_buffer = self._rx_buffer[msg_start:]  # Discard everything before the msg start token
+                        self._recv_at_least(self.MSG_HEADER_LEN)
+                        if bytes(self._rx_buffer[self.MSG_START_TOKEN_LEN:self.MSG_START_TOKEN_LEN + self.MSG_TYPE_LEN]) in self.PACKET_TYPES:
+                            break
+                        self._rx_buffer = self._rx_buffer[self.MSG_START_TOKEN_LEN:]  # Not a valid header, so resynchronize on the next start token
+                        continue
+                    self._rx_buffer.clear()
+                    self._recv_at_least(1)
+                msg_type = bytes(self._rx_buffer[self.MSG_START_TOKEN_LEN:self.MSG_START_TOKEN_LEN + self.MSG_TYPE_LEN])
+                msg_len = int.from_bytes(self._rx_buffer[self.MSG_START_TOKEN_LEN + self.MSG_TYPE_LEN:self.MSG_START_TOKEN_LEN + self.MSG_TYPE_LEN + self.MSG_SIZE_HINT_LEN], "big")
+                msg_stamp = bytes(self._rx_buffer[self.MSG_HEADER_LEN - self.MSG_STAMP_FORMAT.size:self.MSG_HEADER_LEN])
                 self._rx_buffer = self._rx_buffer[self.MSG_HEADER_LEN:]  # Remove msg header from buffer
 
                 # Receive actual message
-                while len(self._rx_buffer) < msg_len:
-                    b = self._socket.recv(self.RX_CHUNK_SIZE)
-                    if b == b'':  # If socket was closed from other side
-                        raise ConnectionAbortedError("Connection was closed from the other side.")
-                    self._rx_buffer.extend(b)
+                self._recv_at_least(msg_len)
                 msg = self._rx_buffer[:msg_len]
                 self._rx_buffer = self._rx_buffer[msg_len:]  # Remove received message from buffer
 
                 if len(self._rx_buffer) > self.ALLOWED_RX_BUFFERBLOAT:
                     warnings.warn(f"Bufferbloat is very large which means that incoming messages aren't processed fast enough. "
                                   f"After message receive {len(self._rx_buffer)} bytes were left over in the buffer.", RuntimeWarning)
-                return bytes(msg)
+                return msg_type + msg_stamp + bytes(msg)  # The packet type is kept as the first byte to let deserialize() choose the decoding, followed by the stamp for the link statistics
             return b''
         else:
             raise self.NotConnectedError("Cannot receive when device is not connected via Bluetooth!")
 
+    def _recv_at_least(self, length: int):
+        while len(self._rx_buffer) < length:
+            b = self._socket.recv(self.RX_CHUNK_SIZE)
+            if b == b'':  # If socket was closed from other side
+                raise ConnectionAbortedError("Connection was closed from the other side.")
+            self._rx_buffer.extend(b)
+
     def deserialize(self, received: bytes):
-        try:
-            new_data: dict[str, any] = json.loads(received.decode())
-        except ValueError:
-            raise self.InvalidDataError(f"Could not interprete received data: {received}")
+        msg_type, msg_stamp, msg = received[:self.MSG_TYPE_LEN], received[self.MSG_TYPE_LEN:self.MSG_TYPE_LEN + self.MSG_STAMP_FORMAT.size], received[self.MSG_TYPE_LEN + self.MSG_STAMP_FORMAT.size:]
+        sequence, timestamp_us = self.MSG_STAMP_FORMAT.unpack(msg_stamp)
+        self._link.update(sequence, timestamp_us, self.MSG_HEADER_LEN + len(msg), self._rx_data.receive_time())  # Before decoding, so rejected packets count as received
+        if msg_type == self.PACKET_TYPE_SAMPLE_BATCH:
+            self._decode_sample_batch(msg)
+            return
+        if msg_type == self.PACKET_TYPE_RECORD_BATCH:
+            return
+        events = []
+        if msg_type == self.PACKET_TYPE_BINARY_TELEMETRY:
+            new_data, events = self._decode_binary_telemetry(msg)
+        elif msg_type == self.PACKET_TYPE_PROFILE:
+            new_data = {self._rx_data.PROFILE_KEY: self._decode_profile(msg)}
         else:
-            self._rx_data.update(new_data)  # Update rx data interface. This simultaneously verifies that the data is consistent with the interface.
+            try:
+                new_data: dict[str, any] = json.loads(msg.decode())
+            except ValueError:
+                raise self.InvalidDataError(f"Could not interprete received data: {msg}")
+            events = new_data.pop(self._rx_data.EVENTS_KEY, [])
+        self._rx_data.update(new_data)  # Update rx data interface. This simultaneously verifies that the data is consistent with the interface.
+        self._rx_data.update_events(events)
+
+    def _decode_binary_telemetry(self, msg: bytes):
+        layout = self._rx_data.BINARY_LAYOUT
+        min_len = self.BINARY_SCHEMA_HASH_FORMAT.size + layout.channel_flags_size + self.EVENT_COUNT_FORMAT.size + self.BINARY_CRC_FORMAT.size
+        if len(msg) < min_len:
+            raise self.InvalidDataError(f"Binary telemetry packet has {len(msg)} bytes but at least {min_len} bytes were expected.")
+        content, (crc,) = msg[:-self.BINARY_CRC_FORMAT.size], self.BINARY_CRC_FORMAT.unpack(msg[-self.BINARY_CRC_FORMAT.size:])
+        if binascii.crc_hqx(content, 0) != crc:
+            raise self.InvalidDataError(f"CRC mismatch in binary telemetry packet: {msg}")
+        (schema_hash,) = self.BINARY_SCHEMA_HASH_FORMAT.unpack(content[:self.BINARY_SCHEMA_HASH_FORMAT.size])
+        if schema_hash != layout.schema_hash:
+            raise self.InvalidDataError(f"Schema hash of binary telemetry {schema_hash:#010x} doesn't match the interface definition {layout.schema_hash:#010x}. "
+                                        f"Make sure that the controller was built with code generated from the current interface file.")
+        try:
+            channels_end = self.BINARY_SCHEMA_HASH_FORMAT.size + layout.channels_size(content[self.BINARY_SCHEMA_HASH_FORMAT.size:])
+            new_data = layout.unpack_channels(content[self.BINARY_SCHEMA_HASH_FORMAT.size:channels_end])  # Only the subscribed channels are contained
+            (count,) = self.EVENT_COUNT_FORMAT.unpack(content[channels_end:channels_end + self.EVENT_COUNT_FORMAT.size])
+            events_data = content[channels_end + self.EVENT_COUNT_FORMAT.size:]
+            if len(events_data) != count * self.EVENT_FORMAT.size:
+                raise ValueError(f"{len(events_data)} bytes of events don't match the event count {count}.")
+            events = list(self.EVENT_FORMAT.iter_unpack(events_data))
+        except (ValueError, struct.error) as e:
+            raise self.InvalidDataError(f"Could not decode the channels and events of binary telemetry packet: {e}")
+        return new_data, events
+
+    def _decode_profile(self, msg: bytes):
+        layout = self._rx_data.PROFILE_LAYOUT
+        expected_len = self.BINARY_SCHEMA_HASH_FORMAT.size + layout.size + self.BINARY_CRC_FORMAT.size
+        if len(msg) != expected_len:
+            raise self.InvalidDataError(f"Profile packet has {len(msg)} bytes but {expected_len} bytes were expected.")
+        content, (crc,) = msg[:-self.BINARY_CRC_FORMAT.size], self.BINARY_CRC_FORMAT.unpack(msg[-self.BINARY_CRC_FORMAT.size:])
+        if binascii.crc_hqx(content, 0) != crc:
+            raise self.InvalidDataError(f"CRC mismatch in profile packet: {msg}")
+        (schema_hash,) = self.BINARY_SCHEMA_HASH_FORMAT.unpack(content[:self.BINARY_SCHEMA_HASH_FORMAT.size])
+        if schema_hash != layout.schema_hash:
+            raise self.InvalidDataError(f"Schema hash of profile {schema_hash:#010x} doesn't match the interface definition {layout.schema_hash:#010x}. "
+                                        f"Make sure that the controller was built with code generated from the current interface file.")
+        return layout.unpack(content[self.BINARY_SCHEMA_HASH_FORMAT.size:])
+
+    def _decode_sample_batch(self, msg: bytes):
+        layout = self._rx_data.SAMPLE_LAYOUT
+        sample_len = self.SAMPLE_DELTA_FORMAT.size + layout.size
+        if len(msg) < self.SAMPLE_BATCH_HEADER_FORMAT.size + self.BINARY_CRC_FORMAT.size:
+            raise self.InvalidDataError(f"Sample batch packet has only {len(msg)} bytes.")
+        content, (crc,) = msg[:-self.BINARY_CRC_FORMAT.size], self.BINARY_CRC_FORMAT.unpack(msg[-self.BINARY_CRC_FORMAT.size:])
+        if binascii.crc_hqx(content, 0) != crc:
+            raise self.InvalidDataError(f"CRC mismatch in sample batch packet: {msg}")
+        schema_hash, timestamp_us, count, dropped = self.SAMPLE_BATCH_HEADER_FORMAT.unpack(content[:self.SAMPLE_BATCH_HEADER_FORMAT.size])
+        if schema_hash != layout.schema_hash:
+            raise self.InvalidDataError(f"Schema hash of sample batch {schema_hash:#010x} doesn't match the interface definition {layout.schema_hash:#010x}. "
+                                        f"Make sure that the controller was built with code generated from the current interface file.")
+        if len(content) != self.SAMPLE_BATCH_HEADER_FORMAT.size + count * sample_len:
+            raise self.InvalidDataError(f"Sample batch packet has {len(msg)} bytes which doesn't match its {count} samples.")
+
+        timestamps_us, samples = [], []
+        for offset in range(self.SAMPLE_BATCH_HEADER_FORMAT.size, len(content), sample_len):
+            (delta_us,) = self.SAMPLE_DELTA_FORMAT.unpack(content[offset:offset + self.SAMPLE_DELTA_FORMAT.size])
+            timestamp_us = (timestamp_us + delta_us) % SampleHistory.DEVICE_TIMESTAMP_RANGE_US
+            timestamps_us.append(timestamp_us)
+            samples.append(layout.unpack_values(content[offset + self.SAMPLE_DELTA_FORMAT.size:offset + sample_len]))
+        self._rx_data.samples.extend(timestamps_us, samples, self._rx_data.receive_time(), dropped)
 
     @staticmethod
     def discover():
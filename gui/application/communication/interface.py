@@ -1,10 +1,11 @@
 import re
 import json
+import struct
 
 from dataclasses import dataclass
 from pathlib import Path
 from threading import RLock
-from collections import UserDict
+from collections import UserDict, deque
 from typing import Callable, TypeVar
 
 
@@ -28,6 +29,10 @@ class SetItemNotAllowedError(Exception):
 class JsonInterfaceReader:
     TO_DEVICE_KEY = "TO_DEVICE"
     FROM_DEVICE_KEY = "FROM_DEVICE"
+    FROM_DEVICE_SAMPLE_KEY = "FROM_DEVICE_SAMPLE"
+    FROM_DEVICE_PROFILE_KEY = "FROM_DEVICE_PROFILE"
+    FROM_DEVICE_EVENTS_KEY = "FROM_DEVICE_EVENTS"
+    PROFILE_SECTION_DEFINITION = {"min_us": "uint32_t", "max_us": "uint32_t", "mean_us": "uint32_t", "count": "uint16_t"}  # Statistics of each profiled section in the order they are packed
 
     def __init__(self, file_path: Path):
         # Verify that json interface file is valid
@@ -46,6 +51,185 @@ class JsonInterfaceReader:
     def from_device(self) -> dict[str, str | dict]:
         return self.json_dict[self.FROM_DEVICE_KEY]
 
+    @property
+    def from_device_sample(self) -> dict[str, str | dict]:
+        """
+        Subset of the definition from the device with the members listed under FROM_DEVICE_SAMPLE, which the device records in every control cycle.
+        The members are selected the same way as generate.ps1 does it: A listed nested struct selects all of its members, and the order of the definition is kept.
+        """
+        accessors = self.json_dict.get(self.FROM_DEVICE_SAMPLE_KEY, [])
+
+        def select(d: dict[str, str | dict], accessor: str):
+            selection = {}
+            for key, val in d.items():
+                name = accessor + key
+                if name in accessors:
+                    selection[key] = val
+                elif isinstance(val, dict):
+                    nested = select(val, name + ".")
+                    if nested:
+                        selection[key] = nested
+            return selection
+
+        return select(self.from_device, "")
+
+    @property
+    def from_device_profile(self) -> dict[str, str | dict]:
+        """
+        Definition of the statistics of the code sections listed under FROM_DEVICE_PROFILE that the device sends in profile packets, like it is generated by generate.ps1.
+        """
+        return {section: dict(self.PROFILE_SECTION_DEFINITION) for section in self.json_dict.get(self.FROM_DEVICE_PROFILE_KEY, [])}
+
+    @property
+    def from_device_events(self) -> list[str]:
+        """
+        Texts of the status events listed under FROM_DEVICE_EVENTS, indexed by their code. A "{}" in a text is replaced by the argument of the event.
+        """
+        return list(self.json_dict.get(self.FROM_DEVICE_EVENTS_KEY, {}).values())
+
+    @property
+    def from_device_event_codes(self) -> dict[str, int]:
+        """
+        Codes of the status events listed under FROM_DEVICE_EVENTS by their names.
+        """
+        return {name: code for code, name in enumerate(self.json_dict.get(self.FROM_DEVICE_EVENTS_KEY, {}))}
+
+
+class BinaryInterfaceLayout:
+    """
+    Packed little endian binary layout of an interface definition as it is generated for the device by generate.ps1.
+    Members are laid out in the order of definition without any padding. The device is an AVR where double is 4 bytes wide, so double is encoded as float.
+    Each member on the lowest level is a channel with a flag bit in the order of definition. If only some channels are packed, they are preceded by their flags.
+    """
+
+    # Maps the types that are allowed to be specified in the interface json file to struct format characters (sizes as on AVR)
+    WIRE_FORMAT = {
+        "char[]": "s",
+        "bool": "?",
+        "float": "f",
+        "double": "f",
+        "int": "h",
+        "int8_t": "b",
+        "int16_t": "h",
+        "int32_t": "i",
+        "int64_t": "q",
+        "uint8_t": "B",
+        "uint16_t": "H",
+        "uint32_t": "I",
+        "uint64_t": "Q",
+    }
+
+    # Smallest unsigned integer with a bit for each channel as chosen by generate.ps1 (Maximum number of channels, struct format)
+    CHANNEL_FLAGS_FORMATS = [(8, "<B"), (16, "<H"), (32, "<I")]
+
+    def __init__(self, definition: dict[str, str | dict]):
+        self._keys: list[tuple[str, ...]] = []
+        self._formats: list[str] = []
+        self._char_array_keys: set[tuple[str, ...]] = set()
+        schema = ""
+
+        def parse(accessor: tuple[str, ...], d: dict[str, str | dict]):
+            nonlocal schema
+            for key, val in d.items():
+                _accessor = accessor + (key,)
+                if isinstance(val, dict):
+                    parse(_accessor, val)
+                    continue
+                schema += f"{'.'.join(_accessor)}:{val};"
+                array_size = re.search(r'\[(\d+)]', val)
+                if array_size:
+                    self._formats.append(array_size.group(1) + self.WIRE_FORMAT["char[]"])
+                    self._char_array_keys.add(_accessor)
+                else:
+                    self._formats.append(self.WIRE_FORMAT[val])
+                self._keys.append(_accessor)
+
+        parse((), definition)
+        self._struct = struct.Struct("<" + "".join(self._formats))
+        self._channel_structs: dict[int, struct.Struct] = {}
+        self._channel_flags_struct = next((struct.Struct(fmt) for count, fmt in self.CHANNEL_FLAGS_FORMATS if len(self._keys) <= count), None)
+        self._schema_hash = self.fnv1a_32(schema.encode())
+
+    @staticmethod
+    def fnv1a_32(data: bytes):
+        h = 0x811C9DC5
+        for b in data:
+            h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+        return h
+
+    @property
+    def size(self):
+        return self._struct.size
+
+    @property
+    def keys(self):
+        return list(self._keys)
+
+    @property
+    def schema_hash(self):
+        """
+        Hash of the canonical schema string ("sensor.wheel.angle_rad:double;...") which is also calculated by generate.ps1.
+        """
+        return self._schema_hash
+
+    @property
+    def all_channels(self):
+        return (1 << len(self._keys)) - 1
+
+    @property
+    def channel_flags_size(self):
+        return self._channel_flags_struct.size
+
+    def channel_flags(self, keys: list[tuple[str, ...]] | set[tuple[str, ...]]) -> int:
+        """
+        Returns the flags of the channels to subscribe to. A key of a nested struct selects all of its channels, keys that aren't part of the layout are ignored.
+        """
+        return sum(1 << index for index, channel in enumerate(self._keys) if any(channel[:len(key)] == key for key in keys))
+
+    def unpack(self, data: bytes) -> dict[str, any]:
+        """
+        Decodes packed binary data into a nested dict that corresponds to the interface definition.
+        """
+        return self._nest(self._keys, self.unpack_values(data))
+
+    def unpack_values(self, data: bytes) -> list[any]:
+        """
+        Decodes packed binary data into a list of values in the order of keys.
+        """
+        return self._decode(self._keys, self._struct.unpack(data))
+
+    def channels_size(self, data: bytes) -> int:
+        """
+        Returns the size of the channel flags at the beginning of data and of the packed channels that follow them.
+        """
+        (channels,) = self._channel_flags_struct.unpack(data[:self.channel_flags_size])
+        return self.channel_flags_size + struct.calcsize("<" + "".join(fmt for index, fmt in enumerate(self._formats) if channels & (1 << index)))
+
+    def unpack_channels(self, data: bytes) -> dict[str, any]:
+        """
+        Decodes the channel flags and the packed channels that follow them into a nested dict that only contains the packed channels.
+        """
+        (channels,) = self._channel_flags_struct.unpack(data[:self.channel_flags_size])
+        if channels & ~self.all_channels:
+            raise ValueError(f"Channel flags {channels:#x} contain channels that aren't part of the layout.")
+        if channels not in self._channel_structs:
+            self._channel_structs[channels] = struct.Struct("<" + "".join(fmt for index, fmt in enumerate(self._formats) if channels & (1 << index)))
+        keys = [key for index, key in enumerate(self._keys) if channels & (1 << index)]
+        return self._nest(keys, self._decode(keys, self._channel_structs[channels].unpack(data[self.channel_flags_size:])))
+
+    def _decode(self, keys: list[tuple[str, ...]], values: tuple) -> list[any]:
+        return [val.split(b'\0', 1)[0].decode() if key in self._char_array_keys else val for key, val in zip(keys, values)]
+
+    @staticmethod
+    def _nest(keys: list[tuple[str, ...]], values: list[any]) -> dict[str, any]:
+        nested = {}
+        for key, val in zip(keys, values):
+            d = nested
+            for k in key[:-1]:
+                d = d.setdefault(k, {})
+            d[key[-1]] = val
+        return nested
+
 
 DataInterfaceDefinitionType = TypeVar('DataInterfaceDefinitionType')
 
@@ -248,3 +432,82 @@ class DataInterface(UserDict):
                 raise TypeError(f"Key {key[-2]} doesn't point to another instance of {DataInterface}. Type of value is {type(d)}.")
 
             raise TypeError(f"Argument 'key' must be a string or a tuple of strings not {type(key)}.")
+
+
+class SampleHistory:
+    """
+    A thread safe history of the values that the device records in every control cycle and sends in batches (c.f. Communication::enqueue_samples() of the controller).
+    The device timestamps are mapped to the program uptime, so the samples can be plotted together with the regularly received data.
+    The mapping is based on the smallest transmission delay observed so far, which keeps it free of the jitter of the transmission.
+    """
+    DEVICE_TIMESTAMP_RANGE_US = 2 ** 32
+
+    def __init__(self, keys: list[tuple[str, ...]], max_samples: int):
+        """
+        :param keys: Keys of the sampled members in the order they are packed by the device.
+        :param max_samples: Number of samples that are kept for each key. Older samples are discarded.
+        """
+        self._access_lock = RLock()
+        self._samples: dict[tuple[str, ...], deque[StampedData]] = {key: deque(maxlen=max_samples) for key in keys}
+        self._time_offset: float | None = None
+        self._last_device_timestamp_us: int | None = None
+        self._device_timestamp_wraps_us = 0
+        self._dropped = 0
+
+    def __contains__(self, key: tuple[str, ...]):
+        return key in self._samples
+
+    @property
+    def dropped(self):
+        """
+        Number of samples the device had to drop because they could not be transmitted fast enough.
+        """
+        return self._dropped
+
+    def extend(self, device_timestamps_us: list[int], samples: list[list[any]], receive_timestamp: float, dropped: int = 0):
+        """
+        Appends a batch of samples.
+
+        :param device_timestamps_us: Timestamps of the samples in µs as measured by the device.
+        :param samples: Values of each sample in the order of the keys.
+        :param receive_timestamp: Time when the batch was received indicating the time elapsed since the start of the application.
+        :param dropped: Number of samples the device dropped before this batch.
+        """
+        with self._access_lock:
+            times = [self._device_time(ts) for ts in device_timestamps_us]
+            if times:
+                offset = receive_timestamp - times[-1]
+                if self._time_offset is None or offset < self._time_offset:
+                    self._time_offset = offset
+            for t, values in zip(times, samples):
+                for history, value in zip(self._samples.values(), values):
+                    history.append(StampedData(value, t + self._time_offset))
+            self._dropped += dropped
+
+    def since(self, key: tuple[str, ...], timestamp: float | None) -> list[StampedData] | None:
+        """
+        Returns the samples of key with a timestamp later than timestamp or all samples if timestamp is None.
+        If no samples have been received at all, None is returned.
+        """
+        with self._access_lock:
+            history = self._samples[key]
+            if not history:
+                return None
+            newer = []
+            for sample in reversed(history):
+                if timestamp is not None and sample.timestamp <= timestamp:
+                    break
+                newer.append(sample)
+            newer.reverse()
+            return newer
+
+    def _device_time(self, timestamp_us: int):
+        # Convert the device timestamps that wrap around every 71 minutes to continuous time in seconds
+        if self._last_device_timestamp_us is not None and timestamp_us < self._last_device_timestamp_us:
+            if self._last_device_timestamp_us - timestamp_us > self.DEVICE_TIMESTAMP_RANGE_US // 2:
+                self._device_timestamp_wraps_us += self.DEVICE_TIMESTAMP_RANGE_US
+            else:  # The device was restarted
+                self._device_timestamp_wraps_us = 0
+                self._time_offset = None
+        self._last_device_timestamp_us = timestamp_us
+        return (timestamp_us + self._device_timestamp_wraps_us) * 1e-6
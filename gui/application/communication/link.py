@@ -0,0 +1,96 @@
+from collections import deque
+from threading import RLock
+
+
+class LinkStatistics:
+    """
+    Health of the link to the device, derived from the sequence number and the device timestamp in the header of every received packet (c.f. Communication::stamp_tx_packet() of the controller).
+    The device numbers the packets when their transmission starts, so a gap in the sequence numbers means that packets were lost on the way or rejected by the receiver.
+    The clocks of the device and the PC aren't synchronized, so the latency is the transmission delay of a packet in excess of the smallest one observed within the window.
+    That is the time a packet waited in the buffers of the Bluetooth link. The window is short enough that the drift between both clocks doesn't matter.
+    """
+    SEQUENCE_RANGE = 2 ** 16
+    DEVICE_TIMESTAMP_RANGE_US = 2 ** 32
+    WINDOW_SEC = 5
+
+    def __init__(self):
+        self._access_lock = RLock()
+        self.reset()
+
+    def reset(self):
+        """
+        Starts over, e.g. on a new connection, since the device may have been restarted meanwhile.
+        """
+        with self._access_lock:
+            self._last_sequence: int | None = None
+            self._last_device_timestamp_us: int | None = None
+            self._device_timestamp_wraps_us = 0
+            self._packets: deque[tuple[float, int, int]] = deque()  # Receive timestamp, size and number of packets lost before of each packet within the window
+            self._offsets: deque[tuple[float, float]] = deque()  # Receive timestamps and increasing offsets between receive and device time, whose first one is the minimum within the window
+            self._latency = 0.0
+            self.received = 0
+            self.lost = 0
+
+    def update(self, sequence: int, device_timestamp_us: int, size: int, receive_timestamp: float):
+        """
+        Accounts for a received packet.
+
+        :param sequence: Sequence number from the packet header.
+        :param device_timestamp_us: Time in µs at which the device started transmitting the packet.
+        :param size: Size of the packet including its header in bytes.
+        :param receive_timestamp: Time when the packet was received indicating the time elapsed since the start of the application.
+        """
+        with self._access_lock:
+            lost = 0
+            if self._last_sequence is not None:
+                lost = (sequence - self._last_sequence - 1) % self.SEQUENCE_RANGE
+            self._last_sequence = sequence
+            self.received += 1
+            self.lost += lost
+
+            offset = receive_timestamp - self._device_time(device_timestamp_us)
+            while self._offsets and self._offsets[-1][1] >= offset:
+                self._offsets.pop()
+            self._offsets.append((receive_timestamp, offset))
+            while self._offsets[0][0] < receive_timestamp - self.WINDOW_SEC:
+                self._offsets.popleft()
+            self._latency = offset - self._offsets[0][1]
+
+            self._packets.append((receive_timestamp, size, lost))
+            while self._packets[0][0] < receive_timestamp - self.WINDOW_SEC:
+                self._packets.popleft()
+
+    @property
+    def loss_percent(self):
+        """
+        Share of the packets lost within the window.
+        """
+        with self._access_lock:
+            lost = sum(p[2] for p in self._packets)
+            return 100 * lost / (lost + len(self._packets)) if self._packets else 0.0
+
+    @property
+    def latency_ms(self):
+        """
+        Latency of the packet received last.
+        """
+        with self._access_lock:
+            return 1e3 * self._latency
+
+    @property
+    def throughput_bps(self):
+        """
+        Bytes per second received within the window.
+        """
+        with self._access_lock:
+            if len(self._packets) < 2:
+                return 0.0
+            duration = self._packets[-1][0] - self._packets[0][0]
+            return sum(p[1] for p in list(self._packets)[1:]) / duration if duration > 0 else 0.0
+
+    def _device_time(self, timestamp_us: int):
+        # Convert the device timestamps that wrap around every 71 minutes to continuous time in seconds
+        if self._last_device_timestamp_us is not None and timestamp_us < self._last_device_timestamp_us and self._last_device_timestamp_us - timestamp_us > self.DEVICE_TIMESTAMP_RANGE_US // 2:
+            self._device_timestamp_wraps_us += self.DEVICE_TIMESTAMP_RANGE_US
+        self._last_device_timestamp_us = timestamp_us
+        return (timestamp_us + self._device_timestamp_wraps_us) * 1e-6
@@ -10,7 +10,7 @@ from collections import UserDict
 from PySide6.QtCore import QTimer, Signal, QObject, SignalInstance
 from PySide6.QtGui import QFont
 from .helper import program_uptime
-from .communication.interface import StampedData, DataInterface, DataInterfaceDefinition
+from .communication.interface import StampedData, DataInterface, DataInterfaceDefinition, SampleHistory
 
 
 @dataclass(frozen=True, eq=True)
@@ -20,11 +20,15 @@ class CurveDefinition:
 
     - label: Name of the curve.
     - _get_data: Getter for stamped data.
+    - _get_samples: Optional getter for all values recorded after a timestamp, if the device samples the value in every control cycle.
+    - interface_key: Key of the value in the interface received from the device, if it is one. The device only transmits the values of curves in use.
 
     If there is no getter for stamped data available, one can use the classmethod make to define it inline.
     """
     label: str
     _get_data: Callable[[], StampedData]
+    _get_samples: Callable[[float | None], list[StampedData] | None] | None = None
+    interface_key: tuple[str, ...] | None = None
 
     @classmethod
     def make(cls, label: str, getter: Callable[[], any], stamper: Callable[[], float] = program_uptime):
@@ -43,6 +47,14 @@ class CurveDefinition:
     def get_timestamp(self):
         return self._get_data().timestamp
 
+    def get_samples(self, after: float | None) -> list[StampedData] | None:
+        """
+        Returns the values recorded after the timestamp after. If the curve isn't sampled or no samples have been received, None is returned.
+        """
+        if self._get_samples is None:
+            return None
+        return self._get_samples(after)
+
 
 @dataclass
 class ColouredCurve:
@@ -59,6 +71,8 @@ class ColouredCurve:
 
 class CurveLibrary:
     _DEFS: dict[str, CurveDefinition] = {}
+    _USAGE: dict[CurveDefinition, int] = {}  # Number of users of each curve that is currently in use
+    _USAGE_CHANGED_CALLBACKS: list[Callable[[], None]] = []
 
     @classmethod
     def colorize(cls, curves: list[str] | list[CurveDefinition]):
@@ -70,17 +84,53 @@ class CurveLibrary:
         cls._DEFS[key] = curve_definition
 
     @classmethod
-    def parse_data_interface(cls, interface: DataInterface):
+    def parse_data_interface(cls, interface: DataInterface, samples: SampleHistory = None):
         def add_data_interface_curves(accessor: list[str], definition: DataInterfaceDefinition):
             for key, val in definition.items():
                 _accessor = accessor + [key]
                 if val in [float, int, bool]:
-                    cls.add_definition('/'.join(_accessor).upper(), CurveDefinition('/'.join(_accessor), partial(interface.get, tuple(_accessor))))
+                    get_samples = partial(samples.since, tuple(_accessor)) if samples is not None and tuple(_accessor) in samples else None
+                    cls.add_definition('/'.join(_accessor).upper(), CurveDefinition('/'.join(_accessor), partial(interface.get, tuple(_accessor)), get_samples, tuple(_accessor)))
                 elif isinstance(val, DataInterfaceDefinition):
                     add_data_interface_curves(_accessor, val)
 
         add_data_interface_curves([], interface.definition)
 
+    @classmethod
+    def acquire(cls, curve_definition: CurveDefinition):
+        """
+        Marks a curve as used, e.g. because it is plotted. Each call must be followed by a call of release() once the curve is not used anymore.
+        """
+        cls._USAGE[curve_definition] = cls._USAGE.get(curve_definition, 0) + 1
+        if cls._USAGE[curve_definition] == 1:
+            cls._notify_usage_changed()
+
+    @classmethod
+    def release(cls, curve_definition: CurveDefinition):
+        cls._USAGE[curve_definition] -= 1
+        if cls._USAGE[curve_definition] == 0:
+            del cls._USAGE[curve_definition]
+            cls._notify_usage_changed()
+
+    @classmethod
+    def used_interface_keys(cls) -> set[tuple[str, ...]]:
+        """
+        Returns the interface keys of all curves in use.
+        """
+        return {curve_definition.interface_key for curve_definition in cls._USAGE if curve_definition.interface_key is not None}
+
+    @classmethod
+    def execute_when_usage_changed(cls, callback: Callable[[], None]):
+        """
+        Adds a callback that is executed when a curve is used for the first time or isn't used anymore.
+        """
+        cls._USAGE_CHANGED_CALLBACKS.append(callback)
+
+    @classmethod
+    def _notify_usage_changed(cls):
+        for callback in cls._USAGE_CHANGED_CALLBACKS:
+            callback()
+
     @classmethod
     @overload
     def definitions(cls) -> dict[str, CurveDefinition]:
@@ -166,6 +216,7 @@ class TimeseriesCurve(pg.PlotDataItem):
         super().__init__(name=label, pen=pg.mkPen(color=color, width=1))
         self._window_duration = window_size_sec
         self._visible_timeseries = np.array([[], []])
+        self._last_timestamp: float | None = None
         self._recording_active = False
         self._recording_arr = np.array([[], []])  # Store the entire data received inside an extra array
 
@@ -183,6 +234,10 @@ class TimeseriesCurve(pg.PlotDataItem):
     def recording_array(self):
         return self._recording_arr
 
+    @property
+    def last_timestamp(self):
+        return self._last_timestamp
+
     def append_data(self, value: float | None, ts: float | None):
         """
         Updates the curve of the plot by appending a new value at the provided frame timestamp ts.
@@ -192,21 +247,33 @@ class TimeseriesCurve(pg.PlotDataItem):
         :param ts: Timestamp of the value that indicates the time elapsed since the start of the application.
         """
         if ts is not None:
+            self.extend_data([value], [ts])
+
+    def extend_data(self, values: list[float | None], timestamps: list[float]):
+        """
+        Like append_data(), but appends several values at once, e.g. the samples recorded by the device in every control cycle.
+
+        :param values: Values to append to the curve.
+        :param timestamps: Timestamps of the values in ascending order.
+        """
+        if timestamps:
             # Initialize timeseries if first time calling
-            _value = np.nan if value is None else value
+            _values = [np.nan if value is None else value for value in values]
             if not self._visible_timeseries.any():
+                ts = timestamps[0]
                 t = np.linspace(ts - self._window_duration, ts, round(self._window_duration * config.PARAMETERS.plot_update_rate_ms))  # Initial time axis which is subject to change
                 self._visible_timeseries = np.array([t, np.full(t.shape[0], np.nan)])  # Initial values np.nan
 
             # Extend recording array
             if self._recording_active:
-                self._recording_arr = np.append(self._recording_arr, [[ts], [_value]], axis=1)
+                self._recording_arr = np.append(self._recording_arr, [timestamps, _values], axis=1)
 
             # Extend the timeseries data of the curve
-            self._visible_timeseries = np.append(self._visible_timeseries, [[ts], [_value]], axis=1)
-            while self._visible_timeseries[0, -1] - self._visible_timeseries[0, 0] > self._window_duration:
-                self._visible_timeseries = np.delete(self._visible_timeseries, 0, axis=1)
+            self._visible_timeseries = np.append(self._visible_timeseries, [timestamps, _values], axis=1)
+            window_start = np.searchsorted(self._visible_timeseries[0], self._visible_timeseries[0, -1] - self._window_duration)  # Batches may exceed the window by far, so cut it at once
+            self._visible_timeseries = self._visible_timeseries[:, window_start:]
             self.setData(self._visible_timeseries[0], self._visible_timeseries[1])
+            self._last_timestamp = timestamps[-1]
 
 
 class MonitoringGraph(pg.PlotItem):
@@ -261,10 +328,16 @@ class MonitoringGraph(pg.PlotItem):
         _curve = TimeseriesCurve(curve.definition.label, curve.color, self._window_size)
         self._curves_dict[curve.definition] = _curve
         self.addItem(_curve)
+        CurveLibrary.acquire(curve.definition)
 
     def remove_curve(self, curve_definition: CurveDefinition):
         self.removeItem(self._curves_dict[curve_definition])
         del self._curves_dict[curve_definition]
+        CurveLibrary.release(curve_definition)
+
+    def remove_all_curves(self):
+        for curve_definition in list(self._curves_dict):
+            self.remove_curve(curve_definition)
 
     @property
     def title(self):
@@ -280,7 +353,11 @@ class MonitoringGraph(pg.PlotItem):
 
     def _update(self):
         for curve_def, time_curve in self._curves_dict.items():
-            time_curve.append_data(curve_def.get_value(), curve_def.get_timestamp())
+            samples = curve_def.get_samples(time_curve.last_timestamp)
+            if samples is None:
+                time_curve.append_data(curve_def.get_value(), curve_def.get_timestamp())
+            else:  # Plot every sample instead of only the most recent value
+                time_curve.extend_data([sample.value for sample in samples], [sample.timestamp for sample in samples])
 
 
 class GraphDict(UserDict):
@@ -307,4 +384,5 @@ class GraphDict(UserDict):
         super().__delitem__(key)
 
     def _remove_graph_from_layout(self, key: int):
+        self.data[key].remove_all_curves()  # The graph is discarded, so its curves aren't in use anymore
         self._layout.removeItem(self.data[key])
@@ -149,7 +149,7 @@ GridLayout {
         }
 
         Text {
-            text: parent.messages[Number(backend.calibration_state).toLocaleString()]
+            text: parent.messages[Number(backend.calibration_state).toLocaleString()] + (backend.calibration_state === 1 ? " " + backend.calibration_progress + " %" : "")
             font.pixelSize: root.textSize
             color: backend.calibration_state === 2 ? Theme.primary : Theme.foreground
             anchors {
@@ -11,6 +11,7 @@ class StatusSection(QMLWidgetBackend):
     connection_state = NotifiedProperty(int)
     receive_size = NotifiedProperty(int)
     calibration_state = NotifiedProperty(int)
+    calibration_progress = NotifiedProperty(int)
     control_switch_state = NotifiedProperty(bool)
     control_cycle_time_ms = NotifiedProperty(float)
     loaded_param_state = NotifiedProperty(int)
@@ -21,11 +22,13 @@ class StatusSection(QMLWidgetBackend):
         self.connection_state = connection_state
         self.receive_size = 0
         self.calibration_state = calibration_state
+        self.calibration_progress = 0
         self.control_switch_state = control_switch_state
         self.control_cycle_time_ms = 0.0
         self.loaded_param_state = loaded_param_state
         self.param_file_name = "Nothing Loaded"
 
+        CurveLibrary.acquire(CurveLibrary.definitions("CONTROL/CYCLE_US"))  # The section is always shown, so the curve stays in use
         self._control_cycle_time_us = ScheduledValue(CurveLibrary.definitions("CONTROL/CYCLE_US").get_value, 500)
         self._control_cycle_time_us.updated.connect(self.set_control_cycle_time)
         self._bytes_received = ScheduledValue(CurveLibrary.definitions("BYTES_RECEIVED").get_value, 500)
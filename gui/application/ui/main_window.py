@@ -1,3 +1,4 @@
+import binascii
 import json
 import configuration as config
 
@@ -11,12 +12,14 @@ from application.ui.monitoring_window import MonitoringWindow
 from application.qml.widget import SetpointSlider, ParameterSection, StatusSection
 from functools import partial
 from resources.main_window_ui import Ui_MainWindow
-from PySide6.QtCore import QTime
+from PySide6.QtCore import QTime, QTimer
 from PySide6.QtGui import QCloseEvent, QGuiApplication
 from PySide6.QtWidgets import QMainWindow, QProgressBar, QLabel, QFileDialog
 
 
 class MinSegGUI(QMainWindow):
+    ALWAYS_SUBSCRIBED_KEYS = {("calibrated",), ("calibration_progress",), ("parameters_crc",), ("parameter_profiles_crc",), ("baud_rate",)}  # Values received from the device that are needed even if no curve uses them
+
     def __init__(self):
         super().__init__(None)
         self.ui = Ui_MainWindow()
@@ -43,10 +46,20 @@ class MinSegGUI(QMainWindow):
             repeat_ms=0
         )
         self.bt_bytes_received = 0
+        self.parameters_changed = False  # Whether parameters were loaded or edited, otherwise the device keeps the ones it stored
+        self.parameters_check_pending = False  # Whether the parameters stored on the device are to be checked once their CRC is received
+        self.sent_parameters: dict | None = None  # The parameters sent last, until the device reports that it stored them
+        self.baud_rate_limit = config.LINK_BAUD_RATE  # Lowered by a fallback for the rest of the session
+        self.baud_rate_requested = False  # Whether a baud rate was requested on the current connection
         self.bt_connect_progress_bar = QProgressBar()
         self.bt_connect_progress_bar.setMaximumSize(250, 15)
         self.bt_connect_progress_bar.setRange(0, 0)
         self.bt_connect_label = QLabel("Connecting ...")
+        self.link_label = QLabel()  # Link health readout, c.f. LinkStatistics
+        self.ui.statusbar.addPermanentWidget(self.link_label)
+        self.link_timer = QTimer(self)
+        self.link_timer.setInterval(1000)
+        self.link_timer.timeout.connect(self.update_link_label)
 
         self.ui.actionNewMonitor.triggered.connect(self.on_open_monitor)
         self.ui.actionConnect.triggered.connect(self.on_bt_connect)
@@ -59,12 +72,22 @@ class MinSegGUI(QMainWindow):
 
         # Add interface set callbacks
         self.bt_device.rx_data.execute_when_set("calibrated", self.on_calibrated)
+        self.bt_device.rx_data.execute_when_set("calibration_progress", self.on_calibration_progress)
         self.bt_device.rx_data.execute_when_set("msg", lambda msg: self.ui.console.append(f"{QTime.currentTime().toString()} -> {msg.value}"))
+        self.bt_device.rx_data.execute_when_set("parameters_crc", self.on_parameters_crc)
+        self.bt_device.rx_data.execute_on_event("PARAMETERS_STORED", self.on_parameters_stored)
+        self.bt_device.rx_data.execute_when_set("baud_rate", self.on_baud_rate)
+        self.bt_device.rx_data.execute_on_event("BAUD_RATE_SWITCH_PENDING", self.on_baud_rate_switch_pending)
+        self.bt_device.rx_data.execute_on_event("BAUD_RATE_FALLBACK", self.on_baud_rate_fallback)
 
         # Curve definitions
         CurveLibrary.add_definition("BYTES_RECEIVED", CurveDefinition.make("bytes_received", lambda: self.bt_bytes_received))
+        CurveLibrary.add_definition("LINK/LOSS_PERCENT", CurveDefinition.make("link_loss_percent", lambda: self.bt_device.link.loss_percent))
+        CurveLibrary.add_definition("LINK/LATENCY_MS", CurveDefinition.make("link_latency_ms", lambda: self.bt_device.link.latency_ms))
+        CurveLibrary.add_definition("LINK/THROUGHPUT_BPS", CurveDefinition.make("link_throughput_bps", lambda: self.bt_device.link.throughput_bps))
         CurveLibrary.add_definition("POS_SETPOINT_MM", CurveDefinition.make("pos_setpoint_mm", lambda: self.bt_device.tx_data["pos_setpoint_mm"].value))
-        CurveLibrary.parse_data_interface(self.bt_device.rx_data)
+        CurveLibrary.parse_data_interface(self.bt_device.rx_data, self.bt_device.rx_data.samples)
+        CurveLibrary.execute_when_usage_changed(self.update_subscription)
 
         # Add QML sections
         self.status_section = StatusSection(self.ui.status_frame, 0, 0, False, 0)
@@ -89,6 +112,9 @@ class MinSegGUI(QMainWindow):
                 start_signal=self.bt_receive_task.started, stop_signal=self.bt_receive_task.stopped,
                 curves=CurveLibrary.colorize(curve_names)
             )
+        self.update_subscription()
+        min_interval_ms, max_interval_ms = config.TELEMETRY_INTERVAL_LIMITS_MS
+        self.bt_device.tx_data["telemetry_limits"] = {"min_interval_ms": min_interval_ms, "max_interval_ms": max_interval_ms}  # Sent together with the entire tx data on connect
 
     def do_catch_ex_in_statusbar(self, do: Callable[[], None], catch: type[Exception] | list[type[Exception]], header: str = None):
         prepend = ""
@@ -103,9 +129,27 @@ class MinSegGUI(QMainWindow):
             return True
 
     def send_tx_data_state(self):
-        self.bt_device.send(data=self.bt_device.tx_data)
+        self.bt_device.send(data={key: val for key, val in self.bt_device.tx_data.items() if key not in ("parameter_profile", "baud_rate")})  # A profile would replace the parameters, the baud rate is requested by on_baud_rate()
+        self.sent_parameters = self.parameters_snapshot()
         self.status_section.loaded_param_state = 1
 
+    def send_tx_data_state_except_parameters(self):
+        """
+        Sends the entire tx data except for the parameters, which the device loads from its EEPROM. They are only sent once the device reported the CRC of its stored parameters,
+        if those differ from the parameters of the GUI. c.f. on_parameters_crc()
+        """
+        self.bt_device.send(data={key: val for key, val in self.bt_device.tx_data.items() if key not in ("parameters", "parameter_profile", "baud_rate")})
+        self.parameters_check_pending = True
+
+    def update_subscription(self):
+        """
+        Subscribes to the values of the curves in use, so the device only transmits those. The subscription is sent together with the entire tx data on connect.
+        """
+        keys = CurveLibrary.used_interface_keys() | self.ALWAYS_SUBSCRIBED_KEYS
+        self.bt_device.tx_data["subscription"] = self.bt_device.rx_data.BINARY_LAYOUT.channel_flags(keys)
+        if self.bt_receive_task.is_active:
+            self.do_catch_ex_in_statusbar(lambda: self.bt_device.send(key="subscription"), [self.bt_device.NotConnectedError, ConnectionAbortedError], "Failed to Send Subscription")
+
     def on_bt_connect(self):
         self.ui.actionConnect.setEnabled(False)
         self.ui.statusbar.addWidget(self.bt_connect_label)
@@ -129,8 +173,10 @@ class MinSegGUI(QMainWindow):
 
         # Start receiving
         self.bt_receive_task.start()
+        self.link_timer.start()
+        self.baud_rate_requested = False
 
-        self.ui.actionTransmitState.trigger()
+        self.send_tx_data_state_except_parameters()
 
     def on_bt_connection_failed(self, exception: Exception):
         self.ui.statusbar.removeWidget(self.bt_connect_label)
@@ -141,6 +187,8 @@ class MinSegGUI(QMainWindow):
 
     def on_bt_disconnect(self):
         self.bt_receive_task.stop()
+        self.link_timer.stop()
+        self.link_label.clear()
         self.status_section.control_switch_state = False
 
         self.bt_device.disconnect()
@@ -154,6 +202,7 @@ class MinSegGUI(QMainWindow):
         self.status_section.connection_state = 0
         self.status_section.calibration_state = 0
         self.status_section.loaded_param_state = 0  # Change state to not yet sent
+        self.parameters_check_pending = False
 
     def on_bt_received(self, received: bytes):
         if not received:
@@ -163,6 +212,39 @@ class MinSegGUI(QMainWindow):
         self.bt_device.rx_data.update_receive_time()  # Update receive timestamp
         self.bt_device.deserialize(received)  # Update RX interface
 
+    def update_link_label(self):
+        link = self.bt_device.link
+        baud_rate = self.bt_device.rx_data["baud_rate"].value
+        self.link_label.setText(f"Link: {baud_rate} Bd, {link.loss_percent:.1f} % lost, {link.latency_ms:.0f} ms latency, {link.throughput_bps / 1000:.1f} kB/s")
+        if link.loss_percent > config.LINK_FALLBACK_LOSS_PERCENT and baud_rate > config.LINK_BAUD_RATES[0] and not self.baud_rate_requested:
+            self.baud_rate_limit = max(rate for rate in config.LINK_BAUD_RATES if rate < baud_rate)
+            self.request_baud_rate(self.baud_rate_limit)
+
+    def on_baud_rate(self, baud_rate: StampedData):
+        """
+        Asks the device once per connection to switch to the configured baud rate, unless a fallback limited it.
+        """
+        target = min(config.LINK_BAUD_RATE, self.baud_rate_limit)
+        if not self.baud_rate_requested and baud_rate.value != 0 and baud_rate.value != target:
+            self.request_baud_rate(target)
+
+    def request_baud_rate(self, baud_rate: int):
+        self.baud_rate_requested = True
+        self.do_catch_ex_in_statusbar(lambda: self.bt_device.send(baud_rate=baud_rate), [self.bt_device.NotConnectedError, ConnectionAbortedError], "Failed to Request Baud Rate")
+
+    def on_baud_rate_switch_pending(self, _arg: int):
+        """
+        The device can only reprogram the HC-06 while no connection is established, so the connection is closed and reopened once the switch is done.
+        """
+        if not self.ui.actionDisconnect.isEnabled():
+            return
+        QTimer.singleShot(0, self.ui.actionDisconnect.trigger)  # Not from within the receive callback
+        QTimer.singleShot(config.LINK_RECONNECT_DELAY_MS, self.ui.actionConnect.trigger)
+
+    def on_baud_rate_fallback(self, baud_rate_100: int):
+        self.baud_rate_limit = min(self.baud_rate_limit, baud_rate_100 * 100)
+        self.on_baud_rate_switch_pending(baud_rate_100)
+
     def on_start_calibration(self):
         self.status_section.calibration_state = 0
         self.bt_device.send(calibration=True)
@@ -179,6 +261,9 @@ class MinSegGUI(QMainWindow):
             self.ui.actionStartCalibration.setEnabled(True)
             return
 
+    def on_calibration_progress(self, progress: StampedData):
+        self.status_section.calibration_progress = progress.value
+
     def on_open_monitor(self):
         new_monitor = MonitoringWindow(self.bt_receive_task.is_active, self.bt_receive_task.started, self.bt_receive_task.stopped)
         new_monitor.destroyed.connect(lambda: self.monitors.remove(new_monitor))
@@ -202,7 +287,7 @@ class MinSegGUI(QMainWindow):
             self.parameter_section.loaded_changed.emit(parameters["variable"])  # Emit the signal now manually
 
             self.update_parameters("inferred", parameters["inferred"])
-            self.send_parameters()
+            self.send_parameters_or_profile()
 
     def save_parameters(self):
         path, _ = QFileDialog.getSaveFileName(self, "Save Parameters", str(config.PARAMETERS_DIR), "JSON (*.json)")
@@ -220,12 +305,83 @@ class MinSegGUI(QMainWindow):
     def send_parameters(self, subkey: Literal["variable", "inferred"] = None):
         do_send = partial(self.bt_device.send, key="parameters") if subkey is None else partial(self.bt_device.send, key=("parameters", subkey))
         if self.do_catch_ex_in_statusbar(do_send, [self.bt_device.NotConnectedError, ConnectionAbortedError], "Failed to Send Parameters"):
+            self.sent_parameters = self.parameters_snapshot()
+            self.status_section.loaded_param_state = 1
+
+    def send_parameters_or_profile(self):
+        """
+        Selects the profile of the device that holds the parameters of the GUI instead of sending them, which only takes a few bytes. c.f. matching_parameter_profile()
+        """
+        index = self.matching_parameter_profile()
+        if index is None:
+            self.send_parameters()
+            return
+        do_send = partial(self.bt_device.send, parameter_profile=index)
+        if self.do_catch_ex_in_statusbar(do_send, [self.bt_device.NotConnectedError, ConnectionAbortedError], "Failed to Select Parameter Profile"):
+            self.sent_parameters = self.parameters_snapshot()
             self.status_section.loaded_param_state = 1
 
+    def matching_parameter_profile(self) -> int | None:
+        """
+        Returns the index of the profile on the device that holds the parameters of the GUI. The device compiles the files in config.PARAMETERS_DIR into profiles in the order of their names
+        and reports the CRC over their names and contents, so the profiles are only used if they were compiled from the same files as the GUI has (c.f. controller/src/profiles.hpp).
+        """
+        device_crc = self.bt_device.rx_data["parameter_profiles_crc"]
+        if device_crc.timestamp is None:
+            return None
+        crc = 0
+        contents = []
+        for name in sorted(path.name for path in config.PARAMETERS_DIR.glob("*.json")):
+            content = (config.PARAMETERS_DIR / name).read_bytes()
+            crc = binascii.crc_hqx(name.encode() + content, crc)
+            contents.append(content)
+        if crc != device_crc.value:
+            return None
+        parameters = self.parameters_snapshot()
+        for index, content in enumerate(contents):
+            try:
+                if json.loads(content) == parameters:
+                    return index
+            except ValueError:
+                continue
+        return None
+
     def update_parameters(self, subkey: Literal["variable", "inferred"], changed: dict):
         self.bt_device.tx_data["parameters", subkey].update(changed)
+        self.parameters_changed = True
         self.status_section.loaded_param_state = 0  # Change state to not yet sent
 
+    def parameters_snapshot(self) -> dict:
+        return json.loads(json.dumps(self.bt_device.tx_data["parameters"], cls=DataInterface.JSONEncoder))
+
+    def on_parameters_crc(self, crc: StampedData):
+        """
+        Sends the parameters after connecting, unless the device stored the same ones before. The GUI can't calculate the CRC of the stored parameters itself, since the device
+        rounds them to float when parsing, so the CRC the device reported after storing them is remembered together with the parameters in config.DEVICE_PARAMETERS_PATH.
+        If no parameters were loaded or edited in the GUI, the device keeps its stored parameters.
+        """
+        if not self.parameters_check_pending:
+            return
+        self.parameters_check_pending = False
+
+        if not self.parameters_changed:
+            self.ui.statusbar.showMessage("The device uses its stored parameters", 3000)
+            return
+        try:
+            stored = json.loads(config.DEVICE_PARAMETERS_PATH.read_text())
+        except (OSError, ValueError):
+            stored = {}
+        if stored.get("crc") == crc.value and stored.get("parameters") == self.parameters_snapshot():
+            self.ui.statusbar.showMessage("The parameters stored on the device are up to date", 3000)
+            self.status_section.loaded_param_state = 1
+        else:
+            self.send_parameters_or_profile()
+
+    def on_parameters_stored(self, crc: int):
+        if self.sent_parameters is not None:
+            config.DEVICE_PARAMETERS_PATH.write_text(json.dumps({"crc": crc, "parameters": self.sent_parameters}, indent=2))
+            self.sent_parameters = None
+
     def on_control_state_change(self, state: bool):
         self.do_catch_ex_in_statusbar(lambda: self.bt_device.send(control_state=state), [self.bt_device.NotConnectedError, ConnectionAbortedError], "Failed to Send Control State Change")
         if not state:
@@ -9,7 +9,7 @@ from pathlib import Path
 from application.helper import KeepMenuOpen
 from application.plotting import MonitoringGraph, GraphDict, CurveLibrary, CurveDefinition, ColouredCurve
 from resources.monitoring_window_ui import Ui_MonitoringWindow
-from PySide6.QtGui import QAction
+from PySide6.QtGui import QAction, QCloseEvent
 from PySide6.QtWidgets import QMainWindow, QFileDialog
 from PySide6.QtCore import Qt, QTime, SignalInstance
 
@@ -110,3 +110,9 @@ class MonitoringWindow(QMainWindow):
             if Path(path).suffix != '.csv':
                 path += '.csv'
             df.to_csv(path)
+
+    def closeEvent(self, event: QCloseEvent):
+        for graph_id in list(self.graphs):
+            del self.graphs[graph_id]  # Releases the curves, so the device stops transmitting values no other graph needs
+
+        super().closeEvent(event)
@@ -6,6 +6,12 @@ HC06_BLUETOOTH_ADDRESS = "98:D3:A1:FD:34:63"
 JSON_INTERFACE_DEFINITION_PATH = Path(__file__).parent.parent / "interface.json"
 DEFAULT_RECORDING_DIR = Path(__file__).parent.parent / "recording"
 PARAMETERS_DIR = Path(__file__).parent.parent / "data" / "parameters"
+DEVICE_PARAMETERS_PATH = Path(__file__).parent.parent / "data" / "device_parameters.json"  # The parameters the device stored last and their CRC
+TELEMETRY_INTERVAL_LIMITS_MS = (6, 200)  # Range the device adapts its telemetry interval in to the link occupancy, 0 selects the default of the device
+LINK_BAUD_RATES = (115200, 230400)  # Baud rates the device supports between the Arduino and the HC-06, in ascending order
+LINK_BAUD_RATE = 115200  # Baud rate the device is asked to switch to on connect. The Arduino runs 230400 baud 3.5 % too slow, c.f. BaudRateSwitch of the controller
+LINK_FALLBACK_LOSS_PERCENT = 5  # The next lower baud rate is requested if more packets are lost
+LINK_RECONNECT_DELAY_MS = 8000  # Time the device takes to reprogram the HC-06 and to verify or revert the new rate after the connection was closed for a baud rate switch
 
 
 class Parameters(QObject):
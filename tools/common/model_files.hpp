@@ -0,0 +1,71 @@
+#ifndef MODEL_FILES_HPP
+#define MODEL_FILES_HPP
+
+/*
+Loading of the plant model in data/model and the parameter sets in data/parameters for the host tools.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "interface.hpp"
+#include "parser.hpp"
+
+typedef std::vector<std::vector<double>> Matrix;
+
+// Discrete plant model: x(k+1) = Phi * x(k) + Gamma * u(k), y(k) = C * x(k) with the sampling time h_s
+struct PlantModel {
+  Matrix phi;
+  Matrix gamma;
+  Matrix c;
+  double h_s = 0;
+};
+
+// Reads a comma separated matrix as it is exported to data/model
+inline bool read_matrix(const std::string &path, Matrix &matrix) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) continue;
+    std::vector<double> row;
+    std::stringstream line_stream(line);
+    std::string cell;
+    while (std::getline(line_stream, cell, ',')) row.push_back(std::stod(cell));
+    matrix.push_back(row);
+  }
+  return true;
+}
+
+inline bool read_plant_model(const std::string &model_dir, PlantModel &model) {
+  Matrix h;
+  if (!read_matrix(model_dir + "/Phi.dat", model.phi) || !read_matrix(model_dir + "/Gamma.dat", model.gamma) || !read_matrix(model_dir + "/C.dat", model.c)
+      || !read_matrix(model_dir + "/h.dat", h) || h.empty() || h[0].empty()) {
+    return false;
+  }
+  model.h_s = h[0][0];
+  return true;
+}
+
+// Loads a parameter file of data/parameters into rx the same way the controller receives it from the GUI
+inline bool read_parameters(const std::string &path, ReceiveInterface &rx) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::stringstream content;
+  content << "{\"parameters\":" << file.rdbuf() << "}";
+  const std::string json = content.str();
+
+  rx = ReceiveInterface();
+  ReceiveParser parser(rx);
+  parser.feed(json.data(), json.size());
+  const ReceiveParser::Error err = parser.finish();
+  if (err != ReceiveParser::OK) {
+    std::printf("%s: parser error %d\n", path.c_str(), (int)err);
+    return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+Host side check of the fixed point control kernel against the floating point one.
+
+Each parameter set is loaded through the generated ReceiveInterface the same way the controller does it.
+The discrete plant model in data/model is then controlled in closed loop by a double precision kernel, which serves as reference.
+A fixed point kernel and a single precision kernel (which is what double means on AVR) are fed with the very same measurements and setpoints.
+The check fails if the control signal of the fixed point kernel deviates from the reference by more than half a motor PWM step.
+
+Build with the CMake project in tools and run from the repository root (requires the ArduinoJson submodule):
+  cmake -S tools -B tools/build && cmake --build tools/build
+  tools/build/fixed_point_check data/model data/parameters/opti_with_i_with_ff.json ...
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include "interface.hpp"
+#include "kernel.hpp"
+#include "model_files.hpp"
+#include "period.hpp"
+
+const double WHEEL_MM_TO_RAD = 2 * M_PI / 130.0;
+const double MOTOR_SATURATION_V = 9;
+const double MAX_CONTROL_SIGNAL_ERROR_V = MOTOR_SATURATION_V / 255 / 2;  // Half a motor PWM step
+const double FALLEN_TILT_ANGLE_RAD = 0.5;
+const int SIMULATION_CYCLES = 5000;
+const int SETPOINT_STEP_CYCLE = 1000;
+const double SETPOINT_STEP_MM = 100;
+const double INITIAL_TILT_ANGLE_RAD = 0.02;
+const double SENSOR_NOISE_AMPLITUDE = 1e-3;
+
+typedef ControlKernel<FloatingPointArithmetic<double>> ReferenceKernel;
+typedef ControlKernel<FloatingPointArithmetic<float>> SinglePrecisionKernel;
+typedef ControlKernel<FixedPointArithmetic<CONTROL_COEFF_FRAC_BITS, CONTROL_SIGNAL_FRAC_BITS>> FixedPointKernel;
+
+struct Deviation {
+  double u = 0;
+  double x = 0;
+};
+
+static void update(Deviation &deviation, double u, double u_ref, const double x[4], const double x_ref[4]) {
+  deviation.u = std::fmax(deviation.u, std::fabs(u - u_ref));
+  for (int i = 0; i < 4; i++) deviation.x = std::fmax(deviation.x, std::fabs(x[i] - x_ref[i]));
+}
+
+static bool check(const std::string &path, const PlantModel &model) {
+  ReceiveInterface rx;
+  if (!read_parameters(path, rx)) return false;
+  double h_s = control_period_ms(rx.parameters.variable.General.h_ms) * 1e-3;
+
+  ReferenceKernel reference;
+  SinglePrecisionKernel single;
+  FixedPointKernel fixed;
+  reference.parameters.compile(rx.parameters, h_s);
+  single.parameters.compile(rx.parameters, h_s);
+  fixed.parameters.compile(rx.parameters, h_s);
+
+  double x_plant[4] = { 0, INITIAL_TILT_ANGLE_RAD, 0, 0 };
+  uint32_t noise_state = 1;
+  Deviation single_deviation, fixed_deviation;
+  int cycles = 0;
+  double u_max = 0;
+
+  for (; cycles < SIMULATION_CYCLES && std::fabs(x_plant[1]) < FALLEN_TILT_ANGLE_RAD; cycles++) {
+    double y[3];
+    for (int i = 0; i < 3; i++) {
+      noise_state = noise_state * 1664525UL + 1013904223UL;  // Deterministic pseudo random numbers
+      y[i] = SENSOR_NOISE_AMPLITUDE * (2.0 * noise_state / UINT32_MAX - 1);
+      for (int j = 0; j < 4; j++) y[i] += model.c[i][j] * x_plant[j];
+    }
+    double r = -(cycles >= SETPOINT_STEP_CYCLE ? SETPOINT_STEP_MM : 0) * WHEEL_MM_TO_RAD;
+
+    reference.step(y[0], y[1], y[2], r, true);
+    single.step(y[0], y[1], y[2], r, true);
+    fixed.step(FixedPointKernel::Signal::from_double(y[0]), FixedPointKernel::Signal::from_double(y[1]), FixedPointKernel::Signal::from_double(y[2]), FixedPointKernel::Signal::from_double(r), true);
+
+    double x_single[4], x_fixed[4];
+    for (int i = 0; i < 4; i++) {
+      x_single[i] = single.x_corr[i];
+      x_fixed[i] = fixed.x_corr[i].to_double();
+    }
+    update(single_deviation, single.u, reference.u, x_single, reference.x_corr);
+    update(fixed_deviation, fixed.u.to_double(), reference.u, x_fixed, reference.x_corr);
+
+    // Plant is driven by the reference kernel with the motor voltage saturation
+    double u = std::fmax(-MOTOR_SATURATION_V, std::fmin(MOTOR_SATURATION_V, reference.u));
+    u_max = std::fmax(u_max, std::fabs(reference.u));
+    double x_next[4];
+    for (int i = 0; i < 4; i++) {
+      x_next[i] = model.gamma[i][0] * u;
+      for (int j = 0; j < 4; j++) x_next[i] += model.phi[i][j] * x_plant[j];
+    }
+    for (int i = 0; i < 4; i++) x_plant[i] = x_next[i];
+  }
+
+  bool passed = fixed_deviation.u <= MAX_CONTROL_SIGNAL_ERROR_V;
+  std::printf("%-50s %5d cycles%s  max|u| %8.3f V  fixed: du %.2e V dx %.2e  float: du %.2e V dx %.2e  %s\n",
+              path.c_str(), cycles, cycles < SIMULATION_CYCLES ? " (fallen)" : "", u_max,
+              fixed_deviation.u, fixed_deviation.x, single_deviation.u, single_deviation.x, passed ? "PASS" : "FAIL");
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::printf("Usage: %s <model directory> <parameter files...>\n", argv[0]);
+    return 2;
+  }
+
+  PlantModel model;
+  if (!read_plant_model(argv[1], model)) {
+    std::printf("Could not read the plant model from %s\n", argv[1]);
+    return 2;
+  }
+
+  std::printf("Maximum tolerated control signal deviation: %.2e V\n", MAX_CONTROL_SIGNAL_ERROR_V);
+  bool passed = true;
+  for (int i = 2; i < argc; i++) passed &= check(argv[i], model);
+  return passed ? 0 : 1;
+}
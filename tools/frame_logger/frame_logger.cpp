@@ -0,0 +1,113 @@
+/*
+Logger of the packets sent by the controller, which keeps up with the telemetry of every control cycle.
+
+The byte stream of the controller is read from a serial port (e.g. /dev/rfcomm0 or \\.\COM5 of the Bluetooth module) or from a previous log. Every complete packet is appended
+to the output file as it was received, so a log can be read again by this logger or anything else that decodes the packets. The chunks are read into the buffer of the FrameDecoder
+and the packets are written from there, so the data isn't copied. Bytes between packets are dropped. The packets per type, the binary packets whose CRC doesn't match and the packets missing
+in the sequence are counted and printed to stderr every few seconds and at the end of the input.
+With --subscribe, a packet that subscribes all telemetry channels is sent to the controller first, so the input must be a serial port in that case.
+With --record, the controller is asked to send record batches of the inputs and outputs of every control step instead of sample batches, which tools/replay replays offline.
+The controller records until the GUI connects again, which sends recording as false.
+
+Build with the CMake project in tools and run e.g.:
+  tools/build/frame_logger --subscribe /dev/rfcomm0 telemetry.log
+  tools/build/frame_logger --record /dev/rfcomm0 run.log
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "protocol.hpp"
+
+const size_t READ_CHUNK_SIZE = 512;  // Short enough that the statistics are updated regularly at the byte rate of the serial link
+const double STATISTICS_INTERVAL_S = 5;
+
+struct Statistics {
+  uint64_t packets[256] = {};
+  uint64_t crc_errors = 0;
+  uint64_t lost = 0;
+  uint64_t bytes = 0;
+  bool sequence_valid = false;
+  uint16_t last_sequence = 0;
+};
+
+static void print_statistics(const Statistics &stats, const host::FrameDecoder &decoder) {
+  std::fprintf(stderr, "%llu bytes logged: %llu J, %llu B, %llu S, %llu R, %llu P packets, %llu CRC errors, %llu lost, %llu bytes skipped\n", (unsigned long long)stats.bytes,
+               (unsigned long long)stats.packets[host::JSON_PACKET], (unsigned long long)stats.packets[host::BINARY_TELEMETRY_PACKET],
+               (unsigned long long)stats.packets[host::SAMPLE_BATCH_PACKET], (unsigned long long)stats.packets[host::RECORD_BATCH_PACKET], (unsigned long long)stats.packets[host::PROFILE_PACKET],
+               (unsigned long long)stats.crc_errors, (unsigned long long)stats.lost, (unsigned long long)decoder.skipped_bytes());
+}
+
+int main(int argc, char **argv) {
+  bool subscribe = false;
+  bool record = false;
+  int arg = 1;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; arg++) {
+    if (std::strcmp(argv[arg], "--subscribe") == 0) subscribe = true;
+    else if (std::strcmp(argv[arg], "--record") == 0) record = true;
+    else break;
+  }
+  if (argc - arg != 2) {
+    std::printf("Usage: %s [--subscribe] [--record] <serial port or log file> <output file>\n", argv[0]);
+    return 2;
+  }
+  const char *input_path = argv[arg];
+  const char *output_path = argv[arg + 1];
+  const bool send = subscribe || record;
+
+  std::FILE *input = std::fopen(input_path, send ? "r+b" : "rb");
+  if (!input) {
+    std::printf("Could not open %s\n", input_path);
+    return 2;
+  }
+  std::setvbuf(input, nullptr, _IONBF, 0);  // The decoder buffers the data itself
+  std::FILE *output = std::fopen(output_path, "ab");
+  if (!output) {
+    std::printf("Could not open %s\n", output_path);
+    return 2;
+  }
+
+  if (send) {
+    host::ReceiveInterface rx{};
+    rx.subscription = host::TransmitInterface::ALL_CHANNELS;
+    rx.recording = record;
+    const host::ReceiveInterface::MemberFlags members = (subscribe ? host::ReceiveInterface::SUBSCRIPTION : 0) | (record ? host::ReceiveInterface::RECORDING : 0);
+    const std::string packet = host::encode_json_packet(rx.to_json(members));
+    std::fwrite(packet.data(), 1, packet.size(), input);
+    std::fflush(input);
+  }
+
+  static host::FrameDecoder decoder;  // Holds two packets of the maximum size
+  Statistics stats;
+  auto last_print = std::chrono::steady_clock::now();
+  while (true) {
+    uint8_t *dest = decoder.write_pointer();
+    const size_t read = std::fread(dest, 1, std::min(decoder.write_space(), READ_CHUNK_SIZE), input);
+    if (read == 0) break;
+    decoder.commit(read);
+
+    host::Frame frame;
+    while (decoder.next(frame)) {
+      std::fwrite(frame.packet, 1, frame.size(), output);
+      stats.packets[frame.type]++;
+      stats.bytes += frame.size();
+      if (!frame.crc_valid()) stats.crc_errors++;
+      if (stats.sequence_valid) stats.lost += (uint16_t)(frame.sequence - stats.last_sequence - 1);
+      stats.sequence_valid = true;
+      stats.last_sequence = frame.sequence;
+    }
+    std::fflush(output);  // Nothing is lost if the logger is killed
+
+    const auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - last_print).count() >= STATISTICS_INTERVAL_S) {
+      print_statistics(stats, decoder);
+      last_print = now;
+    }
+  }
+  print_statistics(stats, decoder);
+
+  std::fclose(output);
+  std::fclose(input);
+  return 0;
+}
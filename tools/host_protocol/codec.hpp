@@ -0,0 +1,196 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+/*
+Framing of the serial protocol of the controller for host programs, which doesn't depend on the Arduino core or ArduinoJson.
+A packet is the start token '$', the packet type, the payload length (2 bytes, big endian), the sequence number (2 bytes, big endian), the time in µs at which the controller
+started transmitting it (4 bytes, big endian) and the payload. c.f. Communication in controller/src/communication/comm.hpp.
+Packets to the controller have no sequence number and timestamp (c.f. encode_json_packet()).
+The binary payloads are little endian and end with a CRC-16/XMODEM of the preceding payload bytes.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace host {
+
+// Must match Communication::PacketType of the controller
+enum PacketType : uint8_t {
+  JSON_PACKET = 'J',
+  BINARY_TELEMETRY_PACKET = 'B',
+  SAMPLE_BATCH_PACKET = 'S',
+  RECORD_BATCH_PACKET = 'R',
+  PROFILE_PACKET = 'P',
+};
+
+const uint8_t PACKET_START_TOKEN = '$';
+const size_t PACKET_HEADER_SIZE = 10;  // Start token (1 byte) + packet type (1 byte) + payload length (2 bytes) + sequence number (2 bytes) + timestamp (4 bytes)
+const size_t PACKET_MAX_SIZE = PACKET_HEADER_SIZE + UINT16_MAX;
+const size_t CRC_SIZE = 2;
+
+inline bool is_packet_type(uint8_t type) {
+  return type == JSON_PACKET || type == BINARY_TELEMETRY_PACKET || type == SAMPLE_BATCH_PACKET || type == RECORD_BATCH_PACKET || type == PROFILE_PACKET;
+}
+
+// Same as _crc_xmodem_update() of avr-libc, which the controller uses, and binascii.crc_hqx() of the GUI
+inline uint16_t crc16_xmodem(const uint8_t *data, size_t size, uint16_t crc = 0) {
+  for (size_t i = 0; i < size; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Packet as it was received. The pointers refer to the buffer of the FrameDecoder and stay valid until data is written to it again.
+struct Frame {
+  PacketType type;
+  const uint8_t *packet;   // Start of the header
+  const uint8_t *payload;  // Start of the payload
+  uint16_t length;         // Payload length
+  uint16_t sequence;       // Counts the packets sent by the controller, so a gap means that packets were lost
+  uint32_t timestamp_us;   // micros() of the controller when the transmission started
+
+  size_t size() const {
+    return PACKET_HEADER_SIZE + length;
+  }
+
+  // Whether the CRC at the end of a binary payload matches. JSON packets have no CRC.
+  bool crc_valid() const {
+    if (type == JSON_PACKET) return true;
+    if (length < CRC_SIZE) return false;
+    const uint16_t crc = payload[length - 2] | (uint16_t)payload[length - 1] << 8;
+    return crc16_xmodem(payload, length - CRC_SIZE) == crc;
+  }
+};
+
+/*
+Streaming decoder of the received byte stream, which reuses a single buffer that fits two packets of the maximum size.
+The received data is written into the buffer directly by write_pointer() and commit(), or copied by feed(). next() then returns the complete packets without copying them.
+Like the GUI, the decoder resynchronizes on the next start token if a header has an unknown packet type, and the bytes skipped meanwhile are counted.
+*/
+class FrameDecoder {
+  std::vector<uint8_t> buffer;
+  size_t start = 0;  // First byte that wasn't decoded yet
+  size_t end = 0;    // End of the received data
+  uint64_t skipped = 0;
+
+public:
+  FrameDecoder()
+    : buffer(2 * PACKET_MAX_SIZE) {}
+
+  // Space for received data, which is at least PACKET_MAX_SIZE bytes. Invalidates the frames returned before, since the pending data is moved to the front.
+  uint8_t *write_pointer() {
+    if (start > 0) {
+      memmove(buffer.data(), buffer.data() + start, end - start);
+      end -= start;
+      start = 0;
+    }
+    return buffer.data() + end;
+  }
+
+  size_t write_space() const {
+    return buffer.size() - (end - start);
+  }
+
+  // Appends size bytes that were written to write_pointer()
+  void commit(size_t size) {
+    end += size;
+  }
+
+  // Copies as much data as fits in the buffer and returns the number of bytes copied
+  size_t feed(const uint8_t *data, size_t size) {
+    if (size > write_space()) size = write_space();
+    memcpy(write_pointer(), data, size);
+    commit(size);
+    return size;
+  }
+
+  // Returns the next complete packet, if any
+  bool next(Frame &frame) {
+    while (end - start >= PACKET_HEADER_SIZE) {
+      const uint8_t *header = buffer.data() + start;
+      if (header[0] != PACKET_START_TOKEN || !is_packet_type(header[1])) {
+        const void *token = memchr(header + 1, PACKET_START_TOKEN, end - start - 1);
+        const size_t discarded = token ? (const uint8_t *)token - header : end - start;
+        start += discarded;
+        skipped += discarded;
+        continue;
+      }
+      const uint16_t length = (uint16_t)header[2] << 8 | header[3];
+      if (end - start < PACKET_HEADER_SIZE + length) return false;
+
+      frame.type = (PacketType)header[1];
+      frame.packet = header;
+      frame.payload = header + PACKET_HEADER_SIZE;
+      frame.length = length;
+      frame.sequence = (uint16_t)header[4] << 8 | header[5];
+      frame.timestamp_us = (uint32_t)header[6] << 24 | (uint32_t)header[7] << 16 | (uint32_t)header[8] << 8 | header[9];
+      start += frame.size();
+      return true;
+    }
+    return false;
+  }
+
+  // Number of bytes that didn't belong to a packet
+  uint64_t skipped_bytes() const {
+    return skipped;
+  }
+};
+
+// Packs a JSON document, e.g. of ReceiveInterface::to_json(), into a packet for the controller, whose header ends with the payload length
+inline std::string encode_json_packet(const std::string &json) {
+  std::string packet;
+  if (json.size() > UINT16_MAX) return packet;
+  packet += (char)PACKET_START_TOKEN;
+  packet += (char)JSON_PACKET;
+  packet += (char)(json.size() >> 8);
+  packet += (char)(json.size() & 0xFF);
+  packet += json;
+  return packet;
+}
+
+// Writers for the JSON encoding of the generated interfaces. A key is separated by a comma from the previous member of the same object.
+inline void json_key(std::string &json, const char *key) {
+  if (json.back() != '{') json += ',';
+  json += '"';
+  json += key;
+  json += "\":";
+}
+
+inline void json_value(std::string &json, bool value) {
+  json += value ? "true" : "false";
+}
+
+inline void json_value(std::string &json, double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.9g", value);  // Enough digits for the 32 bit floating point numbers of the controller
+  json += text;
+}
+
+inline void json_value(std::string &json, float value) {
+  json_value(json, (double)value);
+}
+
+inline void json_value(std::string &json, const char *value) {
+  json += '"';
+  for (; *value; value++) {
+    if (*value == '"' || *value == '\\') json += '\\';
+    json += *value;
+  }
+  json += '"';
+}
+
+template<typename T>
+inline void json_value(std::string &json, T value) {
+  static_assert(std::is_integral<T>::value, "Unsupported type of an interface member");
+  json += std::to_string(value);
+}
+
+}
+
+#endif
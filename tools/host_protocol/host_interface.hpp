@@ -0,0 +1,893 @@
+// This file is automatically generated. Any changes will be overwritten.
+
+#ifndef HOST_INTERFACE_HPP
+#define HOST_INTERFACE_HPP
+
+#include "binary.hpp"
+#include "codec.hpp"
+
+// Same definitions as in interface.hpp of the controller, which both may be included
+#define BIN_SIZE_TX 107
+#define INTERFACE_SCHEMA_HASH_TX 0x8502D87AUL
+#define BIN_SIZE_SAMPLE 14
+#define INTERFACE_SCHEMA_HASH_SAMPLE 0x8F5D5114UL
+#define BIN_SIZE_RECORD 28
+#define INTERFACE_SCHEMA_HASH_RECORD 0xF9741B05UL
+#define PROFILE_SECTION_COUNT 10
+#define BIN_SIZE_PROFILE 140
+#define INTERFACE_SCHEMA_HASH_PROFILE 0x000B4939UL
+
+namespace host {
+
+enum ProfileSection : uint8_t {
+PROFILE_LOOP,
+PROFILE_RECEIVE,
+PROFILE_PARAMETERS,
+PROFILE_TELEMETRY,
+PROFILE_SAMPLES,
+PROFILE_TRANSMIT,
+PROFILE_STEP,
+PROFILE_MPU,
+PROFILE_KERNEL,
+PROFILE_MOTOR,
+};
+
+enum Event : uint8_t {
+EVENT_PACKET_RECEIVED,
+EVENT_PACKET_RECEIVING,
+EVENT_MESSAGE_EXCEEDS_RX_BUFFER_SIZE,
+EVENT_UNKNOWN_PACKET_TYPE,
+EVENT_DESERIALIZATION_FAILED,
+EVENT_INSUFFICIENT_RECEIVE_RATE,
+EVENT_PREVIOUS_PACKET_INCOMPLETE,
+EVENT_CALIBRATION_STARTED,
+EVENT_CALIBRATION_DONE,
+EVENT_EVENTS_DROPPED,
+EVENT_PARAMETERS_STORED,
+EVENT_PARAMETER_PROFILE_SELECTED,
+EVENT_UNKNOWN_PARAMETER_PROFILE,
+EVENT_BAUD_RATE_SWITCH_PENDING,
+EVENT_BAUD_RATE_SWITCHED,
+EVENT_BAUD_RATE_SWITCH_FAILED,
+EVENT_BAUD_RATE_FALLBACK,
+EVENT_UNSUPPORTED_BAUD_RATE,
+};
+
+// Texts of the events in the order of FROM_DEVICE_EVENTS. {} is replaced by the argument of an event.
+const char *const EVENT_TEXTS[] = {
+"## Packet [{} Bytes] received!",
+"Receiving Packet [{} Bytes] ...",
+"Receive Error: MESSAGE_EXCEEDS_RX_BUFFER_SIZE",
+"Receive Error: UNKNOWN_PACKET_TYPE",
+"Receive Error: DESERIALIZATION_FAILED",
+"Receive Warning: INSUFFICIENT_RECEIVE_RATE",
+"Warning: PREVIOUS_PACKET_INCOMPLETE",
+"Accel Gyro calibration started. Please leave the device still on the flat plane.",
+"Accel Gyro calibration done!",
+"Warning: {} events were dropped",
+"Parameters stored in EEPROM (CRC {})",
+"Parameter profile {} selected",
+"Receive Error: Unknown parameter profile {}",
+"Switching to {}00 baud, the connection is closed meanwhile",
+"Switched to {}00 baud",
+"Baud rate switch failed, keeping {}00 baud",
+"Receive errors at the current baud rate, falling back to {}00 baud",
+"Receive Error: Unsupported baud rate {}00",
+};
+
+struct ReceiveInterface {
+bool calibration;
+bool control_state;
+double pos_setpoint_mm;
+struct {
+struct {
+struct {
+uint16_t h_ms;
+double alpha_off;
+uint8_t m_stop;
+uint8_t m_start;
+} General;
+struct {
+double k1;
+double k2;
+double k3;
+} BalanceControl;
+struct {
+double k4;
+double ki;
+} PositionControl;
+struct {
+uint16_t rate_hz;
+double tau_s;
+} Fusion;
+} variable;
+struct {
+struct {
+struct {
+double l11;
+double l12;
+double l13;
+double l21;
+double l22;
+double l23;
+double l31;
+double l32;
+double l33;
+double l41;
+double l42;
+double l43;
+} gain;
+struct {
+double phi11;
+double phi12;
+double phi13;
+double phi14;
+double phi21;
+double phi22;
+double phi23;
+double phi24;
+double phi31;
+double phi32;
+double phi33;
+double phi34;
+double phi41;
+double phi42;
+double phi43;
+double phi44;
+} phi;
+struct {
+double mx11;
+double mx12;
+double mx13;
+double mx21;
+double mx22;
+double mx23;
+double mx31;
+double mx32;
+double mx33;
+double mx41;
+double mx42;
+double mx43;
+} innoGain;
+} observer;
+struct {
+struct {
+double phi11;
+double phi12;
+double phi13;
+double phi14;
+double phi21;
+double phi22;
+double phi23;
+double phi24;
+double phi31;
+double phi32;
+double phi33;
+double phi34;
+double phi41;
+double phi42;
+double phi43;
+double phi44;
+} phi;
+struct {
+double gam1;
+double gam2;
+double gam3;
+double gam4;
+} gamma;
+struct {
+double k1;
+double k2;
+double k3;
+double k4;
+} Km;
+double Kc;
+} ff;
+} inferred;
+} parameters;
+uint32_t subscription;
+uint8_t parameter_profile;
+struct {
+uint16_t min_interval_ms;
+uint16_t max_interval_ms;
+} telemetry_limits;
+uint32_t baud_rate;
+bool recording;
+
+typedef uint16_t MemberFlags;
+enum Member : MemberFlags {
+CALIBRATION = (1UL << 0),
+CONTROL_STATE = (1UL << 1),
+POS_SETPOINT_MM = (1UL << 2),
+PARAMETERS = (1UL << 3),
+SUBSCRIPTION = (1UL << 4),
+PARAMETER_PROFILE = (1UL << 5),
+TELEMETRY_LIMITS = (1UL << 6),
+BAUD_RATE = (1UL << 7),
+RECORDING = (1UL << 8),
+};
+std::string to_json(MemberFlags members) const;  // Encodes the top level members whose flags are passed, e.g. as payload of encode_json_packet()
+};
+
+struct TransmitInterface {
+struct {
+struct {
+double angle_rad;
+double angle_deriv_rad_s;
+} wheel;
+struct {
+double angle_rad;
+double vel_rad_s;
+} tilt;
+struct {
+uint8_t fifo_samples;
+uint16_t fifo_overflows;
+} mpu;
+} sensor;
+struct {
+struct {
+double angle_rad;
+double vel_rad_s;
+} wheel;
+struct {
+double angle_rad;
+double vel_rad_s;
+} tilt;
+struct {
+double z_mm;
+} position;
+} observer;
+struct {
+struct {
+double angle_rad;
+double vel_rad_s;
+} wheel;
+struct {
+double angle_rad;
+double vel_rad_s;
+} tilt;
+struct {
+double z_mm;
+} position;
+} ff_model;
+struct {
+uint32_t cycle_us;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+} period;
+uint16_t overruns;
+struct {
+double u;
+double u_bal;
+double u_pos;
+double u_ff;
+} signal;
+int16_t motor;
+} control;
+bool calibrated;
+uint8_t calibration_progress;
+uint16_t parameters_crc;
+uint16_t parameter_profiles_crc;
+uint16_t telemetry_interval_ms;
+uint32_t baud_rate;
+
+typedef uint32_t ChannelFlags;
+enum Channel : ChannelFlags {
+SENSOR_WHEEL_ANGLE_RAD = (1UL << 0),
+SENSOR_WHEEL_ANGLE_DERIV_RAD_S = (1UL << 1),
+SENSOR_WHEEL = SENSOR_WHEEL_ANGLE_RAD | SENSOR_WHEEL_ANGLE_DERIV_RAD_S,
+SENSOR_TILT_ANGLE_RAD = (1UL << 2),
+SENSOR_TILT_VEL_RAD_S = (1UL << 3),
+SENSOR_TILT = SENSOR_TILT_ANGLE_RAD | SENSOR_TILT_VEL_RAD_S,
+SENSOR_MPU_FIFO_SAMPLES = (1UL << 4),
+SENSOR_MPU_FIFO_OVERFLOWS = (1UL << 5),
+SENSOR_MPU = SENSOR_MPU_FIFO_SAMPLES | SENSOR_MPU_FIFO_OVERFLOWS,
+SENSOR = SENSOR_WHEEL | SENSOR_TILT | SENSOR_MPU,
+OBSERVER_WHEEL_ANGLE_RAD = (1UL << 6),
+OBSERVER_WHEEL_VEL_RAD_S = (1UL << 7),
+OBSERVER_WHEEL = OBSERVER_WHEEL_ANGLE_RAD | OBSERVER_WHEEL_VEL_RAD_S,
+OBSERVER_TILT_ANGLE_RAD = (1UL << 8),
+OBSERVER_TILT_VEL_RAD_S = (1UL << 9),
+OBSERVER_TILT = OBSERVER_TILT_ANGLE_RAD | OBSERVER_TILT_VEL_RAD_S,
+OBSERVER_POSITION_Z_MM = (1UL << 10),
+OBSERVER_POSITION = OBSERVER_POSITION_Z_MM,
+OBSERVER = OBSERVER_WHEEL | OBSERVER_TILT | OBSERVER_POSITION,
+FF_MODEL_WHEEL_ANGLE_RAD = (1UL << 11),
+FF_MODEL_WHEEL_VEL_RAD_S = (1UL << 12),
+FF_MODEL_WHEEL = FF_MODEL_WHEEL_ANGLE_RAD | FF_MODEL_WHEEL_VEL_RAD_S,
+FF_MODEL_TILT_ANGLE_RAD = (1UL << 13),
+FF_MODEL_TILT_VEL_RAD_S = (1UL << 14),
+FF_MODEL_TILT = FF_MODEL_TILT_ANGLE_RAD | FF_MODEL_TILT_VEL_RAD_S,
+FF_MODEL_POSITION_Z_MM = (1UL << 15),
+FF_MODEL_POSITION = FF_MODEL_POSITION_Z_MM,
+FF_MODEL = FF_MODEL_WHEEL | FF_MODEL_TILT | FF_MODEL_POSITION,
+CONTROL_CYCLE_US = (1UL << 16),
+CONTROL_PERIOD_MIN_US = (1UL << 17),
+CONTROL_PERIOD_MAX_US = (1UL << 18),
+CONTROL_PERIOD_MEAN_US = (1UL << 19),
+CONTROL_PERIOD = CONTROL_PERIOD_MIN_US | CONTROL_PERIOD_MAX_US | CONTROL_PERIOD_MEAN_US,
+CONTROL_OVERRUNS = (1UL << 20),
+CONTROL_SIGNAL_U = (1UL << 21),
+CONTROL_SIGNAL_U_BAL = (1UL << 22),
+CONTROL_SIGNAL_U_POS = (1UL << 23),
+CONTROL_SIGNAL_U_FF = (1UL << 24),
+CONTROL_SIGNAL = CONTROL_SIGNAL_U | CONTROL_SIGNAL_U_BAL | CONTROL_SIGNAL_U_POS | CONTROL_SIGNAL_U_FF,
+CONTROL_MOTOR = (1UL << 25),
+CONTROL = CONTROL_CYCLE_US | CONTROL_PERIOD | CONTROL_OVERRUNS | CONTROL_SIGNAL | CONTROL_MOTOR,
+CALIBRATED = (1UL << 26),
+CALIBRATION_PROGRESS = (1UL << 27),
+PARAMETERS_CRC = (1UL << 28),
+PARAMETER_PROFILES_CRC = (1UL << 29),
+TELEMETRY_INTERVAL_MS = (1UL << 30),
+BAUD_RATE = (1UL << 31),
+ALL_CHANNELS = SENSOR | OBSERVER | FF_MODEL | CONTROL | CALIBRATED | CALIBRATION_PROGRESS | PARAMETERS_CRC | PARAMETER_PROFILES_CRC | TELEMETRY_INTERVAL_MS | BAUD_RATE
+};
+size_t from_bin(const uint8_t *src, ChannelFlags channels);  // Unpacks the channels packed by the controller and returns their size. src must hold bin_size(channels) bytes.
+static size_t bin_size(ChannelFlags channels);
+void sample_from_bin(const uint8_t *src);  // Unpacks only the members listed in FROM_DEVICE_SAMPLE from BIN_SIZE_SAMPLE bytes
+};
+
+// Inputs and outputs of a control step in a record batch packet
+struct RecordInterface {
+struct {
+double tilt_vel_rad_s;
+double tilt_angle_rad;
+double wheel_angle_rad;
+} measurements;
+struct {
+double pos_setpoint_mm;
+bool control_enabled;
+} setpoint;
+bool reset;
+uint32_t cycle_us;
+double u;
+int16_t motor;
+
+void from_bin(const uint8_t *src);  // Unpacks BIN_SIZE_RECORD bytes
+};
+
+// Statistics of the code sections in a profile packet
+struct ProfileInterface {
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} loop;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} receive;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} parameters;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} telemetry;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} samples;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} transmit;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} step;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} mpu;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} kernel;
+struct {
+uint32_t min_us;
+uint32_t max_us;
+uint32_t mean_us;
+uint16_t count;
+} motor;
+
+void from_bin(const uint8_t *src);  // Unpacks BIN_SIZE_PROFILE bytes
+};
+
+inline std::string ReceiveInterface::to_json(MemberFlags members) const {
+std::string json = "{";
+if (members & Member::CALIBRATION) {
+json_key(json, "calibration");
+json_value(json, this->calibration);
+}
+if (members & Member::CONTROL_STATE) {
+json_key(json, "control_state");
+json_value(json, this->control_state);
+}
+if (members & Member::POS_SETPOINT_MM) {
+json_key(json, "pos_setpoint_mm");
+json_value(json, this->pos_setpoint_mm);
+}
+if (members & Member::PARAMETERS) {
+json_key(json, "parameters");
+json += '{';
+json_key(json, "variable");
+json += '{';
+json_key(json, "General");
+json += '{';
+json_key(json, "h_ms");
+json_value(json, this->parameters.variable.General.h_ms);
+json_key(json, "alpha_off");
+json_value(json, this->parameters.variable.General.alpha_off);
+json_key(json, "m_stop");
+json_value(json, this->parameters.variable.General.m_stop);
+json_key(json, "m_start");
+json_value(json, this->parameters.variable.General.m_start);
+json += '}';
+json_key(json, "BalanceControl");
+json += '{';
+json_key(json, "k1");
+json_value(json, this->parameters.variable.BalanceControl.k1);
+json_key(json, "k2");
+json_value(json, this->parameters.variable.BalanceControl.k2);
+json_key(json, "k3");
+json_value(json, this->parameters.variable.BalanceControl.k3);
+json += '}';
+json_key(json, "PositionControl");
+json += '{';
+json_key(json, "k4");
+json_value(json, this->parameters.variable.PositionControl.k4);
+json_key(json, "ki");
+json_value(json, this->parameters.variable.PositionControl.ki);
+json += '}';
+json_key(json, "Fusion");
+json += '{';
+json_key(json, "rate_hz");
+json_value(json, this->parameters.variable.Fusion.rate_hz);
+json_key(json, "tau_s");
+json_value(json, this->parameters.variable.Fusion.tau_s);
+json += '}';
+json += '}';
+json_key(json, "inferred");
+json += '{';
+json_key(json, "observer");
+json += '{';
+json_key(json, "gain");
+json += '{';
+json_key(json, "l11");
+json_value(json, this->parameters.inferred.observer.gain.l11);
+json_key(json, "l12");
+json_value(json, this->parameters.inferred.observer.gain.l12);
+json_key(json, "l13");
+json_value(json, this->parameters.inferred.observer.gain.l13);
+json_key(json, "l21");
+json_value(json, this->parameters.inferred.observer.gain.l21);
+json_key(json, "l22");
+json_value(json, this->parameters.inferred.observer.gain.l22);
+json_key(json, "l23");
+json_value(json, this->parameters.inferred.observer.gain.l23);
+json_key(json, "l31");
+json_value(json, this->parameters.inferred.observer.gain.l31);
+json_key(json, "l32");
+json_value(json, this->parameters.inferred.observer.gain.l32);
+json_key(json, "l33");
+json_value(json, this->parameters.inferred.observer.gain.l33);
+json_key(json, "l41");
+json_value(json, this->parameters.inferred.observer.gain.l41);
+json_key(json, "l42");
+json_value(json, this->parameters.inferred.observer.gain.l42);
+json_key(json, "l43");
+json_value(json, this->parameters.inferred.observer.gain.l43);
+json += '}';
+json_key(json, "phi");
+json += '{';
+json_key(json, "phi11");
+json_value(json, this->parameters.inferred.observer.phi.phi11);
+json_key(json, "phi12");
+json_value(json, this->parameters.inferred.observer.phi.phi12);
+json_key(json, "phi13");
+json_value(json, this->parameters.inferred.observer.phi.phi13);
+json_key(json, "phi14");
+json_value(json, this->parameters.inferred.observer.phi.phi14);
+json_key(json, "phi21");
+json_value(json, this->parameters.inferred.observer.phi.phi21);
+json_key(json, "phi22");
+json_value(json, this->parameters.inferred.observer.phi.phi22);
+json_key(json, "phi23");
+json_value(json, this->parameters.inferred.observer.phi.phi23);
+json_key(json, "phi24");
+json_value(json, this->parameters.inferred.observer.phi.phi24);
+json_key(json, "phi31");
+json_value(json, this->parameters.inferred.observer.phi.phi31);
+json_key(json, "phi32");
+json_value(json, this->parameters.inferred.observer.phi.phi32);
+json_key(json, "phi33");
+json_value(json, this->parameters.inferred.observer.phi.phi33);
+json_key(json, "phi34");
+json_value(json, this->parameters.inferred.observer.phi.phi34);
+json_key(json, "phi41");
+json_value(json, this->parameters.inferred.observer.phi.phi41);
+json_key(json, "phi42");
+json_value(json, this->parameters.inferred.observer.phi.phi42);
+json_key(json, "phi43");
+json_value(json, this->parameters.inferred.observer.phi.phi43);
+json_key(json, "phi44");
+json_value(json, this->parameters.inferred.observer.phi.phi44);
+json += '}';
+json_key(json, "innoGain");
+json += '{';
+json_key(json, "mx11");
+json_value(json, this->parameters.inferred.observer.innoGain.mx11);
+json_key(json, "mx12");
+json_value(json, this->parameters.inferred.observer.innoGain.mx12);
+json_key(json, "mx13");
+json_value(json, this->parameters.inferred.observer.innoGain.mx13);
+json_key(json, "mx21");
+json_value(json, this->parameters.inferred.observer.innoGain.mx21);
+json_key(json, "mx22");
+json_value(json, this->parameters.inferred.observer.innoGain.mx22);
+json_key(json, "mx23");
+json_value(json, this->parameters.inferred.observer.innoGain.mx23);
+json_key(json, "mx31");
+json_value(json, this->parameters.inferred.observer.innoGain.mx31);
+json_key(json, "mx32");
+json_value(json, this->parameters.inferred.observer.innoGain.mx32);
+json_key(json, "mx33");
+json_value(json, this->parameters.inferred.observer.innoGain.mx33);
+json_key(json, "mx41");
+json_value(json, this->parameters.inferred.observer.innoGain.mx41);
+json_key(json, "mx42");
+json_value(json, this->parameters.inferred.observer.innoGain.mx42);
+json_key(json, "mx43");
+json_value(json, this->parameters.inferred.observer.innoGain.mx43);
+json += '}';
+json += '}';
+json_key(json, "ff");
+json += '{';
+json_key(json, "phi");
+json += '{';
+json_key(json, "phi11");
+json_value(json, this->parameters.inferred.ff.phi.phi11);
+json_key(json, "phi12");
+json_value(json, this->parameters.inferred.ff.phi.phi12);
+json_key(json, "phi13");
+json_value(json, this->parameters.inferred.ff.phi.phi13);
+json_key(json, "phi14");
+json_value(json, this->parameters.inferred.ff.phi.phi14);
+json_key(json, "phi21");
+json_value(json, this->parameters.inferred.ff.phi.phi21);
+json_key(json, "phi22");
+json_value(json, this->parameters.inferred.ff.phi.phi22);
+json_key(json, "phi23");
+json_value(json, this->parameters.inferred.ff.phi.phi23);
+json_key(json, "phi24");
+json_value(json, this->parameters.inferred.ff.phi.phi24);
+json_key(json, "phi31");
+json_value(json, this->parameters.inferred.ff.phi.phi31);
+json_key(json, "phi32");
+json_value(json, this->parameters.inferred.ff.phi.phi32);
+json_key(json, "phi33");
+json_value(json, this->parameters.inferred.ff.phi.phi33);
+json_key(json, "phi34");
+json_value(json, this->parameters.inferred.ff.phi.phi34);
+json_key(json, "phi41");
+json_value(json, this->parameters.inferred.ff.phi.phi41);
+json_key(json, "phi42");
+json_value(json, this->parameters.inferred.ff.phi.phi42);
+json_key(json, "phi43");
+json_value(json, this->parameters.inferred.ff.phi.phi43);
+json_key(json, "phi44");
+json_value(json, this->parameters.inferred.ff.phi.phi44);
+json += '}';
+json_key(json, "gamma");
+json += '{';
+json_key(json, "gam1");
+json_value(json, this->parameters.inferred.ff.gamma.gam1);
+json_key(json, "gam2");
+json_value(json, this->parameters.inferred.ff.gamma.gam2);
+json_key(json, "gam3");
+json_value(json, this->parameters.inferred.ff.gamma.gam3);
+json_key(json, "gam4");
+json_value(json, this->parameters.inferred.ff.gamma.gam4);
+json += '}';
+json_key(json, "Km");
+json += '{';
+json_key(json, "k1");
+json_value(json, this->parameters.inferred.ff.Km.k1);
+json_key(json, "k2");
+json_value(json, this->parameters.inferred.ff.Km.k2);
+json_key(json, "k3");
+json_value(json, this->parameters.inferred.ff.Km.k3);
+json_key(json, "k4");
+json_value(json, this->parameters.inferred.ff.Km.k4);
+json += '}';
+json_key(json, "Kc");
+json_value(json, this->parameters.inferred.ff.Kc);
+json += '}';
+json += '}';
+json += '}';
+}
+if (members & Member::SUBSCRIPTION) {
+json_key(json, "subscription");
+json_value(json, this->subscription);
+}
+if (members & Member::PARAMETER_PROFILE) {
+json_key(json, "parameter_profile");
+json_value(json, this->parameter_profile);
+}
+if (members & Member::TELEMETRY_LIMITS) {
+json_key(json, "telemetry_limits");
+json += '{';
+json_key(json, "min_interval_ms");
+json_value(json, this->telemetry_limits.min_interval_ms);
+json_key(json, "max_interval_ms");
+json_value(json, this->telemetry_limits.max_interval_ms);
+json += '}';
+}
+if (members & Member::BAUD_RATE) {
+json_key(json, "baud_rate");
+json_value(json, this->baud_rate);
+}
+if (members & Member::RECORDING) {
+json_key(json, "recording");
+json_value(json, this->recording);
+}
+json += '}';
+return json;
+}
+
+inline size_t TransmitInterface::from_bin(const uint8_t *src, ChannelFlags channels) {
+size_t size = 0;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_RAD) {
+this->sensor.wheel.angle_rad = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::SENSOR_WHEEL_ANGLE_DERIV_RAD_S) {
+this->sensor.wheel.angle_deriv_rad_s = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::SENSOR_TILT_ANGLE_RAD) {
+this->sensor.tilt.angle_rad = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::SENSOR_TILT_VEL_RAD_S) {
+this->sensor.tilt.vel_rad_s = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::SENSOR_MPU_FIFO_SAMPLES) {
+this->sensor.mpu.fifo_samples = bin_read<uint8_t>(src + size);
+size += 1;
+}
+if (channels & Channel::SENSOR_MPU_FIFO_OVERFLOWS) {
+this->sensor.mpu.fifo_overflows = bin_read<uint16_t>(src + size);
+size += 2;
+}
+if (channels & Channel::OBSERVER_WHEEL_ANGLE_RAD) {
+this->observer.wheel.angle_rad = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::OBSERVER_WHEEL_VEL_RAD_S) {
+this->observer.wheel.vel_rad_s = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::OBSERVER_TILT_ANGLE_RAD) {
+this->observer.tilt.angle_rad = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::OBSERVER_TILT_VEL_RAD_S) {
+this->observer.tilt.vel_rad_s = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::OBSERVER_POSITION_Z_MM) {
+this->observer.position.z_mm = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_WHEEL_ANGLE_RAD) {
+this->ff_model.wheel.angle_rad = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_WHEEL_VEL_RAD_S) {
+this->ff_model.wheel.vel_rad_s = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_TILT_ANGLE_RAD) {
+this->ff_model.tilt.angle_rad = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_TILT_VEL_RAD_S) {
+this->ff_model.tilt.vel_rad_s = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::FF_MODEL_POSITION_Z_MM) {
+this->ff_model.position.z_mm = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_CYCLE_US) {
+this->control.cycle_us = bin_read<uint32_t>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_PERIOD_MIN_US) {
+this->control.period.min_us = bin_read<uint32_t>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_PERIOD_MAX_US) {
+this->control.period.max_us = bin_read<uint32_t>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_PERIOD_MEAN_US) {
+this->control.period.mean_us = bin_read<uint32_t>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_OVERRUNS) {
+this->control.overruns = bin_read<uint16_t>(src + size);
+size += 2;
+}
+if (channels & Channel::CONTROL_SIGNAL_U) {
+this->control.signal.u = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_SIGNAL_U_BAL) {
+this->control.signal.u_bal = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_SIGNAL_U_POS) {
+this->control.signal.u_pos = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_SIGNAL_U_FF) {
+this->control.signal.u_ff = bin_read<float>(src + size);
+size += 4;
+}
+if (channels & Channel::CONTROL_MOTOR) {
+this->control.motor = bin_read<int16_t>(src + size);
+size += 2;
+}
+if (channels & Channel::CALIBRATED) {
+this->calibrated = bin_read<bool>(src + size);
+size += 1;
+}
+if (channels & Channel::CALIBRATION_PROGRESS) {
+this->calibration_progress = bin_read<uint8_t>(src + size);
+size += 1;
+}
+if (channels & Channel::PARAMETERS_CRC) {
+this->parameters_crc = bin_read<uint16_t>(src + size);
+size += 2;
+}
+if (channels & Channel::PARAMETER_PROFILES_CRC) {
+this->parameter_profiles_crc = bin_read<uint16_t>(src + size);
+size += 2;
+}
+if (channels & Channel::TELEMETRY_INTERVAL_MS) {
+this->telemetry_interval_ms = bin_read<uint16_t>(src + size);
+size += 2;
+}
+if (channels & Channel::BAUD_RATE) {
+this->baud_rate = bin_read<uint32_t>(src + size);
+size += 4;
+}
+return size;
+}
+
+inline size_t TransmitInterface::bin_size(ChannelFlags channels) {
+size_t size = 0;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_RAD) size += 4;
+if (channels & Channel::SENSOR_WHEEL_ANGLE_DERIV_RAD_S) size += 4;
+if (channels & Channel::SENSOR_TILT_ANGLE_RAD) size += 4;
+if (channels & Channel::SENSOR_TILT_VEL_RAD_S) size += 4;
+if (channels & Channel::SENSOR_MPU_FIFO_SAMPLES) size += 1;
+if (channels & Channel::SENSOR_MPU_FIFO_OVERFLOWS) size += 2;
+if (channels & Channel::OBSERVER_WHEEL_ANGLE_RAD) size += 4;
+if (channels & Channel::OBSERVER_WHEEL_VEL_RAD_S) size += 4;
+if (channels & Channel::OBSERVER_TILT_ANGLE_RAD) size += 4;
+if (channels & Channel::OBSERVER_TILT_VEL_RAD_S) size += 4;
+if (channels & Channel::OBSERVER_POSITION_Z_MM) size += 4;
+if (channels & Channel::FF_MODEL_WHEEL_ANGLE_RAD) size += 4;
+if (channels & Channel::FF_MODEL_WHEEL_VEL_RAD_S) size += 4;
+if (channels & Channel::FF_MODEL_TILT_ANGLE_RAD) size += 4;
+if (channels & Channel::FF_MODEL_TILT_VEL_RAD_S) size += 4;
+if (channels & Channel::FF_MODEL_POSITION_Z_MM) size += 4;
+if (channels & Channel::CONTROL_CYCLE_US) size += 4;
+if (channels & Channel::CONTROL_PERIOD_MIN_US) size += 4;
+if (channels & Channel::CONTROL_PERIOD_MAX_US) size += 4;
+if (channels & Channel::CONTROL_PERIOD_MEAN_US) size += 4;
+if (channels & Channel::CONTROL_OVERRUNS) size += 2;
+if (channels & Channel::CONTROL_SIGNAL_U) size += 4;
+if (channels & Channel::CONTROL_SIGNAL_U_BAL) size += 4;
+if (channels & Channel::CONTROL_SIGNAL_U_POS) size += 4;
+if (channels & Channel::CONTROL_SIGNAL_U_FF) size += 4;
+if (channels & Channel::CONTROL_MOTOR) size += 2;
+if (channels & Channel::CALIBRATED) size += 1;
+if (channels & Channel::CALIBRATION_PROGRESS) size += 1;
+if (channels & Channel::PARAMETERS_CRC) size += 2;
+if (channels & Channel::PARAMETER_PROFILES_CRC) size += 2;
+if (channels & Channel::TELEMETRY_INTERVAL_MS) size += 2;
+if (channels & Channel::BAUD_RATE) size += 4;
+return size;
+}
+
+inline void TransmitInterface::sample_from_bin(const uint8_t *src) {
+this->sensor.tilt.angle_rad = bin_read<float>(src + 0);
+this->control.cycle_us = bin_read<uint32_t>(src + 4);
+this->control.signal.u = bin_read<float>(src + 8);
+this->control.motor = bin_read<int16_t>(src + 12);
+}
+
+inline void RecordInterface::from_bin(const uint8_t *src) {
+this->measurements.tilt_vel_rad_s = bin_read<float>(src + 0);
+this->measurements.tilt_angle_rad = bin_read<float>(src + 4);
+this->measurements.wheel_angle_rad = bin_read<float>(src + 8);
+this->setpoint.pos_setpoint_mm = bin_read<float>(src + 12);
+this->setpoint.control_enabled = bin_read<bool>(src + 16);
+this->reset = bin_read<bool>(src + 17);
+this->cycle_us = bin_read<uint32_t>(src + 18);
+this->u = bin_read<float>(src + 22);
+this->motor = bin_read<int16_t>(src + 26);
+}
+
+inline void ProfileInterface::from_bin(const uint8_t *src) {
+this->loop.min_us = bin_read<uint32_t>(src + 0);
+this->loop.max_us = bin_read<uint32_t>(src + 4);
+this->loop.mean_us = bin_read<uint32_t>(src + 8);
+this->loop.count = bin_read<uint16_t>(src + 12);
+this->receive.min_us = bin_read<uint32_t>(src + 14);
+this->receive.max_us = bin_read<uint32_t>(src + 18);
+this->receive.mean_us = bin_read<uint32_t>(src + 22);
+this->receive.count = bin_read<uint16_t>(src + 26);
+this->parameters.min_us = bin_read<uint32_t>(src + 28);
+this->parameters.max_us = bin_read<uint32_t>(src + 32);
+this->parameters.mean_us = bin_read<uint32_t>(src + 36);
+this->parameters.count = bin_read<uint16_t>(src + 40);
+this->telemetry.min_us = bin_read<uint32_t>(src + 42);
+this->telemetry.max_us = bin_read<uint32_t>(src + 46);
+this->telemetry.mean_us = bin_read<uint32_t>(src + 50);
+this->telemetry.count = bin_read<uint16_t>(src + 54);
+this->samples.min_us = bin_read<uint32_t>(src + 56);
+this->samples.max_us = bin_read<uint32_t>(src + 60);
+this->samples.mean_us = bin_read<uint32_t>(src + 64);
+this->samples.count = bin_read<uint16_t>(src + 68);
+this->transmit.min_us = bin_read<uint32_t>(src + 70);
+this->transmit.max_us = bin_read<uint32_t>(src + 74);
+this->transmit.mean_us = bin_read<uint32_t>(src + 78);
+this->transmit.count = bin_read<uint16_t>(src + 82);
+this->step.min_us = bin_read<uint32_t>(src + 84);
+this->step.max_us = bin_read<uint32_t>(src + 88);
+this->step.mean_us = bin_read<uint32_t>(src + 92);
+this->step.count = bin_read<uint16_t>(src + 96);
+this->mpu.min_us = bin_read<uint32_t>(src + 98);
+this->mpu.max_us = bin_read<uint32_t>(src + 102);
+this->mpu.mean_us = bin_read<uint32_t>(src + 106);
+this->mpu.count = bin_read<uint16_t>(src + 110);
+this->kernel.min_us = bin_read<uint32_t>(src + 112);
+this->kernel.max_us = bin_read<uint32_t>(src + 116);
+this->kernel.mean_us = bin_read<uint32_t>(src + 120);
+this->kernel.count = bin_read<uint16_t>(src + 124);
+this->motor.min_us = bin_read<uint32_t>(src + 126);
+this->motor.max_us = bin_read<uint32_t>(src + 130);
+this->motor.mean_us = bin_read<uint32_t>(src + 134);
+this->motor.count = bin_read<uint16_t>(src + 138);
+}
+
+}
+
+#endif
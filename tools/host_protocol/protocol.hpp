@@ -0,0 +1,159 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+/*
+Header-only library for host programs that communicate with the controller, e.g. loggers that keep up with the telemetry of every control cycle.
+The interfaces in host_interface.hpp are generated from interface.json by controller/src/communication/generate.ps1 together with the ones of the controller.
+Received bytes are split into packets by the FrameDecoder of codec.hpp, whose binary payloads are decoded by the functions below. Packets for the controller are
+encoded by encode_json_packet() of ReceiveInterface::to_json(). Besides this directory, controller/src/communication (binary.hpp) must be on the include path.
+*/
+
+#include "host_interface.hpp"
+
+namespace host {
+
+enum class DecodeResult {
+  OK,
+  WRONG_PACKET_TYPE,
+  INVALID_LENGTH,
+  CRC_MISMATCH,
+  SCHEMA_MISMATCH,  // The controller was built with code generated from another interface definition
+};
+
+inline const char *decode_result_text(DecodeResult result) {
+  switch (result) {
+    case DecodeResult::OK: return "OK";
+    case DecodeResult::WRONG_PACKET_TYPE: return "WRONG_PACKET_TYPE";
+    case DecodeResult::INVALID_LENGTH: return "INVALID_LENGTH";
+    case DecodeResult::CRC_MISMATCH: return "CRC_MISMATCH";
+    case DecodeResult::SCHEMA_MISMATCH: return "SCHEMA_MISMATCH";
+  }
+  return "UNKNOWN";
+}
+
+const size_t SCHEMA_HASH_SIZE = 4;
+const size_t EVENT_RECORD_SIZE = 1 + 2;                   // Code (1 byte) + argument (2 bytes)
+const size_t SAMPLE_BATCH_HEADER_SIZE = 4 + 4 + 1 + 1;    // Schema hash (4 bytes) + timestamp of the first sample (4 bytes) + sample count (1 byte) + dropped sample count (1 byte)
+const size_t SAMPLE_BATCH_SAMPLE_SIZE = 2 + BIN_SIZE_SAMPLE;  // Time delta to the previous sample (2 bytes) + packed sample
+const size_t RECORD_BATCH_RECORD_SIZE = 2 + BIN_SIZE_RECORD;  // Time delta to the previous record (2 bytes) + packed record
+const size_t RECORD_BATCH_HEADER_SIZE = SAMPLE_BATCH_HEADER_SIZE + 2 + 2 + 1;  // Sample batch header + parameters CRC (2 bytes) + kernel state format (2 bytes) + kernel state size (1 byte)
+
+struct EventRecord {
+  Event code;
+  uint16_t arg;
+};
+
+// Channel flags and events of a binary telemetry packet. The events refer to the frame.
+struct Telemetry {
+  TransmitInterface::ChannelFlags channels;
+  uint8_t event_count;
+  const uint8_t *events;
+
+  EventRecord event(uint8_t i) const {
+    const uint8_t *record = events + i * EVENT_RECORD_SIZE;
+    return EventRecord{ (Event)record[0], bin_read<uint16_t>(record + 1) };
+  }
+};
+
+// Samples of a sample batch packet, which refer to the frame
+struct SampleBatch {
+  uint32_t timestamp_us;  // Reference of the time delta of the first sample
+  uint8_t count;
+  uint8_t dropped;  // Samples that were dropped on the controller before this batch
+  const uint8_t *samples;
+
+  // Unpacks the members listed in FROM_DEVICE_SAMPLE of sample i into data and advances sample_timestamp_us by its time delta.
+  // Starting with timestamp_us and iterating over the samples in order yields their timestamps.
+  void sample(uint8_t i, TransmitInterface &data, uint32_t &sample_timestamp_us) const {
+    const uint8_t *sample = samples + i * SAMPLE_BATCH_SAMPLE_SIZE;
+    sample_timestamp_us += bin_read<uint16_t>(sample);
+    data.sample_from_bin(sample + 2);
+  }
+};
+
+// Records of a record batch packet, which refer to the frame. The header of a record batch continues the one of a sample batch.
+struct RecordBatch {
+  uint32_t timestamp_us;  // Reference of the time delta of the first record
+  uint8_t count;
+  uint8_t dropped;  // Samples or records that were dropped on the controller before this batch
+  uint16_t parameters_crc;  // CRC of the parameters in use when the batch was sent, c.f. parameters_crc of the transmit interface
+  uint16_t state_format;    // Number formats of the kernel of the controller, c.f. the FORMAT of the arithmetic policies in controller/src/control/kernel.hpp
+  uint8_t state_size;       // Size of the kernel state before the step of the first record (ControlKernel::save_state()), or 0 if the batch doesn't carry it
+  const uint8_t *state;
+  const uint8_t *records;
+
+  // Unpacks record i and advances record_timestamp_us by its time delta, c.f. SampleBatch::sample()
+  void record(uint8_t i, RecordInterface &data, uint32_t &record_timestamp_us) const {
+    const uint8_t *record = records + i * RECORD_BATCH_RECORD_SIZE;
+    record_timestamp_us += bin_read<uint16_t>(record);
+    data.from_bin(record + 2);
+  }
+};
+
+// Verifies the CRC and the schema hash at the start of a binary payload
+inline DecodeResult check_binary_payload(const Frame &frame, PacketType type, size_t min_length, uint32_t schema_hash) {
+  if (frame.type != type) return DecodeResult::WRONG_PACKET_TYPE;
+  if (frame.length < min_length) return DecodeResult::INVALID_LENGTH;
+  if (!frame.crc_valid()) return DecodeResult::CRC_MISMATCH;
+  if (bin_read<uint32_t>(frame.payload) != schema_hash) return DecodeResult::SCHEMA_MISMATCH;
+  return DecodeResult::OK;
+}
+
+// Unpacks the subscribed channels of a binary telemetry packet into data. The other members of data are left as they are.
+inline DecodeResult decode_telemetry(const Frame &frame, TransmitInterface &data, Telemetry &telemetry) {
+  const size_t min_length = SCHEMA_HASH_SIZE + sizeof(TransmitInterface::ChannelFlags) + 1 + CRC_SIZE;
+  const DecodeResult result = check_binary_payload(frame, BINARY_TELEMETRY_PACKET, min_length, INTERFACE_SCHEMA_HASH_TX);
+  if (result != DecodeResult::OK) return result;
+
+  telemetry.channels = bin_read<TransmitInterface::ChannelFlags>(frame.payload + SCHEMA_HASH_SIZE);
+  const size_t channels_start = SCHEMA_HASH_SIZE + sizeof(TransmitInterface::ChannelFlags);
+  const size_t channels_end = channels_start + TransmitInterface::bin_size(telemetry.channels);
+  if (channels_end + 1 + CRC_SIZE > frame.length) return DecodeResult::INVALID_LENGTH;
+  telemetry.event_count = frame.payload[channels_end];
+  telemetry.events = frame.payload + channels_end + 1;
+  if (channels_end + 1 + telemetry.event_count * EVENT_RECORD_SIZE + CRC_SIZE != frame.length) return DecodeResult::INVALID_LENGTH;
+
+  data.from_bin(frame.payload + channels_start, telemetry.channels);
+  return DecodeResult::OK;
+}
+
+inline DecodeResult decode_sample_batch(const Frame &frame, SampleBatch &batch) {
+  const DecodeResult result = check_binary_payload(frame, SAMPLE_BATCH_PACKET, SAMPLE_BATCH_HEADER_SIZE + CRC_SIZE, INTERFACE_SCHEMA_HASH_SAMPLE);
+  if (result != DecodeResult::OK) return result;
+
+  batch.timestamp_us = bin_read<uint32_t>(frame.payload + 4);
+  batch.count = frame.payload[8];
+  batch.dropped = frame.payload[9];
+  batch.samples = frame.payload + SAMPLE_BATCH_HEADER_SIZE;
+  if (SAMPLE_BATCH_HEADER_SIZE + batch.count * SAMPLE_BATCH_SAMPLE_SIZE + CRC_SIZE != frame.length) return DecodeResult::INVALID_LENGTH;
+  return DecodeResult::OK;
+}
+
+inline DecodeResult decode_record_batch(const Frame &frame, RecordBatch &batch) {
+  const DecodeResult result = check_binary_payload(frame, RECORD_BATCH_PACKET, RECORD_BATCH_HEADER_SIZE + CRC_SIZE, INTERFACE_SCHEMA_HASH_RECORD);
+  if (result != DecodeResult::OK) return result;
+
+  batch.timestamp_us = bin_read<uint32_t>(frame.payload + 4);
+  batch.count = frame.payload[8];
+  batch.dropped = frame.payload[9];
+  batch.parameters_crc = bin_read<uint16_t>(frame.payload + SAMPLE_BATCH_HEADER_SIZE);
+  batch.state_format = bin_read<uint16_t>(frame.payload + SAMPLE_BATCH_HEADER_SIZE + 2);
+  batch.state_size = frame.payload[SAMPLE_BATCH_HEADER_SIZE + 4];
+  batch.state = frame.payload + RECORD_BATCH_HEADER_SIZE;
+  batch.records = batch.state + batch.state_size;
+  if (RECORD_BATCH_HEADER_SIZE + batch.state_size + batch.count * RECORD_BATCH_RECORD_SIZE + CRC_SIZE != frame.length) return DecodeResult::INVALID_LENGTH;
+  return DecodeResult::OK;
+}
+
+inline DecodeResult decode_profile(const Frame &frame, ProfileInterface &profile) {
+  const DecodeResult result = check_binary_payload(frame, PROFILE_PACKET, SCHEMA_HASH_SIZE + BIN_SIZE_PROFILE + CRC_SIZE, INTERFACE_SCHEMA_HASH_PROFILE);
+  if (result != DecodeResult::OK) return result;
+  if (frame.length != SCHEMA_HASH_SIZE + BIN_SIZE_PROFILE + CRC_SIZE) return DecodeResult::INVALID_LENGTH;
+
+  profile.from_bin(frame.payload + SCHEMA_HASH_SIZE);
+  return DecodeResult::OK;
+}
+
+}
+
+#endif
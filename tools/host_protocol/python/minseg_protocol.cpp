@@ -0,0 +1,137 @@
+/*
+Python extension module of the frame decoder of the host protocol library, so the GUI doesn't have to search and slice the received bytes in Python.
+Usage:
+  decoder = minseg_protocol.FrameDecoder()
+  for packet in decoder.feed(data):  # Each packet is its type, sequence number and timestamp followed by the payload, like the result of BluetoothDevice.receive()
+      device.deserialize(packet)
+The module is built by the CMake project in tools if the Python development files are found.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <new>
+#include "protocol.hpp"
+
+struct FrameDecoderObject {
+  PyObject_HEAD
+  host::FrameDecoder *decoder;
+};
+
+static PyObject *FrameDecoder_new(PyTypeObject *type, PyObject *, PyObject *) {
+  FrameDecoderObject *self = (FrameDecoderObject *)type->tp_alloc(type, 0);
+  if (!self) return nullptr;
+  self->decoder = new (std::nothrow) host::FrameDecoder();
+  if (!self->decoder) {
+    Py_DECREF(self);
+    return PyErr_NoMemory();
+  }
+  return (PyObject *)self;
+}
+
+static void FrameDecoder_dealloc(FrameDecoderObject *self) {
+  delete self->decoder;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// Appends the received data and returns the list of the packets completed by it
+static PyObject *FrameDecoder_feed(FrameDecoderObject *self, PyObject *arg) {
+  Py_buffer data;
+  if (PyObject_GetBuffer(arg, &data, PyBUF_SIMPLE) != 0) return nullptr;
+  PyObject *packets = PyList_New(0);
+  const uint8_t *src = (const uint8_t *)data.buf;
+  size_t remaining = data.len;
+  while (packets) {
+    const size_t fed = self->decoder->feed(src, remaining);
+    src += fed;
+    remaining -= fed;
+
+    host::Frame frame;
+    while (self->decoder->next(frame)) {
+      const size_t stamp_size = host::PACKET_HEADER_SIZE - 4;  // The header behind the payload length
+      PyObject *packet = PyBytes_FromStringAndSize(nullptr, 1 + stamp_size + frame.length);
+      if (packet) {
+        char *dest = PyBytes_AS_STRING(packet);
+        dest[0] = frame.type;
+        memcpy(dest + 1, frame.packet + 4, stamp_size);
+        memcpy(dest + 1 + stamp_size, frame.payload, frame.length);
+      }
+      if (!packet || PyList_Append(packets, packet) != 0) Py_CLEAR(packets);
+      Py_XDECREF(packet);
+      if (!packets) break;
+    }
+    if (remaining == 0) break;
+  }
+  PyBuffer_Release(&data);
+  return packets;
+}
+
+static PyObject *FrameDecoder_skipped_bytes(FrameDecoderObject *self, void *) {
+  return PyLong_FromUnsignedLongLong(self->decoder->skipped_bytes());
+}
+
+static PyMethodDef FrameDecoder_methods[] = {
+  { "feed", (PyCFunction)FrameDecoder_feed, METH_O, "Appends received bytes and returns the completed packets, each as its type, sequence number and timestamp followed by the payload." },
+  { nullptr, nullptr, 0, nullptr },
+};
+
+static PyGetSetDef FrameDecoder_getset[] = {
+  { "skipped_bytes", (getter)FrameDecoder_skipped_bytes, nullptr, "Number of received bytes that didn't belong to a packet.", nullptr },
+  { nullptr, nullptr, nullptr, nullptr, nullptr },
+};
+
+static PyTypeObject FrameDecoderType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+static PyObject *crc16_xmodem(PyObject *, PyObject *arg) {
+  Py_buffer data;
+  if (PyObject_GetBuffer(arg, &data, PyBUF_SIMPLE) != 0) return nullptr;
+  const uint16_t crc = host::crc16_xmodem((const uint8_t *)data.buf, data.len);
+  PyBuffer_Release(&data);
+  return PyLong_FromLong(crc);
+}
+
+static PyMethodDef module_methods[] = {
+  { "crc16_xmodem", crc16_xmodem, METH_O, "CRC-16/XMODEM of the binary payloads." },
+  { nullptr, nullptr, 0, nullptr },
+};
+
+// Schema hashes don't fit in a long on every platform, which PyModule_AddIntConstant() takes
+static int add_unsigned_constant(PyObject *module, const char *name, unsigned long value) {
+  PyObject *object = PyLong_FromUnsignedLong(value);
+  if (!object) return -1;
+  if (PyModule_AddObject(module, name, object) < 0) {
+    Py_DECREF(object);
+    return -1;
+  }
+  return 0;
+}
+
+static PyModuleDef module_def = { PyModuleDef_HEAD_INIT, "minseg_protocol", "Frame decoder of the MinSeg controller protocol.", -1, module_methods };
+
+PyMODINIT_FUNC PyInit_minseg_protocol() {
+  FrameDecoderType.tp_name = "minseg_protocol.FrameDecoder";
+  FrameDecoderType.tp_basicsize = sizeof(FrameDecoderObject);
+  FrameDecoderType.tp_flags = Py_TPFLAGS_DEFAULT;
+  FrameDecoderType.tp_doc = "Streaming decoder of the packets received from the controller.";
+  FrameDecoderType.tp_new = FrameDecoder_new;
+  FrameDecoderType.tp_dealloc = (destructor)FrameDecoder_dealloc;
+  FrameDecoderType.tp_methods = FrameDecoder_methods;
+  FrameDecoderType.tp_getset = FrameDecoder_getset;
+  if (PyType_Ready(&FrameDecoderType) < 0) return nullptr;
+
+  PyObject *module = PyModule_Create(&module_def);
+  if (!module) return nullptr;
+  Py_INCREF(&FrameDecoderType);
+  if (PyModule_AddObject(module, "FrameDecoder", (PyObject *)&FrameDecoderType) < 0) {
+    Py_DECREF(&FrameDecoderType);
+    Py_DECREF(module);
+    return nullptr;
+  }
+  if (add_unsigned_constant(module, "INTERFACE_SCHEMA_HASH_TX", INTERFACE_SCHEMA_HASH_TX) < 0
+      || add_unsigned_constant(module, "INTERFACE_SCHEMA_HASH_SAMPLE", INTERFACE_SCHEMA_HASH_SAMPLE) < 0
+      || add_unsigned_constant(module, "INTERFACE_SCHEMA_HASH_RECORD", INTERFACE_SCHEMA_HASH_RECORD) < 0
+      || add_unsigned_constant(module, "INTERFACE_SCHEMA_HASH_PROFILE", INTERFACE_SCHEMA_HASH_PROFILE) < 0) {
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
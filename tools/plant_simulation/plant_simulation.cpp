@@ -0,0 +1,170 @@
+/*
+Host side closed loop simulation of the controller with the plant model.
+
+The control step of the controller (ControlStep in controller/src/control/step.hpp) is built natively and runs against a simulation HAL instead of the MinSeg hardware.
+The HAL measures the discrete plant model of data/model with the encoder resolution and MPU noise, and applies the motor PWM value as voltage to the plant.
+Each parameter set is loaded through the generated ReceiveInterface the same way the controller does it and simulated with the fixed point kernel
+and the single precision floating point kernel (which is what double means on AVR). Both variants control a plant of their own in closed loop.
+
+The scenario starts with a tilted robot, which has to balance and then follow a position setpoint step. The results are printed per parameter set and arithmetic:
+whether the robot fell, the RMS tilt angle, the position error at the end, the maximum control signal and the number of saturated cycles.
+A simulated motor deadzone in PWM steps can be given by --deadzone, so the deadzone compensation of a parameter set takes effect.
+
+Build with the CMake project in tools and run from the repository root (requires the ArduinoJson submodule):
+  cmake -S tools -B tools/build && cmake --build tools/build
+  tools/build/plant_simulation [--cycles N] [--deadzone PWM] data/model data/parameters/opti_with_i_with_ff.json ...
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "interface.hpp"
+#include "model_files.hpp"
+#include "step.hpp"
+
+const double ENCODER_RAD_PER_COUNT = 0.5 * M_PI / 180;  // Resolution of the wheel encoder, c.f. ENC_RAD_PER_COUNT in controller/src/encoder.hpp
+const double MPU_NOISE_AMPLITUDE = 1e-3;
+const double FALLEN_TILT_ANGLE_RAD = 0.5;
+const int DEFAULT_SIMULATION_CYCLES = 5000;
+const int SETPOINT_STEP_CYCLE = 1000;
+const double SETPOINT_STEP_MM = 100;
+const double INITIAL_TILT_ANGLE_RAD = 0.02;
+
+typedef ControlStep<FixedPointArithmetic<CONTROL_COEFF_FRAC_BITS, CONTROL_SIGNAL_FRAC_BITS>> FixedPointStep;
+typedef ControlStep<FloatingPointArithmetic<float>> SinglePrecisionStep;
+
+// Simulated hardware of the control step, c.f. controller/src/control/hal.hpp. The plant advances by one sampling time whenever the motor is actuated.
+class SimulationHal {
+  const PlantModel &model;
+  uint8_t deadzone_pwm;
+  uint32_t noise_state = 1;
+
+  // Deterministic pseudo random numbers in [-1, 1]
+  double noise() {
+    noise_state = noise_state * 1664525UL + 1013904223UL;
+    return 2.0 * noise_state / UINT32_MAX - 1;
+  }
+
+public:
+  double x[4] = { 0, INITIAL_TILT_ANGLE_RAD, 0, 0 };
+  double pos_setpoint_mm = 0;
+  double voltage = 0;  // Voltage applied to the plant in the last cycle
+
+  SimulationHal(const PlantModel &model, uint8_t deadzone_pwm)
+    : model(model), deadzone_pwm(deadzone_pwm) {}
+
+  ControlMeasurements measure() {
+    double y[3];
+    for (int i = 0; i < 3; i++) {
+      y[i] = 0;
+      for (int j = 0; j < 4; j++) y[i] += model.c[i][j] * x[j];
+    }
+    return ControlMeasurements{ y[0] + MPU_NOISE_AMPLITUDE * noise(), y[1] + MPU_NOISE_AMPLITUDE * noise(), std::floor(y[2] / ENCODER_RAD_PER_COUNT) * ENCODER_RAD_PER_COUNT };
+  }
+
+  ControlSetpoint setpoint() const {
+    return ControlSetpoint{ pos_setpoint_mm, true };
+  }
+
+  // The motor doesn't turn below deadzone_pwm and the remaining range is mapped to the full voltage
+  void actuate(int16_t motor_val) {
+    const int magnitude = std::abs(motor_val);
+    voltage = magnitude <= deadzone_pwm ? 0 : (motor_val < 0 ? -1 : 1) * MOTOR_SATURATION_V * (magnitude - deadzone_pwm) / (double)(UINT8_MAX - deadzone_pwm);
+
+    double x_next[4];
+    for (int i = 0; i < 4; i++) {
+      x_next[i] = model.gamma[i][0] * voltage;
+      for (int j = 0; j < 4; j++) x_next[i] += model.phi[i][j] * x[j];
+    }
+    for (int i = 0; i < 4; i++) x[i] = x_next[i];
+  }
+};
+
+struct SimulationResult {
+  int cycles = 0;
+  bool fallen = false;
+  double tilt_rms_rad = 0;
+  double position_error_mm = 0;
+  double u_max = 0;
+  int saturated_cycles = 0;
+};
+
+template<typename Step>
+static SimulationResult simulate(const ReceiveInterface &rx, const PlantModel &model, int cycles, uint8_t deadzone_pwm) {
+  Step control;
+  control.kernel.parameters.compile(rx.parameters, model.h_s);
+  SimulationHal hal(model, deadzone_pwm);
+
+  SimulationResult result;
+  double tilt_square_sum = 0;
+  for (; result.cycles < cycles; result.cycles++) {
+    hal.pos_setpoint_mm = result.cycles >= SETPOINT_STEP_CYCLE ? SETPOINT_STEP_MM : 0;
+    control.run(hal);
+
+    tilt_square_sum += hal.x[1] * hal.x[1];
+    result.u_max = std::fmax(result.u_max, std::fabs(control.u));
+    if (std::abs(control.motor_val) == UINT8_MAX) result.saturated_cycles++;
+    if (std::fabs(hal.x[1]) >= FALLEN_TILT_ANGLE_RAD) {
+      result.fallen = true;
+      result.cycles++;
+      break;
+    }
+  }
+  result.tilt_rms_rad = std::sqrt(tilt_square_sum / result.cycles);
+  result.position_error_mm = -hal.x[3] * WHEEL_RAD_TO_MM - hal.pos_setpoint_mm;
+  return result;
+}
+
+static void print_result(const char *arithmetic, const SimulationResult &result) {
+  std::printf("  %-6s %5d cycles%s  rms tilt %.2e rad  position error %8.2f mm  max|u| %7.3f V  saturated %4d cycles\n",
+              arithmetic, result.cycles, result.fallen ? " (fallen)" : "         ", result.tilt_rms_rad, result.position_error_mm, result.u_max, result.saturated_cycles);
+}
+
+static bool run(const std::string &path, const PlantModel &model, int cycles, uint8_t deadzone_pwm) {
+  ReceiveInterface rx;
+  if (!read_parameters(path, rx)) return false;
+
+  std::printf("%s", path.c_str());
+  const uint16_t h_ms = rx.parameters.variable.General.h_ms;
+  if (h_ms != 0 && std::fabs(h_ms * 1e-3 - model.h_s) > 1e-9) std::printf(" (designed for h = %u ms, simulated with the model's h = %g ms)", h_ms, model.h_s * 1e3);
+  std::printf("\n");
+  print_result("fixed", simulate<FixedPointStep>(rx, model, cycles, deadzone_pwm));
+  print_result("float", simulate<SinglePrecisionStep>(rx, model, cycles, deadzone_pwm));
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int cycles = DEFAULT_SIMULATION_CYCLES;
+  int deadzone_pwm = 0;
+  int arg = 1;
+  for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+    if (std::strcmp(argv[arg], "--cycles") == 0) cycles = std::atoi(argv[arg + 1]);
+    else if (std::strcmp(argv[arg], "--deadzone") == 0) deadzone_pwm = std::atoi(argv[arg + 1]);
+    else break;
+  }
+  if (argc - arg < 2 || cycles <= 0 || deadzone_pwm < 0 || deadzone_pwm >= UINT8_MAX) {
+    std::printf("Usage: %s [--cycles N] [--deadzone PWM] <model directory> <parameter files...>\n", argv[0]);
+    return 2;
+  }
+
+  PlantModel model;
+  if (!read_plant_model(argv[arg], model)) {
+    std::printf("Could not read the plant model from %s\n", argv[arg]);
+    return 2;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  bool loaded = true;
+  int simulations = 0;
+  for (int i = arg + 1; i < argc; i++) {
+    loaded &= run(argv[i], model, cycles, deadzone_pwm);
+    simulations += 2;
+  }
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("Simulated %.0f s in %.3f s of wall time\n", simulations * cycles * model.h_s, wall_s);
+  return loaded ? 0 : 2;
+}
@@ -0,0 +1,259 @@
+/*
+Offline replay of control steps recorded on the controller.
+
+With recording switched on (e.g. by frame_logger --record), the controller sends the inputs and outputs of every control step at the boundary of its HAL in record batches:
+the measurements, the setpoint, whether the step reset the kernel, the measured cycle time, the control signal and the motor PWM value.
+The tilt angle is fused from the MPU samples on the controller (c.f. controller/src/mpu.hpp), so the records hold the fused measurements rather than the raw sensor values.
+A recording usually starts in the middle of a run, so the first record of a recording carries the kernel state its step started from (observer, feedforward model, integral action
+and their rounding residues), and so does the record after one was dropped. The batches also carry the CRC of the parameters in use, which is compared with the one of each parameter file.
+
+The record batches of a log are decoded and fed through the control step (ControlStep in controller/src/control/step.hpp) by a replay HAL for each parameter set, with the fixed point
+kernel and the single precision floating point kernel. The kernel is resumed from each recorded state, which is converted if it was recorded with the other arithmetic.
+Records that don't follow from a state, i.e. before the first one and after packets were lost, are skipped. The arithmetic the controller was built with thus reproduces the recorded
+outputs exactly for the parameter file whose CRC matches, and the effect of other parameters or arithmetics on the same inputs can be studied without the robot.
+The results are printed per parameter set and arithmetic: the number of cycles whose motor PWM value differs, the maximum deviation of the control signal and the skipped records.
+
+Build with the CMake project in tools and run from the repository root (requires the ArduinoJson submodule):
+  cmake -S tools -B tools/build && cmake --build tools/build
+  tools/build/replay run.log data/parameters/opti_with_i_with_ff.json ...
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "interface.hpp"
+#include "model_files.hpp"
+#include "period.hpp"
+#include "protocol.hpp"
+#include "step.hpp"
+
+const size_t READ_CHUNK_SIZE = 4096;
+
+typedef FixedPointArithmetic<CONTROL_COEFF_FRAC_BITS, CONTROL_SIGNAL_FRAC_BITS> FixedArithmetic;
+typedef FloatingPointArithmetic<float> SinglePrecisionArithmetic;  // What double means on AVR
+typedef ControlStep<FixedArithmetic> FixedPointStep;
+typedef ControlStep<SinglePrecisionArithmetic> SinglePrecisionStep;
+
+struct KernelState {
+  uint16_t format;  // FORMAT of the arithmetic of the controller
+  std::vector<uint8_t> data;
+};
+
+struct LoggedRecord {
+  host::RecordInterface data;
+  uint32_t timestamp_us;
+  int state = -1;    // Index of the kernel state the step started from, or -1
+  bool gap = false;  // Records may be missing before this one
+};
+
+struct RecordLog {
+  std::vector<LoggedRecord> records;
+  std::vector<KernelState> states;
+  std::vector<uint16_t> parameters_crcs;  // Distinct CRCs of the parameters in use while recording
+  uint64_t dropped = 0;   // Records dropped on the controller
+  uint64_t rejected = 0;  // Record batches that didn't decode
+};
+
+static bool read_records(const char *path, RecordLog &log) {
+  std::FILE *input = std::fopen(path, "rb");
+  if (!input) return false;
+
+  static host::FrameDecoder decoder;
+  bool sequence_valid = false;
+  uint16_t last_sequence = 0;
+  bool lost = false;  // Packets were lost since the last record batch, which may have been record batches
+  while (true) {
+    uint8_t *dest = decoder.write_pointer();
+    const size_t read = std::fread(dest, 1, std::min(decoder.write_space(), READ_CHUNK_SIZE), input);
+    if (read == 0) break;
+    decoder.commit(read);
+
+    host::Frame frame;
+    while (decoder.next(frame)) {
+      if (sequence_valid && frame.sequence != (uint16_t)(last_sequence + 1)) lost = true;
+      sequence_valid = true;
+      last_sequence = frame.sequence;
+      if (frame.type != host::RECORD_BATCH_PACKET) continue;
+
+      host::RecordBatch batch;
+      if (host::decode_record_batch(frame, batch) != host::DecodeResult::OK) {
+        log.rejected++;
+        lost = true;
+        continue;
+      }
+      log.dropped += batch.dropped;
+      if (std::find(log.parameters_crcs.begin(), log.parameters_crcs.end(), batch.parameters_crc) == log.parameters_crcs.end()) log.parameters_crcs.push_back(batch.parameters_crc);
+
+      uint32_t timestamp_us = batch.timestamp_us;
+      for (uint8_t i = 0; i < batch.count; i++) {
+        LoggedRecord record;
+        batch.record(i, record.data, timestamp_us);
+        record.timestamp_us = timestamp_us;
+        if (i == 0) {
+          record.gap = lost || batch.dropped > 0;
+          if (batch.state_size > 0) {
+            record.state = log.states.size();
+            log.states.push_back(KernelState{ batch.state_format, std::vector<uint8_t>(batch.state, batch.state + batch.state_size) });
+          }
+        }
+        log.records.push_back(record);
+      }
+      lost = false;
+    }
+  }
+  std::fclose(input);
+  return true;
+}
+
+// CRC of the parameters as the controller calculates it when storing them, c.f. ParameterStorage of controller/src/storage.hpp
+static uint16_t parameters_crc(const ReceiveInterface &rx) {
+  uint8_t image[4 + BIN_SIZE_PERSISTENT];
+  bin_write<uint32_t>(image, INTERFACE_SCHEMA_HASH_PERSISTENT);
+  rx.persistent_to_bin(image + 4);
+  return host::crc16_xmodem(image, sizeof(image));
+}
+
+// Resumes the kernel from a state recorded with the Source arithmetic. The states are converted via double, so the rounding residues start from zero.
+template<typename Arithmetic, typename Source>
+static bool convert_state(ControlKernel<Arithmetic> &kernel, const KernelState &state) {
+  if (state.format != Source::FORMAT || state.data.size() != ControlKernel<Source>::STATE_SIZE) return false;
+  ControlKernel<Source> source;
+  source.load_state(state.data.data());
+  for (uint8_t i = 0; i < 4; i++) {
+    kernel.x[i] = Arithmetic::signal(Source::to_double(source.x[i]));
+    kernel.x_m[i] = Arithmetic::signal(Source::to_double(source.x_m[i]));
+    kernel.x_residue[i] = typename ControlKernel<Arithmetic>::Residue();
+    kernel.x_m_residue[i] = typename ControlKernel<Arithmetic>::Residue();
+  }
+  kernel.xi = typename ControlKernel<Arithmetic>::Accumulator();
+  kernel.xi.mac(Arithmetic::coefficient(1), Arithmetic::signal(Source::to_double(source.xi.result())));
+  return true;
+}
+
+// Resumes the kernel from a recorded state, which is loaded as it is if it was recorded with the same arithmetic. Returns false if the format is unknown.
+template<typename Arithmetic>
+static bool resume(ControlKernel<Arithmetic> &kernel, const KernelState &state) {
+  if (state.format == Arithmetic::FORMAT && state.data.size() == ControlKernel<Arithmetic>::STATE_SIZE) {
+    kernel.load_state(state.data.data());
+    return true;
+  }
+  return convert_state<Arithmetic, FixedArithmetic>(kernel, state) || convert_state<Arithmetic, SinglePrecisionArithmetic>(kernel, state);
+}
+
+// Replayed hardware of the control step, c.f. controller/src/control/hal.hpp. Measures the current record and keeps the motor PWM value of the step.
+class ReplayHal {
+  const host::RecordInterface *record = nullptr;
+
+public:
+  int16_t motor_val = 0;
+
+  void set_record(const host::RecordInterface &r) {
+    record = &r;
+  }
+
+  ControlMeasurements measure() const {
+    return ControlMeasurements{ record->measurements.tilt_vel_rad_s, record->measurements.tilt_angle_rad, record->measurements.wheel_angle_rad };
+  }
+
+  ControlSetpoint setpoint() const {
+    return ControlSetpoint{ record->setpoint.pos_setpoint_mm, record->setpoint.control_enabled };
+  }
+
+  void actuate(int16_t val) {
+    motor_val = val;
+  }
+};
+
+struct ReplayResult {
+  size_t cycles = 0;
+  size_t skipped = 0;  // Records that don't follow from a recorded state
+  size_t motor_mismatches = 0;
+  double u_deviation_max = 0;
+};
+
+template<typename Step>
+static ReplayResult replay(const ReceiveInterface &rx, const RecordLog &log) {
+  Step control;
+  control.kernel.parameters.compile(rx.parameters, control_period_ms(rx.parameters.variable.General.h_ms) * 1e-3);  // The sampling time of the controller, c.f. control_scheduler.period_ms()
+  ReplayHal hal;
+
+  ReplayResult result;
+  bool resumed = false;
+  for (const LoggedRecord &record : log.records) {
+    if (record.state >= 0) resumed = resume(control.kernel, log.states[record.state]);  // The state was saved after the reset of the step
+    else if (record.gap) resumed = false;
+    else if (resumed && record.data.reset) control.kernel.reset_model();
+    if (!resumed) {
+      result.skipped++;
+      continue;
+    }
+    hal.set_record(record.data);
+    control.run(hal);
+
+    result.cycles++;
+    if (hal.motor_val != record.data.motor) result.motor_mismatches++;
+    result.u_deviation_max = std::fmax(result.u_deviation_max, std::fabs(control.u - record.data.u));
+  }
+  return result;
+}
+
+static void print_result(const char *arithmetic, const ReplayResult &result) {
+  std::printf("  %-6s motor mismatch %6zu of %zu cycles  max|u - u_recorded| %.3e V  skipped %zu records\n", arithmetic, result.motor_mismatches, result.cycles, result.u_deviation_max,
+              result.skipped);
+}
+
+static bool run(const std::string &path, const RecordLog &log) {
+  ReceiveInterface rx;
+  if (!read_parameters(path, rx)) return false;
+
+  const uint16_t crc = parameters_crc(rx);
+  const bool recorded = std::find(log.parameters_crcs.begin(), log.parameters_crcs.end(), crc) != log.parameters_crcs.end();
+  std::printf("%s (CRC 0x%04X%s)\n", path.c_str(), crc, recorded ? ", recorded with these parameters" : "");
+  print_result("fixed", replay<FixedPointStep>(rx, log));
+  print_result("float", replay<SinglePrecisionStep>(rx, log));
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::printf("Usage: %s <log file> <parameter files...>\n", argv[0]);
+    return 2;
+  }
+
+  RecordLog log;
+  if (!read_records(argv[1], log)) {
+    std::printf("Could not read %s\n", argv[1]);
+    return 2;
+  }
+  if (log.records.empty()) {
+    std::printf("No records in %s, was it logged with frame_logger --record?\n", argv[1]);
+    return 2;
+  }
+
+  uint32_t cycle_min_us = UINT32_MAX, cycle_max_us = 0;
+  for (const LoggedRecord &record : log.records) {
+    cycle_min_us = std::min(cycle_min_us, record.data.cycle_us);
+    cycle_max_us = std::max(cycle_max_us, record.data.cycle_us);
+  }
+  const double duration_s = (uint32_t)(log.records.back().timestamp_us - log.records.front().timestamp_us) * 1e-6;
+  std::printf("%zu records over %.3f s, cycle %u - %u us, %zu kernel states, %llu dropped, %llu batches rejected\n", log.records.size(), duration_s, cycle_min_us, cycle_max_us,
+              log.states.size(), (unsigned long long)log.dropped, (unsigned long long)log.rejected);
+  std::printf("Recorded with the parameters of CRC");
+  for (uint16_t crc : log.parameters_crcs) std::printf(" 0x%04X", crc);
+  std::printf("\n");
+
+  const auto start = std::chrono::steady_clock::now();
+  bool loaded = true;
+  int replays = 0;
+  for (int i = 2; i < argc; i++) {
+    loaded &= run(argv[i], log);
+    replays += 2;
+  }
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("Replayed %.3f s in %.3f s of wall time\n", replays * duration_s, wall_s);
+  return loaded ? 0 : 2;
+}